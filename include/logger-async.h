@@ -0,0 +1,113 @@
+/*
+ * libniftylog - niftylight logging library
+ * Copyright (C) 2006-2014 Daniel Hiepler <daniel@niftylight.de>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/**
+ * @file logger-async.h
+ */
+
+/**
+ * @addtogroup logger
+ * @{ 
+ * @defgroup logger_async Asynchronous logging
+ * @brief API to move output of log-messages to a background thread
+ * 
+ * By default, the current @ref NftLogMechanism is called synchronously from
+ * the thread that logs a message. In asynchronous mode, messages are
+ * pushed to a lock-free ring-buffer instead and a background thread 
+ * writes them using the current @ref NftLogMechanism.
+ *
+ * Asynchronous mode is enabled either by @ref nft_log_async_enable() or
+ * by setting the NFT_LOG_ASYNC environment variable to the name of a 
+ * @ref NftLogAsyncPolicy, optionally followed by the amount of ring-buffer
+ * slots (e.g. NFT_LOG_ASYNC="drop:4096").
+ *
+ * With @ref nft_log_async_defer() (or by appending ":deferred", e.g. 
+ * NFT_LOG_ASYNC="block:4096:deferred"), the logging thread doesn't even 
+ * format the message. It only copies the constant format string pointer, 
+ * the call-site and the raw arguments (strings are copied). Formatting 
+ * happens in the background thread.
+ *
+ * All pending messages are written upon exit.
+ * @{
+ */
+
+#ifndef _NFT_LOG_ASYNC_H
+#define _NFT_LOG_ASYNC_H
+
+#include "logger.h"
+
+
+/** default amount of ring-buffer slots */
+#define NFT_LOG_ASYNC_DEFAULT_SLOTS     1024
+
+
+/** what to do when the ring-buffer is full */
+typedef enum
+{
+        /** <b>"off"</b> - asynchronous logging is disabled */
+        NFT_LOG_ASYNC_OFF = 0,
+        /** <b>"block"</b> - wait until there's room for the new message */
+        NFT_LOG_ASYNC_BLOCK,
+        /** <b>"drop"</b> - drop the new message */
+        NFT_LOG_ASYNC_DROP,
+        /** <b>"overwrite"</b> - drop the oldest message to make room for the new one */
+        NFT_LOG_ASYNC_OVERWRITE,
+} NftLogAsyncPolicy;
+
+
+
+NftResult                       nft_log_async_enable(NftLogAsyncPolicy policy, size_t slots);
+void                            nft_log_async_disable();
+void                            nft_log_async_flush();
+void                            nft_log_async_defer(bool defer);
+NftLogAsyncPolicy               nft_log_async_policy();
+uint64_t                        nft_log_async_dropped();
+
+
+#endif /* _NFT_LOG_ASYNC_H */
+
+
+/**
+ * @}
+ * @}
+ */
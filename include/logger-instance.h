@@ -0,0 +1,111 @@
+/*
+ * libniftylog - niftylight logging library
+ * Copyright (C) 2006-2014 Daniel Hiepler <daniel@niftylight.de>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/**
+ * @file logger-instance.h
+ */
+
+/**
+ * @addtogroup logger
+ * @{ 
+ * @defgroup logger_instance Logger instances
+ * @brief API for named loggers with their own level and mechanisms
+ * 
+ * Loggers are named hierarchically with dots, e.g. "niftyled.hw.spi" is a
+ * child of "niftyled.hw" which is a child of "niftyled". Every logger 
+ * inherits level and mechanisms from its nearest ancestor that has them
+ * set. The root logger ("" or NULL) is the one used by NFT_LOG(), its 
+ * level and mechanisms are the ones set by @ref nft_log_level_set() and 
+ * @ref nft_log_mechanism_set().
+ *
+ * The effective level of every logger is cached when the configuration 
+ * changes, so checking it is O(1) on the logging path. Loggers are 
+ * created on first use and live until the process exits, so the result 
+ * of @ref nft_logger_get() can be kept in a static variable.
+ *
+ * <b>Example:</b>
+ * @code
+ * NftLogger *log = nft_logger_get("niftyled.hw.spi");
+ * nft_logger_level_set(log, L_DEBUG);
+ * nft_logger_mechanism_set(log, "file");
+ * NFT_LOGGER_LOG(log, L_DEBUG, "transferred %d bytes", n);
+ * @endcode
+ * @{
+ */
+
+#ifndef _NFT_LOG_INSTANCE_H
+#define _NFT_LOG_INSTANCE_H
+
+#include "logger.h"
+
+
+/** hierarchical logger (s. @ref nft_logger_get()) */
+typedef struct _NftLogger NftLogger;
+
+
+/** convenience macro for nft_logger_site() (like NFT_LOG() for a certain @ref NftLogger) \n
+ * <b>Example:</b> NFT_LOGGER_LOG(logger, L_INFO, "Reading config file \"%s\"...", config); 
+ */
+#define NFT_LOGGER_LOG($logger, $level, $msg, ...) do { NftLogger *_nft_logger = ($logger); const NftLoglevel _nft_log_l = ($level); if(_NFT_LOG_COMPILED($level, _nft_log_l)) { static NftLogSite _nft_log_site _NFT_LOG_SITE_ATTR = _NFT_LOG_SITE_INIT($level, $msg); if(nft_logger_site_is_enabled(_nft_logger, &_nft_log_site, _nft_log_l)) nft_logger_site(_nft_logger, &_nft_log_site, _nft_log_l, $msg, ##__VA_ARGS__); } } while(0)
+
+
+
+NftLogger                      *nft_logger_get(const char *name);
+const char                     *nft_logger_name(NftLogger * logger);
+NftLogger                      *nft_logger_parent(NftLogger * logger);
+NftResult                       nft_logger_level_set(NftLogger * logger, NftLoglevel level);
+NftLoglevel                     nft_logger_level_get(NftLogger * logger);
+NftResult                       nft_logger_mechanism_set(NftLogger * logger, const char *spec);
+bool                            nft_logger_is_enabled(NftLogger * logger, NftLoglevel level);
+bool                            nft_logger_site_is_enabled(NftLogger * logger, NftLogSite * site, NftLoglevel level);
+void                            nft_logger_site(NftLogger * logger, NftLogSite * site, NftLoglevel level, const char *msg, ...);
+void                            nft_logger_log(NftLogger * logger, NftLoglevel level, const char *file, const char *func, int line, const char *msg, ...);
+
+
+#endif /* _NFT_LOG_INSTANCE_H */
+
+
+/**
+ * @}
+ * @}
+ */
@@ -57,6 +57,12 @@
  * A list of available logging mechanisms is printed on stdout either by calling
  * @ref nft_log_mechanism_print_list() or by setting NFT_LOG_MECHANISM="list"
  *
+ * Several mechanisms can be active at once, each with its own minimum 
+ * @ref NftLoglevel, e.g. NFT_LOG_MECHANISM="syslog:error,file:debug,stderr".
+ * Mechanisms without level use the level set by @ref nft_log_level_set(). 
+ * Messages are filtered by the most verbose level any mechanism wants and 
+ * formatted only once for all mechanisms.
+ *
  * Each logging mechanism may use own NFT_LOG_... environment variables for
  * configuration.
  * 
@@ -67,12 +73,22 @@
  *   mechanism.c:nft_log_mechanisms structure
  * - implement all needed functions described by the @ref NftLogMechanism descriptor
  *   (any function can be NULL if it's not needed)
+ *
+ * Mechanisms that store messages in their own format (e.g. "binary") can
+ * provide a record() function. It receives an @ref NftLogRecord with the
+ * unformatted message (format string and captured arguments) instead of 
+ * the formatted text for all NFT_LOG() statements. Only messages from 
+ * other sources (e.g. nft_log()) are still passed to log(). The format 
+ * string is only guaranteed to stay valid beyond the call if it equals 
+ * the format of the call-site (i.e. it is constant).
  * @{
  */
 
 #ifndef _NFT_LOG_MECHANISM_H
 #define _NFT_LOG_MECHANISM_H
 
+#include <stdint.h>
+#include <stddef.h>
 #include "logger.h"
 
 
@@ -80,13 +96,46 @@
 #define NFT_LOG_DEFAULT_MECHANISM	"stderr"
 
 
+/** unformatted log-message */
+typedef struct
+{
+        /** @ref NftLoglevel of message */
+        NftLoglevel                     level;
+        /** call-site that logged this message */
+        const NftLogSite               *site;
+        /** format string (same as site->format if that's constant) */
+        const char                     *format;
+        /** arguments captured in their native binary representation */
+        const char                     *args;
+        /** size of args in bytes */
+        size_t                          args_len;
+        /** time of logging (nanoseconds since epoch) */
+        uint64_t                        time;
+        /** thread that logged this message */
+        unsigned long                   tid;
+        /** thread info of logging thread ("[tid name] ", NULL if the
+            calling thread logged this message) */
+        const char                     *thread;
+        /** fields of structured message (format is the plain message then,
+            s. @ref NFT_LOG_KV()) */
+        const NftLogKv                 *kv;
+        /** amount of fields */
+        size_t                          kv_count;
+        /** 1 in how many messages of the call-site is logged (0 if not 
+            sampled, s. @ref nft_log_sample_set()) */
+        unsigned int                    weight;
+} NftLogRecord;
+
+
 /** logging mechanism descriptor */
 typedef struct
 {
         /** name of this mechanism */
         const char                      name[64];
-        /** logging function of this mechanism */
-        void                            (*log) (NftLoglevel level, const char *msg);
+        /** logging function of this mechanism (msg is \0 terminated, len is strlen(msg)) */
+        void                            (*log) (NftLoglevel level, const char *msg, size_t len);
+        /** logging function for unformatted messages (optional) */
+        void                            (*record) (const NftLogRecord * record);
         /** initialization function of this mechanism */
         NftResult                       (*init) (void);
         /** deinitialization function of this mechanism */
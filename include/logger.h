@@ -52,17 +52,66 @@
  *   supressed. You should do this initially to set the default @ref NftLoglevel.
  *   (@ref L_INFO or @ref L_ERROR would be a wise choice for example) 
  * - use @ref nft_log_level_get() to acquire the currently used @ref NftLoglevel
+ * - every NFT_LOG() statement has a static @ref NftLogSite. A disabled 
+ *   statement costs one load & branch and doesn't evaluate its arguments.
+ *   Use @ref nft_log_sites_print() or @ref nft_log_sites_foreach() to list
+ *   all call-sites and @ref nft_log_sites_mode_set() to switch them on/off 
+ *   at runtime
+ * - use @ref nft_log_level_is_enabled() to cheaply find out if a message of a
+ *   certain @ref NftLoglevel would be printed at all
+ * - the NFT_LOG_LEVEL environment variable is read once. Use 
+ *   @ref nft_log_level_reload() to re-read it after changing it at runtime.
+ *   Besides a level name, it can hold a comma separated list of a default 
+ *   level and "pattern=level" rules for source files, e.g. 
+ *   NFT_LOG_LEVEL="warning,src/hw/\*=debug,render.c=noisy". Patterns 
+ *   ('*' and '?' wildcards) are matched against __FILE__ or any part of it
+ *   following a '/', the last matching rule wins. Rules are resolved once
+ *   per NFT_LOG() call-site and cached until the specification changes.
  * - use @ref NFT_LOG() to output printable strings to the user. \n
+ * - use @ref NFT_LOG_KV() to log a message with typed key/value fields 
+ *   (e.g. NFT_KV_INT("strip", 3)) instead of printing them into the text
  * - use @ref nft_log_level_to_string() and nft_log_level_from_string() to 
  *   convert between @ref NftLoglevel and their printable names
  * - a list of all loglevels can conveniently printed to stdout using
  *   @ref nft_log_print_loglevels()
  * - to compare two @ref NftLoglevel, the @ref nft_log_level_is_noisier_than()
  *   function can be used
+ * - use @ref nft_log_timestamp_set() or the NFT_LOG_TIMESTAMP environment 
+ *   variable to print a timestamp in front of every message. The date & time
+ *   part is formatted once per second and thread, only the fraction of the
+ *   second is printed per message
+ * - use @ref nft_log_clock_set() or the NFT_LOG_CLOCK environment variable
+ *   to take the time of messages from the CPU timestamp counter. Raw ticks
+ *   are stored and converted to wall-clock time (calibrated against the
+ *   system clocks) by whoever writes the message.
+ * - use @ref nft_log_thread_set() or the NFT_LOG_THREAD environment variable
+ *   to print id and/or name of the logging thread after the timestamp. Each
+ *   thread looks them up once, @ref nft_log_thread_name_set() names a thread
+ *   for logging only.
+ * - use @ref nft_log_output_set() or the NFT_LOG_OUTPUT environment variable
+ *   to pass one JSON object per message to text mechanisms (e.g. stderr or 
+ *   file) instead of a line of text: level, timestamp & thread (if enabled),
+ *   file, line, func, fields of @ref NFT_LOG_KV() and the message
+ * - use @ref nft_log_ratelimit_set() or the NFT_LOG_RATELIMIT environment 
+ *   variable to limit how many messages of a level each call-site may log
+ *   per second, @ref NFT_LOG_RATELIMITED() sets the limit of a single 
+ *   call-site. Dropped messages aren't formatted, "suppressed N messages" 
+ *   is logged before the next message that passes or, if the call-site 
+ *   stays quiet, once its limit allows messages again (and upon exit).
+ * - use @ref nft_log_dedup_set() or the NFT_LOG_DEDUP environment variable
+ *   to collapse messages that repeat one of the last few messages (same 
+ *   level & text) into "last message repeated N times: ..." lines
+ * - use @ref nft_log_sample_set() or the NFT_LOG_SAMPLE environment 
+ *   variable (e.g. NFT_LOG_SAMPLE="noisy=1/1000") to log only a random 
+ *   1 in N messages of a level, @ref NFT_LOG_SAMPLED() samples a single 
+ *   call-site. Logged messages carry N as weight to scale counts up again.
  * 
- * Messages are logged using the default mechanism (stderr). A custom
- * @ref NftLogFunc can be registered using @ref nft_log_func_register() to enable
- * the application to process logging messages additionally (e.g. to log to a GUI)
+ * Messages are logged using the default mechanism (stderr). To process
+ * messages additionally (e.g. to log to a GUI), any number of 
+ * @ref NftLogSubscriber functions can be registered with 
+ * @ref nft_log_subscribe(). Each gets an @ref NftLogMessage for every 
+ * message with a level in its level mask. (The older 
+ * @ref nft_log_func_register() registers a single @ref NftLogFunc.)
  *
  * Other convenience macros include:
  * - \ref NFT_LOG_PERROR("foo") - output perror("foo") using the logging mechanism
@@ -86,6 +135,22 @@
 #define NFT_LOG_ENV_LEVEL         "NFT_LOG_LEVEL"
 /** name of environment variable to hold mechanism */
 #define NFT_LOG_ENV_MECHANISM     "NFT_LOG_MECHANISM"
+/** name of environment variable to enable asynchronous logging */
+#define NFT_LOG_ENV_ASYNC         "NFT_LOG_ASYNC"
+/** name of environment variable to hold timestamp mode */
+#define NFT_LOG_ENV_TIMESTAMP     "NFT_LOG_TIMESTAMP"
+/** name of environment variable to hold clock */
+#define NFT_LOG_ENV_CLOCK         "NFT_LOG_CLOCK"
+/** name of environment variable to hold thread info mode */
+#define NFT_LOG_ENV_THREAD        "NFT_LOG_THREAD"
+/** name of environment variable to hold output format */
+#define NFT_LOG_ENV_OUTPUT        "NFT_LOG_OUTPUT"
+/** name of environment variable to hold rate limits */
+#define NFT_LOG_ENV_RATELIMIT     "NFT_LOG_RATELIMIT"
+/** name of environment variable to hold timeout of duplicate suppression */
+#define NFT_LOG_ENV_DEDUP         "NFT_LOG_DEDUP"
+/** name of environment variable to hold sampling rates */
+#define NFT_LOG_ENV_SAMPLE        "NFT_LOG_SAMPLE"
 
 /** available loglevels (used by @ref nft_log_level_set() and @ref NFT_LOG()) 
     (adjust also logger.c:_loglevel_names when adjusting this) */
@@ -117,18 +182,280 @@ typedef enum
         L_MIN
 } NftLoglevel;
 
+/** timestamps printed in front of every message (s. @ref nft_log_timestamp_set()) */
+typedef enum
+{
+        /** <b>"off"</b> - no timestamp */
+        NFT_LOG_TIMESTAMP_OFF = 0,
+        /** <b>"sec"</b> - "YYYY-mm-dd HH:MM:SS" (CLOCK_REALTIME_COARSE) */
+        NFT_LOG_TIMESTAMP_SEC,
+        /** <b>"msec"</b> - "YYYY-mm-dd HH:MM:SS.mmm" (CLOCK_REALTIME_COARSE) */
+        NFT_LOG_TIMESTAMP_MSEC,
+        /** <b>"usec"</b> - "YYYY-mm-dd HH:MM:SS.uuuuuu" (@ref NftLogClock) */
+        NFT_LOG_TIMESTAMP_USEC,
+        /** <b>"monotonic"</b> - "SSSSS.uuuuuu" since boot (CLOCK_MONOTONIC) */
+        NFT_LOG_TIMESTAMP_MONOTONIC,
+        /* placeholder - always at end of the list */
+        NFT_LOG_TIMESTAMP_MAX
+} NftLogTimestamp;
+
+/** clock used to take the time of messages (s. @ref nft_log_clock_set()) */
+typedef enum
+{
+        /** <b>"realtime"</b> - clock_gettime(CLOCK_REALTIME) */
+        NFT_LOG_CLOCK_REALTIME = 0,
+        /** <b>"tsc"</b> - raw CPU timestamp counter, converted when the
+            message is written (needs invariant TSC) */
+        NFT_LOG_CLOCK_TSC,
+        /* placeholder - always at end of the list */
+        NFT_LOG_CLOCK_MAX
+} NftLogClock;
+
+/** thread info printed in front of every message (s. @ref nft_log_thread_set()) */
+typedef enum
+{
+        /** <b>"off"</b> - no thread info */
+        NFT_LOG_THREAD_OFF = 0,
+        /** <b>"id"</b> - "[tid]" */
+        NFT_LOG_THREAD_ID,
+        /** <b>"name"</b> - "[name]" (or "[tid]" for threads without name) */
+        NFT_LOG_THREAD_NAME,
+        /** <b>"all"</b> - "[tid name]" */
+        NFT_LOG_THREAD_ALL,
+        /* placeholder - always at end of the list */
+        NFT_LOG_THREAD_MAX
+} NftLogThread;
+
+/** format of messages passed to mechanisms (s. @ref nft_log_output_set()) */
+typedef enum
+{
+        /** <b>"text"</b> - prefix followed by message */
+        NFT_LOG_OUTPUT_TEXT = 0,
+        /** <b>"json"</b> - one JSON object per message (JSON lines) */
+        NFT_LOG_OUTPUT_JSON,
+        /* placeholder - always at end of the list */
+        NFT_LOG_OUTPUT_MAX
+} NftLogOutput;
+
+/** 
+ * most verbose level any call-site, rule or mechanism currently logs
+ * @note don't access directly, use @ref nft_log_level_is_enabled()
+ */
+extern NftLoglevel              _nft_log_level;
+
+
+/** mode of a call-site (s. @ref nft_log_site_mode_set()) */
+typedef enum
+{
+        /** call-site follows the current loglevel */
+        NFT_LOG_SITE_DEFAULT = 0,
+        /** call-site always logs, regardless of current loglevel */
+        NFT_LOG_SITE_ON,
+        /** call-site never logs */
+        NFT_LOG_SITE_OFF,
+} NftLogSiteMode;
+
+
+/** 
+ * descriptor of one NFT_LOG() call-site. Every NFT_LOG() statement emits one 
+ * of those as static variable in the "nft_log_sites" section.
+ */
+typedef struct
+{
+        /** __FILE__ of call-site */
+        const char                     *file;
+        /** __func__ of call-site */
+        const char                     *func;
+        /** __LINE__ of call-site */
+        int                             line;
+        /** @ref NftLoglevel of call-site (L_INVALID if not constant) */
+        NftLoglevel                     level;
+        /** format string of call-site (NULL if not constant) */
+        const char                     *format;
+        /** @ref NftLogSiteMode of this call-site */
+        NftLogSiteMode                  mode;
+        /** non-zero if call-site should call nft_log_site() (maintained by library) */
+        int                             enabled;
+        /** level specification the cached levels belong to (maintained by library) */
+        unsigned int                    generation;
+        /** most verbose level this call-site logs (maintained by library) */
+        NftLoglevel                     threshold;
+        /** level of the NFT_LOG_LEVEL rule matching this call-site or L_INVALID (maintained by library) */
+        NftLoglevel                     rule;
+        /** messages per second this call-site may log or 0 to use the limit of the level (s. @ref NFT_LOG_RATELIMITED()) */
+        unsigned int                    rate;
+        /** messages this call-site may log at once or 0 for rate */
+        unsigned int                    burst;
+        /** time the token bucket of this call-site is full again (maintained by library) */
+        uint64_t                        bucket;
+        /** messages dropped since the last one that passed the rate limit (maintained by library) */
+        unsigned long                   suppressed;
+        /** log 1 in sample messages or 0 to use the rate of the level (s. @ref NFT_LOG_SAMPLED()) */
+        unsigned int                    sample;
+} NftLogSite;
+
+
 /** logging function that will be called for every log-message if registered with @ref nft_log_func_register() */
 typedef void                    (NftLogFunc) (void *userdata, NftLoglevel level, const char *file, const char *func, int line, const char *msg);
 
+/** type of value of a @ref NftLogKv field */
+typedef enum
+{
+        /** signed integer (value.i) */
+        NFT_KV_TYPE_INT = 0,
+        /** unsigned integer (value.u) */
+        NFT_KV_TYPE_UINT,
+        /** floating point number (value.d) */
+        NFT_KV_TYPE_DBL,
+        /** \0 terminated string (value.s) */
+        NFT_KV_TYPE_STR,
+        /** boolean (value.b) */
+        NFT_KV_TYPE_BOOL,
+} NftLogKvType;
+
+/** typed key/value field of a structured message (s. @ref NFT_LOG_KV()) */
+typedef struct
+{
+        /** name of field */
+        const char                     *key;
+        /** type of value */
+        NftLogKvType                    type;
+        /** value */
+        union
+        {
+                int64_t                 i;
+                uint64_t                u;
+                double                  d;
+                const char             *s;
+                bool                    b;
+        } value;
+} NftLogKv;
+
+/** 
+ * log-message passed to @ref NftLogSubscriber functions. All pointers 
+ * point into the library's message buffer and are only valid during the 
+ * call.
+ */
+typedef struct
+{
+        /** @ref NftLoglevel of message */
+        NftLoglevel                     level;
+        /** __FILE__ of call-site */
+        const char                     *file;
+        /** __func__ of call-site */
+        const char                     *func;
+        /** __LINE__ of call-site */
+        int                             line;
+        /** prefix as printed by mechanisms (e.g. "error: ", not \0 terminated) */
+        const char                     *prefix;
+        /** length of prefix */
+        size_t                          prefix_len;
+        /** message body (follows prefix, \0 terminated) */
+        const char                     *body;
+        /** length of body */
+        size_t                          body_len;
+        /** time of logging (nanoseconds since epoch) */
+        uint64_t                        time;
+        /** thread that logged this message */
+        unsigned long                   tid;
+        /** increased by one for every message passed to subscribers */
+        uint64_t                        sequence;
+        /** fields of structured message (s. @ref NFT_LOG_KV(), NULL otherwise) */
+        const NftLogKv                 *kv;
+        /** amount of fields */
+        size_t                          kv_count;
+        /** 1 in how many messages of the call-site is logged (0 if not 
+            sampled, s. @ref nft_log_sample_set()) */
+        unsigned int                    weight;
+} NftLogMessage;
+
+/** function called for log-messages if registered with @ref nft_log_subscribe() */
+typedef void                    (NftLogSubscriber) (void *userdata, const NftLogMessage * message);
+
+/** bit of one @ref NftLoglevel in level masks of @ref nft_log_subscribe() */
+#define NFT_LOG_LEVEL_BIT(level)        (1u << (level))
+/** level mask with level and all less verbose levels (e.g. warnings & errors) */
+#define NFT_LOG_LEVELS_FROM(level)      (~0u << (level))
+/** level mask with all levels */
+#define NFT_LOG_LEVELS_ALL              (~0u)
+
+/** function called for every call-site by @ref nft_log_sites_foreach() */
+typedef void                    (NftLogSiteFunc) (void *userdata, NftLogSite * site);
+
+
+#ifndef NFT_LOG_COMPILE_LEVEL
+/** 
+ * NFT_LOG() statements with a constant loglevel below this are removed at
+ * compile-time (including format string & arguments). Define this before 
+ * including logger.h or use -DNFT_LOG_COMPILE_LEVEL=L_INFO for example.
+ * @note the compiler needs to be able to fold constants, so it's best to 
+ *       compile with optimizations enabled
+ */
+#define NFT_LOG_COMPILE_LEVEL L_MAX
+#endif
+
+/* true if statement with this loglevel isn't removed at compile-time */
+#define _NFT_LOG_COMPILED($level, $l) (__builtin_constant_p($level) ? ($level) >= NFT_LOG_COMPILE_LEVEL : ($l) >= NFT_LOG_COMPILE_LEVEL)
+#define _NFT_LOG_COMPILED_CONST($level) (__builtin_constant_p($level) ? ($level) >= NFT_LOG_COMPILE_LEVEL : 1)
+
+/* call-sites are collected in a dedicated section where supported */
+#ifdef __ELF__
+#define _NFT_LOG_SITE_ATTR __attribute__((section("nft_log_sites"), aligned(sizeof(void *))))
+#else
+#define _NFT_LOG_SITE_ATTR __attribute__((aligned(sizeof(void *))))
+#endif
+
+/* initializer for a static NftLogSite */
+#define _NFT_LOG_SITE_INIT_EX($level, $msg, $rate, $burst, $sample) { .file = __FILE__, .func = __func__, .line = __LINE__, .level = __builtin_constant_p($level) ? ($level) : L_INVALID, .format = (__builtin_constant_p($msg) && _NFT_LOG_COMPILED_CONST($level)) ? ($msg) : NULL, .mode = NFT_LOG_SITE_DEFAULT, .enabled = 1, .rate = ($rate), .burst = ($burst), .sample = ($sample), }
+#define _NFT_LOG_SITE_INIT($level, $msg) _NFT_LOG_SITE_INIT_EX($level, $msg, 0, 0, 0)
+
+/* check if call-site is enabled (one load if loglevel is constant) */
+#define _NFT_LOG_SITE_ENABLED($site, $level, $l) (__builtin_constant_p($level) ? __atomic_load_n(&($site).enabled, __ATOMIC_RELAXED) : nft_log_site_is_enabled(&($site), $l))
+
 /** convenience macro for nft_log() \n
  * @note No \\n is needed at end of string. \n
+ * @note Arguments are only evaluated if the message is actually logged. \n
+ * @note Statements below @ref NFT_LOG_COMPILE_LEVEL are removed at compile-time. \n
  * <b>Example:</b> NFT_LOG(LL_INFO, "Reading config file \"%s\"...", config); 
  */
-#define NFT_LOG($level, $msg, ...) nft_log($level, __FILE__, __func__, __LINE__, $msg, ##__VA_ARGS__)
+#define NFT_LOG($level, $msg, ...) do { const NftLoglevel _nft_log_l = ($level); if(_NFT_LOG_COMPILED($level, _nft_log_l)) { static NftLogSite _nft_log_site _NFT_LOG_SITE_ATTR = _NFT_LOG_SITE_INIT($level, $msg); if(_NFT_LOG_SITE_ENABLED(_nft_log_site, $level, _nft_log_l)) nft_log_site(&_nft_log_site, _nft_log_l, $msg, ##__VA_ARGS__); } } while(0)
+/** 
+ * structured logging: message with typed fields that are passed through to
+ * subscribers & mechanisms that handle unformatted messages. Text 
+ * mechanisms get "msg key=value ...". Like @ref NFT_LOG(), fields aren't 
+ * even evaluated if the message is filtered. 
+ * e.g. NFT_LOG_KV(L_DEBUG, "frame", NFT_KV_INT("strip", n), NFT_KV_DBL("fps", f))
+ */
+#define NFT_LOG_KV($level, $msg, ...) do { const NftLoglevel _nft_log_l = ($level); if(_NFT_LOG_COMPILED($level, _nft_log_l)) { static NftLogSite _nft_log_site _NFT_LOG_SITE_ATTR = _NFT_LOG_SITE_INIT($level, $msg); if(_NFT_LOG_SITE_ENABLED(_nft_log_site, $level, _nft_log_l)) { const NftLogKv _nft_log_kv[] = { __VA_ARGS__ }; nft_log_kv(&_nft_log_site, _nft_log_l, $msg, _nft_log_kv, sizeof(_nft_log_kv) / sizeof(_nft_log_kv[0])); } } } while(0)
+/** 
+ * like @ref NFT_LOG() but with an explicit rate limit for this call-site 
+ * (overrides @ref nft_log_ratelimit_set()): burst messages at once, then 
+ * rate messages per second (both must be constant). Dropped messages 
+ * aren't formatted.
+ * e.g. NFT_LOG_RATELIMITED(L_WARNING, 10, 20, "short read: %d bytes", n)
+ */
+#define NFT_LOG_RATELIMITED($level, $rate, $burst, $msg, ...) do { const NftLoglevel _nft_log_l = ($level); if(_NFT_LOG_COMPILED($level, _nft_log_l)) { static NftLogSite _nft_log_site _NFT_LOG_SITE_ATTR = _NFT_LOG_SITE_INIT_EX($level, $msg, $rate, $burst, 0); if(_NFT_LOG_SITE_ENABLED(_nft_log_site, $level, _nft_log_l)) nft_log_site(&_nft_log_site, _nft_log_l, $msg, ##__VA_ARGS__); } } while(0)
+/** 
+ * like @ref NFT_LOG() but only 1 in $n messages (chosen randomly) is logged 
+ * (overrides @ref nft_log_sample_set(), $n must be constant). Sampled out 
+ * messages aren't formatted.
+ * e.g. NFT_LOG_SAMPLED(L_NOISY, 100, "pixel %d: %x", i, p)
+ */
+#define NFT_LOG_SAMPLED($level, $n, $msg, ...) do { const NftLoglevel _nft_log_l = ($level); if(_NFT_LOG_COMPILED($level, _nft_log_l)) { static NftLogSite _nft_log_site _NFT_LOG_SITE_ATTR = _NFT_LOG_SITE_INIT_EX($level, $msg, 0, 0, $n); if(_NFT_LOG_SITE_ENABLED(_nft_log_site, $level, _nft_log_l)) nft_log_site(&_nft_log_site, _nft_log_l, $msg, ##__VA_ARGS__); } } while(0)
+/** signed integer field for @ref NFT_LOG_KV() */
+#define NFT_KV_INT($key, $v) { .key = ($key), .type = NFT_KV_TYPE_INT, .value = { .i = (int64_t) ($v) } }
+/** unsigned integer field for @ref NFT_LOG_KV() */
+#define NFT_KV_UINT($key, $v) { .key = ($key), .type = NFT_KV_TYPE_UINT, .value = { .u = (uint64_t) ($v) } }
+/** floating point field for @ref NFT_LOG_KV() */
+#define NFT_KV_DBL($key, $v) { .key = ($key), .type = NFT_KV_TYPE_DBL, .value = { .d = (double) ($v) } }
+/** string field for @ref NFT_LOG_KV() (only referenced, not copied) */
+#define NFT_KV_STR($key, $v) { .key = ($key), .type = NFT_KV_TYPE_STR, .value = { .s = ($v) } }
+/** boolean field for @ref NFT_LOG_KV() */
+#define NFT_KV_BOOL($key, $v) { .key = ($key), .type = NFT_KV_TYPE_BOOL, .value = { .b = ($v) } }
 /** perror logging-functionality */
-#define NFT_LOG_PERROR($msg) nft_log(L_ERROR, __FILE__, __func__, __LINE__, "%s: %s", $msg, strerror(errno))
+#define NFT_LOG_PERROR($msg) NFT_LOG(L_ERROR, "%s: %s", $msg, strerror(errno))
 /** NULL pointer error-msg & return abrevation */
-#define NFT_LOG_NULL(ret) { nft_log(L_NOISY, __FILE__, __func__, __LINE__, "NULL pointer received."); return ret; }
+#define NFT_LOG_NULL(ret) { NFT_LOG(L_NOISY, "NULL pointer received."); return ret; }
 
 
 /* high-level TODO macro ;) */
@@ -139,12 +466,93 @@ typedef void                    (NftLogFunc) (void *userdata, NftLoglevel level,
 void                            nft_log(NftLoglevel level, const char *file, const char *func, int line, const char *msg, ...);
 void                            nft_log_va(NftLoglevel level, const char *file, const char *func, int line, const char *msg, va_list args);
 void                            nft_log_func_register(NftLogFunc * func, void *userdata);
+NftResult                       nft_log_subscribe(NftLogSubscriber * func, void *userdata, unsigned int levels);
+NftResult                       nft_log_unsubscribe(NftLogSubscriber * func, void *userdata);
 NftResult                       nft_log_level_set(NftLoglevel loglevel);
 NftLoglevel                     nft_log_level_get();
+void                            nft_log_level_reload();
 const char                     *nft_log_level_to_string(NftLoglevel loglevel);
 NftLoglevel                     nft_log_level_from_string(const char *name);
 bool                            nft_log_level_is_noisier_than(NftLoglevel a, NftLoglevel b);
 void                            nft_log_print_loglevels();
+NftResult                       nft_log_timestamp_set(NftLogTimestamp mode);
+NftLogTimestamp                 nft_log_timestamp_get();
+NftResult                       nft_log_clock_set(NftLogClock clock);
+NftLogClock                     nft_log_clock_get();
+NftResult                       nft_log_thread_set(NftLogThread mode);
+NftLogThread                    nft_log_thread_get();
+void                            nft_log_thread_name_set(const char *name);
+const char                     *nft_log_thread_name_get();
+NftResult                       nft_log_output_set(NftLogOutput output);
+NftLogOutput                    nft_log_output_get();
+NftResult                       nft_log_ratelimit_set(NftLoglevel level, unsigned int rate, unsigned int burst);
+NftResult                       nft_log_ratelimit_get(NftLoglevel level, unsigned int *rate, unsigned int *burst);
+NftResult                       nft_log_dedup_set(unsigned int timeout);
+unsigned int                    nft_log_dedup_get();
+void                            nft_log_dedup_flush();
+NftResult                       nft_log_sample_set(NftLoglevel level, unsigned int n);
+unsigned int                    nft_log_sample_get(NftLoglevel level);
+
+void                            nft_log_site(NftLogSite * site, NftLoglevel level, const char *msg, ...);
+void                            nft_log_kv(NftLogSite * site, NftLoglevel level, const char *msg, const NftLogKv * kv, size_t count);
+void                            nft_log_sites_register(NftLogSite * start, NftLogSite * stop);
+void                            nft_log_sites_unregister(NftLogSite * start);
+void                            nft_log_sites_foreach(NftLogSiteFunc * func, void *userdata);
+void                            nft_log_sites_print();
+int                             nft_log_sites_mode_set(const char *file, int line, NftLogSiteMode mode);
+void                            nft_log_site_mode_set(NftLogSite * site, NftLogSiteMode mode);
+
+
+/**
+ * find out if a message of a certain loglevel would currently be logged.
+ * This is a lock-free inline check against the cached loglevel and can be
+ * used to skip expensive preparation of log-messages that would be filtered 
+ * anyway. (If NFT_LOG_LEVEL contains rules for source files, this is true
+ * if the message would be logged by any of them.)
+ *
+ * @param[in] level @ref NftLoglevel of the message
+ * @result true if message would be logged, false otherwise
+ */
+static inline bool nft_log_level_is_enabled(NftLoglevel level)
+{
+        return level >= __atomic_load_n(&_nft_log_level, __ATOMIC_RELAXED);
+}
+
+
+/**
+ * find out if a call-site would log a message of a certain loglevel. 
+ * NFT_LOG() only uses this if the loglevel isn't constant.
+ *
+ * @param[in] site @ref NftLogSite
+ * @param[in] level @ref NftLoglevel of the message
+ * @result true if message would be logged, false otherwise
+ */
+static inline bool nft_log_site_is_enabled(NftLogSite * site, NftLoglevel level)
+{
+        if(!__atomic_load_n(&site->enabled, __ATOMIC_RELAXED))
+                return false;
+
+        return nft_log_level_is_enabled(level) || __atomic_load_n(&site->mode, __ATOMIC_RELAXED) == NFT_LOG_SITE_ON;
+}
+
+
+#ifdef __ELF__
+/* boundaries of the call-site section of the current binary */
+extern NftLogSite               __start_nft_log_sites[] __attribute__((weak, visibility("hidden")));
+extern NftLogSite               __stop_nft_log_sites[] __attribute__((weak, visibility("hidden")));
+
+/* register call-sites of the current binary/library upon load */
+static void __attribute__((constructor)) _nft_log_sites_load(void)
+{
+        nft_log_sites_register(__start_nft_log_sites, __stop_nft_log_sites);
+}
+
+/* unregister call-sites of the current binary/library upon unload */
+static void __attribute__((destructor)) _nft_log_sites_unload(void)
+{
+        nft_log_sites_unregister(__start_nft_log_sites);
+}
+#endif
 
 
 #endif /* _NFT_LOGGER_H */
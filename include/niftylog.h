@@ -63,6 +63,8 @@
 
 #include "logger.h"
 #include "logger-mechanism.h"
+#include "logger-async.h"
+#include "logger-instance.h"
 #include "logger-version.h"
 
 
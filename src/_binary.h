@@ -0,0 +1,146 @@
+/*
+ * libniftylog - niftylight logging library
+ * Copyright (C) 2006-2014 Daniel Hiepler <daniel@niftylight.de>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/**
+ * @file _binary.h
+ *
+ * file format of the "binary" logging mechanism:
+ * 
+ * The file starts with a @ref BinaryHeader. It's followed by records, each 
+ * starting with a type byte. A @ref BinarySite record (followed by file, 
+ * func & format string incl. \0) is written once for every call-site 
+ * before its first message. @ref BinaryMessage records refer to it by id 
+ * and are followed by the captured arguments. Messages with site id 0 
+ * carry already formatted text instead.
+ *
+ * All values are stored in host byte order. Arguments are stored in the
+ * native binary representation, so files can only be decoded on hosts 
+ * with the same ABI. Everytime the file is opened, a new header is 
+ * appended and all site ids become invalid.
+ */
+
+#ifndef _BINARY_H
+#define _BINARY_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+
+/** magic string at start of header (incl. \0) */
+#define BINARY_MAGIC            "NFTLOGB"
+/** current version of the file format */
+#define BINARY_VERSION          1
+/** used to check byte order */
+#define BINARY_BYTEORDER        0x01020304
+
+
+/** type of record */
+typedef enum
+{
+        /** @ref BinarySite */
+        BINARY_SITE = 1,
+        /** @ref BinaryMessage */
+        BINARY_MESSAGE = 2,
+} BinaryType;
+
+
+/** file header */
+typedef struct
+{
+        /** BINARY_MAGIC */
+        char magic[8];
+        /** BINARY_VERSION */
+        uint32_t version;
+        /** BINARY_BYTEORDER */
+        uint32_t byteorder;
+        /** size of int, long, long long, size_t, void *, double, 
+            long double & intmax_t */
+        uint8_t sizes[8];
+} BinaryHeader;
+
+
+/** call-site dictionary entry */
+typedef struct
+{
+        /** BINARY_SITE */
+        uint8_t type;
+        /** unused */
+        uint8_t reserved[3];
+        /** id of this site (> 0) */
+        uint32_t id;
+        /** __LINE__ */
+        int32_t line;
+        /** length of __FILE__ incl. \0 */
+        uint32_t file_len;
+        /** length of __func__ incl. \0 */
+        uint32_t func_len;
+        /** length of format string incl. \0 */
+        uint32_t format_len;
+} BinarySite;
+
+
+/** log message */
+typedef struct
+{
+        /** BINARY_MESSAGE */
+        uint8_t type;
+        /** NftLoglevel */
+        uint8_t level;
+        /** unused */
+        uint8_t reserved[2];
+        /** id of call-site or 0 for preformatted text */
+        uint32_t site;
+        /** nanoseconds since epoch */
+        uint64_t time;
+        /** thread-id */
+        uint32_t tid;
+        /** length of arguments (or text) following this record */
+        uint32_t len;
+} BinaryMessage;
+
+
+/** fill sizes of basic types for BinaryHeader */
+#define BINARY_SIZES { sizeof(int), sizeof(long), sizeof(long long), sizeof(size_t), sizeof(void *), sizeof(double), sizeof(long double), sizeof(intmax_t) }
+
+
+#endif /* _BINARY_H */
@@ -0,0 +1,170 @@
+/*
+ * libniftylog - niftylight logging library
+ * Copyright (C) 2006-2014 Daniel Hiepler <daniel@niftylight.de>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+#ifndef _FORMAT_H
+#define _FORMAT_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdarg.h>
+
+
+/** width/precision not given */
+#define FMT_NONE        (-1)
+/** width/precision given as argument ('*') */
+#define FMT_STAR        (-2)
+
+
+/** length modifier of a conversion */
+typedef enum
+{
+        FMT_LEN_NONE = 0,
+        FMT_LEN_HH,
+        FMT_LEN_H,
+        FMT_LEN_L,
+        FMT_LEN_LL,
+        FMT_LEN_J,
+        FMT_LEN_Z,
+        FMT_LEN_T,
+        FMT_LEN_BIGL,
+} FormatLength;
+
+
+/** type of argument consumed by a conversion */
+typedef enum
+{
+        /** no argument ("%%") */
+        FMT_ARG_NONE = 0,
+        /** int (also char & short after promotion) */
+        FMT_ARG_INT,
+        /** long */
+        FMT_ARG_LONG,
+        /** long long */
+        FMT_ARG_LLONG,
+        /** intmax_t */
+        FMT_ARG_INTMAX,
+        /** size_t */
+        FMT_ARG_SIZE,
+        /** ptrdiff_t */
+        FMT_ARG_PTRDIFF,
+        /** double */
+        FMT_ARG_DOUBLE,
+        /** long double */
+        FMT_ARG_LDOUBLE,
+        /** const char * */
+        FMT_ARG_STRING,
+        /** void * */
+        FMT_ARG_POINTER,
+        /** unsupported conversion (%n, %ls, positional arguments, ...) */
+        FMT_ARG_INVALID,
+} FormatArg;
+
+
+/** one parsed conversion specification */
+typedef struct
+{
+        /** start of conversion in format string (points to '%') */
+        const char *start;
+        /** length of conversion in format string */
+        size_t len;
+        /** '-' flag */
+        bool left;
+        /** '+' flag */
+        bool plus;
+        /** ' ' flag */
+        bool space;
+        /** '#' flag */
+        bool alt;
+        /** '0' flag */
+        bool zero;
+        /** minimum field width, FMT_NONE or FMT_STAR */
+        int width;
+        /** precision, FMT_NONE or FMT_STAR */
+        int precision;
+        /** length modifier */
+        FormatLength length;
+        /** conversion character */
+        char conversion;
+        /** type of argument */
+        FormatArg arg;
+} FormatSpec;
+
+
+/** value of one argument */
+typedef union
+{
+        /** all integer types and characters */
+        intmax_t i;
+        /** double */
+        double d;
+        /** long double */
+        long double ld;
+        /** string */
+        const char *s;
+        /** pointer */
+        const void *p;
+} FormatValue;
+
+
+/** output buffer */
+typedef struct
+{
+        /** buffer */
+        char *buf;
+        /** size of buffer */
+        size_t size;
+        /** length of output so far (may exceed size) */
+        size_t pos;
+} FormatOut;
+
+
+bool                            _format_spec_parse(const char *fmt, FormatSpec * spec);
+void                            _format_put(FormatOut * o, const char *s, size_t len);
+void                            _format_conversion(FormatOut * o, const FormatSpec * s, int width, int precision, const FormatValue * v);
+int                             _format_finish(FormatOut * o);
+int                             _format(char *buf, size_t size, const char *fmt, va_list args);
+
+
+#endif /* _FORMAT_H */
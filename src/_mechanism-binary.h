@@ -0,0 +1,81 @@
+/*
+ * libniftylog - niftylight logging library
+ * Copyright (C) 2006-2014 Daniel Hiepler <daniel@niftylight.de>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+/**
+ * @file _mechanism-binary.h
+ */
+
+/**
+ * @addtogroup logger_mechanism
+ * @{ 
+ * @defgroup logger_mechanism_binary binary
+ * @brief logging mechanism to write compact binary records to a file
+ * 
+ * Messages aren't formatted. Only the call-site id, timestamp, thread-id, 
+ * loglevel and the binary representation of all arguments are written. 
+ * Filename, function name and format string of every call-site are only
+ * written once. Use the "nftlog-decode" tool to convert the file to text.
+ *
+ * The file can be set with the variable NFT_LOG_BINARY_FILE. If unset,
+ * "niftylog.bin" in the current directory will be used. New messages are
+ * always appended.
+ *
+ * Output is buffered. Buffers are flushed for messages with a level of 
+ * @ref L_WARNING or higher and at exit.
+ * @{ 
+ */
+
+#ifndef _NFT_LOG_MECHANISM_BINARY_H
+#define _NFT_LOG_MECHANISM_BINARY_H
+
+
+
+NftLogMechanism                *nft_log_mechanism_binary();
+
+
+#endif /* _NFT_LOG_MECHANISM_BINARY_H */
+
+
+/**
+ * @}
+ * @}
+ */
@@ -0,0 +1,93 @@
+/*
+ * libniftylog - niftylight logging library
+ * Copyright (C) 2006-2014 Daniel Hiepler <daniel@niftylight.de>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+/**
+ * @file _mechanism-file.h
+ */
+
+/**
+ * @addtogroup logger_mechanism
+ * @{ 
+ * @defgroup logger_mechanism_file file
+ * @brief logging mechanism to write messages to a file
+ * 
+ * Messages are collected in a userspace buffer and written with one 
+ * writev() call when the buffer is full, when the oldest buffered message 
+ * is older than the flush interval or when a message with a level of 
+ * @ref L_WARNING or higher is logged. A background thread also writes the 
+ * buffer every flush interval, so messages don't wait for the next one to 
+ * be logged (without pthreads, they do). Pending messages are written at 
+ * exit.
+ *
+ * The mechanism is configured by these variables:
+ * - NFT_LOG_FILE - path of logfile (default: "niftylog.log")
+ * - NFT_LOG_FILE_BUFFER - size of buffer in bytes (default: 64k)
+ * - NFT_LOG_FILE_FLUSH - flush interval in milliseconds (default: 1000)
+ * - NFT_LOG_FILE_ROTATE_SIZE - rotate file when it gets bigger than this
+ *   (default: 0 = never)
+ * - NFT_LOG_FILE_ROTATE_INTERVAL - rotate file after this amount of 
+ *   seconds (default: 0 = never)
+ * - NFT_LOG_FILE_KEEP - amount of rotated files to keep (default: 5)
+ *
+ * Sizes can have a "k", "M" or "G" suffix, intervals an "m", "h" or "d" 
+ * suffix. Rotated files are renamed to "<file>.1", "<file>.2", ...
+ *
+ * Two buffers are used. Writing and rotating happens with the full buffer
+ * while other threads keep logging into the second one.
+ * @{ 
+ */
+
+#ifndef _NFT_LOG_MECHANISM_FILE_H
+#define _NFT_LOG_MECHANISM_FILE_H
+
+
+
+NftLogMechanism                *nft_log_mechanism_file();
+
+
+#endif /* _NFT_LOG_MECHANISM_FILE_H */
+
+
+/**
+ * @}
+ * @}
+ */
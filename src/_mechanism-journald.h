@@ -0,0 +1,82 @@
+/*
+ * libniftylog - niftylight logging library
+ * Copyright (C) 2006-2014 Daniel Hiepler <daniel@niftylight.de>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+/**
+ * @file _mechanism-journald.h
+ */
+
+/**
+ * @addtogroup logger_mechanism
+ * @{ 
+ * @defgroup logger_mechanism_journald journald
+ * @brief logging mechanism to send messages to the systemd journal
+ * 
+ * Messages are sent to journald using its native protocol. Every entry 
+ * consists of the fields PRIORITY, SYSLOG_IDENTIFIER and MESSAGE. 
+ * Messages logged with NFT_LOG() additionally carry CODE_FILE, CODE_LINE, 
+ * CODE_FUNC and TID. Fields are passed as iovecs pointing to the original
+ * data. Entries too large for one datagram are passed as sealed memfd.
+ *
+ * The mechanism is configured by these variables:
+ * - NFT_LOG_IDENT - SYSLOG_IDENTIFIER (default: process name)
+ * - NFT_LOG_JOURNAL_SOCKET - path of journald socket 
+ *   (default: "/run/systemd/journal/socket")
+ * - NFT_LOG_JOURNAL_SNDBUF - send buffer size of socket, optionally with 
+ *   "k", "M" or "G" suffix (default: 8M, capped by the kernel)
+ * @{ 
+ */
+
+#ifndef _NFT_LOG_MECHANISM_JOURNALD_H
+#define _NFT_LOG_MECHANISM_JOURNALD_H
+
+
+
+NftLogMechanism                *nft_log_mechanism_journald();
+
+
+#endif /* _NFT_LOG_MECHANISM_JOURNALD_H */
+
+
+/**
+ * @}
+ * @}
+ */
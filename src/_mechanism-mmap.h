@@ -0,0 +1,86 @@
+/*
+ * libniftylog - niftylight logging library
+ * Copyright (C) 2006-2014 Daniel Hiepler <daniel@niftylight.de>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+/**
+ * @file _mechanism-mmap.h
+ */
+
+/**
+ * @addtogroup logger_mechanism
+ * @{ 
+ * @defgroup logger_mechanism_mmap mmap
+ * @brief logging mechanism to write messages into a memory-mapped file
+ * 
+ * The logfile is extended by preallocated segments that are mapped into 
+ * memory. Threads reserve space for a message by atomically advancing 
+ * the write position and copy the message directly into the mapping, so 
+ * logging doesn't need a syscall per message. When a segment is full, the
+ * next one is mapped right behind the last message. Writeback is left to 
+ * the page cache, so messages survive a crash of the process (but not of 
+ * the system).
+ *
+ * The unused rest of the current segment is truncated when the mechanism 
+ * is deinitialized or the process exits. After a crash, the file ends 
+ * with NUL bytes.
+ *
+ * The mechanism is configured by these variables:
+ * - NFT_LOG_MMAP_FILE - path of logfile (default: "niftylog-mmap.log")
+ * - NFT_LOG_MMAP_SEGMENT - size of one segment in bytes, optionally with 
+ *   "k", "M" or "G" suffix (default: 4M, minimum: 64k)
+ * @{ 
+ */
+
+#ifndef _NFT_LOG_MECHANISM_MMAP_H
+#define _NFT_LOG_MECHANISM_MMAP_H
+
+
+
+NftLogMechanism                *nft_log_mechanism_mmap();
+
+
+#endif /* _NFT_LOG_MECHANISM_MMAP_H */
+
+
+/**
+ * @}
+ * @}
+ */
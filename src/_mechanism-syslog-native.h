@@ -0,0 +1,91 @@
+/*
+ * libniftylog - niftylight logging library
+ * Copyright (C) 2006-2014 Daniel Hiepler <daniel@niftylight.de>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+/**
+ * @file _mechanism-syslog-native.h
+ */
+
+/**
+ * @addtogroup logger_mechanism
+ * @{ 
+ * @defgroup logger_mechanism_syslog_native syslog-native
+ * @brief logging mechanism to send messages to the syslog daemon directly
+ * 
+ * Unlike @ref logger_mechanism_syslog, this doesn't use syslog(3) but 
+ * talks to the local syslog socket itself. Headers are built from a cached 
+ * hostname, ident and pid (all determined when the mechanism is 
+ * initialized), the timestamp is only formatted once per second. 
+ * Datagrams are queued and sent in batches with one sendmmsg() call. 
+ * The queue is sent when it's full, when the oldest queued message is 
+ * older than the flush interval, when a message with a level of 
+ * @ref L_WARNING or higher is logged and at exit. A background thread also 
+ * sends the queue every flush interval, so messages don't wait for the 
+ * next one to be logged (without pthreads, they do).
+ *
+ * The mechanism is configured by these variables:
+ * - NFT_LOG_IDENT - syslog "identity" (APP-NAME) (default: process name)
+ * - NFT_LOG_SYSLOG_SOCKET - path of syslog socket (default: "/dev/log")
+ * - NFT_LOG_SYSLOG_FORMAT - "5424" for RFC 5424 framing (default) or 
+ *   "3164" for the traditional BSD format (RFC 3164)
+ * - NFT_LOG_SYSLOG_BATCH - amount of datagrams sent at once (default: 16)
+ * - NFT_LOG_SYSLOG_FLUSH - flush interval in milliseconds (default: 100)
+ *
+ * This mechanism will always use LOG_USER as syslog facility. 
+ * The @ref NftLoglevel will be translated to the syslog priority.
+ * @{ 
+ */
+
+#ifndef _NFT_LOG_MECHANISM_SYSLOG_NATIVE_H
+#define _NFT_LOG_MECHANISM_SYSLOG_NATIVE_H
+
+
+
+NftLogMechanism                *nft_log_mechanism_syslog_native();
+
+
+#endif /* _NFT_LOG_MECHANISM_SYSLOG_NATIVE_H */
+
+
+/**
+ * @}
+ * @}
+ */
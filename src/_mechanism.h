@@ -46,7 +46,21 @@
 #define _MECHANISM_H
 
 
-void                            _mechanism_log(NftLoglevel level, char *msg);
+/** set of mechanisms (s. mechanism.c) */
+struct Mechanisms;
+
+
+void                            _mechanism_init();
+void                            _mechanism_log(NftLoglevel level, char *msg, size_t len);
+void                            _mechanism_log_sync(struct Mechanisms **slot, NftLoglevel base, NftLoglevel level, char *msg, size_t len);
+NftLoglevel                     _mechanism_level(NftLoglevel level);
+bool                            _mechanism_records();
+bool                            _mechanism_text();
+void                            _mechanism_log_record(const NftLogRecord * record, NftLoglevel base, char *msg, size_t len);
+
+NftResult                       _mechanism_sinks_set(struct Mechanisms **slot, const char *spec);
+NftLoglevel                     _mechanism_sinks_level(struct Mechanisms **slot, NftLoglevel base);
+void                            _mechanism_sinks_log(struct Mechanisms **slot, NftLoglevel base, NftLoglevel level, char *msg, size_t len);
 
 
 #endif /* _MECHANISM_H */
@@ -0,0 +1,896 @@
+/*
+ * libniftylog - niftylight logging library
+ * Copyright (C) 2006-2014 Daniel Hiepler <daniel@niftylight.de>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/**
+ * @file async.c
+ */
+
+/**
+ * @addtogroup logger_async
+ * @{
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <inttypes.h>
+#include "config.h"
+#include "logger-async.h"
+#include "logger-mechanism.h"
+#include "_mechanism.h"
+#include "_logger.h"
+#include "_format.h"
+#include "_capture.h"
+#include "_async.h"
+#include "_clock.h"
+#include "_thread.h"
+#include "_sample.h"
+
+
+
+/** names of policies (must be synced with NftLogAsyncPolicy definition!) */
+static const char *_policy_names[] = {
+        "off",
+        "block",
+        "drop",
+        "overwrite",
+};
+
+
+/** true as soon as the environment has been read */
+static bool _env_read;
+
+
+
+#ifdef HAVE_PTHREAD_H
+
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <errno.h>
+
+
+/** maximum size of one message incl. \0 (longer messages are written
+    synchronously) */
+#define ASYNC_MSG_SIZE          900
+/** used to keep producer & consumer state in different cachelines */
+#define CACHELINE_SIZE          64
+/** time the writer thread sleeps if there's nothing to do (ms) */
+#define WRITER_IDLE_MS          100
+/** time to wait between checks when blocking (ms) */
+#define BLOCK_WAIT_MS           10
+
+
+/** content of a ring-buffer slot */
+typedef enum
+{
+        /** complete message, pass to mechanism */
+        SLOT_MESSAGE,
+        /** formatted message without prefix */
+        SLOT_BODY,
+        /** captured arguments, format before passing on */
+        SLOT_ARGS,
+        /** nothing (message didn't fit & is written synchronously) */
+        SLOT_NONE,
+} SlotKind;
+
+
+/** one ring-buffer slot */
+struct Slot
+{
+        /** sequence number to synchronize producers & consumers */
+        size_t seq;
+        /** content of this slot */
+        SlotKind kind;
+        /** loglevel of message */
+        NftLoglevel level;
+        /** mechanisms to write to (SLOT_MESSAGE, NULL for current ones) */
+        struct Mechanisms **sinks;
+        /** level for mechanisms without own level (SLOT_MESSAGE) */
+        NftLoglevel base;
+        /** call-site of message (SLOT_BODY & SLOT_ARGS) */
+        const NftLogSite *site;
+        /** time of logging (SLOT_BODY & SLOT_ARGS, stamp from _clock_now()) */
+        uint64_t time;
+        /** thread that logged the message (SLOT_BODY & SLOT_ARGS) */
+        unsigned long tid;
+        /** thread info of logging thread (SLOT_BODY & SLOT_ARGS) */
+        char thread[THREAD_PREFIX_MAX];
+        /** length of message/arguments */
+        size_t len;
+        /** message or captured arguments */
+        char msg[ASYNC_MSG_SIZE];
+};
+
+
+/** ring-buffer & writer thread */
+static struct
+{
+        /** ring-buffer slots */
+        struct Slot *slots;
+        /** amount of slots - 1 */
+        size_t mask;
+        /** current policy */
+        NftLogAsyncPolicy policy;
+        /** writer thread */
+        pthread_t thread;
+        /** false to stop writer thread */
+        bool running;
+        /** true while writer thread waits for new messages */
+        bool sleeping;
+        /** protects condition variables */
+        pthread_mutex_t mutex;
+        /** signalled when new messages are available */
+        pthread_cond_t data;
+        /** signalled when messages have been consumed */
+        pthread_cond_t space;
+        /** amount of dropped messages */
+        uint64_t dropped;
+        /** amount of consumed (written or overwritten) slots */
+        uint64_t completed;
+        /** next position to write to */
+        size_t tail __attribute__ ((aligned(CACHELINE_SIZE)));
+        /** next position to read from */
+        size_t head __attribute__ ((aligned(CACHELINE_SIZE)));
+} _q = {
+        .mutex = PTHREAD_MUTEX_INITIALIZER,
+        .data = PTHREAD_COND_INITIALIZER,
+        .space = PTHREAD_COND_INITIALIZER,
+};
+
+
+/** true while asynchronous logging is active */
+static bool _active;
+/** true if formatting is deferred to the writer thread */
+static bool _deferred;
+/** amount of threads currently pushing a message */
+static int _producers;
+/** true if atexit handler has been installed */
+static bool _atexit;
+/** true for the writer thread */
+static __thread bool _is_writer;
+
+
+
+
+/** wait on condition variable for some milliseconds */
+static void _wait(pthread_cond_t * cond, int ms)
+{
+        struct timespec t;
+        clock_gettime(CLOCK_REALTIME, &t);
+        t.tv_nsec += (long) ms *1000000L;
+        t.tv_sec += t.tv_nsec / 1000000000L;
+        t.tv_nsec %= 1000000000L;
+        pthread_cond_timedwait(cond, &_q.mutex, &t);
+}
+
+
+/** claim free slot for writing or return NULL if ring-buffer is full */
+static struct Slot *_claim(size_t * pos)
+{
+        size_t p = __atomic_load_n(&_q.tail, __ATOMIC_RELAXED);
+        for(;;)
+        {
+                struct Slot *s = &_q.slots[p & _q.mask];
+                size_t seq = __atomic_load_n(&s->seq, __ATOMIC_ACQUIRE);
+                intptr_t dif = (intptr_t) (seq - p);
+
+                if(dif == 0)
+                {
+                        if(__atomic_compare_exchange_n(&_q.tail, &p, p + 1,
+                                                       true,
+                                                       __ATOMIC_RELAXED,
+                                                       __ATOMIC_RELAXED))
+                        {
+                                *pos = p;
+                                return s;
+                        }
+                }
+                else if(dif < 0)
+                        return NULL;
+                else
+                        p = __atomic_load_n(&_q.tail, __ATOMIC_RELAXED);
+        }
+}
+
+
+/** publish slot claimed by _claim() */
+static void _commit(struct Slot *s, size_t pos)
+{
+        __atomic_store_n(&s->seq, pos + 1, __ATOMIC_RELEASE);
+}
+
+
+/** take oldest slot for reading or return NULL if ring-buffer is empty */
+static struct Slot *_take(size_t * pos)
+{
+        size_t p = __atomic_load_n(&_q.head, __ATOMIC_RELAXED);
+        for(;;)
+        {
+                struct Slot *s = &_q.slots[p & _q.mask];
+                size_t seq = __atomic_load_n(&s->seq, __ATOMIC_ACQUIRE);
+                intptr_t dif = (intptr_t) (seq - (p + 1));
+
+                if(dif == 0)
+                {
+                        if(__atomic_compare_exchange_n(&_q.head, &p, p + 1,
+                                                       true,
+                                                       __ATOMIC_RELAXED,
+                                                       __ATOMIC_RELAXED))
+                        {
+                                *pos = p;
+                                return s;
+                        }
+                }
+                else if(dif < 0)
+                        return NULL;
+                else
+                        p = __atomic_load_n(&_q.head, __ATOMIC_RELAXED);
+        }
+}
+
+
+/** give slot taken by _take() back to producers */
+static void _release(struct Slot *s, size_t pos)
+{
+        __atomic_store_n(&s->seq, pos + _q.mask + 1, __ATOMIC_RELEASE);
+}
+
+
+/** 
+ * count message as consumed (after it has been written, not when its slot 
+ * is released, so nft_log_async_flush() doesn't return too early) 
+ */
+static void _complete()
+{
+        __atomic_add_fetch(&_q.completed, 1, __ATOMIC_RELEASE);
+}
+
+
+/** true if there's at least one message in the ring-buffer */
+static bool _pending()
+{
+        size_t p = __atomic_load_n(&_q.head, __ATOMIC_SEQ_CST);
+        struct Slot *s = &_q.slots[p & _q.mask];
+        return __atomic_load_n(&s->seq, __ATOMIC_SEQ_CST) == p + 1;
+}
+
+
+/** wake up writer thread if it's sleeping */
+static void _wakeup()
+{
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        if(!__atomic_load_n(&_q.sleeping, __ATOMIC_RELAXED))
+                return;
+
+        pthread_mutex_lock(&_q.mutex);
+        pthread_cond_signal(&_q.data);
+        pthread_mutex_unlock(&_q.mutex);
+}
+
+
+/** write notice about dropped messages */
+static void _report_dropped(uint64_t * reported)
+{
+        uint64_t dropped = __atomic_load_n(&_q.dropped, __ATOMIC_RELAXED);
+        if(dropped == *reported)
+                return;
+
+        char msg[128];
+        int n = snprintf(msg, sizeof(msg),
+                         "%" PRIu64 " messages dropped by asynchronous "
+                         "logging", dropped - *reported);
+        _mechanism_log_sync(NULL, L_INVALID, L_WARNING, msg, (size_t) n);
+
+        *reported = dropped;
+}
+
+
+/** writer thread */
+static void *_writer(void *arg)
+{
+        _is_writer = true;
+
+        struct Slot slot;
+        uint64_t reported = 0;
+
+        for(;;)
+        {
+                /* write all pending messages */
+                struct Slot *s;
+                size_t pos;
+                while((s = _take(&pos)))
+                {
+                        memcpy(&slot, s, offsetof(struct Slot, msg) + s->len);
+                        _release(s, pos);
+
+                        /* convert raw stamp of caller */
+                        if(slot.kind != SLOT_MESSAGE)
+                                slot.time = _clock_ns(slot.time);
+
+                        switch (slot.kind)
+                        {
+                                case SLOT_MESSAGE:
+                                {
+                                        slot.msg[slot.len] = '\0';
+                                        _mechanism_log_sync(slot.sinks,
+                                                            slot.base,
+                                                            slot.level,
+                                                            slot.msg,
+                                                            slot.len);
+                                        break;
+                                }
+
+                                case SLOT_BODY:
+                                {
+                                        slot.msg[slot.len] = '\0';
+                                        _log_emit(slot.site, slot.level,
+                                                  slot.msg, slot.time,
+                                                  slot.tid, slot.thread);
+                                        break;
+                                }
+
+                                case SLOT_ARGS:
+                                {
+                                        NftLogRecord r = {
+                                                .level = slot.level,
+                                                .site = slot.site,
+                                                .format = slot.site->format,
+                                                .args = slot.msg,
+                                                .args_len = slot.len,
+                                                .time = slot.time,
+                                                .tid = slot.tid,
+                                                .thread = slot.thread,
+                                                .weight =
+                                                        _sample_weight
+                                                        (slot.site,
+                                                         slot.level),
+                                        };
+                                        _log_record(&r);
+                                        break;
+                                }
+
+                                case SLOT_NONE:
+                                        break;
+                        }
+
+                        _complete();
+                }
+
+                _report_dropped(&reported);
+
+                pthread_mutex_lock(&_q.mutex);
+
+                /* wake up blocked producers & flushing threads */
+                pthread_cond_broadcast(&_q.space);
+
+                /* stop if requested and nothing is left */
+                if(!_q.running && !_pending())
+                {
+                        pthread_mutex_unlock(&_q.mutex);
+                        break;
+                }
+
+                /* sleep until new messages arrive */
+                __atomic_store_n(&_q.sleeping, true, __ATOMIC_SEQ_CST);
+                if(!_pending() && _q.running)
+                        _wait(&_q.data, WRITER_IDLE_MS);
+                __atomic_store_n(&_q.sleeping, false, __ATOMIC_RELAXED);
+
+                pthread_mutex_unlock(&_q.mutex);
+        }
+
+        return NULL;
+}
+
+
+/** claim slot according to current policy or return NULL if message is dropped */
+static struct Slot *_claim_policy(size_t * pos)
+{
+        struct Slot *s;
+        if((s = _claim(pos)))
+                return s;
+
+        switch (_q.policy)
+        {
+                case NFT_LOG_ASYNC_BLOCK:
+                {
+                        pthread_mutex_lock(&_q.mutex);
+                        while(!(s = _claim(pos)))
+                        {
+                                pthread_cond_signal(&_q.data);
+                                _wait(&_q.space, BLOCK_WAIT_MS);
+                        }
+                        pthread_mutex_unlock(&_q.mutex);
+                        return s;
+                }
+
+                case NFT_LOG_ASYNC_OVERWRITE:
+                {
+                        /* drop oldest messages until there's room */
+                        do
+                        {
+                                struct Slot *old;
+                                size_t oldpos;
+                                if((old = _take(&oldpos)))
+                                {
+                                        _release(old, oldpos);
+                                        _complete();
+                                        __atomic_add_fetch(&_q.dropped, 1,
+                                                           __ATOMIC_RELAXED);
+                                }
+                        }
+                        while(!(s = _claim(pos)));
+
+                        return s;
+                }
+
+                default:
+                {
+                        __atomic_add_fetch(&_q.dropped, 1, __ATOMIC_RELAXED);
+                        return NULL;
+                }
+        }
+}
+
+
+/** called upon exit to write all pending messages */
+static void _exit_handler()
+{
+        nft_log_async_disable();
+}
+
+
+/** 
+ * start pushing a message 
+ * @result false if message should be logged synchronously
+ */
+static bool _producer_enter()
+{
+        /* messages logged by the writer thread itself are never queued */
+        if(!__atomic_load_n(&_active, __ATOMIC_RELAXED) || _is_writer)
+                return false;
+
+        __atomic_add_fetch(&_producers, 1, __ATOMIC_SEQ_CST);
+        if(!__atomic_load_n(&_active, __ATOMIC_SEQ_CST))
+        {
+                __atomic_sub_fetch(&_producers, 1, __ATOMIC_RELEASE);
+                return false;
+        }
+
+        return true;
+}
+
+
+/** finish pushing a message */
+static void _producer_leave()
+{
+        __atomic_sub_fetch(&_producers, 1, __ATOMIC_RELEASE);
+}
+
+
+/**
+ * push message to ring-buffer if asynchronous logging is active
+ *
+ * @param[in] sinks mechanisms to write to (NULL for current mechanisms)
+ * @param[in] base level for mechanisms without own level (or L_INVALID)
+ * @param[in] level @ref NftLoglevel of message
+ * @param[in] msg message
+ * @param[in] len length of message
+ * @result true if message has been handled, false if it should be logged 
+ *         synchronously
+ */
+bool _async_push(struct Mechanisms **sinks, NftLoglevel base,
+                 NftLoglevel level, const char *msg, size_t len)
+{
+        if(!_producer_enter())
+                return false;
+
+        /* too long for a slot: write pending messages, then this one 
+           synchronously */
+        if(len >= ASYNC_MSG_SIZE)
+        {
+                _producer_leave();
+                nft_log_async_flush();
+                return false;
+        }
+
+        struct Slot *s;
+        size_t pos;
+        if((s = _claim_policy(&pos)))
+        {
+                s->kind = SLOT_MESSAGE;
+                s->sinks = sinks;
+                s->base = base;
+                s->level = level;
+                s->len = len;
+                memcpy(s->msg, msg, len);
+
+                _commit(s, pos);
+                _wakeup();
+        }
+
+        _producer_leave();
+        return true;
+}
+
+
+/**
+ * push unformatted message to ring-buffer if asynchronous logging is active
+ * and formatting is deferred (or the current mechanism handles unformatted 
+ * messages). Arguments are captured and formatted by the writer thread.
+ *
+ * @param[in] site call-site with constant format string
+ * @param[in] level @ref NftLoglevel of message
+ * @param[in] args arguments (only consumed if message has been handled)
+ * @result true if message has been handled, false if it should be logged 
+ *         synchronously
+ */
+bool _async_push_deferred(const NftLogSite * site, NftLoglevel level,
+                          va_list args)
+{
+        if(!__atomic_load_n(&_active, __ATOMIC_RELAXED) ||
+           (!__atomic_load_n(&_deferred, __ATOMIC_RELAXED) &&
+            !_mechanism_records()) || !_producer_enter())
+                return false;
+
+        bool overflow = false;
+        struct Slot *s;
+        size_t pos;
+        if((s = _claim_policy(&pos)))
+        {
+                const char *fmt = site->format;
+
+                s->level = level;
+                s->site = site;
+                s->time = _clock_now();
+                s->tid = _log_tid();
+
+                size_t tlen;
+                const char *thread = _thread_prefix(&tlen);
+                memcpy(s->thread, thread, tlen + 1);
+
+                va_list copy;
+                va_copy(copy, args);
+                int n = _capture(s->msg, sizeof(s->msg), fmt, copy);
+                va_end(copy);
+
+                if(n >= 0)
+                {
+                        s->kind = SLOT_ARGS;
+                        s->len = (size_t) n;
+                }
+                /* can't capture arguments, format now */
+                else
+                {
+                        va_copy(copy, args);
+                        n = _format(s->msg, sizeof(s->msg), fmt, copy);
+                        va_end(copy);
+                        s->kind = SLOT_BODY;
+                        s->len = (n < 0) ? 0 : (size_t) n;
+
+                        /* too long for a slot: log synchronously after all
+                           pending messages */
+                        if(s->len >= sizeof(s->msg))
+                        {
+                                s->kind = SLOT_NONE;
+                                s->len = 0;
+                                overflow = true;
+                        }
+                }
+
+                _commit(s, pos);
+                _wakeup();
+        }
+
+        _producer_leave();
+
+        if(overflow)
+        {
+                nft_log_async_flush();
+                return false;
+        }
+
+        return true;
+}
+
+
+/**
+ * enable asynchronous logging
+ *
+ * @param[in] policy @ref NftLogAsyncPolicy to use when ring-buffer is full
+ *            (NFT_LOG_ASYNC_OFF disables asynchronous logging)
+ * @param[in] slots amount of ring-buffer slots (rounded up to the next power 
+ *            of 2) or 0 for @ref NFT_LOG_ASYNC_DEFAULT_SLOTS
+ * @result NFT_SUCCESS or NFT_FAILURE
+ */
+NftResult nft_log_async_enable(NftLogAsyncPolicy policy, size_t slots)
+{
+        if(policy < NFT_LOG_ASYNC_OFF || policy > NFT_LOG_ASYNC_OVERWRITE)
+        {
+                fprintf(stderr, "Invalid asynchronous logging policy: %d\n",
+                        policy);
+                return NFT_FAILURE;
+        }
+
+        /* stop current writer */
+        nft_log_async_disable();
+
+        if(policy == NFT_LOG_ASYNC_OFF)
+                return NFT_SUCCESS;
+
+        /* amount of slots must be a power of 2 */
+        size_t n = 2;
+        while(n < (slots ? slots : NFT_LOG_ASYNC_DEFAULT_SLOTS))
+                n <<= 1;
+
+        if(!(_q.slots = calloc(n, sizeof(struct Slot))))
+        {
+                perror("calloc");
+                return NFT_FAILURE;
+        }
+
+        for(size_t i = 0; i < n; i++)
+                _q.slots[i].seq = i;
+
+        _q.mask = n - 1;
+        _q.head = 0;
+        _q.tail = 0;
+        _q.dropped = 0;
+        _q.completed = 0;
+        _q.policy = policy;
+        _q.running = true;
+        _q.sleeping = false;
+
+        int err;
+        if((err = pthread_create(&_q.thread, NULL, _writer, NULL)) != 0)
+        {
+                fprintf(stderr, "Failed to start logging thread: %s\n",
+                        strerror(err));
+                free(_q.slots);
+                _q.slots = NULL;
+                _q.policy = NFT_LOG_ASYNC_OFF;
+                return NFT_FAILURE;
+        }
+
+        /* write all pending messages upon exit */
+        if(!_atexit)
+        {
+                atexit(_exit_handler);
+                _atexit = true;
+        }
+
+        __atomic_store_n(&_active, true, __ATOMIC_SEQ_CST);
+
+        return NFT_SUCCESS;
+}
+
+
+/**
+ * disable asynchronous logging after all pending messages have been written
+ */
+void nft_log_async_disable()
+{
+        if(_is_writer)
+                return;
+
+        if(!__atomic_exchange_n(&_active, false, __ATOMIC_SEQ_CST))
+                return;
+
+        /* wait for threads that are still pushing messages */
+        while(__atomic_load_n(&_producers, __ATOMIC_ACQUIRE))
+                sched_yield();
+
+        /* stop writer thread (it writes all pending messages before) */
+        pthread_mutex_lock(&_q.mutex);
+        _q.running = false;
+        pthread_cond_signal(&_q.data);
+        pthread_mutex_unlock(&_q.mutex);
+
+        pthread_join(_q.thread, NULL);
+
+        free(_q.slots);
+        _q.slots = NULL;
+        _q.policy = NFT_LOG_ASYNC_OFF;
+}
+
+
+/**
+ * wait until all messages logged before have been written
+ */
+void nft_log_async_flush()
+{
+        if(_is_writer || !__atomic_load_n(&_active, __ATOMIC_ACQUIRE))
+                return;
+
+        uint64_t target = __atomic_load_n(&_q.tail, __ATOMIC_ACQUIRE);
+
+        pthread_mutex_lock(&_q.mutex);
+        while(__atomic_load_n(&_q.completed, __ATOMIC_ACQUIRE) < target)
+        {
+                pthread_cond_signal(&_q.data);
+                _wait(&_q.space, BLOCK_WAIT_MS);
+        }
+        pthread_mutex_unlock(&_q.mutex);
+}
+
+
+/**
+ * defer formatting of log-messages to the writer thread. The logging 
+ * thread only captures the arguments of the message. Only applies to 
+ * NFT_LOG() statements with a constant format string while asynchronous
+ * logging is enabled. 
+ *
+ * @param[in] defer true to defer formatting, false to format in the 
+ *            logging thread
+ * @note registered @ref NftLogFunc will be called from the writer thread
+ *       for deferred messages
+ */
+void nft_log_async_defer(bool defer)
+{
+        __atomic_store_n(&_deferred, defer, __ATOMIC_RELAXED);
+}
+
+
+/**
+ * get current policy
+ *
+ * @result current @ref NftLogAsyncPolicy (NFT_LOG_ASYNC_OFF if asynchronous
+ *         logging is disabled)
+ */
+NftLogAsyncPolicy nft_log_async_policy()
+{
+        return __atomic_load_n(&_active, __ATOMIC_ACQUIRE) ?
+                _q.policy : NFT_LOG_ASYNC_OFF;
+}
+
+
+/**
+ * get amount of messages dropped since asynchronous logging was enabled
+ *
+ * @result amount of dropped messages
+ */
+uint64_t nft_log_async_dropped()
+{
+        return __atomic_load_n(&_q.dropped, __ATOMIC_RELAXED);
+}
+
+
+#else /* HAVE_PTHREAD_H */
+
+
+bool _async_push(struct Mechanisms **sinks, NftLoglevel base,
+                 NftLoglevel level, const char *msg, size_t len)
+{
+        return false;
+}
+
+
+bool _async_push_deferred(const NftLogSite * site, NftLoglevel level,
+                          va_list args)
+{
+        return false;
+}
+
+
+NftResult nft_log_async_enable(NftLogAsyncPolicy policy, size_t slots)
+{
+        if(policy == NFT_LOG_ASYNC_OFF)
+                return NFT_SUCCESS;
+
+        fprintf(stderr, "Asynchronous logging is not supported\n");
+        return NFT_FAILURE;
+}
+
+
+void nft_log_async_disable()
+{
+}
+
+
+void nft_log_async_flush()
+{
+}
+
+
+void nft_log_async_defer(bool defer)
+{
+}
+
+
+NftLogAsyncPolicy nft_log_async_policy()
+{
+        return NFT_LOG_ASYNC_OFF;
+}
+
+
+uint64_t nft_log_async_dropped()
+{
+        return 0;
+}
+
+
+#endif /* HAVE_PTHREAD_H */
+
+
+/**
+ * enable asynchronous logging if NFT_LOG_ASYNC environment variable is set
+ * (only the first call has an effect)
+ */
+void _async_env()
+{
+        if(__atomic_exchange_n(&_env_read, true, __ATOMIC_ACQ_REL))
+                return;
+
+        char *env;
+        if(!(env = getenv(NFT_LOG_ENV_ASYNC)))
+                return;
+
+        /* "policy[:slots[:deferred]]" */
+        size_t len = strcspn(env, ":");
+        size_t slots = 0;
+        if(env[len] == ':')
+        {
+                char *end;
+                slots = strtoul(&env[len + 1], &end, 10);
+                if(strcmp(end, ":deferred") == 0)
+                        nft_log_async_defer(true);
+        }
+
+        for(NftLogAsyncPolicy p = NFT_LOG_ASYNC_OFF;
+            p <= NFT_LOG_ASYNC_OVERWRITE; p++)
+        {
+                if(strlen(_policy_names[p]) == len &&
+                   strncmp(env, _policy_names[p], len) == 0)
+                {
+                        nft_log_async_enable(p, slots);
+                        return;
+                }
+        }
+
+        fprintf(stderr, "Unknown asynchronous logging policy: \"%s\"\n", env);
+}
+
+
+/**
+ * @}
+ */
@@ -0,0 +1,274 @@
+/*
+ * libniftylog - niftylight logging library
+ * Copyright (C) 2006-2014 Daniel Hiepler <daniel@niftylight.de>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/**
+ * @file capture.c
+ */
+
+/**
+ * @addtogroup logger
+ * @{
+ *
+ * Capturing arguments of a log-message to format it later:
+ * The format string is walked once to find the type of each argument. 
+ * Arguments are stored in their native binary representation. Strings 
+ * are copied (incl. \0, a leading flag byte tells NULL pointers apart).
+ * Arguments for '*' width/precision are stored as int in front of the 
+ * argument they belong to.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "_format.h"
+#include "_capture.h"
+
+
+
+/** store value in capture buffer */
+#define _PUT(type, value) do { type _v = (value); if(used + sizeof(type) > size) return -1; memcpy(buf + used, &_v, sizeof(type)); used += sizeof(type); } while(0)
+/** read value from capture buffer */
+#define _GET(type, var) do { if(used + sizeof(type) > len) return -1; memcpy(&(var), buf + used, sizeof(type)); used += sizeof(type); } while(0)
+/** read value from capture buffer and convert it */
+#define _GET_AS(type, var) do { type _v; _GET(type, _v); (var) = (intmax_t) _v; } while(0)
+
+
+
+/**
+ * capture arguments of a log-message
+ *
+ * @param[out] buf buffer to store arguments in
+ * @param[in] size size of buf
+ * @param[in] fmt format string
+ * @param[in] args arguments (will be consumed)
+ * @result amount of bytes used in buf or -1 if arguments can't be 
+ *         captured (buffer too small or unsupported conversion)
+ */
+int _capture(char *buf, size_t size, const char *fmt, va_list args)
+{
+        size_t used = 0;
+
+        for(const char *p = fmt; *p; p++)
+        {
+                if(*p != '%')
+                        continue;
+
+                FormatSpec s;
+                if(!_format_spec_parse(p, &s) || s.arg == FMT_ARG_INVALID)
+                        return -1;
+
+                p += s.len - 1;
+
+                int precision = s.precision;
+                if(s.width == FMT_STAR)
+                        _PUT(int, va_arg(args, int));
+                if(s.precision == FMT_STAR)
+                {
+                        precision = va_arg(args, int);
+                        _PUT(int, precision);
+                }
+
+                switch (s.arg)
+                {
+                        case FMT_ARG_INT:
+                                _PUT(int, va_arg(args, int));
+                                break;
+                        case FMT_ARG_LONG:
+                                _PUT(long, va_arg(args, long));
+                                break;
+                        case FMT_ARG_LLONG:
+                                _PUT(long long, va_arg(args, long long));
+                                break;
+                        case FMT_ARG_INTMAX:
+                                _PUT(intmax_t, va_arg(args, intmax_t));
+                                break;
+                        case FMT_ARG_SIZE:
+                                _PUT(size_t, va_arg(args, size_t));
+                                break;
+                        case FMT_ARG_PTRDIFF:
+                                _PUT(ptrdiff_t, va_arg(args, ptrdiff_t));
+                                break;
+                        case FMT_ARG_DOUBLE:
+                                _PUT(double, va_arg(args, double));
+                                break;
+                        case FMT_ARG_LDOUBLE:
+                                _PUT(long double, va_arg(args, long double));
+                                break;
+                        case FMT_ARG_POINTER:
+                                _PUT(void *, va_arg(args, void *));
+                                break;
+
+                        case FMT_ARG_STRING:
+                        {
+                                const char *str = va_arg(args, const char *);
+                                _PUT(char, str ? 1 : 0);
+                                if(!str)
+                                        break;
+
+                                /* only copy what will be printed */
+                                size_t l = (precision >= 0) ?
+                                        strnlen(str, (size_t) precision) :
+                                        strlen(str);
+                                if(used + l + 1 > size)
+                                        return -1;
+                                memcpy(buf + used, str, l);
+                                buf[used + l] = '\0';
+                                used += l + 1;
+                                break;
+                        }
+
+                        default:
+                                break;
+                }
+        }
+
+        return (int) used;
+}
+
+
+/**
+ * format message from captured arguments
+ *
+ * @param[out] out buffer for formatted message
+ * @param[in] size size of out
+ * @param[in] fmt format string used by _capture()
+ * @param[in] buf arguments as stored by _capture()
+ * @param[in] len amount of bytes in buf
+ * @result length of formatted message (like snprintf()) or -1 upon error
+ */
+int _capture_render(char *out, size_t size, const char *fmt,
+                    const char *buf, size_t len)
+{
+        size_t used = 0;
+        FormatOut o = {.buf = out,.size = size,.pos = 0 };
+
+        if(!size)
+                return -1;
+
+        for(const char *p = fmt; *p;)
+        {
+                /* literal text */
+                const char *pct = p;
+                while(*pct && *pct != '%')
+                        pct++;
+                _format_put(&o, p, (size_t) (pct - p));
+                if(!*pct)
+                        break;
+
+                FormatSpec s;
+                if(!_format_spec_parse(pct, &s) || s.arg == FMT_ARG_INVALID)
+                        return -1;
+
+                p = pct + s.len;
+
+                int width = 0, precision = 0;
+                if(s.width == FMT_STAR)
+                        _GET(int, width);
+                if(s.precision == FMT_STAR)
+                        _GET(int, precision);
+
+                FormatValue v;
+                switch (s.arg)
+                {
+                        case FMT_ARG_NONE:
+                                break;
+                        case FMT_ARG_INT:
+                                _GET_AS(int, v.i);
+                                break;
+                        case FMT_ARG_LONG:
+                                _GET_AS(long, v.i);
+                                break;
+                        case FMT_ARG_LLONG:
+                                _GET_AS(long long, v.i);
+                                break;
+                        case FMT_ARG_INTMAX:
+                                _GET_AS(intmax_t, v.i);
+                                break;
+                        case FMT_ARG_SIZE:
+                                _GET_AS(size_t, v.i);
+                                break;
+                        case FMT_ARG_PTRDIFF:
+                                _GET_AS(ptrdiff_t, v.i);
+                                break;
+                        case FMT_ARG_DOUBLE:
+                                _GET(double, v.d);
+                                break;
+                        case FMT_ARG_LDOUBLE:
+                                _GET(long double, v.ld);
+                                break;
+                        case FMT_ARG_POINTER:
+                                _GET(const void *, v.p);
+                                break;
+
+                        case FMT_ARG_STRING:
+                        {
+                                char isset;
+                                _GET(char, isset);
+
+                                v.s = NULL;
+                                if(isset)
+                                {
+                                        v.s = buf + used;
+                                        size_t l = strnlen(v.s, len - used);
+                                        if(l == len - used)
+                                                return -1;
+                                        used += l + 1;
+                                }
+                                break;
+                        }
+
+                        default:
+                                return -1;
+                }
+
+                _format_conversion(&o, &s, width, precision, &v);
+        }
+
+        return _format_finish(&o);
+}
+
+
+/**
+ * @}
+ */
@@ -0,0 +1,426 @@
+/*
+ * libniftylog - niftylight logging library
+ * Copyright (C) 2006-2014 Daniel Hiepler <daniel@niftylight.de>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+/**
+ * @file clock.c
+ */
+
+/**
+ * @addtogroup logger
+ * @{
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include "config.h"
+#include "logger.h"
+#include "_clock.h"
+
+#if defined(__x86_64__) && defined(__SIZEOF_INT128__) && \
+        defined(HAVE_CPUID_H) && defined(HAVE_X86INTRIN_H)
+#include <cpuid.h>
+#include <x86intrin.h>
+/** reading the timestamp counter is supported on this platform */
+#define HAVE_TSC
+#endif
+
+
+
+/** stamps holding raw TSC ticks are tagged with this bit (nanoseconds since
+    epoch won't reach it before 2262) */
+#define STAMP_TSC               (1ULL << 63)
+/** re-anchor calibration when converting a stamp that's this far (ns) 
+    ahead of the last anchor */
+#define CALIBRATION_PERIOD      1000000000ULL
+/** duration of initial calibration pass (ns) */
+#define CALIBRATION_INITIAL     5000000L
+/** attempts to read TSC & system clocks close together */
+#define CALIBRATION_TRIES       5
+
+
+/** names of clocks (must be synced with NftLogClock) */
+static const char *_names[] = {
+        "realtime",
+        "tsc",
+};
+
+
+/** current clock */
+static NftLogClock _clock;
+/** true as soon as the environment has been read */
+static bool _env_read;
+
+
+#ifdef HAVE_TSC
+/** TSC & system clocks read at (almost) the same time */
+struct Point
+{
+        /** ticks */
+        uint64_t tsc;
+        /** CLOCK_REALTIME (ns) */
+        uint64_t realtime;
+        /** CLOCK_MONOTONIC (ns) */
+        uint64_t monotonic;
+};
+
+/** conversion of ticks (written under seqlock) */
+static struct
+{
+        /** odd while being updated */
+        unsigned int seq;
+        /** ticks at anchor */
+        uint64_t tsc;
+        /** nanoseconds since epoch at anchor */
+        uint64_t ns;
+        /** nanoseconds per tick (32.32 fixed point) */
+        uint64_t mult;
+        /** ticks per CALIBRATION_PERIOD */
+        uint64_t period;
+} _cal;
+
+/** first calibration point (frequency is measured since then) */
+static struct Point _base;
+/** true while someone calibrates */
+static bool _calibrating;
+/** true once the initial calibration pass finished */
+static bool _calibrated;
+#endif
+
+
+
+
+/**
+ * convert timespec to nanoseconds
+ */
+static uint64_t _ns(const struct timespec *t)
+{
+        return (uint64_t) t->tv_sec * 1000000000ULL + (uint64_t) t->tv_nsec;
+}
+
+
+#ifdef HAVE_TSC
+/**
+ * check if TSC ticks at a constant rate in all P-, C- & T-states
+ * (invariant TSC)
+ */
+static bool _tsc_invariant()
+{
+        unsigned int a, b, c, d;
+        if(!__get_cpuid(0x80000000, &a, &b, &c, &d) || a < 0x80000007)
+                return false;
+
+        __get_cpuid(0x80000007, &a, &b, &c, &d);
+        return (d & (1 << 8)) != 0;
+}
+
+
+/**
+ * read TSC & system clocks (best of a few attempts)
+ */
+static void _point(struct Point *p)
+{
+        uint64_t best = UINT64_MAX;
+        for(int i = 0; i < CALIBRATION_TRIES; i++)
+        {
+                struct timespec rt, mono;
+                uint64_t t0 = __rdtsc();
+                clock_gettime(CLOCK_REALTIME, &rt);
+                clock_gettime(CLOCK_MONOTONIC, &mono);
+                uint64_t t1 = __rdtsc();
+
+                if(t1 - t0 < best)
+                {
+                        best = t1 - t0;
+                        p->tsc = t0 + (t1 - t0) / 2;
+                        p->realtime = _ns(&rt);
+                        p->monotonic = _ns(&mono);
+                }
+        }
+}
+
+
+/**
+ * anchor conversion at a point. The frequency is measured against 
+ * CLOCK_MONOTONIC since the first calibration, so it gets more precise over 
+ * time and isn't disturbed by steps of CLOCK_REALTIME.
+ */
+static void _anchor(const struct Point *p)
+{
+        uint64_t ticks = p->tsc - _base.tsc;
+        uint64_t ns = p->monotonic - _base.monotonic;
+        if(!ticks || !ns)
+                return;
+
+        uint64_t mult = (uint64_t) (((unsigned __int128) ns << 32) / ticks);
+        uint64_t period = (uint64_t) (((unsigned __int128) ticks *
+                                       CALIBRATION_PERIOD) / ns);
+
+        unsigned int seq = __atomic_load_n(&_cal.seq, __ATOMIC_RELAXED);
+        __atomic_store_n(&_cal.seq, seq + 1, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+        __atomic_store_n(&_cal.tsc, p->tsc, __ATOMIC_RELAXED);
+        __atomic_store_n(&_cal.ns, p->realtime, __ATOMIC_RELAXED);
+        __atomic_store_n(&_cal.mult, mult, __ATOMIC_RELAXED);
+        __atomic_store_n(&_cal.period, period, __ATOMIC_RELAXED);
+        __atomic_store_n(&_cal.seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+
+/**
+ * initial calibration pass (once)
+ *
+ * @result true if TSC can be used
+ */
+static bool _calibrate()
+{
+        if(__atomic_load_n(&_calibrated, __ATOMIC_ACQUIRE))
+                return true;
+
+        if(!_tsc_invariant())
+                return false;
+
+        /* someone else might be calibrating */
+        while(__atomic_exchange_n(&_calibrating, true, __ATOMIC_ACQUIRE))
+        {
+                struct timespec t = {.tv_nsec = CALIBRATION_INITIAL / 10 };
+                nanosleep(&t, NULL);
+        }
+
+        if(!__atomic_load_n(&_calibrated, __ATOMIC_RELAXED))
+        {
+                _point(&_base);
+
+                struct timespec t = {.tv_nsec = CALIBRATION_INITIAL };
+                while(nanosleep(&t, &t) != 0 && errno == EINTR);
+
+                struct Point p;
+                _point(&p);
+                _anchor(&p);
+
+                __atomic_store_n(&_calibrated, true, __ATOMIC_RELEASE);
+        }
+
+        __atomic_store_n(&_calibrating, false, __ATOMIC_RELEASE);
+
+        return true;
+}
+
+
+/**
+ * convert ticks to nanoseconds since epoch
+ */
+static uint64_t _tsc_ns(uint64_t ticks)
+{
+        uint64_t tsc, ns, mult, period;
+        unsigned int s1, s2;
+        do
+        {
+                s1 = __atomic_load_n(&_cal.seq, __ATOMIC_ACQUIRE);
+                tsc = __atomic_load_n(&_cal.tsc, __ATOMIC_RELAXED);
+                ns = __atomic_load_n(&_cal.ns, __ATOMIC_RELAXED);
+                mult = __atomic_load_n(&_cal.mult, __ATOMIC_RELAXED);
+                period = __atomic_load_n(&_cal.period, __ATOMIC_RELAXED);
+                __atomic_thread_fence(__ATOMIC_ACQUIRE);
+                s2 = __atomic_load_n(&_cal.seq, __ATOMIC_RELAXED);
+        }
+        while((s1 & 1) || s1 != s2);
+
+        /* anchor is getting old, refresh it (unless someone else does) */
+        if(ticks > tsc + period &&
+           !__atomic_exchange_n(&_calibrating, true, __ATOMIC_ACQUIRE))
+        {
+                struct Point p;
+                _point(&p);
+                _anchor(&p);
+                __atomic_store_n(&_calibrating, false, __ATOMIC_RELEASE);
+
+                return _tsc_ns(ticks);
+        }
+
+        /* stamp might have been taken before the anchor */
+        int64_t d = (int64_t) (ticks - tsc);
+        return ns + (uint64_t) (int64_t) (((__int128) d * mult) >> 32);
+}
+#endif
+
+
+/**
+ * switch clock
+ */
+static NftResult _switch(NftLogClock clock)
+{
+        if(clock == NFT_LOG_CLOCK_TSC)
+        {
+#ifdef HAVE_TSC
+                if(!_calibrate())
+#endif
+                {
+                        fprintf(stderr,
+                                "No invariant TSC available, using realtime clock.\n");
+                        __atomic_store_n(&_clock, NFT_LOG_CLOCK_REALTIME,
+                                         __ATOMIC_RELAXED);
+                        return NFT_FAILURE;
+                }
+        }
+
+        __atomic_store_n(&_clock, clock, __ATOMIC_RELAXED);
+        return NFT_SUCCESS;
+}
+
+
+/**
+ * parse name of clock
+ *
+ * @result NftLogClock or -1 if name is invalid
+ */
+static int _parse(const char *name)
+{
+        for(int i = 0; i < NFT_LOG_CLOCK_MAX; i++)
+        {
+                if(strcmp(name, _names[i]) == 0)
+                        return i;
+        }
+
+        fprintf(stderr, "Invalid clock: \"%s\"\n", name);
+        return -1;
+}
+
+
+/**
+ * get current clock (reads environment upon first call)
+ */
+static NftLogClock _clock_get()
+{
+        if(!__atomic_load_n(&_env_read, __ATOMIC_ACQUIRE))
+        {
+                char *env;
+                int clock;
+                if((env = getenv(NFT_LOG_ENV_CLOCK)) &&
+                   (clock = _parse(env)) >= 0)
+                        _switch(clock);
+
+                __atomic_store_n(&_env_read, true, __ATOMIC_RELEASE);
+        }
+
+        return __atomic_load_n(&_clock, __ATOMIC_RELAXED);
+}
+
+
+/**
+ * get raw time stamp from current clock. This is cheap with the "tsc" clock, 
+ * so it's taken by the thread that logs and converted later by 
+ * @ref _clock_ns() (e.g. by the asynchronous writer).
+ *
+ * @result stamp (only to be passed to @ref _clock_ns())
+ */
+uint64_t _clock_now()
+{
+#ifdef HAVE_TSC
+        if(_clock_get() == NFT_LOG_CLOCK_TSC)
+                return __rdtsc() | STAMP_TSC;
+#endif
+
+        struct timespec t;
+        clock_gettime(CLOCK_REALTIME, &t);
+        return _ns(&t);
+}
+
+
+/**
+ * convert stamp from @ref _clock_now()
+ *
+ * @result nanoseconds since epoch
+ */
+uint64_t _clock_ns(uint64_t stamp)
+{
+#ifdef HAVE_TSC
+        if(stamp & STAMP_TSC)
+                return _tsc_ns(stamp & ~STAMP_TSC);
+#endif
+
+        return stamp;
+}
+
+
+/**
+ * set clock used to take the time of messages. The NFT_LOG_CLOCK 
+ * environment variable (holding the name of a clock) always wins. 
+ *
+ * @param[in] clock @ref NftLogClock
+ * @result NFT_SUCCESS or NFT_FAILURE (e.g. when there's no invariant TSC, 
+ *         the realtime clock is used instead)
+ */
+NftResult nft_log_clock_set(NftLogClock clock)
+{
+        if(clock < NFT_LOG_CLOCK_REALTIME || clock >= NFT_LOG_CLOCK_MAX)
+                return NFT_FAILURE;
+
+        /* environment always wins (only if it's valid) */
+        char *env;
+        int c;
+        if((env = getenv(NFT_LOG_ENV_CLOCK)) && (c = _parse(env)) >= 0)
+                clock = c;
+
+        NftResult r = _switch(clock);
+        __atomic_store_n(&_env_read, true, __ATOMIC_RELEASE);
+
+        return r;
+}
+
+
+/**
+ * get current clock
+ *
+ * @result @ref NftLogClock
+ */
+NftLogClock nft_log_clock_get()
+{
+        return _clock_get();
+}
+
+
+/**
+ * @}
+ */
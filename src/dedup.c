@@ -0,0 +1,469 @@
+/*
+ * libniftylog - niftylight logging library
+ * Copyright (C) 2006-2014 Daniel Hiepler <daniel@niftylight.de>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+/**
+ * @file dedup.c
+ */
+
+/**
+ * @addtogroup logger
+ * @{
+ */
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "config.h"
+#include "logger-mechanism.h"
+#include "_logger.h"
+#include "_flusher.h"
+#include "_dedup.h"
+
+
+/** amount of recent messages repeats are looked for */
+#define DEDUP_ENTRIES   8
+/** bytes of a message quoted in the summary of its repeats */
+#define DEDUP_TEXT_MAX  64
+
+
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+/** serializes access to recent messages */
+static pthread_mutex_t _mutex = PTHREAD_MUTEX_INITIALIZER;
+#define _LOCK()         pthread_mutex_lock(&_mutex)
+#define _UNLOCK()       pthread_mutex_unlock(&_mutex)
+/** serializes starting & stopping the timer */
+static pthread_mutex_t _timer_mutex = PTHREAD_MUTEX_INITIALIZER;
+#define _TIMER_LOCK()   pthread_mutex_lock(&_timer_mutex)
+#define _TIMER_UNLOCK() pthread_mutex_unlock(&_timer_mutex)
+#else
+#define _LOCK()
+#define _UNLOCK()
+#define _TIMER_LOCK()
+#define _TIMER_UNLOCK()
+#endif
+
+
+/** one recently logged message */
+struct Entry
+{
+        /** hash of level & message body (0 if entry is unused) */
+        uint64_t hash;
+        /** level of message */
+        NftLoglevel level;
+        /** level for mechanisms without own level */
+        NftLoglevel base;
+        /** call-site that logged the message first */
+        const char *file;
+        const char *func;
+        int line;
+        /** length of message body */
+        size_t len;
+        /** start of message body */
+        char text[DEDUP_TEXT_MAX];
+        /** time (ms) of first repeat that has been dropped */
+        uint64_t since;
+        /** repeats dropped since then */
+        unsigned long repeats;
+        /** value of _tick when message has last been seen */
+        uint64_t seen;
+};
+
+
+/** recently logged messages */
+static struct Entry _entries[DEDUP_ENTRIES];
+/** counts messages passed to _dedup_wants() (for LRU eviction) */
+static uint64_t _tick;
+/** milliseconds after which repeats are summarized (0 = off) */
+static unsigned int _timeout;
+/** true as soon as the environment has been read */
+static bool _env_read;
+/** true if atexit handler has been installed */
+static bool _atexit;
+/** thread that writes summaries after timeout if nothing else is logged */
+static struct Flusher *_timer;
+/** true while the calling thread writes summaries */
+static __thread bool _summarizing;
+
+
+
+
+/**
+ * monotonic time in milliseconds
+ */
+static uint64_t _ms()
+{
+        struct timespec t;
+#ifdef CLOCK_MONOTONIC_COARSE
+        clock_gettime(CLOCK_MONOTONIC_COARSE, &t);
+#else
+        clock_gettime(CLOCK_MONOTONIC, &t);
+#endif
+        return (uint64_t) t.tv_sec * 1000 + (uint64_t) t.tv_nsec / 1000000;
+}
+
+
+/**
+ * mix bits of a 64 bit word (murmur3 finalizer)
+ */
+static uint64_t _mix(uint64_t x)
+{
+        x ^= x >> 33;
+        x *= 0xff51afd7ed558ccdULL;
+        x ^= x >> 33;
+        x *= 0xc4ceb9fe1a85ec53ULL;
+        x ^= x >> 33;
+        return x;
+}
+
+
+/**
+ * hash message (8 bytes per step, not cryptographic)
+ *
+ * @result hash (never 0)
+ */
+static uint64_t _hash(NftLoglevel level, const char *s, size_t len)
+{
+        uint64_t h = _mix((uint64_t) level ^ (len << 8));
+
+        size_t i;
+        for(i = 0; i + 8 <= len; i += 8)
+        {
+                uint64_t k;
+                memcpy(&k, s + i, 8);
+                h = (h ^ _mix(k)) * 0x9e3779b97f4a7c15ULL;
+        }
+
+        uint64_t k = 0;
+        memcpy(&k, s + i, len - i);
+        h = _mix(h ^ _mix(k));
+
+        return h ? h : 1;
+}
+
+
+/**
+ * write summary of dropped repeats of an entry
+ */
+static void _summarize(const struct Entry *e)
+{
+        _summarizing = true;
+        _log_line(NULL, e->base, e->level, e->file, e->func, e->line,
+                  "last message repeated %lu times: %.*s%s", e->repeats,
+                  (int) (e->len < DEDUP_TEXT_MAX ? e->len : DEDUP_TEXT_MAX),
+                  e->text, e->len > DEDUP_TEXT_MAX ? "..." : "");
+        _summarizing = false;
+}
+
+
+/**
+ * copy entries with repeats that must be summarized now & reset them
+ *
+ * @param[out] runs copies
+ * @param[in] all true to take all entries with repeats, false to only take
+ *            those older than timeout
+ * @result amount of copies
+ */
+static size_t _take(struct Entry *runs, uint64_t now, bool all)
+{
+        size_t n = 0;
+        for(int i = 0; i < DEDUP_ENTRIES; i++)
+        {
+                struct Entry *e = &_entries[i];
+                if(!e->repeats || (!all && now - e->since < _timeout))
+                        continue;
+
+                runs[n++] = *e;
+                e->repeats = 0;
+        }
+
+        return n;
+}
+
+
+/**
+ * write summaries of all dropped repeats
+ */
+void nft_log_dedup_flush()
+{
+        struct Entry runs[DEDUP_ENTRIES];
+
+        _LOCK();
+        size_t n = _take(runs, 0, true);
+        _UNLOCK();
+
+        for(size_t i = 0; i < n; i++)
+                _summarize(&runs[i]);
+}
+
+
+/**
+ * write summaries of repeats older than timeout (called by timer)
+ */
+static void _expire()
+{
+        struct Entry runs[DEDUP_ENTRIES];
+
+        _LOCK();
+        size_t n = _take(runs, _ms(), false);
+        _UNLOCK();
+
+        for(size_t i = 0; i < n; i++)
+                _summarize(&runs[i]);
+}
+
+
+/**
+ * (re-)start timer that checks for expired repeats every timeout ms 
+ * (stop it if timeout is 0)
+ */
+static void _timer_set(unsigned int timeout)
+{
+        _TIMER_LOCK();
+        _flusher_stop(_timer);
+        _timer = timeout ? _flusher_start(timeout, _expire) : NULL;
+        _TIMER_UNLOCK();
+}
+
+
+/**
+ * stop timer & write pending summaries upon exit
+ */
+static void _exit_flush()
+{
+        _timer_set(0);
+        nft_log_dedup_flush();
+}
+
+
+/**
+ * store timeout & make sure pending repeats are summarized after timeout 
+ * and upon exit
+ */
+static void _timeout_store(unsigned int timeout)
+{
+        __atomic_store_n(&_timeout, timeout, __ATOMIC_RELAXED);
+        _timer_set(timeout);
+
+        _LOCK();
+        bool install = (timeout && !_atexit);
+        if(install)
+                _atexit = true;
+        _UNLOCK();
+
+        if(install)
+                atexit(_exit_flush);
+}
+
+
+/**
+ * parse timeout
+ *
+ * @result true if timeout is valid
+ */
+static bool _parse(const char *s, unsigned int *timeout)
+{
+        char *end;
+        unsigned long t;
+        if(*s < '0' || *s > '9' || (t = strtoul(s, &end, 10)) > UINT32_MAX ||
+           *end)
+        {
+                fprintf(stderr, "Invalid deduplication timeout: \"%s\"\n", s);
+                return false;
+        }
+
+        *timeout = (unsigned int) t;
+        return true;
+}
+
+
+/**
+ * get current timeout (reads environment upon first call)
+ */
+static unsigned int _timeout_get()
+{
+        if(!__atomic_load_n(&_env_read, __ATOMIC_ACQUIRE))
+        {
+                char *env;
+                unsigned int timeout;
+                if((env = getenv(NFT_LOG_ENV_DEDUP)) &&
+                   _parse(env, &timeout))
+                        _timeout_store(timeout);
+
+                __atomic_store_n(&_env_read, true, __ATOMIC_RELEASE);
+        }
+
+        return __atomic_load_n(&_timeout, __ATOMIC_RELAXED);
+}
+
+
+/**
+ * check if message is a repeat of one of the recent messages. Repeats are
+ * counted & dropped, the summary "last message repeated N times: ..." is 
+ * written when the message is evicted by others or (by a timer, even if 
+ * nothing else is logged) at most two timeouts after the first repeat 
+ * that has been dropped.
+ *
+ * @param[in] base level for mechanisms without own level
+ * @param[in] level @ref NftLoglevel of message
+ * @param[in] file __FILE__ of message
+ * @param[in] func __func__ of message
+ * @param[in] line __LINE__ of message
+ * @param[in] body message without prefix
+ * @param[in] len length of body
+ * @result true if message should be logged
+ */
+bool _dedup_wants(NftLoglevel base, NftLoglevel level, const char *file,
+                  const char *func, int line, const char *body, size_t len)
+{
+        /* deduplication turned off or summary being written? */
+        if(!_timeout_get() || _summarizing)
+                return true;
+
+        uint64_t hash = _hash(level, body, len);
+        uint64_t now = _ms();
+        size_t cmp = len < DEDUP_TEXT_MAX ? len : DEDUP_TEXT_MAX;
+        struct Entry runs[DEDUP_ENTRIES];
+
+        _LOCK();
+
+        /* summarize repeats older than timeout */
+        size_t n = _take(runs, now, false);
+
+        struct Entry *e, *oldest = &_entries[0];
+        bool repeat = false;
+        for(e = _entries; e < _entries + DEDUP_ENTRIES; e++)
+        {
+                if(e->hash == hash && e->level == level && e->base == base &&
+                   e->len == len && memcmp(e->text, body, cmp) == 0)
+                {
+                        repeat = true;
+                        break;
+                }
+
+                if(e->seen < oldest->seen)
+                        oldest = e;
+        }
+
+        if(repeat)
+        {
+                if(!e->repeats++)
+                        e->since = now;
+        }
+        /* replace least recently seen message */
+        else
+        {
+                e = oldest;
+                if(e->repeats)
+                        runs[n++] = *e;
+
+                e->hash = hash;
+                e->level = level;
+                e->base = base;
+                e->file = file;
+                e->func = func;
+                e->line = line;
+                e->len = len;
+                memcpy(e->text, body, cmp);
+                e->repeats = 0;
+        }
+
+        e->seen = ++_tick;
+
+        _UNLOCK();
+
+        for(size_t i = 0; i < n; i++)
+                _summarize(&runs[i]);
+
+        return !repeat;
+}
+
+
+/**
+ * collapse repeated messages: a message that equals (level & text without
+ * prefix) one of the last DEDUP_ENTRIES messages is dropped. Once the 
+ * original is pushed out by other messages or timeout ms after the first
+ * dropped repeat (checked every timeout ms by a timer thread, so this 
+ * doesn't wait for further messages), "last message repeated N times: ..."
+ * is written instead.
+ * Only affects the current mechanisms (not those of a @ref NftLogger), 
+ * subscribers still get every message. The NFT_LOG_DEDUP environment 
+ * variable (timeout in ms) always wins.
+ *
+ * @param[in] timeout milliseconds or 0 to turn deduplication off (pending
+ *            summaries are written)
+ * @result NFT_SUCCESS or NFT_FAILURE
+ */
+NftResult nft_log_dedup_set(unsigned int timeout)
+{
+        /* environment always wins (only if it's valid) */
+        char *env;
+        unsigned int t;
+        if((env = getenv(NFT_LOG_ENV_DEDUP)) && _parse(env, &t))
+                timeout = t;
+
+        _timeout_store(timeout);
+        __atomic_store_n(&_env_read, true, __ATOMIC_RELEASE);
+
+        if(!timeout)
+                nft_log_dedup_flush();
+
+        return NFT_SUCCESS;
+}
+
+
+/**
+ * get current deduplication timeout
+ *
+ * @result milliseconds (0 if deduplication is off)
+ */
+unsigned int nft_log_dedup_get()
+{
+        return _timeout_get();
+}
+
+
+/**
+ * @}
+ */
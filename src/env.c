@@ -0,0 +1,202 @@
+/*
+ * libniftylog - niftylight logging library
+ * Copyright (C) 2006-2014 Daniel Hiepler <daniel@niftylight.de>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+/**
+ * @file env.c
+ * helpers to read numeric & per-level settings from the environment
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include "logger-mechanism.h"
+#include "_logger.h"
+#include "_env.h"
+
+
+/** maximum length of one item of a per-level list */
+#define ITEM_MAX        64
+
+
+
+/** units for sizes */
+static const char _size_units[] = "kMG";
+static const uint64_t _size_factors[] = { 1ULL << 10, 1ULL << 20, 1ULL << 30 };
+/** units for intervals */
+static const char _time_units[] = "smhd";
+static const uint64_t _time_factors[] = { 1, 60, 60 * 60, 24 * 60 * 60 };
+
+
+
+/** read number with optional unit suffix from environment */
+static uint64_t _env(const char *name, uint64_t def,
+                     const char *units, const uint64_t * factors)
+{
+        const char *e;
+        if(!(e = getenv(name)))
+                return def;
+
+        char *end;
+        uint64_t v = strtoull(e, &end, 10);
+        if(end != e && *end == '\0')
+                return v;
+
+        const char *u;
+        if(end != e && *end && (u = strchr(units, *end)) && end[1] == '\0')
+                return v * factors[u - units];
+
+        fprintf(stderr, "Invalid %s: \"%s\"\n", name, e);
+        return def;
+}
+
+
+/**
+ * read plain number from environment
+ *
+ * @param[in] name name of environment variable
+ * @param[in] def default if variable is unset or invalid
+ * @result value
+ */
+uint64_t _env_number(const char *name, uint64_t def)
+{
+        return _env(name, def, "", NULL);
+}
+
+
+/**
+ * read size in bytes (with optional k/M/G suffix) from environment
+ *
+ * @param[in] name name of environment variable
+ * @param[in] def default if variable is unset or invalid
+ * @result size in bytes
+ */
+uint64_t _env_size(const char *name, uint64_t def)
+{
+        return _env(name, def, _size_units, _size_factors);
+}
+
+
+/**
+ * read interval in seconds (with optional s/m/h/d suffix) from environment
+ *
+ * @param[in] name name of environment variable
+ * @param[in] def default if variable is unset or invalid
+ * @result interval in seconds
+ */
+uint64_t _env_interval(const char *name, uint64_t def)
+{
+        return _env(name, def, _time_units, _time_factors);
+}
+
+
+/**
+ * parse one "[level=]value" item
+ *
+ * @param[in] apply false to only check item
+ * @result true if item is valid
+ */
+static bool _item(const char *item, size_t len, const char *what,
+                  bool (*func) (NftLoglevel level, const char *value,
+                                bool apply), bool apply)
+{
+        char buf[ITEM_MAX];
+        if(len >= sizeof(buf))
+                goto _invalid;
+
+        memcpy(buf, item, len);
+        buf[len] = '\0';
+
+        /* value of single level? */
+        NftLoglevel level = L_INVALID;
+        char *value = buf;
+        char *eq;
+        if((eq = strchr(buf, '=')))
+        {
+                if((level = _log_level_parse(buf, eq - buf)) == L_INVALID)
+                        goto _invalid;
+                value = eq + 1;
+        }
+
+        if(func(level, value, apply))
+                return true;
+
+_invalid:
+        fprintf(stderr, "Invalid %s: \"%.*s\"\n", what, (int) len, item);
+        return false;
+}
+
+
+/**
+ * read comma separated list of "[level=]value" items from environment 
+ * (nothing is applied if any item is invalid)
+ *
+ * @param[in] name name of environment variable
+ * @param[in] what description of value for error messages
+ * @param[in] func checks value for level (L_INVALID for all levels) and 
+ *            applies it if apply is true
+ * @result true if variable is set and valid
+ */
+bool _env_levels(const char *name, const char *what,
+                 bool (*func) (NftLoglevel level, const char *value,
+                               bool apply))
+{
+        const char *spec;
+        if(!(spec = getenv(name)))
+                return false;
+
+        for(int apply = 0; apply <= 1; apply++)
+        {
+                for(const char *s = spec; *s;)
+                {
+                        size_t len = strcspn(s, ",");
+                        if(len && !_item(s, len, what, func, apply))
+                                return false;
+
+                        s += len;
+                        if(*s == ',')
+                                s++;
+                }
+        }
+
+        return true;
+}
@@ -0,0 +1,220 @@
+/*
+ * libniftylog - niftylight logging library
+ * Copyright (C) 2006-2014 Daniel Hiepler <daniel@niftylight.de>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+/**
+ * @file flusher.c
+ */
+
+/**
+ * @addtogroup logger
+ * @{
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include "config.h"
+#include "_flusher.h"
+
+
+
+#ifdef HAVE_PTHREAD_H
+
+#include <pthread.h>
+#include <errno.h>
+#include <unistd.h>
+
+
+/** 
+ * thread that calls a function every interval ms, so buffering mechanisms 
+ * write pending messages even if no further message arrives 
+ */
+struct Flusher
+{
+        /** the thread */
+        pthread_t thread;
+        /** protects running */
+        pthread_mutex_t mutex;
+        /** signalled to stop thread */
+        pthread_cond_t cond;
+        /** false to stop thread */
+        bool running;
+        /** interval (ms) */
+        uint64_t interval;
+        /** function to call */
+        void (*func) (void);
+        /** process that started the thread */
+        pid_t pid;
+};
+
+
+
+
+/** flusher thread */
+static void *_thread(void *arg)
+{
+        struct Flusher *f = arg;
+
+        pthread_mutex_lock(&f->mutex);
+        while(f->running)
+        {
+                struct timespec t;
+                clock_gettime(CLOCK_MONOTONIC, &t);
+                t.tv_sec += (time_t) (f->interval / 1000);
+                t.tv_nsec += (long) (f->interval % 1000) * 1000000L;
+                t.tv_sec += t.tv_nsec / 1000000000L;
+                t.tv_nsec %= 1000000000L;
+
+                /* sleep until interval is over or thread is stopped */
+                int err = 0;
+                while(f->running && err != ETIMEDOUT)
+                        err = pthread_cond_timedwait(&f->cond, &f->mutex, &t);
+
+                if(!f->running)
+                        break;
+
+                pthread_mutex_unlock(&f->mutex);
+                f->func();
+                pthread_mutex_lock(&f->mutex);
+        }
+        pthread_mutex_unlock(&f->mutex);
+
+        return NULL;
+}
+
+
+/**
+ * start thread that calls func every interval ms
+ *
+ * @param[in] interval milliseconds (> 0)
+ * @param[in] func function to call (must not log)
+ * @result flusher or NULL upon error
+ */
+struct Flusher *_flusher_start(uint64_t interval, void (*func) (void))
+{
+        struct Flusher *f;
+        if(!(f = calloc(1, sizeof(*f))))
+        {
+                perror("calloc");
+                return NULL;
+        }
+
+        f->interval = interval;
+        f->func = func;
+        f->running = true;
+        f->pid = getpid();
+
+        pthread_condattr_t attr;
+        pthread_condattr_init(&attr);
+        pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+        pthread_cond_init(&f->cond, &attr);
+        pthread_condattr_destroy(&attr);
+        pthread_mutex_init(&f->mutex, NULL);
+
+        int err;
+        if((err = pthread_create(&f->thread, NULL, _thread, f)) != 0)
+        {
+                fprintf(stderr, "Failed to start flusher thread: %s\n",
+                        strerror(err));
+                pthread_cond_destroy(&f->cond);
+                pthread_mutex_destroy(&f->mutex);
+                free(f);
+                return NULL;
+        }
+
+        return f;
+}
+
+
+/**
+ * stop thread started by _flusher_start() (func isn't called anymore 
+ * afterwards)
+ *
+ * @param[in] f flusher or NULL
+ */
+void _flusher_stop(struct Flusher *f)
+{
+        if(!f)
+                return;
+
+        /* thread doesn't exist in a forked child */
+        if(f->pid != getpid())
+        {
+                free(f);
+                return;
+        }
+
+        pthread_mutex_lock(&f->mutex);
+        f->running = false;
+        pthread_cond_signal(&f->cond);
+        pthread_mutex_unlock(&f->mutex);
+
+        pthread_join(f->thread, NULL);
+
+        pthread_cond_destroy(&f->cond);
+        pthread_mutex_destroy(&f->mutex);
+        free(f);
+}
+
+
+#else /* HAVE_PTHREAD_H */
+
+
+struct Flusher *_flusher_start(uint64_t interval, void (*func) (void))
+{
+        return NULL;
+}
+
+
+void _flusher_stop(struct Flusher *f)
+{
+}
+
+
+#endif /* HAVE_PTHREAD_H */
+
+
+/**
+ * @}
+ */
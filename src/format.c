@@ -0,0 +1,1013 @@
+/*
+ * libniftylog - niftylight logging library
+ * Copyright (C) 2006-2014 Daniel Hiepler <daniel@niftylight.de>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/**
+ * @file format.c
+ */
+
+/**
+ * @addtogroup logger
+ * @{
+ *
+ * Formatting engine used instead of vsnprintf(): Integers are converted 
+ * using a table of two-digit pairs. Floats are converted to fixed point 
+ * using one exact scaling by a power of 10 as long as the result can be 
+ * rounded correctly (ties and huge values are left to snprintf()). All 
+ * conversions it can't handle exactly like glibc are passed to snprintf().
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include "_format.h"
+
+
+
+/** parse decimal number */
+static int _number(const char **p)
+{
+        int result = 0;
+        while(**p >= '0' && **p <= '9')
+        {
+                if(result < 100000)
+                        result = result * 10 + (**p - '0');
+                (*p)++;
+        }
+        return result;
+}
+
+
+/**
+ * parse one printf conversion specification
+ *
+ * @param[in] fmt format string pointing to '%'
+ * @param[out] spec parsed conversion
+ * @result true if conversion could be parsed. spec->arg will be 
+ *         FMT_ARG_INVALID for conversions that aren't supported.
+ */
+bool _format_spec_parse(const char *fmt, FormatSpec * spec)
+{
+        const char *p = fmt + 1;
+
+        *spec = (FormatSpec)
+        {
+        .start = fmt,.width = FMT_NONE,.precision = FMT_NONE,};
+
+        /* flags */
+        for(;; p++)
+        {
+                if(*p == '-')
+                        spec->left = true;
+                else if(*p == '+')
+                        spec->plus = true;
+                else if(*p == ' ')
+                        spec->space = true;
+                else if(*p == '#')
+                        spec->alt = true;
+                else if(*p == '0')
+                        spec->zero = true;
+                else
+                        break;
+        }
+
+        /* width */
+        if(*p == '*')
+        {
+                spec->width = FMT_STAR;
+                p++;
+        }
+        else if(*p >= '1' && *p <= '9')
+        {
+                spec->width = _number(&p);
+        }
+
+        /* precision */
+        if(*p == '.')
+        {
+                p++;
+                if(*p == '*')
+                {
+                        spec->precision = FMT_STAR;
+                        p++;
+                }
+                else
+                {
+                        spec->precision = _number(&p);
+                }
+        }
+
+        /* length modifier */
+        switch (*p)
+        {
+                case 'h':
+                {
+                        p++;
+                        spec->length = FMT_LEN_H;
+                        if(*p == 'h')
+                        {
+                                p++;
+                                spec->length = FMT_LEN_HH;
+                        }
+                        break;
+                }
+
+                case 'l':
+                {
+                        p++;
+                        spec->length = FMT_LEN_L;
+                        if(*p == 'l')
+                        {
+                                p++;
+                                spec->length = FMT_LEN_LL;
+                        }
+                        break;
+                }
+
+                case 'q':
+                {
+                        p++;
+                        spec->length = FMT_LEN_LL;
+                        break;
+                }
+
+                case 'j':
+                {
+                        p++;
+                        spec->length = FMT_LEN_J;
+                        break;
+                }
+
+                case 'z':
+                {
+                        p++;
+                        spec->length = FMT_LEN_Z;
+                        break;
+                }
+
+                case 't':
+                {
+                        p++;
+                        spec->length = FMT_LEN_T;
+                        break;
+                }
+
+                case 'L':
+                {
+                        p++;
+                        spec->length = FMT_LEN_BIGL;
+                        break;
+                }
+        }
+
+        /* conversion */
+        if(!(spec->conversion = *p))
+                return false;
+
+        spec->len = (size_t) (p + 1 - fmt);
+
+        switch (spec->conversion)
+        {
+                case '%':
+                {
+                        spec->arg = FMT_ARG_NONE;
+                        break;
+                }
+
+                case 'd':
+                case 'i':
+                case 'u':
+                case 'o':
+                case 'x':
+                case 'X':
+                {
+                        switch (spec->length)
+                        {
+                                case FMT_LEN_L:
+                                        spec->arg = FMT_ARG_LONG;
+                                        break;
+                                case FMT_LEN_LL:
+                                        spec->arg = FMT_ARG_LLONG;
+                                        break;
+                                case FMT_LEN_J:
+                                        spec->arg = FMT_ARG_INTMAX;
+                                        break;
+                                case FMT_LEN_Z:
+                                        spec->arg = FMT_ARG_SIZE;
+                                        break;
+                                case FMT_LEN_T:
+                                        spec->arg = FMT_ARG_PTRDIFF;
+                                        break;
+                                case FMT_LEN_BIGL:
+                                        spec->arg = FMT_ARG_INVALID;
+                                        break;
+                                default:
+                                        spec->arg = FMT_ARG_INT;
+                                        break;
+                        }
+                        break;
+                }
+
+                case 'c':
+                {
+                        spec->arg = (spec->length == FMT_LEN_NONE) ?
+                                FMT_ARG_INT : FMT_ARG_INVALID;
+                        break;
+                }
+
+                case 's':
+                {
+                        spec->arg = (spec->length == FMT_LEN_NONE) ?
+                                FMT_ARG_STRING : FMT_ARG_INVALID;
+                        break;
+                }
+
+                case 'p':
+                {
+                        spec->arg = FMT_ARG_POINTER;
+                        break;
+                }
+
+                case 'f':
+                case 'F':
+                case 'e':
+                case 'E':
+                case 'g':
+                case 'G':
+                case 'a':
+                case 'A':
+                {
+                        if(spec->length == FMT_LEN_BIGL)
+                                spec->arg = FMT_ARG_LDOUBLE;
+                        else if(spec->length == FMT_LEN_NONE ||
+                                spec->length == FMT_LEN_L)
+                                spec->arg = FMT_ARG_DOUBLE;
+                        else
+                                spec->arg = FMT_ARG_INVALID;
+                        break;
+                }
+
+                default:
+                {
+                        /* %n, %m, positional arguments, ... */
+                        spec->arg = FMT_ARG_INVALID;
+                        break;
+                }
+        }
+
+        return true;
+}
+
+/** two decimal digits for every number 0..99 */
+static const char _digits2[] =
+        "0001020304050607080910111213141516171819"
+        "2021222324252627282930313233343536373839"
+        "4041424344454647484950515253545556575859"
+        "6061626364656667686970717273747576777879"
+        "8081828384858687888990919293949596979899";
+/** hexadecimal digits */
+static const char _hex[] = "0123456789abcdef";
+/** upper case hexadecimal digits */
+static const char _hex_upper[] = "0123456789ABCDEF";
+/** powers of 10 that are exact doubles */
+static const double _pow10[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+
+/** highest precision handled by _fixed() */
+#define MAX_FIXED_PRECISION     22
+/** size of buffer for digits of one number */
+#define DIGITS_SIZE             64
+/** copies up to this size are done without memcpy() */
+#define SHORT_COPY              32
+
+
+
+
+/** append string to output */
+static inline void _put(FormatOut * o, const char *s, size_t len)
+{
+        if(o->pos + 1 < o->size)
+        {
+                size_t n = o->size - 1 - o->pos;
+                if(len < n)
+                        n = len;
+
+                /* most pieces are short, avoid calling memcpy() */
+                char *d = o->buf + o->pos;
+                if(n <= SHORT_COPY)
+                {
+                        for(size_t i = 0; i < n; i++)
+                                d[i] = s[i];
+                }
+                else
+                {
+                        memcpy(d, s, n);
+                }
+        }
+        o->pos += len;
+}
+
+
+/**
+ * append string to output
+ *
+ * @param[in] o output buffer
+ * @param[in] s string
+ * @param[in] len length of s
+ */
+void _format_put(FormatOut * o, const char *s, size_t len)
+{
+        _put(o, s, len);
+}
+
+
+/** append character multiple times to output */
+static inline void _fill(FormatOut * o, char c, size_t count)
+{
+        if(o->pos + 1 < o->size)
+        {
+                size_t n = o->size - 1 - o->pos;
+                if(count < n)
+                        n = count;
+
+                char *d = o->buf + o->pos;
+                for(size_t i = 0; i < n; i++)
+                        d[i] = c;
+        }
+        o->pos += count;
+}
+
+
+/**
+ * terminate output
+ *
+ * @result length of complete output (like snprintf())
+ */
+int _format_finish(FormatOut * o)
+{
+        if(o->size)
+                o->buf[o->pos < o->size ? o->pos : o->size - 1] = '\0';
+
+        return (int) o->pos;
+}
+
+
+/**
+ * write field: prefix (sign, "0x"), zeros, body padded to width
+ *
+ * @param[in] zeros amount of zeros between prefix and body
+ * @param[in] zero pad with zeros instead of spaces
+ */
+static inline void _field(FormatOut * o, const char *prefix, size_t plen,
+                   size_t zeros, const char *body, size_t blen,
+                   int width, bool left, bool zero)
+{
+        size_t len = plen + zeros + blen;
+        size_t pad = (width > 0 && (size_t) width > len) ?
+                (size_t) width - len : 0;
+
+        if(!left && !zero)
+                _fill(o, ' ', pad);
+
+        _put(o, prefix, plen);
+
+        if(zero && !left)
+                _fill(o, '0', pad);
+
+        _fill(o, '0', zeros);
+        _put(o, body, blen);
+
+        if(left)
+                _fill(o, ' ', pad);
+}
+
+
+/**
+ * convert unsigned decimal number
+ *
+ * @param[in] end end of buffer (digits are written in front of it)
+ * @result amount of digits
+ */
+static size_t _decimal(char *end, uintmax_t v)
+{
+        char *p = end;
+
+        while(v >= 100)
+        {
+                size_t d = (size_t) (v % 100) * 2;
+                v /= 100;
+                *--p = _digits2[d + 1];
+                *--p = _digits2[d];
+        }
+
+        if(v >= 10)
+        {
+                size_t d = (size_t) v *2;
+                *--p = _digits2[d + 1];
+                *--p = _digits2[d];
+        }
+        else
+        {
+                *--p = (char) ('0' + v);
+        }
+
+        return (size_t) (end - p);
+}
+
+
+/**
+ * convert unsigned number with base 8 or 16
+ *
+ * @param[in] end end of buffer (digits are written in front of it)
+ * @result amount of digits
+ */
+static size_t _power2(char *end, uintmax_t v, unsigned int shift,
+                      const char *digits)
+{
+        char *p = end;
+        uintmax_t mask = (1u << shift) - 1;
+
+        do
+        {
+                *--p = digits[v & mask];
+                v >>= shift;
+        }
+        while(v);
+
+        return (size_t) (end - p);
+}
+
+
+/** format integer conversion (d, i, u, o, x, X) */
+static bool _integer(FormatOut * o, const FormatSpec * s, int width,
+                     int precision, intmax_t value)
+{
+        char sign[2] = { 0 };
+        size_t slen = 0;
+        uintmax_t u;
+
+        if(s->conversion == 'd' || s->conversion == 'i')
+        {
+                if(s->alt)
+                        return false;
+
+                if(s->length == FMT_LEN_HH)
+                        value = (signed char) value;
+                else if(s->length == FMT_LEN_H)
+                        value = (short) value;
+
+                if(value < 0)
+                {
+                        sign[slen++] = '-';
+                        u = -(uintmax_t) value;
+                }
+                else
+                {
+                        if(s->plus)
+                                sign[slen++] = '+';
+                        else if(s->space)
+                                sign[slen++] = ' ';
+                        u = (uintmax_t) value;
+                }
+        }
+        else
+        {
+                if(s->alt && s->conversion == 'u')
+                        return false;
+
+                u = (uintmax_t) value;
+                switch (s->arg)
+                {
+                        case FMT_ARG_INT:
+                                u = (unsigned int) u;
+                                break;
+                        case FMT_ARG_LONG:
+                                u = (unsigned long) u;
+                                break;
+                        case FMT_ARG_LLONG:
+                                u = (unsigned long long) u;
+                                break;
+                        case FMT_ARG_SIZE:
+                        case FMT_ARG_PTRDIFF:
+                                u = (size_t) u;
+                                break;
+                        default:
+                                break;
+                }
+
+                if(s->length == FMT_LEN_HH)
+                        u = (unsigned char) u;
+                else if(s->length == FMT_LEN_H)
+                        u = (unsigned short) u;
+        }
+
+        char buf[DIGITS_SIZE];
+        char *end = buf + sizeof(buf);
+        size_t len;
+
+        switch (s->conversion)
+        {
+                case 'x':
+                        len = _power2(end, u, 4, _hex);
+                        break;
+                case 'X':
+                        len = _power2(end, u, 4, _hex_upper);
+                        break;
+                case 'o':
+                        len = _power2(end, u, 3, _hex);
+                        break;
+                default:
+                        len = _decimal(end, u);
+                        break;
+        }
+
+        /* precision 0 and value 0 prints no digits */
+        if(precision == 0 && u == 0)
+                len = 0;
+
+        size_t zeros = (precision > 0 && (size_t) precision > len) ?
+                (size_t) precision - len : 0;
+
+        if(s->alt)
+        {
+                /* octal: first digit must be 0 */
+                if(s->conversion == 'o')
+                {
+                        if(zeros == 0 && (len == 0 || *(end - len) != '0'))
+                                zeros = 1;
+                }
+                /* hex: "0x" prefix for values != 0 */
+                else if(u != 0)
+                {
+                        sign[0] = '0';
+                        sign[1] = s->conversion;
+                        slen = 2;
+                }
+        }
+
+        _field(o, sign, slen, zeros, end - len, len, width, s->left,
+               s->zero && precision < 0);
+
+        return true;
+}
+
+
+/**
+ * convert positive double to fixed point digits
+ *
+ * @param[out] buf buffer for digits (DIGITS_SIZE)
+ * @param[in] v value (>= 0)
+ * @param[in] precision amount of fractional digits
+ * @param[out] integer amount of integer digits
+ * @result length of digits or 0 if value can't be converted exactly
+ */
+static size_t _fixed(char *buf, double v, int precision, size_t * integer)
+{
+        if(precision > MAX_FIXED_PRECISION)
+                return 0;
+
+        /* scale to integer (10^precision is exact, one rounding error) */
+        double r = v * _pow10[precision];
+        if(r >= 9007199254740992.0)
+                return 0;
+
+        double whole = (double) (uint64_t) r;
+        double frac = r - whole;
+
+        /* too close to a tie to decide the rounding direction */
+        double err = r * 2.3e-16 + 1e-300;
+        if(frac > 0.5 - err && frac < 0.5 + err)
+                return 0;
+
+        uint64_t n = (uint64_t) whole + (frac > 0.5 ? 1 : 0);
+
+        char tmp[DIGITS_SIZE];
+        char *end = tmp + sizeof(tmp);
+        size_t len = _decimal(end, n);
+
+        /* leading zeros for values < 1 */
+        size_t p = (size_t) precision;
+        size_t total = (len > p) ? len : p + 1;
+
+        memset(buf, '0', total - len);
+        memcpy(buf + total - len, end - len, len);
+
+        *integer = total - p;
+
+        return total;
+}
+
+
+/** format floating point conversion (f, F, g, G) */
+static bool _float(FormatOut * o, const FormatSpec * s, int width,
+                   int precision, double value)
+{
+        if(s->alt || !isfinite(value))
+                return false;
+
+        char sign[1];
+        size_t slen = 0;
+        if(signbit(value))
+                sign[slen++] = '-';
+        else if(s->plus)
+                sign[slen++] = '+';
+        else if(s->space)
+                sign[slen++] = ' ';
+
+        double v = fabs(value);
+        if(precision < 0)
+                precision = 6;
+
+        char digits[DIGITS_SIZE];
+        size_t len, integer;
+        bool strip = false;
+
+        if(s->conversion == 'f' || s->conversion == 'F')
+        {
+                if(!(len = _fixed(digits, v, precision, &integer)))
+                        return false;
+        }
+        else
+        {
+                /* significant digits */
+                int p = precision ? precision : 1;
+                if(p > 15)
+                        return false;
+
+                /* decimal exponent of value rounded to p digits (log10() 
+                   is only a guess) */
+                int x = (v != 0) ? (int) floor(log10(v)) : 0;
+                for(int i = 0;; i++)
+                {
+                        /* exponential notation is left to snprintf() */
+                        if(x < -4 || x >= p || i > 2)
+                                return false;
+
+                        if(!(len = _fixed(digits, v, p - 1 - x, &integer)))
+                                return false;
+
+                        if(v == 0)
+                                break;
+
+                        /* count significant digits */
+                        size_t z = 0;
+                        while(z < len && digits[z] == '0')
+                                z++;
+
+                        if(len - z == (size_t) p)
+                                break;
+
+                        x += (len - z > (size_t) p) ? 1 : -1;
+                }
+
+                strip = true;
+        }
+
+        /* insert decimal point */
+        char body[DIGITS_SIZE + 1];
+        memcpy(body, digits, integer);
+        size_t blen = integer;
+        size_t fraction = len - integer;
+
+        /* remove trailing zeros of %g */
+        if(strip)
+        {
+                while(fraction && digits[integer + fraction - 1] == '0')
+                        fraction--;
+        }
+
+        if(fraction)
+        {
+                body[blen++] = '.';
+                memcpy(body + blen, digits + integer, fraction);
+                blen += fraction;
+        }
+
+        _field(o, sign, slen, 0, body, blen, width, s->left, s->zero);
+
+        return true;
+}
+
+
+/** snprintf() single conversion with optional width/precision arguments */
+#define _SNPRINTF(type, value) \
+        ((s->width == FMT_STAR && s->precision == FMT_STAR) ? snprintf(out, r, spec, width, precision, (type) (value)) : \
+         (s->width == FMT_STAR) ? snprintf(out, r, spec, width, (type) (value)) : \
+         (s->precision == FMT_STAR) ? snprintf(out, r, spec, precision, (type) (value)) : \
+         snprintf(out, r, spec, (type) (value)))
+
+
+/** format conversion using snprintf() */
+static void _fallback(FormatOut * o, const FormatSpec * s, int width,
+                      int precision, const FormatValue * v)
+{
+        char spec[64];
+        if(s->len >= sizeof(spec))
+                return;
+        memcpy(spec, s->start, s->len);
+        spec[s->len] = '\0';
+
+        char *out = o->buf + (o->pos < o->size ? o->pos : o->size);
+        size_t r = (o->pos < o->size) ? o->size - o->pos : 0;
+
+        int n;
+        switch (s->arg)
+        {
+                case FMT_ARG_INT:
+                        n = _SNPRINTF(int, v->i);
+                        break;
+                case FMT_ARG_LONG:
+                        n = _SNPRINTF(long, v->i);
+                        break;
+                case FMT_ARG_LLONG:
+                        n = _SNPRINTF(long long, v->i);
+                        break;
+                case FMT_ARG_INTMAX:
+                        n = _SNPRINTF(intmax_t, v->i);
+                        break;
+                case FMT_ARG_SIZE:
+                        n = _SNPRINTF(size_t, v->i);
+                        break;
+                case FMT_ARG_PTRDIFF:
+                        n = _SNPRINTF(ptrdiff_t, v->i);
+                        break;
+                case FMT_ARG_DOUBLE:
+                        n = _SNPRINTF(double, v->d);
+                        break;
+                case FMT_ARG_LDOUBLE:
+                        n = _SNPRINTF(long double, v->ld);
+                        break;
+                case FMT_ARG_STRING:
+                        n = _SNPRINTF(const char *, v->s);
+                        break;
+                case FMT_ARG_POINTER:
+                        n = _SNPRINTF(const void *, v->p);
+                        break;
+                default:
+                        n = 0;
+                        break;
+        }
+
+        if(n > 0)
+                o->pos += (size_t) n;
+}
+
+
+/**
+ * format one conversion
+ *
+ * @param[in] o output buffer
+ * @param[in] s parsed conversion (s->arg must not be FMT_ARG_INVALID)
+ * @param[in] width value of width if it's FMT_STAR
+ * @param[in] precision value of precision if it's FMT_STAR
+ * @param[in] v argument
+ */
+void _format_conversion(FormatOut * o, const FormatSpec * s, int width,
+                        int precision, const FormatValue * v)
+{
+        /* original values for snprintf() */
+        const FormatSpec *spec = s;
+        int w = width, p = precision;
+
+        /* negative width argument means '-' flag */
+        FormatSpec tmp;
+        if(s->width != FMT_STAR)
+        {
+                width = s->width;
+        }
+        else if(width < 0)
+        {
+                tmp = *s;
+                tmp.left = true;
+                width = -width;
+                s = &tmp;
+        }
+
+        /* negative precision argument is ignored */
+        if(s->precision != FMT_STAR)
+                precision = s->precision;
+        else if(precision < 0)
+                precision = FMT_NONE;
+
+        switch (s->conversion)
+        {
+                case '%':
+                {
+                        _put(o, "%", 1);
+                        return;
+                }
+
+                case 'd':
+                case 'i':
+                case 'u':
+                case 'o':
+                case 'x':
+                case 'X':
+                {
+                        if(_integer(o, s, width, precision, v->i))
+                                return;
+                        break;
+                }
+
+                case 's':
+                {
+                        if(s->zero)
+                                break;
+
+                        const char *str = v->s;
+                        if(!str)
+                                str = (precision < 0 || precision >= 6) ?
+                                        "(null)" : "";
+
+                        size_t len = (precision >= 0) ?
+                                strnlen(str, (size_t) precision) :
+                                strlen(str);
+                        _field(o, NULL, 0, 0, str, len, width, s->left,
+                               false);
+                        return;
+                }
+
+                case 'c':
+                {
+                        if(s->zero)
+                                break;
+
+                        char c = (char) (unsigned char) v->i;
+                        _field(o, NULL, 0, 0, &c, 1, width, s->left, false);
+                        return;
+                }
+
+                case 'p':
+                {
+                        if(s->zero || s->plus || s->space || s->alt ||
+                           precision >= 0)
+                                break;
+
+                        if(!v->p)
+                        {
+                                _field(o, NULL, 0, 0, "(nil)", 5, width,
+                                       s->left, false);
+                                return;
+                        }
+
+                        char buf[DIGITS_SIZE];
+                        char *end = buf + sizeof(buf);
+                        size_t len = _power2(end, (uintptr_t) v->p, 4, _hex);
+                        _field(o, "0x", 2, 0, end - len, len, width,
+                               s->left, false);
+                        return;
+                }
+
+                case 'f':
+                case 'F':
+                case 'g':
+                case 'G':
+                {
+                        if(s->arg == FMT_ARG_DOUBLE &&
+                           _float(o, s, width, precision, v->d))
+                                return;
+                        break;
+                }
+        }
+
+        _fallback(o, spec, w, p, v);
+}
+
+
+/**
+ * format message (replacement for vsnprintf()). Common conversions are
+ * handled directly, everything else is passed to snprintf() per 
+ * conversion. Unsupported format strings (positional arguments, %n, ...)
+ * are passed to vsnprintf() completely.
+ *
+ * @param[out] buf output buffer
+ * @param[in] size size of buf
+ * @param[in] fmt printf() format string
+ * @param[in] args arguments
+ * @result length of formatted message (like vsnprintf())
+ */
+int _format(char *buf, size_t size, const char *fmt, va_list args)
+{
+        FormatOut o = {.buf = buf,.size = size,.pos = 0 };
+
+        va_list ap;
+        va_copy(ap, args);
+
+        for(const char *p = fmt; *p;)
+        {
+                /* literal text */
+                const char *pct = p;
+                while(*pct && *pct != '%')
+                        pct++;
+                _put(&o, p, (size_t) (pct - p));
+                if(!*pct)
+                        break;
+
+                FormatSpec s;
+                if(!_format_spec_parse(pct, &s) || s.arg == FMT_ARG_INVALID)
+                {
+                        va_end(ap);
+                        return vsnprintf(buf, size, fmt, args);
+                }
+                p = pct + s.len;
+
+                int width = 0, precision = 0;
+                if(s.width == FMT_STAR)
+                        width = va_arg(ap, int);
+                if(s.precision == FMT_STAR)
+                        precision = va_arg(ap, int);
+
+                FormatValue v;
+                switch (s.arg)
+                {
+                        case FMT_ARG_INT:
+                                v.i = va_arg(ap, int);
+                                break;
+                        case FMT_ARG_LONG:
+                                v.i = va_arg(ap, long);
+                                break;
+                        case FMT_ARG_LLONG:
+                                v.i = va_arg(ap, long long);
+                                break;
+                        case FMT_ARG_INTMAX:
+                                v.i = va_arg(ap, intmax_t);
+                                break;
+                        case FMT_ARG_SIZE:
+                                v.i = (intmax_t) va_arg(ap, size_t);
+                                break;
+                        case FMT_ARG_PTRDIFF:
+                                v.i = va_arg(ap, ptrdiff_t);
+                                break;
+                        case FMT_ARG_DOUBLE:
+                                v.d = va_arg(ap, double);
+                                break;
+                        case FMT_ARG_LDOUBLE:
+                                v.ld = va_arg(ap, long double);
+                                break;
+                        case FMT_ARG_STRING:
+                                v.s = va_arg(ap, const char *);
+                                break;
+                        case FMT_ARG_POINTER:
+                                v.p = va_arg(ap, const void *);
+                                break;
+                        default:
+                                break;
+                }
+
+                _format_conversion(&o, &s, width, precision, &v);
+        }
+
+        va_end(ap);
+
+        return _format_finish(&o);
+}
+
+
+
+/**
+ * @}
+ */
@@ -0,0 +1,498 @@
+/*
+ * libniftylog - niftylight logging library
+ * Copyright (C) 2006-2014 Daniel Hiepler <daniel@niftylight.de>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+/**
+ * @file instance.c
+ */
+
+/**
+ * @addtogroup logger_instance
+ * @{
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include "config.h"
+#include "logger.h"
+#include "logger-mechanism.h"
+#include "logger-instance.h"
+#include "_mechanism.h"
+#include "_logger.h"
+#include "_instance.h"
+#include "_ratelimit.h"
+#include "_sample.h"
+
+
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+/** serializes changes of loggers */
+static pthread_mutex_t _mutex = PTHREAD_MUTEX_INITIALIZER;
+#define _LOCK()         pthread_mutex_lock(&_mutex)
+#define _UNLOCK()       pthread_mutex_unlock(&_mutex)
+#else
+#define _LOCK()
+#define _UNLOCK()
+#endif
+
+
+/** one logger */
+struct _NftLogger
+{
+        /** full dotted name */
+        char *name;
+        /** parent logger (NULL for root logger) */
+        NftLogger *parent;
+        /** first child */
+        NftLogger *children;
+        /** next sibling */
+        NftLogger *next;
+        /** own level (L_INVALID to inherit) */
+        NftLoglevel level;
+        /** own mechanisms (NULL to inherit) */
+        struct Mechanisms *sinks;
+        /** inherited level (L_INVALID for the global level) */
+        NftLoglevel effective;
+        /** inherited mechanisms (NULL for the current mechanisms) */
+        struct Mechanisms **target;
+        /** 
+         * most verbose level that's logged (L_INVALID until global level 
+         * is known) 
+         */
+        NftLoglevel threshold;
+};
+
+
+/** root logger (used by NFT_LOG()) */
+static NftLogger _root = {
+        .name = "",
+        .level = L_INVALID,
+        .effective = L_INVALID,
+        .threshold = L_INVALID,
+};
+
+
+
+
+/**
+ * recalculate cached state of a logger and all its descendants 
+ * (called with _mutex held)
+ */
+static void _update(NftLogger * l)
+{
+        NftLogger *p = l->parent;
+
+        NftLoglevel effective = l->level;
+        if(effective == L_INVALID && p)
+                effective = p->effective;
+
+        struct Mechanisms **target =
+                __atomic_load_n(&l->sinks, __ATOMIC_RELAXED) ? &l->sinks :
+                (p ? p->target : NULL);
+
+        NftLoglevel threshold = _mechanism_sinks_level(target, effective);
+
+        __atomic_store_n(&l->effective, effective, __ATOMIC_RELAXED);
+        __atomic_store_n(&l->target, target, __ATOMIC_RELAXED);
+        __atomic_store_n(&l->threshold, threshold, __ATOMIC_RELAXED);
+
+        for(NftLogger * c = l->children; c; c = c->next)
+                _update(c);
+}
+
+
+/**
+ * recalculate cached state of all loggers (called when global level or 
+ * current mechanisms change)
+ */
+void _instance_update()
+{
+        _LOCK();
+        _update(&_root);
+        _UNLOCK();
+}
+
+
+/**
+ * find child of logger
+ *
+ * @param[in] l parent logger
+ * @param[in] name full name of child
+ * @param[in] len length of name
+ * @result child or NULL
+ */
+static NftLogger *_child(NftLogger * l, const char *name, size_t len)
+{
+        for(NftLogger * c = l->children; c; c = c->next)
+        {
+                if(strncmp(c->name, name, len) == 0 && c->name[len] == '\0')
+                        return c;
+        }
+
+        return NULL;
+}
+
+
+/**
+ * create new child of logger (called with _mutex held)
+ *
+ * @param[in] l parent logger
+ * @param[in] name full name of child
+ * @param[in] len length of name
+ * @result new logger or NULL
+ */
+static NftLogger *_create(NftLogger * l, const char *name, size_t len)
+{
+        NftLogger *c;
+        if(!(c = calloc(1, sizeof(NftLogger))))
+        {
+                perror("calloc");
+                return NULL;
+        }
+
+        if(!(c->name = malloc(len + 1)))
+        {
+                perror("malloc");
+                free(c);
+                return NULL;
+        }
+        memcpy(c->name, name, len);
+        c->name[len] = '\0';
+
+        c->parent = l;
+        c->level = L_INVALID;
+        _update(c);
+
+        /* publish */
+        c->next = l->children;
+        __atomic_store_n(&l->children, c, __ATOMIC_RELEASE);
+
+        return c;
+}
+
+
+/**
+ * get logger by name. The logger (and all its ancestors) is created if it 
+ * doesn't exist, yet.
+ *
+ * @param[in] name dotted name of logger (e.g. "niftyled.hw.spi") or NULL/"" 
+ *            for the root logger
+ * @result @ref NftLogger or NULL upon error
+ */
+NftLogger *nft_logger_get(const char *name)
+{
+        /* make sure global level & mechanisms are initialized */
+        nft_log_level_get();
+
+        if(!name || !*name)
+                return &_root;
+
+        _LOCK();
+
+        NftLogger *l = &_root;
+        for(const char *p = name; l && *p;)
+        {
+                size_t len = strcspn(p, ".");
+                if(len == 0 || (p[len] == '.' && p[len + 1] == '\0'))
+                {
+                        fprintf(stderr, "Invalid logger name: \"%s\"\n",
+                                name);
+                        l = NULL;
+                        break;
+                }
+
+                size_t full = (size_t) (p - name) + len;
+                NftLogger *c;
+                if(!(c = _child(l, name, full)))
+                        c = _create(l, name, full);
+                l = c;
+
+                p += len;
+                if(*p == '.')
+                        p++;
+        }
+
+        _UNLOCK();
+
+        return l;
+}
+
+
+/**
+ * get name of logger
+ *
+ * @param[in] logger @ref NftLogger
+ * @result full dotted name ("" for root logger)
+ */
+const char *nft_logger_name(NftLogger * logger)
+{
+        if(!logger)
+                NFT_LOG_NULL(NULL);
+
+        return logger->name;
+}
+
+
+/**
+ * get parent of logger
+ *
+ * @param[in] logger @ref NftLogger
+ * @result parent @ref NftLogger or NULL for root logger
+ */
+NftLogger *nft_logger_parent(NftLogger * logger)
+{
+        if(!logger)
+                NFT_LOG_NULL(NULL);
+
+        return logger->parent;
+}
+
+
+/**
+ * set level of logger. Descendants without own level inherit it.
+ *
+ * @param[in] logger @ref NftLogger
+ * @param[in] level @ref NftLoglevel or L_INVALID to inherit level from 
+ *            parent (the root logger uses @ref nft_log_level_set())
+ * @result NFT_SUCCESS or NFT_FAILURE
+ */
+NftResult nft_logger_level_set(NftLogger * logger, NftLoglevel level)
+{
+        if(!logger)
+                NFT_LOG_NULL(NFT_FAILURE);
+
+        if(logger == &_root)
+                return nft_log_level_set(level);
+
+        if(level != L_INVALID && (level >= L_MIN || level <= L_MAX))
+                return NFT_FAILURE;
+
+        _LOCK();
+        logger->level = level;
+        _update(logger);
+        _UNLOCK();
+
+        return NFT_SUCCESS;
+}
+
+
+/**
+ * get level of logger
+ *
+ * @param[in] logger @ref NftLogger
+ * @result most verbose @ref NftLoglevel the logger currently logs
+ */
+NftLoglevel nft_logger_level_get(NftLogger * logger)
+{
+        if(!logger)
+                NFT_LOG_NULL(L_INVALID);
+
+        NftLoglevel t = __atomic_load_n(&logger->threshold, __ATOMIC_RELAXED);
+        if(t == L_INVALID)
+                return nft_log_level_get();
+
+        return t;
+}
+
+
+/**
+ * set logging mechanisms of logger. Descendants without own mechanisms 
+ * inherit them.
+ *
+ * @param[in] logger @ref NftLogger
+ * @param[in] spec mechanism specification as used by 
+ *            @ref nft_log_mechanism_set() or NULL to inherit mechanisms 
+ *            from parent (the root logger uses @ref nft_log_mechanism_set())
+ * @result NFT_SUCCESS or NFT_FAILURE
+ */
+NftResult nft_logger_mechanism_set(NftLogger * logger, const char *spec)
+{
+        if(!logger)
+                NFT_LOG_NULL(NFT_FAILURE);
+
+        if(logger == &_root)
+                return nft_log_mechanism_set(spec);
+
+        NftResult result = _mechanism_sinks_set(&logger->sinks, spec);
+
+        _LOCK();
+        _update(logger);
+        _UNLOCK();
+
+        return result;
+}
+
+
+/**
+ * find out if a logger would log a message of a certain level 
+ *
+ * @param[in] logger @ref NftLogger (NULL for root logger)
+ * @param[in] level @ref NftLoglevel of the message
+ * @result true if message would be logged
+ */
+bool nft_logger_is_enabled(NftLogger * logger, NftLoglevel level)
+{
+        if(!logger)
+                logger = &_root;
+
+        NftLoglevel t = __atomic_load_n(&logger->threshold, __ATOMIC_RELAXED);
+        if(t == L_INVALID)
+                return nft_log_level_is_enabled(level);
+
+        return level >= t;
+}
+
+
+/**
+ * find out if a call-site would log a message of a certain level through 
+ * a logger (used by NFT_LOGGER_LOG())
+ *
+ * @param[in] logger @ref NftLogger (NULL for root logger)
+ * @param[in] site @ref NftLogSite
+ * @param[in] level @ref NftLoglevel of the message
+ * @result true if message would be logged
+ */
+bool nft_logger_site_is_enabled(NftLogger * logger, NftLogSite * site,
+                                NftLoglevel level)
+{
+        switch (__atomic_load_n(&site->mode, __ATOMIC_RELAXED))
+        {
+                case NFT_LOG_SITE_ON:
+                        return true;
+
+                case NFT_LOG_SITE_OFF:
+                        return false;
+
+                default:
+                        return nft_logger_is_enabled(logger, level);
+        }
+}
+
+
+/**
+ * format message and pass it to the mechanisms of a logger
+ */
+static void _logger_va(NftLogger * l, NftLoglevel level,
+                       const char *file, const char *func, int line,
+                       const NftLogRecord * r, const char *msg,
+                       va_list args)
+{
+        if(!l)
+                l = &_root;
+
+        /* long prefix depends on level of logger, not on levels of its 
+           mechanisms */
+        NftLoglevel effective = __atomic_load_n(&l->effective,
+                                                __ATOMIC_RELAXED);
+        bool debug = (effective != L_INVALID ? effective :
+                      nft_log_level_get()) <= L_DEBUG;
+
+        _log_to(__atomic_load_n(&l->target, __ATOMIC_RELAXED), effective,
+                debug, level, file, func, line, r, msg, args);
+}
+
+
+/**
+ * logging function for call-sites of a logger
+ * @note DON'T CALL FUNCTION DIRECTLY! - Use the NFT_LOGGER_LOG() macro instead!
+ * @param[in] logger @ref NftLogger (NULL for root logger)
+ * @param[in] site @ref NftLogSite of the calling NFT_LOGGER_LOG() statement
+ * @param[in] level @ref NftLoglevel this message should have
+ * @param[in] msg the log-message to output
+ */
+void nft_logger_site(NftLogger * logger, NftLogSite * site,
+                     NftLoglevel level, const char *msg, ...)
+{
+        /* sampled out or call-site logging faster than its rate limit? */
+        unsigned long suppressed;
+        if(!_sample_wants(site, level) ||
+           !_ratelimit_wants(site, level, logger ? logger : &_root,
+                             &suppressed))
+                return;
+
+        if(suppressed)
+                nft_logger_log(logger, level, site->file, site->func,
+                               site->line, "suppressed %lu messages",
+                               suppressed);
+
+        NftLogRecord r = {
+                .level = level,
+                .site = site,
+                .weight = _sample_weight(site, level),
+        };
+
+        va_list ap;
+        va_start(ap, msg);
+        _logger_va(logger, level, site->file, site->func, site->line, &r,
+                   msg, ap);
+        va_end(ap);
+}
+
+
+/**
+ * log message through a logger
+ *
+ * @param[in] logger @ref NftLogger (NULL for root logger)
+ * @param[in] level @ref NftLoglevel this message should have
+ * @param[in] file __FILE__
+ * @param[in] func __FUNC__
+ * @param[in] line __line__
+ * @param[in] msg the log-message to output
+ */
+void nft_logger_log(NftLogger * logger, NftLoglevel level,
+                    const char *file, const char *func, int line,
+                    const char *msg, ...)
+{
+        if(!nft_logger_is_enabled(logger, level))
+                return;
+
+        va_list ap;
+        va_start(ap, msg);
+        _logger_va(logger, level, file, func, line, NULL, msg, ap);
+        va_end(ap);
+}
+
+
+/**
+ * @}
+ */
@@ -0,0 +1,409 @@
+/*
+ * libniftylog - niftylight logging library
+ * Copyright (C) 2006-2014 Daniel Hiepler <daniel@niftylight.de>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+/**
+ * @file json.c
+ */
+
+/**
+ * @addtogroup logger
+ * @{
+ */
+
+#include <string.h>
+#include "config.h"
+#include "_json.h"
+
+#if defined(__x86_64__) && defined(HAVE_X86INTRIN_H)
+#include <immintrin.h>
+/** SSE2 is always there on x86_64, AVX2 is checked at runtime */
+#define HAVE_JSON_SIMD
+#endif
+
+
+
+/** hex digits for \\u escapes */
+static const char _hex[] = "0123456789abcdef";
+
+
+/** implementation used by _json_escape() (chosen upon first call) */
+static JsonEscape *_impl;
+
+
+
+
+/**
+ * length of valid UTF-8 sequence at s (no overlongs, surrogates or 
+ * codepoints > U+10FFFF)
+ *
+ * @result length of sequence or 0 if it's invalid
+ */
+static size_t _utf8(const unsigned char *s, size_t len)
+{
+        unsigned char c = s[0];
+        size_t n;
+        unsigned char lo = 0x80, hi = 0xbf;
+
+        if(c >= 0xc2 && c <= 0xdf)
+                n = 2;
+        else if(c >= 0xe0 && c <= 0xef)
+        {
+                n = 3;
+                if(c == 0xe0)
+                        lo = 0xa0;
+                else if(c == 0xed)
+                        hi = 0x9f;
+        }
+        else if(c >= 0xf0 && c <= 0xf4)
+        {
+                n = 4;
+                if(c == 0xf0)
+                        lo = 0x90;
+                else if(c == 0xf4)
+                        hi = 0x8f;
+        }
+        else
+                return 0;
+
+        if(len < n || s[1] < lo || s[1] > hi)
+                return 0;
+
+        for(size_t i = 2; i < n; i++)
+        {
+                if(s[i] < 0x80 || s[i] > 0xbf)
+                        return 0;
+        }
+
+        return n;
+}
+
+
+/**
+ * escape one byte (or UTF-8 sequence) that can't be copied as-is
+ *
+ * @param[out] dst destination
+ * @param[in] room space in dst
+ * @param[in] s source
+ * @param[in] len bytes left in source
+ * @param[out] used bytes of source consumed
+ * @result bytes written to dst (0 if it didn't fit)
+ */
+static size_t _escape_one(char *dst, size_t room, const char *s, size_t len,
+                          size_t *used)
+{
+        unsigned char c = (unsigned char) s[0];
+        char e = 0;
+
+        switch (c)
+        {
+                case '"':
+                        e = '"';
+                        break;
+                case '\\':
+                        e = '\\';
+                        break;
+                case '\n':
+                        e = 'n';
+                        break;
+                case '\r':
+                        e = 'r';
+                        break;
+                case '\t':
+                        e = 't';
+                        break;
+                case '\b':
+                        e = 'b';
+                        break;
+                case '\f':
+                        e = 'f';
+                        break;
+                default:
+                        break;
+        }
+
+        *used = 1;
+
+        /* short escape */
+        if(e)
+        {
+                if(room < 2)
+                        return 0;
+
+                dst[0] = '\\';
+                dst[1] = e;
+                return 2;
+        }
+
+        /* other control character */
+        if(c < 0x20)
+        {
+                if(room < 6)
+                        return 0;
+
+                memcpy(dst, "\\u00", 4);
+                dst[4] = _hex[c >> 4];
+                dst[5] = _hex[c & 0xf];
+                return 6;
+        }
+
+        /* valid UTF-8 is copied, everything else replaced by U+FFFD */
+        size_t n;
+        if((n = _utf8((const unsigned char *) s, len)))
+        {
+                if(room < n)
+                        return 0;
+
+                memcpy(dst, s, n);
+                *used = n;
+                return n;
+        }
+
+        if(room < 6)
+                return 0;
+
+        memcpy(dst, "\\ufffd", 6);
+        return 6;
+}
+
+
+/**
+ * escape string byte by byte
+ */
+size_t _json_escape_scalar(char *dst, size_t room, const char *s,
+                           size_t len)
+{
+        size_t i = 0, o = 0;
+        while(i < len)
+        {
+                unsigned char c = (unsigned char) s[i];
+                if(c >= 0x20 && c < 0x80 && c != '"' && c != '\\')
+                {
+                        if(o >= room)
+                                break;
+
+                        dst[o++] = (char) c;
+                        i++;
+                        continue;
+                }
+
+                size_t used, n;
+                if(!(n = _escape_one(dst + o, room - o, s + i, len - i, &used)))
+                        break;
+
+                o += n;
+                i += used;
+        }
+
+        return o;
+}
+
+
+#ifdef HAVE_JSON_SIMD
+/**
+ * escape string 16 bytes at a time (SSE2). Chunks of plain ASCII are 
+ * copied, the first byte that needs attention is handled by 
+ * _escape_one().
+ */
+static size_t _json_escape_sse2(char *dst, size_t room, const char *s,
+                                size_t len)
+{
+        const __m128i quote = _mm_set1_epi8('"');
+        const __m128i backslash = _mm_set1_epi8('\\');
+        const __m128i space = _mm_set1_epi8(' ');
+
+        size_t i = 0, o = 0;
+        while(i + 16 <= len && o + 16 <= room)
+        {
+                __m128i v = _mm_loadu_si128((const __m128i *) (s + i));
+
+                /* signed compare also catches bytes >= 0x80 */
+                __m128i m = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, quote),
+                                                      _mm_cmpeq_epi8(v,
+                                                                     backslash)),
+                                         _mm_cmplt_epi8(v, space));
+                unsigned int mask = (unsigned int) _mm_movemask_epi8(m);
+
+                _mm_storeu_si128((__m128i *) (dst + o), v);
+                if(!mask)
+                {
+                        i += 16;
+                        o += 16;
+                        continue;
+                }
+
+                unsigned int n = (unsigned int) __builtin_ctz(mask);
+                i += n;
+                o += n;
+
+                size_t used, w;
+                if(!(w = _escape_one(dst + o, room - o, s + i, len - i, &used)))
+                        return o;
+
+                o += w;
+                i += used;
+        }
+
+        return o + _json_escape_scalar(dst + o, room - o, s + i, len - i);
+}
+
+
+/**
+ * escape string 32 bytes at a time (AVX2)
+ */
+__attribute__ ((target("avx2")))
+static size_t _json_escape_avx2(char *dst, size_t room, const char *s,
+                                size_t len)
+{
+        const __m256i quote = _mm256_set1_epi8('"');
+        const __m256i backslash = _mm256_set1_epi8('\\');
+        const __m256i space = _mm256_set1_epi8(' ');
+
+        size_t i = 0, o = 0;
+        while(i + 32 <= len && o + 32 <= room)
+        {
+                __m256i v = _mm256_loadu_si256((const __m256i *) (s + i));
+
+                /* signed compare also catches bytes >= 0x80 */
+                __m256i m = _mm256_or_si256(_mm256_or_si256
+                                            (_mm256_cmpeq_epi8(v, quote),
+                                             _mm256_cmpeq_epi8(v, backslash)),
+                                            _mm256_cmpgt_epi8(space, v));
+                unsigned int mask = (unsigned int) _mm256_movemask_epi8(m);
+
+                _mm256_storeu_si256((__m256i *) (dst + o), v);
+                if(!mask)
+                {
+                        i += 32;
+                        o += 32;
+                        continue;
+                }
+
+                unsigned int n = (unsigned int) __builtin_ctz(mask);
+                i += n;
+                o += n;
+
+                size_t used, w;
+                if(!(w = _escape_one(dst + o, room - o, s + i, len - i, &used)))
+                        return o;
+
+                o += w;
+                i += used;
+        }
+
+        return o + _json_escape_sse2(dst + o, room - o, s + i, len - i);
+}
+#endif
+
+
+/**
+ * check which implementations of _json_escape() this CPU supports
+ *
+ * @result bitmask of 1 << JsonImpl
+ */
+unsigned int _json_escape_supported()
+{
+        unsigned int r = 1u << JSON_SCALAR;
+#ifdef HAVE_JSON_SIMD
+        r |= 1u << JSON_SSE2;
+        __builtin_cpu_init();
+        if(__builtin_cpu_supports("avx2"))
+                r |= 1u << JSON_AVX2;
+#endif
+        return r;
+}
+
+
+/**
+ * get implementation of _json_escape()
+ *
+ * @result implementation or NULL if CPU doesn't support it
+ */
+JsonEscape *_json_escape_impl(JsonImpl impl)
+{
+        if(!(_json_escape_supported() & (1u << impl)))
+                return NULL;
+
+        switch (impl)
+        {
+#ifdef HAVE_JSON_SIMD
+                case JSON_AVX2:
+                        return _json_escape_avx2;
+                case JSON_SSE2:
+                        return _json_escape_sse2;
+#endif
+                default:
+                        return _json_escape_scalar;
+        }
+}
+
+
+/**
+ * escape string for use inside a JSON string (without quotes) using the 
+ * fastest implementation the CPU supports. Escapes & UTF-8 sequences are 
+ * never split, invalid UTF-8 is replaced by U+FFFD.
+ *
+ * @param[out] dst destination (not \0 terminated)
+ * @param[in] room space in dst
+ * @param[in] s string
+ * @param[in] len length of string
+ * @result bytes written (stops early if room is exhausted)
+ */
+size_t _json_escape(char *dst, size_t room, const char *s, size_t len)
+{
+        JsonEscape *f;
+        if(!(f = __atomic_load_n(&_impl, __ATOMIC_RELAXED)))
+        {
+                unsigned int supported = _json_escape_supported();
+                f = _json_escape_impl(supported & (1u << JSON_AVX2) ?
+                                      JSON_AVX2 :
+                                      supported & (1u << JSON_SSE2) ?
+                                      JSON_SSE2 : JSON_SCALAR);
+                __atomic_store_n(&_impl, f, __ATOMIC_RELAXED);
+        }
+
+        return f(dst, room, s, len);
+}
+
+
+/**
+ * @}
+ */
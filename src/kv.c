@@ -0,0 +1,238 @@
+/*
+ * libniftylog - niftylight logging library
+ * Copyright (C) 2006-2014 Daniel Hiepler <daniel@niftylight.de>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+/**
+ * @file kv.c
+ */
+
+/**
+ * @addtogroup logger
+ * @{
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "logger.h"
+#include "_kv.h"
+
+
+
+
+/**
+ * append bytes to buffer (truncating)
+ */
+static size_t _put(char *buf, size_t size, size_t pos, const char *s,
+                   size_t len)
+{
+        if(pos + len > size - 1)
+                len = size - 1 - pos;
+
+        memcpy(buf + pos, s, len);
+
+        return pos + len;
+}
+
+
+/**
+ * check if string value needs quotes to be parsed back
+ */
+static bool _needs_quotes(const char *s)
+{
+        if(!*s)
+                return true;
+
+        for(; *s; s++)
+        {
+                if(*s == ' ' || *s == '"' || *s == '=' || *s == '\\' ||
+                   (unsigned char) *s < 0x20)
+                        return true;
+        }
+
+        return false;
+}
+
+
+/**
+ * append quoted & escaped string
+ */
+static size_t _put_quoted(char *buf, size_t size, size_t pos, const char *s)
+{
+        pos = _put(buf, size, pos, "\"", 1);
+        for(; *s && pos < size - 1; s++)
+        {
+                char esc[2] = { '\\', *s };
+                switch (*s)
+                {
+                        case '"':
+                        case '\\':
+                        {
+                                pos = _put(buf, size, pos, esc, 2);
+                                break;
+                        }
+
+                        case '\n':
+                        {
+                                pos = _put(buf, size, pos, "\\n", 2);
+                                break;
+                        }
+
+                        default:
+                        {
+                                pos = _put(buf, size, pos, s, 1);
+                                break;
+                        }
+                }
+        }
+
+        return _put(buf, size, pos, "\"", 1);
+}
+
+
+/**
+ * render value of a field without quoting
+ *
+ * @param[out] buf destination (always \0 terminated)
+ * @param[in] size space in buf (> 0)
+ * @param[in] kv field
+ * @result length of value in buf
+ */
+size_t _kv_value(char *buf, size_t size, const NftLogKv * kv)
+{
+        int n;
+        switch (kv->type)
+        {
+                case NFT_KV_TYPE_INT:
+                {
+                        n = snprintf(buf, size, "%lld", (long long) kv->value.i);
+                        break;
+                }
+
+                case NFT_KV_TYPE_UINT:
+                {
+                        n = snprintf(buf, size, "%llu",
+                                     (unsigned long long) kv->value.u);
+                        break;
+                }
+
+                case NFT_KV_TYPE_DBL:
+                {
+                        n = snprintf(buf, size, "%g", kv->value.d);
+                        break;
+                }
+
+                case NFT_KV_TYPE_BOOL:
+                {
+                        n = snprintf(buf, size, "%s",
+                                     kv->value.b ? "true" : "false");
+                        break;
+                }
+
+                case NFT_KV_TYPE_STR:
+                {
+                        n = snprintf(buf, size, "%s",
+                                     kv->value.s ? kv->value.s : "(null)");
+                        break;
+                }
+
+                default:
+                {
+                        n = snprintf(buf, size, "?");
+                        break;
+                }
+        }
+
+        return n < 0 ? 0 : (size_t) n < size ? (size_t) n : size - 1;
+}
+
+
+/**
+ * append value of a field (strings quoted if needed)
+ */
+static size_t _put_value(char *buf, size_t size, size_t pos,
+                         const NftLogKv * kv)
+{
+        if(kv->type == NFT_KV_TYPE_STR && kv->value.s &&
+           _needs_quotes(kv->value.s))
+                return _put_quoted(buf, size, pos, kv->value.s);
+
+        return pos + _kv_value(buf + pos, size - pos, kv);
+}
+
+
+/**
+ * render structured message as text: "msg key=value key=value ..." (values
+ * are quoted if they contain spaces, quotes or '=')
+ *
+ * @param[out] buf destination (always \0 terminated)
+ * @param[in] size space in buf (> 0)
+ * @param[in] msg plain message (NULL for fields only)
+ * @param[in] kv fields
+ * @param[in] count amount of fields
+ * @result length of text in buf
+ */
+size_t _kv_render(char *buf, size_t size, const char *msg,
+                  const NftLogKv * kv, size_t count)
+{
+        size_t pos = 0;
+        if(msg)
+                pos = _put(buf, size, pos, msg, strlen(msg));
+
+        for(size_t i = 0; i < count; i++)
+        {
+                if(pos)
+                        pos = _put(buf, size, pos, " ", 1);
+
+                const char *key = kv[i].key ? kv[i].key : "(null)";
+                pos = _put(buf, size, pos, key, strlen(key));
+                pos = _put(buf, size, pos, "=", 1);
+                pos = _put_value(buf, size, pos, &kv[i]);
+        }
+
+        buf[pos] = '\0';
+
+        return pos;
+}
+
+
+/**
+ * @}
+ */
@@ -53,15 +53,58 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <malloc.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
 #include "logger-mechanism.h"
 #include "logger.h"
 #include "config.h"
 #include "_mechanism.h"
-
-
-
-/** maximum length of log-message in bytes */
-#define MAX_MSG_SIZE    4096
+#include "_site.h"
+#include "_async.h"
+#include "_format.h"
+#include "_capture.h"
+#include "_logger.h"
+#include "_instance.h"
+#include "_timestamp.h"
+#include "_clock.h"
+#include "_thread.h"
+#include "_kv.h"
+#include "_output.h"
+#include "_ratelimit.h"
+#include "_dedup.h"
+#include "_sample.h"
+
+
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#include <sched.h>
+/** serializes changes of subscribers */
+static pthread_mutex_t _subscribers_mutex = PTHREAD_MUTEX_INITIALIZER;
+#define _SUBSCRIBERS_LOCK()     pthread_mutex_lock(&_subscribers_mutex)
+#define _SUBSCRIBERS_UNLOCK()   pthread_mutex_unlock(&_subscribers_mutex)
+/** serializes nft_log_func_register() */
+static pthread_mutex_t _func_mutex = PTHREAD_MUTEX_INITIALIZER;
+#define _FUNC_LOCK()            pthread_mutex_lock(&_func_mutex)
+#define _FUNC_UNLOCK()          pthread_mutex_unlock(&_func_mutex)
+#define _YIELD()                sched_yield()
+/** serializes changes of loglevel */
+static pthread_mutex_t _level_mutex = PTHREAD_MUTEX_INITIALIZER;
+#define _LEVEL_LOCK()           pthread_mutex_lock(&_level_mutex)
+#define _LEVEL_UNLOCK()         pthread_mutex_unlock(&_level_mutex)
+#else
+#define _SUBSCRIBERS_LOCK()
+#define _SUBSCRIBERS_UNLOCK()
+#define _FUNC_LOCK()
+#define _FUNC_UNLOCK()
+#define _YIELD()
+#define _LEVEL_LOCK()
+#define _LEVEL_UNLOCK()
+#endif
+
+
+/** maximum amount of subscribers */
+#define MAX_SUBSCRIBERS         16
 
 
 /** names of existing loglevels (must be synced with NftLoglevel definition!) */
@@ -78,19 +121,76 @@ static const char *_loglevel_names[] = {
 };
 
 
+/** one registered NftLogSubscriber */
+struct Subscriber
+{
+        /** function */
+        NftLogSubscriber *func;
+        /** userdata for function */
+        void *userdata;
+        /** levels this subscriber wants */
+        unsigned int levels;
+};
+
+
+/** set of subscribers (never changed once it has been published) */
+struct Subscribers
+{
+        /** amount of subscribers */
+        int count;
+        /** subscribers in order of registration */
+        struct Subscriber s[MAX_SUBSCRIBERS];
+};
+
+
+/** function registered with nft_log_func_register() */
+struct Legacy
+{
+        /** the function */
+        NftLogFunc *func;
+        /** userdata for function */
+        void *userdata;
+};
+
+
+/** published subscribers (NULL if there are none) */
+static struct Subscribers *_subscribers;
 /** 
- * holds a pointer to an external logging function that can be registered
- * using nft_log_func_register() 
- */
-static NftLogFunc *_func;
-/**
- * userdata for registered NftLogFunc
+ * threads currently notifying a published set of subscribers (one counter
+ * per epoch parity) 
  */
-static void *_uptr;
+static unsigned int _readers[2];
+/** current epoch (new readers are counted in _readers[_epoch & 1]) */
+static unsigned int _epoch;
+/** > 0 while the calling thread notifies subscribers */
+static __thread unsigned int _notifying;
+/** levels any subscriber wants */
+static unsigned int _subscribed;
+/** sequence number of next message passed to subscribers */
+static uint64_t _sequence;
+/** function registered with nft_log_func_register() (or NULL) */
+static struct Legacy *_legacy;
 /**
  * current loglevel (fallback if ENV-Var isn't set)
  */
 static NftLoglevel _level;
+/**
+ * loglevel from environment (L_INVALID if unset or invalid)
+ */
+static NftLoglevel _env_level = L_INVALID;
+/**
+ * true as soon as the environment has been read
+ */
+static bool _env_read;
+/**
+ * loglevel from environment or nft_log_level_set() (s. nft_log_level_get())
+ */
+static NftLoglevel _configured;
+/**
+ * most verbose level any call-site, rule or mechanism logs (gate of 
+ * nft_log_level_is_enabled(), cached to avoid getenv() in nft_log())
+ */
+NftLoglevel _nft_log_level;
 
 
 
@@ -98,49 +198,331 @@ static NftLoglevel _level;
 
 
 /**
- * va_list version of nft_log (more detailed version)
+ * publish currently effective loglevel (called with _level_mutex held)
  */
-static void _log_va_debug(NftLoglevel level,
-                          const char *file,
-                          const char *func,
-                          int line, const char *msg, va_list args)
+static void _level_publish()
 {
+        NftLoglevel l = (_env_level != L_INVALID ? _env_level : _level);
+        __atomic_store_n(&_configured, l, __ATOMIC_RELAXED);
 
+        /* most verbose level any mechanism wants */
+        l = _mechanism_level(l);
 
-        char *tmp;
-        if(!(tmp = alloca(MAX_MSG_SIZE)))
+        /* update cached state of all call-sites (rules for source files 
+           might want more verbose messages) */
+        l = _site_update_all(l);
+
+        __atomic_store_n(&_nft_log_level, l, __ATOMIC_RELAXED);
+
+        /* loggers might inherit the global level */
+        _instance_update();
+}
+
+
+/**
+ * (re-)read loglevel from environment (called with _level_mutex held)
+ */
+static void _level_env_read()
+{
+        /* mark as read first, nft_log_level_from_string() might log */
+        __atomic_store_n(&_env_read, true, __ATOMIC_RELEASE);
+
+        /* default level & rules for source files */
+        _env_level = _site_spec_set(getenv(NFT_LOG_ENV_LEVEL));
+
+        _level_publish();
+}
+
+
+/**
+ * recalculate effective loglevel (used when mechanisms change)
+ */
+void _log_level_update()
+{
+        _LEVEL_LOCK();
+        if(!__atomic_load_n(&_env_read, __ATOMIC_ACQUIRE))
+                _level_env_read();
+        else
+                _level_publish();
+        _LEVEL_UNLOCK();
+}
+
+
+/**
+ * find out if messages get the long debug prefix
+ *
+ * @param[in] rule level of NFT_LOG_LEVEL rule matching the message or 
+ *            L_INVALID
+ * @result true if the level of the rule (or the configured level) is debug
+ *         or more verbose
+ */
+static bool _debug(NftLoglevel rule)
+{
+        return (rule != L_INVALID ? rule : nft_log_level_get()) <= L_DEBUG;
+}
+
+
+/**
+ * append string to message buffer (truncate at MAX_MSG_SIZE)
+ *
+ * @result new length of message
+ */
+static size_t _append(char *buf, size_t pos, const char *s, size_t len)
+{
+        if(pos + len > MAX_MSG_SIZE - 1)
+                len = MAX_MSG_SIZE - 1 - pos;
+
+        memcpy(buf + pos, s, len);
+
+        return pos + len;
+}
+
+
+/**
+ * write prefix of message to buffer:
+ * "file:line func() level: " in debug mode, "level: " for warnings and 
+ * errors, nothing otherwise. Timestamp and thread info (if enabled) go in 
+ * front.
+ *
+ * @param[in] time time of message (nanoseconds since epoch) or 0 for now
+ * @param[in] thread thread info of logging thread or NULL for calling thread
+ * @result length of prefix
+ */
+static size_t _prefix(char *buf, bool debug, NftLoglevel level,
+                      const char *file, const char *func, int line,
+                      uint64_t time, const char *thread)
+{
+        size_t pos = _timestamp(buf, MAX_MSG_SIZE - 1, time);
+
+        size_t n;
+        if(!thread)
+                thread = _thread_prefix(&n);
+        else
+                n = strlen(thread);
+        pos = _append(buf, pos, thread, n);
+
+        if(!debug && level < L_WARNING)
+                return pos;
+
+        if(debug)
         {
-                perror("alloca");
-                return;
+                /* line number */
+                char num[16];
+                size_t n = sizeof(num);
+                unsigned int v = line < 0 ? 0 : (unsigned int) line;
+                do
+                {
+                        num[--n] = (char) ('0' + v % 10);
+                        v /= 10;
+                }
+                while(v);
+
+                pos = _append(buf, pos, file, strlen(file));
+                pos = _append(buf, pos, ":", 1);
+                pos = _append(buf, pos, &num[n], sizeof(num) - n);
+                pos = _append(buf, pos, " ", 1);
+                pos = _append(buf, pos, func, strlen(func));
+                pos = _append(buf, pos, "() ", 3);
         }
 
-        /* print log-string */
-        if(vsnprintf(tmp, MAX_MSG_SIZE - 1, msg, args) < 0)
+        const char *name;
+        if(!(name = nft_log_level_to_string(level)))
+                name = "(null)";
+
+        pos = _append(buf, pos, name, strlen(name));
+        pos = _append(buf, pos, ": ", 2);
+
+        return pos;
+}
+
+
+/**
+ * check if any subscriber wants messages of this level. Subscribers only 
+ * get messages that pass the level of the matching rule (or the configured
+ * level), not messages that only a more verbose mechanism wants.
+ *
+ * @param[in] base level of rule matching the message or L_INVALID
+ * @param[in] level @ref NftLoglevel of message
+ */
+static bool _subscribers_want(NftLoglevel base, NftLoglevel level)
+{
+        if(!(__atomic_load_n(&_subscribed, __ATOMIC_RELAXED) &
+             NFT_LOG_LEVEL_BIT(level)))
+                return false;
+
+        return level >= (base != L_INVALID ? base : nft_log_level_get());
+}
+
+
+/**
+ * pass message to all subscribers that want it
+ *
+ * @param[in] buf prefix followed by message body (\0 terminated)
+ * @param[in] prefix length of prefix
+ * @param[in] len length of complete message
+ * @param[in] time time of logging (0 = now)
+ * @param[in] tid thread that logged the message (0 = calling thread)
+ * @param[in] kv fields of structured message (or NULL)
+ * @param[in] kv_count amount of fields
+ */
+static void _notify(NftLoglevel level,
+                    const char *file, const char *func, int line,
+                    const char *buf, size_t prefix, size_t len,
+                    uint64_t time, unsigned long tid,
+                    const NftLogKv * kv, size_t kv_count, unsigned int weight)
+{
+        NftLogMessage m = {
+                .level = level,
+                .file = file,
+                .func = func,
+                .line = line,
+                .prefix = buf,
+                .prefix_len = prefix,
+                .body = buf + prefix,
+                .body_len = len - prefix,
+                .time = time ? time : _log_time(),
+                .tid = tid ? tid : _log_tid(),
+                .sequence = __atomic_fetch_add(&_sequence, 1,
+                                               __ATOMIC_RELAXED),
+                .kv = kv,
+                .kv_count = kv_count,
+                .weight = weight,
+        };
+
+        /* set of subscribers isn't freed while we use it */
+        unsigned int parity = __atomic_load_n(&_epoch, __ATOMIC_ACQUIRE) & 1;
+        __atomic_add_fetch(&_readers[parity], 1, __ATOMIC_SEQ_CST);
+        _notifying++;
+
+        struct Subscribers *c = __atomic_load_n(&_subscribers,
+                                                __ATOMIC_SEQ_CST);
+        unsigned int bit = NFT_LOG_LEVEL_BIT(level);
+        for(int i = 0; c && i < c->count; i++)
         {
-                perror("vsnprintf");
-                return;
+                const struct Subscriber *s = &c->s[i];
+                if(s->levels & bit)
+                        s->func(s->userdata, &m);
         }
 
-        /* if an external function is registered, pass everything through to it 
-         */
-        if(_func)
+        _notifying--;
+        __atomic_sub_fetch(&_readers[parity], 1, __ATOMIC_RELEASE);
+}
+
+
+/**
+ * pass assembled message to subscribers & mechanisms
+ *
+ * @param[in] sinks mechanisms to use (NULL for current mechanisms)
+ * @param[in] base level for mechanisms without own level (or L_INVALID)
+ * @param[in] buf prefix followed by message body (\0 terminated)
+ * @param[in] prefix length of prefix
+ * @param[in] len length of complete message
+ * @param[in] r time, thread & fields of message (NULL for a message just 
+ *            logged by the calling thread)
+ */
+static void _dispatch(struct Mechanisms **sinks, NftLoglevel base,
+                      NftLoglevel level,
+                      const char *file, const char *func, int line,
+                      char *buf, size_t prefix, size_t len,
+                      const NftLogRecord * r)
+{
+        static const NftLogRecord now;
+        if(!r)
+                r = &now;
+
+        if(_subscribers_want(base, level))
+                _notify(level, file, func, line, buf, prefix, len, r->time,
+                        r->tid, r->kv, r->kv_count, r->weight);
+
+        /* collapse repeats of recent messages (only for current mechanisms) */
+        if(!sinks && !_dedup_wants(base, level, file, func, line,
+                                   buf + prefix, len - prefix))
+                return;
+
+        /* mechanisms get JSON object instead of text (with the plain message
+           of structured messages) */
+        if(_output_json())
         {
-                _func(_uptr, level, file, func, line, tmp);
+                char *json;
+                if(!(json = alloca(MAX_MSG_SIZE)))
+                {
+                        perror("alloca");
+                        return;
+                }
+
+                const char *body = r->kv ? r->format : buf + prefix;
+                len = _output_json_encode(json, MAX_MSG_SIZE, level, file,
+                                          func, line, r->time, r->thread,
+                                          r->weight, body, r->kv ? strlen(body) :
+                                          len - prefix, r->kv, r->kv_count);
+                buf = json;
         }
 
-        /* build message */
-        char *message;
-        if(!(message = alloca(MAX_MSG_SIZE)))
+        /* use logging mechanisms to print message */
+        _mechanism_sinks_log(sinks, base, level, buf, len);
+}
+
+
+/**
+ * length of message after printing n bytes behind prefix (like snprintf())
+ */
+static size_t _length(size_t prefix, int n)
+{
+        size_t len = prefix + (size_t) n;
+
+        return len < MAX_MSG_SIZE ? len : MAX_MSG_SIZE - 1;
+}
+
+
+/**
+ * format message behind prefix into one buffer and pass it on
+ *
+ * @param[in] sinks mechanisms to use (NULL for current mechanisms)
+ * @param[in] base level for mechanisms without own level (or L_INVALID)
+ * @param[in] r details of message (e.g. weight) or NULL
+ */
+void _log_to(struct Mechanisms **sinks, NftLoglevel base,
+             bool debug, NftLoglevel level,
+             const char *file,
+             const char *func, int line, const NftLogRecord * r,
+             const char *msg, va_list args)
+{
+        char *buf;
+        if(!(buf = alloca(MAX_MSG_SIZE)))
         {
                 perror("alloca");
                 return;
         }
 
-        snprintf(message, MAX_MSG_SIZE - 1, "%s:%d %s() %s: %s",
-                 file, line, func, nft_log_level_to_string(level), tmp);
+        size_t prefix = _prefix(buf, debug, level, file, func, line, 0,
+                                NULL);
+
+        /* print log-string */
+        int n;
+        if((n = _format(buf + prefix, MAX_MSG_SIZE - prefix, msg, args)) < 0)
+        {
+                fprintf(stderr, "Failed to print message: \"%s\"", msg);
+                perror("vsnprintf");
+                return;
+        }
+
+        _dispatch(sinks, base, level, file, func, line, buf, prefix,
+                  _length(prefix, n), r);
+}
+
 
-        /* use current logging mechanism to print message */
-        _mechanism_log(level, message);
+/**
+ * variadic version of _log_to()
+ */
+void _log_line(struct Mechanisms **sinks, NftLoglevel base,
+               NftLoglevel level, const char *file, const char *func,
+               int line, const char *msg, ...)
+{
+        va_list ap;
+        va_start(ap, msg);
+        _log_to(sinks, base, _debug(L_INVALID), level, file,
+                func, line, NULL, msg, ap);
+        va_end(ap);
 }
 
 
@@ -157,24 +539,184 @@ void nft_log(NftLoglevel level,
              const char *file,
              const char *func, int line, const char *msg, ...)
 {
-        /* get current loglevel */
-        NftLoglevel lcur = nft_log_level_get();
+        /* cheap check against cached loglevel */
+        if(!nft_log_level_is_enabled(level))
+                return;
 
-        /* filter messages by loglevel */
-        if(lcur > level)
+        /* filter messages by loglevel (of rule for file) */
+        NftLoglevel rule;
+        if(!_site_file_wants(file, level, &rule))
                 return;
 
         /* build message */
         va_list ap;
         va_start(ap, msg);
 
-        if(lcur <= L_DEBUG)
-                _log_va_debug(level, file, func, line, msg, ap);
-        else
-                nft_log_va(level, file, func, line, msg, ap);
+        _log_to(NULL, rule, _debug(rule), level, file, func, line, NULL,
+                msg, ap);
+
+        va_end(ap);
+
+}
+
+
+/**
+ * capture arguments and pass unformatted message to current mechanism
+ *
+ * @result true if message has been handled, false if it should be formatted
+ */
+static bool _log_capture(const NftLogSite * site, NftLoglevel level,
+                         const char *format, va_list args)
+{
+        char *buf;
+        if(!(buf = alloca(MAX_MSG_SIZE)))
+        {
+                perror("alloca");
+                return false;
+        }
+
+        va_list copy;
+        va_copy(copy, args);
+        int n = _capture(buf, MAX_MSG_SIZE, format, copy);
+        va_end(copy);
+
+        if(n < 0)
+                return false;
+
+        NftLogRecord r = {
+                .level = level,
+                .site = site,
+                .format = format,
+                .args = buf,
+                .args_len = (size_t) n,
+                .time = _log_time(),
+                .tid = _log_tid(),
+                .weight = _sample_weight(site, level),
+        };
+        _log_record(&r);
+
+        return true;
+}
+
+
+/**
+ * check rate limit of call-site before anything is formatted & report 
+ * dropped messages once the call-site may log again
+ *
+ * @result true if message should be logged
+ */
+static bool _log_ratelimit(NftLogSite * site, NftLoglevel level)
+{
+        unsigned long suppressed;
+        if(!_ratelimit_wants(site, level, NULL, &suppressed))
+                return false;
+
+        if(suppressed)
+                nft_log(level, site->file, site->func, site->line,
+                        "suppressed %lu messages", suppressed);
+
+        return true;
+}
+
+
+/**
+ * logging function for call-sites 
+ * @note DON'T CALL FUNCTION DIRECTLY! - Use the NFT_LOG() macro instead!
+ * @param[in] site @ref NftLogSite of the calling NFT_LOG() statement
+ * @param[in] level @ref NftLoglevel this message should have
+ * @param[in] msg the log-message to output
+ */
+void nft_log_site(NftLogSite * site, NftLoglevel level, const char *msg, ...)
+{
+        /* call-site switched off, message filtered by loglevel, sampled out 
+           or over rate limit? */
+        if(!_site_wants(site, level) || !_sample_wants(site, level) ||
+           !_log_ratelimit(site, level))
+                return;
+
+        va_list ap;
+        va_start(ap, msg);
+
+        /* let asynchronous writer thread (only possible if format string is
+           constant) or mechanism format the message? */
+        if((site->format && _async_push_deferred(site, level, ap)) ||
+           (_mechanism_records() && _log_capture(site, level, msg, ap)))
+        {
+                va_end(ap);
+                return;
+        }
+
+        /* build message */
+        NftLogRecord r = {
+                .level = level,
+                .site = site,
+                .weight = _sample_weight(site, level),
+        };
+        _log_to(NULL, _site_base(site), _debug(_site_rule(site)),
+                level, site->file, site->func, site->line, &r, msg, ap);
 
         va_end(ap);
+}
+
 
+/**
+ * logging function for structured call-sites
+ * @note DON'T CALL FUNCTION DIRECTLY! - Use the NFT_LOG_KV() macro instead!
+ * @param[in] site @ref NftLogSite of the calling NFT_LOG_KV() statement
+ * @param[in] level @ref NftLoglevel this message should have
+ * @param[in] msg the plain log-message (no format string)
+ * @param[in] kv fields of the message
+ * @param[in] count amount of fields
+ */
+void nft_log_kv(NftLogSite * site, NftLoglevel level, const char *msg,
+                const NftLogKv * kv, size_t count)
+{
+        /* call-site switched off, message filtered by loglevel, sampled out 
+           or over rate limit? */
+        if(!_site_wants(site, level) || !_sample_wants(site, level) ||
+           !_log_ratelimit(site, level))
+                return;
+
+        /* pass fields to mechanisms that handle unformatted messages (in the 
+           calling thread, fields only live as long as the caller) */
+        if(_mechanism_records())
+        {
+                NftLogRecord r = {
+                        .level = level,
+                        .site = site,
+                        .format = msg,
+                        .time = _log_time(),
+                        .tid = _log_tid(),
+                        .kv = kv,
+                        .kv_count = count,
+                        .weight = _sample_weight(site, level),
+                };
+                _log_record(&r);
+                return;
+        }
+
+        char *buf;
+        if(!(buf = alloca(MAX_MSG_SIZE)))
+        {
+                perror("alloca");
+                return;
+        }
+
+        size_t prefix = _prefix(buf, _debug(_site_rule(site)), level,
+                                site->file, site->func, site->line, 0, NULL);
+        size_t len = prefix + _kv_render(buf + prefix, MAX_MSG_SIZE - prefix,
+                                         msg, kv, count);
+
+        NftLogRecord r = {
+                .level = level,
+                .site = site,
+                .format = msg,
+                .kv = kv,
+                .kv_count = count,
+                .weight = _sample_weight(site, level),
+        };
+        _dispatch(NULL, _site_base(site), level, site->file, site->func,
+                  site->line, buf, prefix, len, &r);
 }
 
 
@@ -192,65 +734,406 @@ void nft_log_va(NftLoglevel level,
                 const char *file,
                 const char *func, int line, const char *msg, va_list args)
 {
+        _log_to(NULL, L_INVALID, false, level, file, func, line, NULL, msg,
+                args);
+}
 
 
-        char *tmp;
-        if(!(tmp = alloca(MAX_MSG_SIZE)))
+/**
+ * pass formatted message to subscribers & current mechanisms (used by the
+ * asynchronous writer thread for messages formatted there)
+ *
+ * @param[in] site @ref NftLogSite of the message
+ * @param[in] level @ref NftLoglevel this message should have
+ * @param[in] msg the formatted log-message
+ * @param[in] time time of logging
+ * @param[in] tid thread that logged the message
+ * @param[in] thread thread info of thread that logged the message
+ */
+void _log_emit(const NftLogSite * site, NftLoglevel level, char *msg,
+               uint64_t time, unsigned long tid, const char *thread)
+{
+        char *buf;
+        if(!(buf = alloca(MAX_MSG_SIZE)))
         {
                 perror("alloca");
                 return;
         }
 
-        /* print log-string */
-        if(vsnprintf((char *) tmp, MAX_MSG_SIZE - 1, msg, args) < 0)
+        size_t prefix = _prefix(buf, _debug(_site_rule(site)),
+                                level, site->file, site->func, site->line,
+                                time, thread);
+        size_t len = _append(buf, prefix, msg, strlen(msg));
+        buf[len] = '\0';
+
+        NftLogRecord r = {
+                .level = level,
+                .site = site,
+                .format = msg,
+                .time = time,
+                .tid = tid,
+                .thread = thread,
+                .weight = _sample_weight(site, level),
+        };
+        _dispatch(NULL, _site_base(site), level, site->file, site->func,
+                  site->line, buf, prefix, len, &r);
+}
+
+
+/**
+ * pass unformatted message to current mechanism. The message is only 
+ * formatted if the mechanism can't handle it or a @ref NftLogFunc is 
+ * registered.
+ *
+ * @param[in] record the unformatted message
+ */
+void _log_record(const NftLogRecord * record)
+{
+        /* nobody needs formatted message */
+        bool subscribed = _subscribers_want(_site_base(record->site),
+                                            record->level);
+        if(!subscribed && !_mechanism_text())
         {
-                fprintf(stderr, "Failed to print message: \"%s\"", msg);
-                perror("vsnprintf");
+                _mechanism_log_record(record, _site_base(record->site),
+                                      NULL, 0);
                 return;
         }
 
-        /* if an external function is registered, pass everything through to it 
-         */
-        if(_func)
+        char *buf;
+        if(!(buf = alloca(MAX_MSG_SIZE)))
         {
-                _func(_uptr, level, file, func, line, tmp);
+                perror("alloca");
+                return;
         }
 
-        /* no critical message */
-        if(level < L_WARNING)
+        const NftLogSite *site = record->site;
+        size_t prefix = _prefix(buf, _debug(_site_rule(site)),
+                                record->level, site->file, site->func,
+                                site->line, record->time, record->thread);
+
+        int n;
+        if(record->kv)
         {
-                _mechanism_log(level, tmp);
+                n = (int) _kv_render(buf + prefix, MAX_MSG_SIZE - prefix,
+                                     record->format, record->kv,
+                                     record->kv_count);
         }
-        /* warning or error message, print loglevel */
-        else
+        else if((n = _capture_render(buf + prefix, MAX_MSG_SIZE - prefix,
+                                     record->format, record->args,
+                                     record->args_len)) < 0)
+        {
+                n = snprintf(buf + prefix, MAX_MSG_SIZE - prefix, "%s",
+                             record->format);
+        }
+
+        size_t len = _length(prefix, n);
+        if(subscribed)
+        {
+                _notify(record->level, site->file, site->func, site->line,
+                        buf, prefix, len, record->time, record->tid,
+                        record->kv, record->kv_count, record->weight);
+        }
+
+        /* mechanisms that need text get JSON object instead */
+        if(_output_json())
         {
-                /* build message */
-                char *message;
-                if(!(message = alloca(MAX_MSG_SIZE)))
+                char *json;
+                if(!(json = alloca(MAX_MSG_SIZE)))
                 {
                         perror("alloca");
                         return;
                 }
 
-                snprintf(message, MAX_MSG_SIZE - 1, "%s: %s",
-                         nft_log_level_to_string(level), tmp);
+                const char *body = record->kv ? record->format : buf + prefix;
+                len = _output_json_encode(json, MAX_MSG_SIZE, record->level,
+                                          site->file, site->func, site->line,
+                                          record->time, record->thread,
+                                          record->weight, body,
+                                          record->kv ? strlen(body) :
+                                          len - prefix, record->kv,
+                                          record->kv_count);
+                buf = json;
+        }
+
+        /* formatted message is shared by all mechanisms that need it */
+        _mechanism_log_record(record, _site_base(record->site), buf, len);
+}
+
 
-                /* use current logging mechanism to print message */
-                _mechanism_log(level, message);
+/**
+ * get current time
+ *
+ * @result nanoseconds since epoch
+ */
+uint64_t _log_time()
+{
+        return _clock_ns(_clock_now());
+}
+
+
+/** id of calling thread (0 until _log_tid() has been called) */
+static __thread unsigned long _tid;
+
+
+#ifdef HAVE_PTHREAD_H
+/** registers _log_forked() once */
+static pthread_once_t _atfork_once = PTHREAD_ONCE_INIT;
+
+
+/**
+ * forget cached ids of the thread that called fork() (in the child)
+ */
+static void _log_forked()
+{
+        _tid = 0;
+        _thread_forked();
+}
+
+
+/**
+ * make sure a forked child doesn't log with the ids of its parent
+ */
+static void _log_atfork()
+{
+        pthread_atfork(NULL, NULL, _log_forked);
+}
+#endif /* HAVE_PTHREAD_H */
+
+
+/**
+ * get id of calling thread
+ *
+ * @result thread-id (process-id if threads have no own id)
+ */
+unsigned long _log_tid()
+{
+        if(!_tid)
+        {
+#ifdef HAVE_PTHREAD_H
+                pthread_once(&_atfork_once, _log_atfork);
+#endif
+#ifdef SYS_gettid
+                _tid = (unsigned long) syscall(SYS_gettid);
+#else
+                _tid = (unsigned long) getpid();
+#endif
         }
 
+        return _tid;
 }
 
 
 /**
- * register an external logging function
- * @param[in] func a @ref NftLogFunc that should output a string to the user in some way
+ * pass messages to function registered with nft_log_func_register()
+ */
+static void _func_subscriber(void *userdata, const NftLogMessage * m)
+{
+        const struct Legacy *l = userdata;
+        l->func(l->userdata, m->level, m->file, m->func, m->line, m->body);
+}
+
+
+/**
+ * register an external logging function (replaces previously registered 
+ * one, use @ref nft_log_subscribe() to register more than one function)
+ * @param[in] func a @ref NftLogFunc that should output a string to the user in some way (NULL to unregister)
  * @param[in] userdata arbitrary pointer that will be passed to the NftLogFunc
  */
 void nft_log_func_register(NftLogFunc * func, void *userdata)
 {
-        _func = func;
-        _uptr = userdata;
+        struct Legacy *l = NULL;
+        if(func)
+        {
+                if(!(l = malloc(sizeof(*l))))
+                {
+                        perror("malloc");
+                        return;
+                }
+
+                l->func = func;
+                l->userdata = userdata;
+                if(!nft_log_subscribe(_func_subscriber, l, NFT_LOG_LEVELS_ALL))
+                {
+                        free(l);
+                        l = NULL;
+                }
+        }
+
+        _FUNC_LOCK();
+        struct Legacy *old = _legacy;
+        _legacy = l;
+        _FUNC_UNLOCK();
+
+        /* old function isn't called anymore when unsubscribe returns (unless
+           we're called from a subscriber, old userdata is leaked then) */
+        if(old && nft_log_unsubscribe(_func_subscriber, old) && !_notifying)
+                free(old);
+}
+
+
+/**
+ * wait until no thread notifies a set of subscribers that has been 
+ * replaced before. The epoch is flipped twice, so readers that started 
+ * while an earlier grace period was running are waited for, too.
+ */
+static void _synchronize()
+{
+        for(int i = 0; i < 2; i++)
+        {
+                unsigned int old =
+                        __atomic_fetch_add(&_epoch, 1, __ATOMIC_SEQ_CST) & 1;
+
+                while(__atomic_load_n(&_readers[old], __ATOMIC_SEQ_CST))
+                        _YIELD();
+        }
+}
+
+
+/**
+ * publish new set of subscribers (called with _subscribers_mutex held)
+ *
+ * @param[in] c new set (freed if it's empty)
+ * @result previous set to pass to _subscribers_retire()
+ */
+static struct Subscribers *_subscribers_publish(struct Subscribers *c)
+{
+        unsigned int levels = 0;
+        for(int i = 0; c && i < c->count; i++)
+                levels |= c->s[i].levels;
+
+        if(c && !c->count)
+        {
+                free(c);
+                c = NULL;
+        }
+
+        struct Subscribers *old = _subscribers;
+        __atomic_store_n(&_subscribers, c, __ATOMIC_SEQ_CST);
+        __atomic_store_n(&_subscribed, levels, __ATOMIC_RELEASE);
+
+        return old;
+}
+
+
+/**
+ * free replaced set of subscribers once no thread uses it anymore (called
+ * without _subscribers_mutex, so subscribers may (un)subscribe). A 
+ * subscriber can't wait for itself, the set is leaked then.
+ */
+static void _subscribers_retire(struct Subscribers *old)
+{
+        if(!old || _notifying)
+                return;
+
+        _synchronize();
+        free(old);
+}
+
+
+/**
+ * register a function that gets every log-message with a level in levels.
+ * Messages still have to pass the current loglevel. Subscribers are called
+ * in the thread that formats the message (the writer thread when 
+ * formatting is deferred).
+ *
+ * @param[in] func @ref NftLogSubscriber to register
+ * @param[in] userdata arbitrary pointer that will be passed to func
+ * @param[in] levels mask of wanted levels (e.g. NFT_LOG_LEVELS_ALL or 
+ *            NFT_LOG_LEVELS_FROM(L_WARNING) | NFT_LOG_LEVEL_BIT(L_DEBUG))
+ * @result NFT_SUCCESS or NFT_FAILURE if too many functions are registered
+ */
+NftResult nft_log_subscribe(NftLogSubscriber * func, void *userdata,
+                            unsigned int levels)
+{
+        if(!func)
+                return NFT_FAILURE;
+
+        _SUBSCRIBERS_LOCK();
+
+        struct Subscribers *old = _subscribers, *c;
+        if(old && old->count == MAX_SUBSCRIBERS)
+        {
+                _SUBSCRIBERS_UNLOCK();
+                fprintf(stderr, "Too many log subscribers (max. %d)\n",
+                        MAX_SUBSCRIBERS);
+                return NFT_FAILURE;
+        }
+
+        if(!(c = malloc(sizeof(*c))))
+        {
+                _SUBSCRIBERS_UNLOCK();
+                perror("malloc");
+                return NFT_FAILURE;
+        }
+
+        /* copy current subscribers & append new one */
+        c->count = 0;
+        if(old)
+                *c = *old;
+        c->s[c->count].func = func;
+        c->s[c->count].userdata = userdata;
+        c->s[c->count].levels = levels;
+        c->count++;
+
+        old = _subscribers_publish(c);
+
+        _SUBSCRIBERS_UNLOCK();
+
+        _subscribers_retire(old);
+
+        return NFT_SUCCESS;
+}
+
+
+/**
+ * unregister a function registered with @ref nft_log_subscribe(). When 
+ * this returns, func isn't running anymore (unless this is called from a 
+ * subscriber), so userdata may be freed.
+ *
+ * @param[in] func registered @ref NftLogSubscriber
+ * @param[in] userdata userdata given upon registration
+ * @result NFT_SUCCESS or NFT_FAILURE if func wasn't registered
+ */
+NftResult nft_log_unsubscribe(NftLogSubscriber * func, void *userdata)
+{
+        _SUBSCRIBERS_LOCK();
+
+        struct Subscribers *old = _subscribers, *c;
+        int found = -1;
+        for(int i = 0; old && i < old->count && found < 0; i++)
+        {
+                if(old->s[i].func == func && old->s[i].userdata == userdata)
+                        found = i;
+        }
+
+        if(found < 0)
+        {
+                _SUBSCRIBERS_UNLOCK();
+                return NFT_FAILURE;
+        }
+
+        if(!(c = malloc(sizeof(*c))))
+        {
+                _SUBSCRIBERS_UNLOCK();
+                perror("malloc");
+                return NFT_FAILURE;
+        }
+
+        /* copy all other subscribers */
+        c->count = 0;
+        for(int i = 0; i < old->count; i++)
+        {
+                if(i != found)
+                        c->s[c->count++] = old->s[i];
+        }
+
+        old = _subscribers_publish(c);
+
+        _SUBSCRIBERS_UNLOCK();
+
+        _subscribers_retire(old);
+
+        return NFT_SUCCESS;
 }
 
 
@@ -261,44 +1144,61 @@ void nft_log_func_register(NftLogFunc * func, void *userdata)
  */
 NftResult nft_log_level_set(NftLoglevel loglevel)
 {
-        /** @todo lock for threading */
         if(loglevel >= L_MIN || loglevel <= L_MAX)
                 return NFT_FAILURE;
 
-        /* the envirnoment variable always wins */
-        char *env;
-        if((env = getenv(NFT_LOG_ENV_LEVEL)))
-        {
-                /* only set loglevel if it's valid */
-                NftLoglevel l;
-                if((l = nft_log_level_from_string(env)) != L_INVALID)
-                {
-                        _level = l;
-                        return NFT_SUCCESS;
-                }
-        }
+        /* mechanisms take part in the effective level */
+        _mechanism_init();
+
+        _LEVEL_LOCK();
 
         /* set new loglevel */
         _level = loglevel;
 
+        /* the envirnoment variable always wins (only if it's valid) */
+        _level_env_read();
+
+        _LEVEL_UNLOCK();
+
         return NFT_SUCCESS;
 }
 
 
 /**
- * get current loglevel
+ * get current loglevel as set by the NFT_LOG_LEVEL environment variable or
+ * @ref nft_log_level_set(). Rules for source files and mechanisms with 
+ * their own level might log more verbose messages (s. 
+ * @ref nft_log_level_is_enabled()).
  * @result the current @ref NftLoglevel
  */
 NftLoglevel nft_log_level_get()
 {
-        /* valid environment variable set? */
-        NftLoglevel l = nft_log_level_from_string(getenv(NFT_LOG_ENV_LEVEL));
-        if(l >= L_MIN || l <= L_MAX)
+        /* environment not read, yet? */
+        if(!__atomic_load_n(&_env_read, __ATOMIC_ACQUIRE))
         {
-                return _level;
+                _mechanism_init();
+
+                _LEVEL_LOCK();
+                if(!__atomic_load_n(&_env_read, __ATOMIC_ACQUIRE))
+                        _level_env_read();
+                _LEVEL_UNLOCK();
         }
 
-        return l;
+        return __atomic_load_n(&_configured, __ATOMIC_RELAXED);
+}
+
+
+/**
+ * re-read loglevel from the NFT_LOG_LEVEL environment variable. The 
+ * environment is only read once, so call this after changing it at runtime.
+ */
+void nft_log_level_reload()
+{
+        _mechanism_init();
+
+        _LEVEL_LOCK();
+        _level_env_read();
+        _LEVEL_UNLOCK();
 }
 
 
@@ -348,6 +1248,27 @@ NftLoglevel nft_log_level_from_string(const char *name)
 }
 
 
+/**
+ * parse exact name of loglevel without logging anything (usable while 
+ * logging, e.g. for environment variables read upon first message)
+ *
+ * @param[in] name printable name of loglevel (not necessarily terminated)
+ * @param[in] len length of name
+ * @result NftLoglevel or L_INVALID
+ */
+NftLoglevel _log_level_parse(const char *name, size_t len)
+{
+        for(NftLoglevel l = L_MAX + 1; l < L_MIN; l++)
+        {
+                const char *n = _loglevel_names[l - 1];
+                if(strncmp(name, n, len) == 0 && n[len] == '\0')
+                        return l;
+        }
+
+        return L_INVALID;
+}
+
+
 /**
  * find out if loglevel a is more noisy than loglevel b
  *
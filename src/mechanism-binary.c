@@ -0,0 +1,331 @@
+/*
+ * libniftylog - niftylight logging library
+ * Copyright (C) 2006-2014 Daniel Hiepler <daniel@niftylight.de>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+/**
+ * @file mechanism-binary.c
+ */
+
+/**
+ * @addtogroup logger_mechanism_binary
+ * @{
+ */
+
+#ifndef WIN32
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "config.h"
+#include "logger-mechanism.h"
+#include "_logger.h"
+#include "_capture.h"
+#include "_kv.h"
+#include "_binary.h"
+
+
+
+#define NFT_LOG_ENV_BINARY_FILE         "NFT_LOG_BINARY_FILE"
+#define NFT_LOG_DEFAULT_BINARY_FILE     PACKAGE ".bin"
+
+/** size of output buffer in bytes */
+#define BUFFER_SIZE                     (256*1024)
+/** initial amount of entries in call-site map (must be power of 2) */
+#define SITES_INITIAL                   256
+
+
+static NftLogMechanism _mechanism;
+
+
+/** call-site map entry */
+struct SiteId
+{
+        /** call-site (NULL if entry is unused) */
+        const NftLogSite *site;
+        /** id written to file */
+        uint32_t id;
+};
+
+
+/** output file */
+static FILE *_file;
+/** call-site map (open addressing) */
+static struct SiteId *_sites;
+/** amount of entries in call-site map */
+static size_t _sites_size;
+/** amount of used entries in call-site map (= last id) */
+static uint32_t _sites_count;
+
+
+
+
+/** hash call-site pointer */
+static size_t _hash(const NftLogSite * site)
+{
+        return (size_t) (((uintptr_t) site >> 3) * 0x9E3779B97F4A7C15ULL);
+}
+
+
+/** insert entry into call-site map */
+static void _map_insert(struct SiteId *map, size_t size,
+                        const NftLogSite * site, uint32_t id)
+{
+        size_t i = _hash(site) & (size - 1);
+        while(map[i].site)
+                i = (i + 1) & (size - 1);
+
+        map[i].site = site;
+        map[i].id = id;
+}
+
+
+/** double size of call-site map */
+static bool _map_grow()
+{
+        size_t size = _sites_size ? _sites_size * 2 : SITES_INITIAL;
+
+        struct SiteId *map;
+        if(!(map = calloc(size, sizeof(struct SiteId))))
+        {
+                perror("calloc");
+                return false;
+        }
+
+        for(size_t i = 0; i < _sites_size; i++)
+        {
+                if(_sites[i].site)
+                        _map_insert(map, size, _sites[i].site, _sites[i].id);
+        }
+
+        free(_sites);
+        _sites = map;
+        _sites_size = size;
+
+        return true;
+}
+
+
+/** 
+ * get id of call-site, write dictionary entry if site is new 
+ * @result id or 0 upon error
+ */
+static uint32_t _site_id(const NftLogSite * site)
+{
+        /* known site? */
+        if(_sites_size)
+        {
+                size_t i = _hash(site) & (_sites_size - 1);
+                while(_sites[i].site)
+                {
+                        if(_sites[i].site == site)
+                                return _sites[i].id;
+
+                        i = (i + 1) & (_sites_size - 1);
+                }
+        }
+
+        /* keep map at least half empty */
+        if((size_t) (_sites_count + 1) * 2 > _sites_size && !_map_grow())
+                return 0;
+
+        uint32_t id = ++_sites_count;
+        _map_insert(_sites, _sites_size, site, id);
+
+        /* write dictionary entry */
+        BinarySite s = {
+                .type = BINARY_SITE,
+                .id = id,
+                .line = site->line,
+                .file_len = strlen(site->file) + 1,
+                .func_len = strlen(site->func) + 1,
+                .format_len = strlen(site->format) + 1,
+        };
+        fwrite(&s, sizeof(s), 1, _file);
+        fwrite(site->file, s.file_len, 1, _file);
+        fwrite(site->func, s.func_len, 1, _file);
+        fwrite(site->format, s.format_len, 1, _file);
+
+        return id;
+}
+
+
+/** write message record */
+static void _write(NftLoglevel level, uint32_t site, uint64_t time,
+                   unsigned long tid, const void *data, size_t len)
+{
+        BinaryMessage m = {
+                .type = BINARY_MESSAGE,
+                .level = (uint8_t) level,
+                .site = site,
+                .time = time,
+                .tid = (uint32_t) tid,
+                .len = (uint32_t) len,
+        };
+        fwrite(&m, sizeof(m), 1, _file);
+        fwrite(data, len, 1, _file);
+
+        /* don't lose important messages */
+        if(level >= L_WARNING)
+                fflush(_file);
+}
+
+
+/** initialize logging mechanism */
+static NftResult _init()
+{
+        const char *path;
+        if(!(path = getenv(NFT_LOG_ENV_BINARY_FILE)))
+                path = NFT_LOG_DEFAULT_BINARY_FILE;
+
+        if(!(_file = fopen(path, "ab")))
+        {
+                fprintf(stderr, "Failed to open \"%s\": ", path);
+                perror("fopen");
+                return NFT_FAILURE;
+        }
+
+        setvbuf(_file, NULL, _IOFBF, BUFFER_SIZE);
+
+        /* every header starts a new dictionary */
+        BinaryHeader h = {
+                .magic = BINARY_MAGIC,
+                .version = BINARY_VERSION,
+                .byteorder = BINARY_BYTEORDER,
+                .sizes = BINARY_SIZES,
+        };
+        if(fwrite(&h, sizeof(h), 1, _file) != 1)
+        {
+                perror("fwrite");
+                fclose(_file);
+                _file = NULL;
+                return NFT_FAILURE;
+        }
+
+        return NFT_SUCCESS;
+}
+
+
+/** deinitialize logging mechanism */
+static void _deinit()
+{
+        if(_file)
+        {
+                fclose(_file);
+                _file = NULL;
+        }
+
+        free(_sites);
+        _sites = NULL;
+        _sites_size = 0;
+        _sites_count = 0;
+}
+
+
+/** logging function for formatted messages */
+static void _log(NftLoglevel level, const char *msg, size_t len)
+{
+        if(!_file)
+                return;
+
+        flockfile(_file);
+        _write(level, 0, _log_time(), _log_tid(), msg, len);
+        funlockfile(_file);
+}
+
+
+/** logging function for unformatted messages */
+static void _record(const NftLogRecord * r)
+{
+        if(!_file)
+                return;
+
+        flockfile(_file);
+
+        /* structured messages are stored as text */
+        uint32_t id;
+        if(!r->kv && r->site->format && (id = _site_id(r->site)))
+        {
+                _write(r->level, id, r->time, r->tid, r->args, r->args_len);
+        }
+        /* store as text */
+        else
+        {
+                char msg[MAX_MSG_SIZE];
+                if(r->kv)
+                        _kv_render(msg, sizeof(msg), r->format, r->kv,
+                                   r->kv_count);
+                else if(_capture_render(msg, sizeof(msg), r->format, r->args,
+                                        r->args_len) < 0)
+                        snprintf(msg, sizeof(msg), "%s", r->format);
+
+                _write(r->level, 0, r->time, r->tid, msg, strlen(msg));
+        }
+
+        funlockfile(_file);
+}
+
+
+/** 
+ * return descriptor for this mechanism 
+ * @result NftLogMechanism descriptor 
+ */
+NftLogMechanism *nft_log_mechanism_binary()
+{
+        return &_mechanism;
+}
+
+
+
+/* descriptor */
+static NftLogMechanism _mechanism = {
+        .name = "binary",
+        .log = &_log,
+        .record = &_record,
+        .init = &_init,
+        .deinit = &_deinit,
+};
+
+
+#endif
+
+/**
+ * @}
+ */
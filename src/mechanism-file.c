@@ -0,0 +1,438 @@
+/*
+ * libniftylog - niftylight logging library
+ * Copyright (C) 2006-2014 Daniel Hiepler <daniel@niftylight.de>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+/**
+ * @file mechanism-file.c
+ */
+
+/**
+ * @addtogroup logger_mechanism_file
+ * @{
+ */
+
+#ifndef WIN32
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <limits.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include "config.h"
+#include "logger-mechanism.h"
+#include "_env.h"
+#include "_flusher.h"
+
+
+
+#define NFT_LOG_ENV_FILE                        "NFT_LOG_FILE"
+#define NFT_LOG_ENV_FILE_BUFFER                 "NFT_LOG_FILE_BUFFER"
+#define NFT_LOG_ENV_FILE_FLUSH                  "NFT_LOG_FILE_FLUSH"
+#define NFT_LOG_ENV_FILE_ROTATE_SIZE            "NFT_LOG_FILE_ROTATE_SIZE"
+#define NFT_LOG_ENV_FILE_ROTATE_INTERVAL        "NFT_LOG_FILE_ROTATE_INTERVAL"
+#define NFT_LOG_ENV_FILE_KEEP                   "NFT_LOG_FILE_KEEP"
+
+#define NFT_LOG_DEFAULT_FILE                    PACKAGE ".log"
+#define NFT_LOG_DEFAULT_FILE_BUFFER             (64*1024)
+#define NFT_LOG_DEFAULT_FILE_FLUSH              1000
+#define NFT_LOG_DEFAULT_FILE_KEEP               5
+
+
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#define _LOCK(m)        pthread_mutex_lock(&(m))
+#define _UNLOCK(m)      pthread_mutex_unlock(&(m))
+/** protects active buffer */
+static pthread_mutex_t _buffer_mutex = PTHREAD_MUTEX_INITIALIZER;
+/** protects file & the buffer that's currently written */
+static pthread_mutex_t _io_mutex = PTHREAD_MUTEX_INITIALIZER;
+#else
+#define _LOCK(m)
+#define _UNLOCK(m)
+#endif
+
+
+static NftLogMechanism _mechanism;
+
+
+/** message buffer */
+struct Buffer
+{
+        /** buffered messages */
+        char *data;
+        /** amount of used bytes */
+        size_t len;
+};
+
+
+/** state of this mechanism */
+static struct
+{
+        /** path of logfile */
+        char path[PATH_MAX];
+        /** file descriptor or -1 */
+        int fd;
+        /** both buffers */
+        struct Buffer buffers[2];
+        /** buffer that's currently filled */
+        struct Buffer *active;
+        /** size of each buffer */
+        size_t size;
+        /** time the first message was put into active buffer (ms) */
+        uint64_t first;
+        /** flush interval (ms) */
+        uint64_t flush;
+        /** rotate file when it's bigger than this (0 = never) */
+        uint64_t rotate_size;
+        /** rotate file after this interval (s, 0 = never) */
+        uint64_t rotate_interval;
+        /** time of next rotation (ms) */
+        uint64_t next_rotation;
+        /** current size of logfile */
+        uint64_t written;
+        /** amount of rotated files to keep */
+        unsigned int keep;
+        /** writes buffered messages every flush interval */
+        struct Flusher *flusher;
+} _f = {
+        .fd = -1,
+};
+
+
+/** monotonic time in milliseconds */
+static uint64_t _ms()
+{
+        struct timespec t;
+#ifdef CLOCK_MONOTONIC_COARSE
+        clock_gettime(CLOCK_MONOTONIC_COARSE, &t);
+#else
+        clock_gettime(CLOCK_MONOTONIC, &t);
+#endif
+        return (uint64_t) t.tv_sec * 1000 + (uint64_t) t.tv_nsec / 1000000;
+}
+
+
+/** open logfile */
+static int _open(int flags)
+{
+        int fd;
+        if((fd = open(_f.path, O_WRONLY | O_CREAT | O_APPEND | flags, 0644)) < 0)
+        {
+                fprintf(stderr, "Failed to open \"%s\": ", _f.path);
+                perror("open");
+        }
+
+        return fd;
+}
+
+
+/** write all iovecs to logfile */
+static void _write(struct iovec *iov, int count)
+{
+        while(count > 0)
+        {
+                ssize_t n;
+                if((n = writev(_f.fd, iov, count)) < 0)
+                {
+                        if(errno == EINTR)
+                                continue;
+
+                        perror("writev");
+                        return;
+                }
+
+                _f.written += (uint64_t) n;
+
+                /* skip written data */
+                while(count > 0 && (size_t) n >= iov->iov_len)
+                {
+                        n -= (ssize_t) iov->iov_len;
+                        iov++;
+                        count--;
+                }
+                if(count > 0)
+                {
+                        iov->iov_base = (char *) iov->iov_base + n;
+                        iov->iov_len -= (size_t) n;
+                }
+        }
+}
+
+
+/** rename logfiles and open new one */
+static void _rotate(uint64_t now)
+{
+        char from[PATH_MAX + 16], to[PATH_MAX + 16];
+
+        for(unsigned int i = _f.keep; i > 1; i--)
+        {
+                snprintf(from, sizeof(from), "%s.%u", _f.path, i - 1);
+                snprintf(to, sizeof(to), "%s.%u", _f.path, i);
+                rename(from, to);
+        }
+
+        if(_f.keep)
+        {
+                snprintf(to, sizeof(to), "%s.1", _f.path);
+                rename(_f.path, to);
+        }
+
+        /* continue with old file if new one can't be opened */
+        int fd;
+        if((fd = _open(O_TRUNC)) >= 0)
+        {
+                close(_f.fd);
+                _f.fd = fd;
+                _f.written = 0;
+        }
+
+        _f.next_rotation = now + _f.rotate_interval * 1000;
+}
+
+
+/**
+ * write active buffer (followed by msg if given) to file. Other threads 
+ * continue to log into the second buffer meanwhile.
+ */
+static void _flush(const char *msg, size_t len, uint64_t now)
+{
+        _LOCK(_io_mutex);
+
+        if(_f.fd < 0)
+        {
+                _UNLOCK(_io_mutex);
+                return;
+        }
+
+        /* swap buffers (second buffer is empty while we hold _io_mutex) */
+        _LOCK(_buffer_mutex);
+        struct Buffer *full = _f.active;
+        _f.active = (full == &_f.buffers[0]) ? &_f.buffers[1] : &_f.buffers[0];
+        _UNLOCK(_buffer_mutex);
+
+        struct iovec iov[3] = {
+                {.iov_base = full->data,.iov_len = full->len},
+                {.iov_base = (void *) msg,.iov_len = len},
+                {.iov_base = "\n",.iov_len = 1},
+        };
+        _write(iov, msg ? 3 : 1);
+        full->len = 0;
+
+        if((_f.rotate_size && _f.written >= _f.rotate_size) ||
+           (_f.rotate_interval && now >= _f.next_rotation))
+        {
+                _rotate(now);
+        }
+
+        _UNLOCK(_io_mutex);
+}
+
+
+/** write buffered messages (called by flusher thread) */
+static void _tick()
+{
+        _LOCK(_buffer_mutex);
+        bool pending = _f.active && _f.active->len;
+        _UNLOCK(_buffer_mutex);
+
+        if(pending)
+                _flush(NULL, 0, _ms());
+}
+
+
+/** write pending messages at exit */
+__attribute__ ((destructor))
+static void _exit_flush()
+{
+        _flush(NULL, 0, _ms());
+}
+
+
+/** initialize logging mechanism */
+static NftResult _init()
+{
+        const char *path;
+        if(!(path = getenv(NFT_LOG_ENV_FILE)))
+                path = NFT_LOG_DEFAULT_FILE;
+
+        if(strlen(path) >= sizeof(_f.path))
+        {
+                fprintf(stderr, "Path too long: \"%s\"\n", path);
+                return NFT_FAILURE;
+        }
+        strcpy(_f.path, path);
+
+        _f.size = _env_size(NFT_LOG_ENV_FILE_BUFFER,
+                            NFT_LOG_DEFAULT_FILE_BUFFER);
+        _f.flush = _env_number(NFT_LOG_ENV_FILE_FLUSH,
+                               NFT_LOG_DEFAULT_FILE_FLUSH);
+        _f.rotate_size = _env_size(NFT_LOG_ENV_FILE_ROTATE_SIZE, 0);
+        _f.rotate_interval = _env_interval(NFT_LOG_ENV_FILE_ROTATE_INTERVAL, 0);
+        _f.keep = (unsigned int) _env_number(NFT_LOG_ENV_FILE_KEEP,
+                                             NFT_LOG_DEFAULT_FILE_KEEP);
+
+        for(int i = 0; i < 2; i++)
+        {
+                _f.buffers[i].len = 0;
+                if(!(_f.buffers[i].data = malloc(_f.size + 1)))
+                {
+                        perror("malloc");
+                        free(_f.buffers[0].data);
+                        _f.buffers[0].data = NULL;
+                        return NFT_FAILURE;
+                }
+        }
+        _f.active = &_f.buffers[0];
+
+        int fd;
+        if((fd = _open(0)) < 0)
+        {
+                free(_f.buffers[0].data);
+                free(_f.buffers[1].data);
+                _f.buffers[0].data = _f.buffers[1].data = NULL;
+                return NFT_FAILURE;
+        }
+
+        /* existing content counts for rotation */
+        struct stat st;
+        _f.written = (fstat(fd, &st) == 0) ? (uint64_t) st.st_size : 0;
+        _f.next_rotation = _ms() + _f.rotate_interval * 1000;
+
+        _LOCK(_io_mutex);
+        _f.fd = fd;
+        _UNLOCK(_io_mutex);
+
+        /* write buffered messages even if no further message arrives */
+        if(_f.flush)
+                _f.flusher = _flusher_start(_f.flush, _tick);
+
+        return NFT_SUCCESS;
+}
+
+
+/** deinitialize logging mechanism */
+static void _deinit()
+{
+        _flusher_stop(_f.flusher);
+        _f.flusher = NULL;
+
+        _flush(NULL, 0, _ms());
+
+        _LOCK(_io_mutex);
+        if(_f.fd >= 0)
+        {
+                close(_f.fd);
+                _f.fd = -1;
+        }
+        free(_f.buffers[0].data);
+        free(_f.buffers[1].data);
+        _f.buffers[0].data = _f.buffers[1].data = NULL;
+        _UNLOCK(_io_mutex);
+}
+
+
+/** main logging function */
+static void _log(NftLoglevel level, const char *msg, size_t len)
+{
+        uint64_t now = _ms();
+
+        _LOCK(_buffer_mutex);
+
+        struct Buffer *b = _f.active;
+        if(!b || !b->data)
+        {
+                _UNLOCK(_buffer_mutex);
+                return;
+        }
+
+        /* just append to buffer? */
+        if(level < L_WARNING && b->len + len + 1 <= _f.size &&
+           (b->len == 0 || now - _f.first < _f.flush))
+        {
+                if(b->len == 0)
+                        _f.first = now;
+
+                memcpy(b->data + b->len, msg, len);
+                b->data[b->len + len] = '\n';
+                b->len += len + 1;
+
+                _UNLOCK(_buffer_mutex);
+                return;
+        }
+
+        _UNLOCK(_buffer_mutex);
+
+        /* write buffer together with this message */
+        _flush(msg, len, now);
+}
+
+
+/** 
+ * return descriptor for this mechanism 
+ * @result NftLogMechanism descriptor 
+ */
+NftLogMechanism *nft_log_mechanism_file()
+{
+        return &_mechanism;
+}
+
+
+
+/* descriptor */
+static NftLogMechanism _mechanism = {
+        .name = "file",
+        .log = &_log,
+        .init = &_init,
+        .deinit = &_deinit,
+};
+
+
+#endif
+
+/**
+ * @}
+ */
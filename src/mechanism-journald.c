@@ -0,0 +1,515 @@
+/*
+ * libniftylog - niftylight logging library
+ * Copyright (C) 2006-2014 Daniel Hiepler <daniel@niftylight.de>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+/**
+ * @file mechanism-journald.c
+ */
+
+/**
+ * @addtogroup logger_mechanism_journald
+ * @{
+ */
+
+#ifndef WIN32
+
+/* memfd_create() */
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <syslog.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include "config.h"
+#include "logger-mechanism.h"
+#include "_logger.h"
+#include "_capture.h"
+#include "_kv.h"
+#include "_env.h"
+
+
+
+#define NFT_LOG_ENV_IDENT               "NFT_LOG_IDENT"
+#define NFT_LOG_ENV_JOURNAL_SOCKET      "NFT_LOG_JOURNAL_SOCKET"
+#define NFT_LOG_ENV_JOURNAL_SNDBUF      "NFT_LOG_JOURNAL_SNDBUF"
+
+#define NFT_LOG_DEFAULT_IDENT           PACKAGE
+#define NFT_LOG_DEFAULT_JOURNAL_SOCKET  "/run/systemd/journal/socket"
+#define NFT_LOG_DEFAULT_JOURNAL_SNDBUF  (8*1024*1024)
+
+/** maximum length of MESSAGE field rendered from unformatted messages */
+#define JOURNAL_MSG_SIZE        (16*1024)
+/** maximum amount of structured fields (s. NFT_LOG_KV()) per entry */
+#define MAX_KV_FIELDS           16
+/** maximum length of names & rendered values of structured fields */
+#define MAX_KV_SIZE             64
+/** maximum amount of fields per entry */
+#define MAX_FIELDS              (8 + MAX_KV_FIELDS)
+/** maximum amount of iovecs per entry (5 per field) */
+#define MAX_IOVECS              (MAX_FIELDS * 5)
+
+
+static NftLogMechanism _mechanism;
+
+
+/** one journal entry in native protocol */
+struct Entry
+{
+        /** data of all fields */
+        struct iovec iov[MAX_IOVECS];
+        int count;
+        /** little-endian length of fields in binary-safe encoding */
+        unsigned char sizes[MAX_FIELDS][8];
+        int nsizes;
+        /** CODE_LINE & TID values */
+        char line[16];
+        char tid[24];
+        /** names & values of structured fields */
+        char kv_names[MAX_KV_FIELDS][MAX_KV_SIZE];
+        char kv_values[MAX_KV_FIELDS][MAX_KV_SIZE];
+};
+
+
+/** socket or -1 */
+static int _fd = -1;
+/** address of journald */
+static struct sockaddr_un _addr;
+/** SYSLOG_IDENTIFIER */
+static char _ident[256];
+static size_t _ident_len;
+/** an error has been reported */
+static bool _reported;
+
+
+
+
+/** print error once */
+static void _error(const char *s)
+{
+        if(_reported)
+                return;
+
+        perror(s);
+        _reported = true;
+}
+
+
+/** convert loglevel to syslog priority */
+static int _priority(NftLoglevel level)
+{
+        switch (level)
+        {
+                case L_VERY_NOISY:
+                case L_NOISY:
+                case L_DEBUG:
+                        return LOG_DEBUG;
+
+                case L_VERBOSE:
+                case L_INFO:
+                        return LOG_INFO;
+
+                case L_NOTICE:
+                        return LOG_NOTICE;
+
+                case L_WARNING:
+                        return LOG_WARNING;
+
+                case L_ERROR:
+                        return LOG_ERR;
+
+                default:
+                        return LOG_CRIT;
+        }
+}
+
+
+/** add data to entry */
+static void _add(struct Entry *e, const void *data, size_t len)
+{
+        e->iov[e->count].iov_base = (void *) data;
+        e->iov[e->count].iov_len = len;
+        e->count++;
+}
+
+
+/** add field to entry (value is referenced, not copied) */
+static void _field(struct Entry *e, const char *name, const char *value,
+                   size_t len)
+{
+        _add(e, name, strlen(name));
+
+        /* NAME=value\n */
+        if(!memchr(value, '\n', len))
+        {
+                _add(e, "=", 1);
+                _add(e, value, len);
+                _add(e, "\n", 1);
+                return;
+        }
+
+        /* NAME\n<64 bit little-endian length>value\n */
+        unsigned char *size = e->sizes[e->nsizes++];
+        for(int i = 0; i < 8; i++)
+                size[i] = (unsigned char) ((uint64_t) len >> (8 * i));
+
+        _add(e, "\n", 1);
+        _add(e, size, 8);
+        _add(e, value, len);
+        _add(e, "\n", 1);
+}
+
+
+/** add structured field (name converted to journal conventions) */
+static void _kv_field(struct Entry *e, int i, const NftLogKv * kv)
+{
+        /* uppercase letters, digits & '_', not starting with '_' or digit */
+        char *name = e->kv_names[i];
+        size_t n = 0;
+        const char *key = kv->key ? kv->key : "";
+        if(!(*key >= 'a' && *key <= 'z') && !(*key >= 'A' && *key <= 'Z'))
+                name[n++] = 'F', name[n++] = '_';
+        for(; *key && n < MAX_KV_SIZE - 1; key++)
+        {
+                char c = *key;
+                if(c >= 'a' && c <= 'z')
+                        c = (char) (c - 'a' + 'A');
+                else if(!(c >= 'A' && c <= 'Z') && !(c >= '0' && c <= '9'))
+                        c = '_';
+                name[n++] = c;
+        }
+        name[n] = '\0';
+
+        /* strings are referenced, others rendered */
+        if(kv->type == NFT_KV_TYPE_STR && kv->value.s)
+        {
+                _field(e, name, kv->value.s, strlen(kv->value.s));
+                return;
+        }
+
+        size_t len = _kv_value(e->kv_values[i], MAX_KV_SIZE, kv);
+        _field(e, name, e->kv_values[i], len);
+}
+
+
+/** add fields every entry has */
+static void _common(struct Entry *e, NftLoglevel level, const char *msg,
+                    size_t len)
+{
+        static const char priorities[] = "01234567";
+
+        e->count = 0;
+        e->nsizes = 0;
+        _field(e, "PRIORITY", &priorities[_priority(level)], 1);
+        _field(e, "SYSLOG_IDENTIFIER", _ident, _ident_len);
+        _field(e, "MESSAGE", msg, len);
+}
+
+
+/** pass entry as sealed memfd (for entries too large for a datagram) */
+static bool _send_memfd(struct Entry *e)
+{
+#if defined(HAVE_MEMFD_CREATE) && defined(F_ADD_SEALS)
+        int fd;
+        if((fd = memfd_create("niftylog-journal",
+                              MFD_CLOEXEC | MFD_ALLOW_SEALING)) < 0)
+        {
+                _error("memfd_create");
+                return false;
+        }
+
+        /* write entry */
+        struct iovec *iov = e->iov;
+        int count = e->count;
+        while(count > 0)
+        {
+                ssize_t n;
+                if((n = writev(fd, iov, count)) < 0)
+                {
+                        if(errno == EINTR)
+                                continue;
+
+                        _error("writev");
+                        close(fd);
+                        return false;
+                }
+
+                /* skip written data */
+                while(count > 0 && (size_t) n >= iov->iov_len)
+                {
+                        n -= (ssize_t) iov->iov_len;
+                        iov++;
+                        count--;
+                }
+                if(count > 0)
+                {
+                        iov->iov_base = (char *) iov->iov_base + n;
+                        iov->iov_len -= (size_t) n;
+                }
+        }
+
+        /* journald only accepts sealed memfds */
+        if(fcntl(fd, F_ADD_SEALS,
+                 F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL) < 0)
+        {
+                _error("fcntl");
+                close(fd);
+                return false;
+        }
+
+        /* send descriptor */
+        union
+        {
+                struct cmsghdr header;
+                char buf[CMSG_SPACE(sizeof(int))];
+        } control;
+        memset(&control, 0, sizeof(control));
+
+        struct msghdr m = {
+                .msg_name = &_addr,
+                .msg_namelen = sizeof(_addr),
+                .msg_control = control.buf,
+                .msg_controllen = sizeof(control.buf),
+        };
+
+        struct cmsghdr *c = CMSG_FIRSTHDR(&m);
+        c->cmsg_level = SOL_SOCKET;
+        c->cmsg_type = SCM_RIGHTS;
+        c->cmsg_len = CMSG_LEN(sizeof(int));
+        memcpy(CMSG_DATA(c), &fd, sizeof(int));
+
+        bool result = true;
+        while(sendmsg(_fd, &m, MSG_NOSIGNAL) < 0)
+        {
+                if(errno == EINTR)
+                        continue;
+
+                _error("sendmsg");
+                result = false;
+                break;
+        }
+
+        close(fd);
+        return result;
+#else
+        return false;
+#endif
+}
+
+
+/** send entry to journald */
+static void _send(struct Entry *e)
+{
+        if(_fd < 0)
+                return;
+
+        struct msghdr m = {
+                .msg_name = &_addr,
+                .msg_namelen = sizeof(_addr),
+                .msg_iov = e->iov,
+                .msg_iovlen = (size_t) e->count,
+        };
+
+        while(sendmsg(_fd, &m, MSG_NOSIGNAL) < 0)
+        {
+                if(errno == EINTR)
+                        continue;
+
+                /* too large for one datagram? */
+                if((errno == EMSGSIZE || errno == ENOBUFS) && _send_memfd(e))
+                        return;
+
+                _error("sendmsg");
+                return;
+        }
+}
+
+
+/** initialize logging mechanism */
+static NftResult _init()
+{
+        const char *path;
+        if(!(path = getenv(NFT_LOG_ENV_JOURNAL_SOCKET)))
+                path = NFT_LOG_DEFAULT_JOURNAL_SOCKET;
+
+        if(strlen(path) >= sizeof(_addr.sun_path))
+        {
+                fprintf(stderr, "Path too long: \"%s\"\n", path);
+                return NFT_FAILURE;
+        }
+
+        struct stat st;
+        if(stat(path, &st) != 0 || !S_ISSOCK(st.st_mode))
+        {
+                fprintf(stderr, "No journal socket at \"%s\"\n", path);
+                return NFT_FAILURE;
+        }
+
+        memset(&_addr, 0, sizeof(_addr));
+        _addr.sun_family = AF_UNIX;
+        strcpy(_addr.sun_path, path);
+
+        /* get logging ident (or process name) */
+        const char *ident;
+        if(!(ident = getenv(NFT_LOG_ENV_IDENT)))
+        {
+                const char *slash;
+                if(!(ident = getenv("_")))
+                        ident = NFT_LOG_DEFAULT_IDENT;
+                else if((slash = strrchr(ident, '/')))
+                        ident = slash + 1;
+        }
+        snprintf(_ident, sizeof(_ident), "%s", ident);
+        _ident_len = strlen(_ident);
+
+        int fd;
+        if((fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0)) < 0)
+        {
+                perror("socket");
+                return NFT_FAILURE;
+        }
+
+        /* big send buffer, so entries rarely need a memfd (capped by 
+           kernel) */
+        int sndbuf = (int) _env_size(NFT_LOG_ENV_JOURNAL_SNDBUF,
+                                     NFT_LOG_DEFAULT_JOURNAL_SNDBUF);
+        setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof(sndbuf));
+
+        _reported = false;
+        _fd = fd;
+
+        return NFT_SUCCESS;
+}
+
+
+/** deinitialize logging mechanism */
+static void _deinit()
+{
+        if(_fd < 0)
+                return;
+
+        close(_fd);
+        _fd = -1;
+}
+
+
+/** logging function for formatted messages */
+static void _log(NftLoglevel level, const char *msg, size_t len)
+{
+        struct Entry e;
+        _common(&e, level, msg, len);
+        _send(&e);
+}
+
+
+/** logging function for unformatted messages (with call-site) */
+static void _record(const NftLogRecord * r)
+{
+        /* format message */
+        char msg[JOURNAL_MSG_SIZE];
+        int n;
+        if(r->kv)
+                n = (int) _kv_render(msg, sizeof(msg), r->format, r->kv,
+                                     r->kv_count);
+        else if((n = _capture_render(msg, sizeof(msg), r->format, r->args,
+                                     r->args_len)) < 0)
+        {
+                n = snprintf(msg, sizeof(msg), "%s", r->format);
+        }
+        size_t len = ((size_t) n < sizeof(msg)) ? (size_t) n : sizeof(msg) - 1;
+
+        struct Entry e;
+        _common(&e, r->level, msg, len);
+
+        if(r->site)
+        {
+                int l = snprintf(e.line, sizeof(e.line), "%d", r->site->line);
+                _field(&e, "CODE_FILE", r->site->file, strlen(r->site->file));
+                _field(&e, "CODE_LINE", e.line, (size_t) l);
+                _field(&e, "CODE_FUNC", r->site->func, strlen(r->site->func));
+        }
+
+        int t = snprintf(e.tid, sizeof(e.tid), "%lu", r->tid);
+        _field(&e, "TID", e.tid, (size_t) t);
+
+        /* structured fields as journal fields */
+        for(size_t i = 0; r->kv && i < r->kv_count && i < MAX_KV_FIELDS; i++)
+                _kv_field(&e, (int) i, &r->kv[i]);
+
+        _send(&e);
+}
+
+
+/** 
+ * return descriptor for this mechanism 
+ * @result NftLogMechanism descriptor 
+ */
+NftLogMechanism *nft_log_mechanism_journald()
+{
+        return &_mechanism;
+}
+
+
+
+/* descriptor */
+static NftLogMechanism _mechanism = {
+        .name = "journald",
+        .log = &_log,
+        .record = &_record,
+        .init = &_init,
+        .deinit = &_deinit,
+};
+
+
+#endif
+
+/**
+ * @}
+ */
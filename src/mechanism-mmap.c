@@ -0,0 +1,375 @@
+/*
+ * libniftylog - niftylight logging library
+ * Copyright (C) 2006-2014 Daniel Hiepler <daniel@niftylight.de>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+/**
+ * @file mechanism-mmap.c
+ */
+
+/**
+ * @addtogroup logger_mechanism_mmap
+ * @{
+ */
+
+#ifndef WIN32
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "config.h"
+#include "logger-mechanism.h"
+#include "_env.h"
+
+
+
+#define NFT_LOG_ENV_MMAP_FILE           "NFT_LOG_MMAP_FILE"
+#define NFT_LOG_ENV_MMAP_SEGMENT        "NFT_LOG_MMAP_SEGMENT"
+
+#define NFT_LOG_DEFAULT_MMAP_FILE       PACKAGE "-mmap.log"
+#define NFT_LOG_DEFAULT_MMAP_SEGMENT    (4*1024*1024)
+#define NFT_LOG_MIN_MMAP_SEGMENT        (64*1024)
+
+
+static NftLogMechanism _mechanism;
+
+
+/** state of this mechanism */
+static struct
+{
+        /** file descriptor or -1 */
+        int fd;
+        /** start of mapping (page aligned) */
+        char *map;
+        /** length of mapping */
+        size_t map_len;
+        /** start of current segment inside mapping */
+        char *base;
+        /** size of segments */
+        size_t size;
+        /** file offset of current segment */
+        uint64_t offset;
+        /** next free byte in current segment (may grow beyond size) */
+        uint64_t pos;
+        /** length of segment when it got full (set by first thread that 
+            didn't fit) */
+        uint64_t used;
+        /** threads currently writing to the segment */
+        unsigned int writers;
+        /** set while the segment is exchanged */
+        bool switching;
+} _m = {
+        .fd = -1,
+};
+
+
+
+/** announce that we're going to write to the current segment */
+static void _writer_enter()
+{
+        for(;;)
+        {
+                __atomic_add_fetch(&_m.writers, 1, __ATOMIC_SEQ_CST);
+                if(!__atomic_load_n(&_m.switching, __ATOMIC_SEQ_CST))
+                        return;
+
+                /* wait until segment has been exchanged */
+                __atomic_sub_fetch(&_m.writers, 1, __ATOMIC_RELEASE);
+                while(__atomic_load_n(&_m.switching, __ATOMIC_ACQUIRE))
+                        sched_yield();
+        }
+}
+
+
+/** finish writing to segment */
+static void _writer_leave()
+{
+        __atomic_sub_fetch(&_m.writers, 1, __ATOMIC_RELEASE);
+}
+
+
+/**
+ * get exclusive access to the segment
+ * 
+ * @result false if another thread got it first (and we waited for it to 
+ *         finish)
+ */
+static bool _exclusive_enter()
+{
+        if(__atomic_exchange_n(&_m.switching, true, __ATOMIC_SEQ_CST))
+        {
+                while(__atomic_load_n(&_m.switching, __ATOMIC_ACQUIRE))
+                        sched_yield();
+                return false;
+        }
+
+        while(__atomic_load_n(&_m.writers, __ATOMIC_ACQUIRE))
+                sched_yield();
+
+        return true;
+}
+
+
+/** release exclusive access */
+static void _exclusive_leave()
+{
+        __atomic_store_n(&_m.switching, false, __ATOMIC_RELEASE);
+}
+
+
+/** length of data in current segment */
+static uint64_t _used()
+{
+        return (_m.pos > _m.size) ? _m.used : _m.pos;
+}
+
+
+/** unmap current segment */
+static void _unmap()
+{
+        if(!_m.map)
+                return;
+
+        munmap(_m.map, _m.map_len);
+        _m.map = _m.base = NULL;
+}
+
+
+/** allocate & map segment at current offset */
+static bool _map()
+{
+        /* mappings must start at a page boundary */
+        uint64_t page = (uint64_t) sysconf(_SC_PAGESIZE);
+        uint64_t start = _m.offset - _m.offset % page;
+        size_t skip = (size_t) (_m.offset - start);
+
+        int err;
+        if((err = posix_fallocate(_m.fd, (off_t) _m.offset, (off_t) _m.size)))
+        {
+                errno = err;
+                perror("posix_fallocate");
+                return false;
+        }
+
+        void *map;
+        if((map = mmap(NULL, _m.size + skip, PROT_READ | PROT_WRITE,
+                       MAP_SHARED, _m.fd, (off_t) start)) == MAP_FAILED)
+        {
+                perror("mmap");
+                return false;
+        }
+
+        _m.map = map;
+        _m.map_len = _m.size + skip;
+        _m.base = _m.map + skip;
+        _m.pos = 0;
+        _m.used = 0;
+
+        return true;
+}
+
+
+/** cut off unused part of segment and close file */
+static void _close()
+{
+        /* a segment switch doesn't close the file, so wait for it to finish 
+           and try again */
+        while(!_exclusive_enter())
+                ;
+
+        if(_m.fd >= 0)
+        {
+                _unmap();
+                if(ftruncate(_m.fd, (off_t) (_m.offset + _used())) != 0)
+                        perror("ftruncate");
+                close(_m.fd);
+                _m.fd = -1;
+        }
+
+        _exclusive_leave();
+}
+
+
+/** switch to next segment */
+static void _next()
+{
+        if(!_exclusive_enter())
+                return;
+
+        /* segment might have been switched already */
+        if(_m.base && _m.pos > _m.size)
+        {
+                _m.offset += _m.used;
+                _m.pos = _m.used = 0;
+                _unmap();
+                _map();
+        }
+
+        _exclusive_leave();
+}
+
+
+/** truncate file at exit */
+__attribute__ ((destructor))
+static void _exit_close()
+{
+        _close();
+}
+
+
+/** initialize logging mechanism */
+static NftResult _init()
+{
+        const char *path;
+        if(!(path = getenv(NFT_LOG_ENV_MMAP_FILE)))
+                path = NFT_LOG_DEFAULT_MMAP_FILE;
+
+        _m.size = _env_size(NFT_LOG_ENV_MMAP_SEGMENT,
+                            NFT_LOG_DEFAULT_MMAP_SEGMENT);
+        if(_m.size < NFT_LOG_MIN_MMAP_SEGMENT)
+                _m.size = NFT_LOG_MIN_MMAP_SEGMENT;
+
+        int fd;
+        if((fd = open(path, O_RDWR | O_CREAT, 0644)) < 0)
+        {
+                fprintf(stderr, "Failed to open \"%s\": ", path);
+                perror("open");
+                return NFT_FAILURE;
+        }
+
+        /* append to existing content */
+        struct stat st;
+        if(fstat(fd, &st) != 0)
+        {
+                perror("fstat");
+                close(fd);
+                return NFT_FAILURE;
+        }
+
+        _m.fd = fd;
+        _m.offset = (uint64_t) st.st_size;
+        if(!_map())
+        {
+                close(fd);
+                _m.fd = -1;
+                return NFT_FAILURE;
+        }
+
+        return NFT_SUCCESS;
+}
+
+
+/** deinitialize logging mechanism */
+static void _deinit()
+{
+        _close();
+}
+
+
+/** main logging function */
+static void _log(NftLoglevel level, const char *msg, size_t len)
+{
+        uint64_t need = (uint64_t) len + 1;
+
+        for(;;)
+        {
+                _writer_enter();
+
+                if(!_m.base)
+                {
+                        _writer_leave();
+                        return;
+                }
+
+                /* reserve space */
+                uint64_t pos = __atomic_fetch_add(&_m.pos, need,
+                                                  __ATOMIC_RELAXED);
+                if(pos + need <= _m.size)
+                {
+                        memcpy(_m.base + pos, msg, len);
+                        _m.base[pos + len] = '\n';
+                        _writer_leave();
+                        return;
+                }
+
+                /* first message that didn't fit marks the end of the 
+                   segment (segments are always bigger than a message) */
+                if(pos <= _m.size)
+                        __atomic_store_n(&_m.used, pos, __ATOMIC_RELAXED);
+
+                _writer_leave();
+                _next();
+        }
+}
+
+
+/** 
+ * return descriptor for this mechanism 
+ * @result NftLogMechanism descriptor 
+ */
+NftLogMechanism *nft_log_mechanism_mmap()
+{
+        return &_mechanism;
+}
+
+
+
+/* descriptor */
+static NftLogMechanism _mechanism = {
+        .name = "mmap",
+        .log = &_log,
+        .init = &_init,
+        .deinit = &_deinit,
+};
+
+
+#endif
+
+/**
+ * @}
+ */
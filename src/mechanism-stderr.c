@@ -60,10 +60,10 @@ static NftLogMechanism _mechanism;
 
 
 /** main logging function */
-static void _log(NftLoglevel level, const char *msg)
+static void _log(NftLoglevel level, const char *msg, size_t len)
 {
         /* print to stderr */
-        fprintf(stderr, "%s\n", msg);
+        fprintf(stderr, "%.*s\n", (int) len, msg);
 }
 
 
@@ -0,0 +1,622 @@
+/*
+ * libniftylog - niftylight logging library
+ * Copyright (C) 2006-2014 Daniel Hiepler <daniel@niftylight.de>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+/**
+ * @file mechanism-syslog-native.c
+ */
+
+/**
+ * @addtogroup logger_mechanism_syslog_native
+ * @{
+ */
+
+#ifndef WIN32
+
+/* sendmmsg() */
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <syslog.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include "config.h"
+#include "logger-mechanism.h"
+#include "_logger.h"
+#include "_env.h"
+#include "_flusher.h"
+
+
+
+#define NFT_LOG_ENV_IDENT               "NFT_LOG_IDENT"
+#define NFT_LOG_ENV_SYSLOG_SOCKET       "NFT_LOG_SYSLOG_SOCKET"
+#define NFT_LOG_ENV_SYSLOG_FORMAT       "NFT_LOG_SYSLOG_FORMAT"
+#define NFT_LOG_ENV_SYSLOG_BATCH        "NFT_LOG_SYSLOG_BATCH"
+#define NFT_LOG_ENV_SYSLOG_FLUSH        "NFT_LOG_SYSLOG_FLUSH"
+
+#define NFT_LOG_DEFAULT_IDENT           PACKAGE
+#define NFT_LOG_DEFAULT_SYSLOG_SOCKET   "/dev/log"
+#define NFT_LOG_DEFAULT_SYSLOG_BATCH    16
+#define NFT_LOG_DEFAULT_SYSLOG_FLUSH    100
+#define NFT_LOG_MAX_SYSLOG_BATCH        1024
+
+/** maximum length of RFC 5424 APP-NAME */
+#define APP_NAME_SIZE   48
+/** maximum length of RFC 5424 HOSTNAME */
+#define HOSTNAME_SIZE   255
+/** space for syslog header */
+#define HEADER_SIZE     (64 + APP_NAME_SIZE + HOSTNAME_SIZE)
+/** maximum size of one datagram */
+#define DATAGRAM_SIZE   (HEADER_SIZE + MAX_MSG_SIZE)
+
+
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#define _LOCK()         pthread_mutex_lock(&_mutex)
+#define _UNLOCK()       pthread_mutex_unlock(&_mutex)
+/** protects queue & socket */
+static pthread_mutex_t _mutex = PTHREAD_MUTEX_INITIALIZER;
+#else
+#define _LOCK()
+#define _UNLOCK()
+#endif
+
+
+static NftLogMechanism _mechanism;
+
+
+/** state of this mechanism */
+static struct
+{
+        /** socket or -1 */
+        int fd;
+        /** address of syslog daemon */
+        struct sockaddr_un addr;
+        /** use RFC 3164 instead of RFC 5424 */
+        bool rfc3164;
+        /** amount of datagrams to send at once */
+        unsigned int batch;
+        /** flush interval (ms) */
+        uint64_t flush;
+        /** queued datagrams */
+        char *data;
+        /** one iovec per queued datagram */
+        struct iovec *iov;
+#ifdef HAVE_SENDMMSG
+        /** one header per queued datagram */
+        struct mmsghdr *msgs;
+#endif
+        /** amount of queued datagrams */
+        unsigned int count;
+        /** time the first datagram was queued (ms) */
+        uint64_t first;
+        /** second the cached timestamp belongs to */
+        time_t second;
+        /** cached timestamp (without fraction) */
+        char stamp[32];
+        size_t stamp_len;
+        /** cached part of header following the timestamp */
+        char tail[HEADER_SIZE];
+        size_t tail_len;
+        /** an error has been reported */
+        bool reported;
+        /** sends queued datagrams every flush interval */
+        struct Flusher *flusher;
+} _s = {
+        .fd = -1,
+        .second = -1,
+};
+
+
+/** month names for RFC 3164 timestamps */
+static const char *_months[] = {
+        "Jan", "Feb", "Mar", "Apr", "May", "Jun",
+        "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"
+};
+
+
+
+
+/** convert loglevel to syslog severity */
+static int _severity(NftLoglevel level)
+{
+        switch (level)
+        {
+                case L_VERY_NOISY:
+                case L_NOISY:
+                case L_DEBUG:
+                        return LOG_DEBUG;
+
+                case L_VERBOSE:
+                case L_INFO:
+                        return LOG_INFO;
+
+                case L_NOTICE:
+                        return LOG_NOTICE;
+
+                case L_WARNING:
+                        return LOG_WARNING;
+
+                case L_ERROR:
+                        return LOG_ERR;
+
+                default:
+                        return LOG_CRIT;
+        }
+}
+
+
+/** write v as decimal number with at least width digits, return end */
+static char *_digits(char *p, unsigned long v, int width)
+{
+        char tmp[24];
+        int n = 0;
+        do
+        {
+                tmp[n++] = (char) ('0' + v % 10);
+                v /= 10;
+        }
+        while(v || n < width);
+
+        while(n)
+                *p++ = tmp[--n];
+
+        return p;
+}
+
+
+/** copy string, replace everything that's not printable ASCII */
+static size_t _printable(char *dst, const char *src, size_t size)
+{
+        size_t i;
+        for(i = 0; i < size && src[i]; i++)
+                dst[i] = (src[i] > ' ' && src[i] < 127) ? src[i] : '_';
+
+        return i;
+}
+
+
+/** format timestamp for current second */
+static void _stamp(time_t second)
+{
+        struct tm tm;
+        char *p = _s.stamp;
+
+        if(_s.rfc3164)
+        {
+                /* "Mmm dd hh:mm:ss" in local time */
+                localtime_r(&second, &tm);
+                memcpy(p, _months[tm.tm_mon], 3);
+                p += 3;
+                *p++ = ' ';
+                if(tm.tm_mday < 10)
+                        *p++ = ' ';
+                p = _digits(p, (unsigned long) tm.tm_mday, 1);
+        }
+        else
+        {
+                /* "YYYY-MM-DDThh:mm:ss" in UTC */
+                gmtime_r(&second, &tm);
+                p = _digits(p, (unsigned long) tm.tm_year + 1900, 4);
+                *p++ = '-';
+                p = _digits(p, (unsigned long) tm.tm_mon + 1, 2);
+                *p++ = '-';
+                p = _digits(p, (unsigned long) tm.tm_mday, 2);
+        }
+
+        *p++ = _s.rfc3164 ? ' ' : 'T';
+        p = _digits(p, (unsigned long) tm.tm_hour, 2);
+        *p++ = ':';
+        p = _digits(p, (unsigned long) tm.tm_min, 2);
+        *p++ = ':';
+        p = _digits(p, (unsigned long) tm.tm_sec, 2);
+
+        _s.stamp_len = (size_t) (p - _s.stamp);
+        _s.second = second;
+}
+
+
+/** write syslog header for message, return its length */
+static size_t _header(char *buf, NftLoglevel level, const struct timespec *now)
+{
+        char *p = buf;
+
+        *p++ = '<';
+        p = _digits(p, (unsigned long) (LOG_USER | _severity(level)), 1);
+        *p++ = '>';
+        if(!_s.rfc3164)
+        {
+                *p++ = '1';
+                *p++ = ' ';
+        }
+
+        if(now->tv_sec != _s.second)
+                _stamp(now->tv_sec);
+        memcpy(p, _s.stamp, _s.stamp_len);
+        p += _s.stamp_len;
+
+        if(!_s.rfc3164)
+        {
+                *p++ = '.';
+                p = _digits(p, (unsigned long) now->tv_nsec / 1000, 6);
+                *p++ = 'Z';
+        }
+
+        memcpy(p, _s.tail, _s.tail_len);
+        p += _s.tail_len;
+
+        return (size_t) (p - buf);
+}
+
+
+/** (re)connect to syslog daemon */
+static bool _connect()
+{
+        if(_s.fd >= 0)
+                close(_s.fd);
+
+        if((_s.fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0)) < 0)
+        {
+                perror("socket");
+                return false;
+        }
+
+        if(connect(_s.fd, (struct sockaddr *) &_s.addr, sizeof(_s.addr)) != 0)
+        {
+                if(!_s.reported)
+                {
+                        fprintf(stderr, "Failed to connect to \"%s\": ",
+                                _s.addr.sun_path);
+                        perror("connect");
+                        _s.reported = true;
+                }
+                close(_s.fd);
+                _s.fd = -1;
+                return false;
+        }
+
+        return true;
+}
+
+
+/** send datagrams, return amount of sent datagrams or -1 */
+static int _sendmmsg(unsigned int first)
+{
+#ifdef HAVE_SENDMMSG
+        return sendmmsg(_s.fd, &_s.msgs[first], _s.count - first, 0);
+#else
+        if(send(_s.fd, _s.iov[first].iov_base, _s.iov[first].iov_len, 0) < 0)
+                return -1;
+        return 1;
+#endif
+}
+
+
+/** send all queued datagrams (with lock held) */
+static void _send()
+{
+        bool reconnected = false;
+        unsigned int sent = 0;
+
+        while(sent < _s.count)
+        {
+                int n;
+                if(_s.fd >= 0 && (n = _sendmmsg(sent)) >= 0)
+                {
+                        sent += (unsigned int) n;
+                        continue;
+                }
+
+                if(_s.fd >= 0 && errno == EINTR)
+                        continue;
+
+                /* syslog daemon might have been restarted */
+                if(!reconnected && (_s.fd < 0 || errno == ECONNREFUSED ||
+                                    errno == ENOTCONN || errno == ENOENT))
+                {
+                        reconnected = true;
+                        if(_connect())
+                                continue;
+                }
+                else if(!_s.reported)
+                {
+                        perror("sendmmsg");
+                        _s.reported = true;
+                }
+
+                /* drop remaining datagrams */
+                break;
+        }
+
+        _s.count = 0;
+}
+
+
+/** send queued datagrams (called by flusher thread) */
+static void _tick()
+{
+        _LOCK();
+        if(_s.count)
+                _send();
+        _UNLOCK();
+}
+
+
+/** send queued datagrams at exit */
+__attribute__ ((destructor))
+static void _exit_flush()
+{
+        _LOCK();
+        if(_s.count)
+                _send();
+        _UNLOCK();
+}
+
+
+/** get logging ident */
+static const char *_ident()
+{
+        const char *ident;
+        if((ident = getenv(NFT_LOG_ENV_IDENT)))
+                return ident;
+
+        /* try to get process name */
+        if((ident = getenv("_")))
+        {
+                const char *slash;
+                return (slash = strrchr(ident, '/')) ? slash + 1 : ident;
+        }
+
+        return NFT_LOG_DEFAULT_IDENT;
+}
+
+
+/** initialize logging mechanism */
+static NftResult _init()
+{
+        const char *path;
+        if(!(path = getenv(NFT_LOG_ENV_SYSLOG_SOCKET)))
+                path = NFT_LOG_DEFAULT_SYSLOG_SOCKET;
+
+        if(strlen(path) >= sizeof(_s.addr.sun_path))
+        {
+                fprintf(stderr, "Path too long: \"%s\"\n", path);
+                return NFT_FAILURE;
+        }
+
+        memset(&_s.addr, 0, sizeof(_s.addr));
+        _s.addr.sun_family = AF_UNIX;
+        strcpy(_s.addr.sun_path, path);
+
+        const char *format;
+        if((format = getenv(NFT_LOG_ENV_SYSLOG_FORMAT)) &&
+           strcmp(format, "3164") != 0 && strcmp(format, "5424") != 0)
+        {
+                fprintf(stderr, "Invalid %s: \"%s\" (use 5424 or 3164)\n",
+                        NFT_LOG_ENV_SYSLOG_FORMAT, format);
+        }
+        _s.rfc3164 = format && strcmp(format, "3164") == 0;
+
+        _s.batch = (unsigned int) _env_number(NFT_LOG_ENV_SYSLOG_BATCH,
+                                              NFT_LOG_DEFAULT_SYSLOG_BATCH);
+        if(_s.batch < 1)
+                _s.batch = 1;
+        if(_s.batch > NFT_LOG_MAX_SYSLOG_BATCH)
+                _s.batch = NFT_LOG_MAX_SYSLOG_BATCH;
+        _s.flush = _env_number(NFT_LOG_ENV_SYSLOG_FLUSH,
+                               NFT_LOG_DEFAULT_SYSLOG_FLUSH);
+
+        /* cache everything behind the timestamp */
+        char ident[APP_NAME_SIZE + 1];
+        ident[_printable(ident, _ident(), APP_NAME_SIZE)] = '\0';
+        if(_s.rfc3164)
+        {
+                /* local daemons add the hostname themselves */
+                _s.tail_len = (size_t) snprintf(_s.tail, sizeof(_s.tail),
+                                                " %s[%ld]: ", ident,
+                                                (long) getpid());
+        }
+        else
+        {
+                char host[HOSTNAME_SIZE + 1] = "";
+                gethostname(host, sizeof(host));
+                host[HOSTNAME_SIZE] = '\0';
+                char hostname[HOSTNAME_SIZE + 1];
+                hostname[_printable(hostname, host, HOSTNAME_SIZE)] = '\0';
+
+                _s.tail_len = (size_t) snprintf(_s.tail, sizeof(_s.tail),
+                                                " %s %s %ld - - ",
+                                                hostname[0] ? hostname : "-",
+                                                ident[0] ? ident : "-",
+                                                (long) getpid());
+        }
+        _s.second = -1;
+
+        if(!(_s.data = malloc((size_t) _s.batch * DATAGRAM_SIZE)) ||
+           !(_s.iov = calloc(_s.batch, sizeof(*_s.iov))))
+        {
+                perror("malloc");
+                free(_s.data);
+                _s.data = NULL;
+                return NFT_FAILURE;
+        }
+
+#ifdef HAVE_SENDMMSG
+        if(!(_s.msgs = calloc(_s.batch, sizeof(*_s.msgs))))
+        {
+                perror("calloc");
+                free(_s.data);
+                free(_s.iov);
+                _s.data = NULL;
+                _s.iov = NULL;
+                return NFT_FAILURE;
+        }
+
+        for(unsigned int i = 0; i < _s.batch; i++)
+        {
+                _s.msgs[i].msg_hdr.msg_iov = &_s.iov[i];
+                _s.msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+#endif
+
+        _s.reported = false;
+        _s.count = 0;
+        if(!_connect())
+        {
+                free(_s.data);
+                free(_s.iov);
+                _s.data = NULL;
+                _s.iov = NULL;
+#ifdef HAVE_SENDMMSG
+                free(_s.msgs);
+                _s.msgs = NULL;
+#endif
+                return NFT_FAILURE;
+        }
+
+        /* send queued datagrams even if no further message arrives */
+        if(_s.flush)
+                _s.flusher = _flusher_start(_s.flush, _tick);
+
+        return NFT_SUCCESS;
+}
+
+
+/** deinitialize logging mechanism */
+static void _deinit()
+{
+        _flusher_stop(_s.flusher);
+        _s.flusher = NULL;
+
+        _LOCK();
+
+        if(_s.count)
+                _send();
+
+        if(_s.fd >= 0)
+        {
+                close(_s.fd);
+                _s.fd = -1;
+        }
+
+        free(_s.data);
+        free(_s.iov);
+        _s.data = NULL;
+        _s.iov = NULL;
+#ifdef HAVE_SENDMMSG
+        free(_s.msgs);
+        _s.msgs = NULL;
+#endif
+
+        _UNLOCK();
+}
+
+
+/** main logging function */
+static void _log(NftLoglevel level, const char *msg, size_t len)
+{
+        struct timespec now;
+        clock_gettime(CLOCK_REALTIME, &now);
+        uint64_t ms = (uint64_t) now.tv_sec * 1000 +
+                (uint64_t) now.tv_nsec / 1000000;
+
+        _LOCK();
+
+        if(!_s.data)
+        {
+                _UNLOCK();
+                return;
+        }
+
+        /* queue datagram */
+        char *d = _s.data + (size_t) _s.count * DATAGRAM_SIZE;
+        size_t n = _header(d, level, &now);
+        if(len > MAX_MSG_SIZE)
+                len = MAX_MSG_SIZE;
+        memcpy(d + n, msg, len);
+
+        _s.iov[_s.count].iov_base = d;
+        _s.iov[_s.count].iov_len = n + len;
+        if(_s.count++ == 0)
+                _s.first = ms;
+
+        /* send batch */
+        if(_s.count >= _s.batch || level >= L_WARNING ||
+           ms - _s.first >= _s.flush)
+                _send();
+
+        _UNLOCK();
+}
+
+
+/** 
+ * return descriptor for this mechanism 
+ * @result NftLogMechanism descriptor 
+ */
+NftLogMechanism *nft_log_mechanism_syslog_native()
+{
+        return &_mechanism;
+}
+
+
+
+/* descriptor */
+static NftLogMechanism _mechanism = {
+        .name = "syslog-native",
+        .log = &_log,
+        .init = &_init,
+        .deinit = &_deinit,
+};
+
+
+#endif
+
+/**
+ * @}
+ */
@@ -108,7 +108,7 @@ static void _deinit()
 
 
 /** main logging function */
-static void _log(NftLoglevel level, const char *msg)
+static void _log(NftLoglevel level, const char *msg, size_t len)
 {
         /* convert loglevel to priority */
         int priority;
@@ -155,7 +155,7 @@ static void _log(NftLoglevel level, const char *msg)
         }
 
         /* print to stderr */
-        syslog(priority, "%s", msg);
+        syslog(priority, "%.*s", (int) len, msg);
 }
 
 
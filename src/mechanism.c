@@ -52,11 +52,21 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include "config.h"
 #include "logger-mechanism.h"
+#include "logger-async.h"
 #include "_mechanism.h"
+#include "_logger.h"
+#include "_async.h"
 #include "_mechanism-syslog.h"
 #include "_mechanism-stderr.h"
 #include "_mechanism-null.h"
+#include "_mechanism-binary.h"
+#include "_mechanism-file.h"
+#include "_mechanism-mmap.h"
+#include "_mechanism-syslog-native.h"
+#include "_mechanism-journald.h"
 
 
 
@@ -70,13 +80,94 @@ static struct LogMechanisms
         { &nft_log_mechanism_stderr },
 #ifndef WIN32		
         { &nft_log_mechanism_syslog },
+        { &nft_log_mechanism_syslog_native },
+        { &nft_log_mechanism_journald },
+        { &nft_log_mechanism_binary },
+        { &nft_log_mechanism_file },
+        { &nft_log_mechanism_mmap },
 #endif
         { NULL }
 };
 
 
-/** currently used logging mechanism */
-static NftLogMechanism *_current;
+/** maximum amount of mechanisms that are active at once */
+#define MAX_SINKS       8
+/** maximum length of mechanism specification */
+#define MAX_SPEC        256
+
+
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#include <sched.h>
+/** serializes changes of mechanisms */
+static pthread_mutex_t _mutex = PTHREAD_MUTEX_INITIALIZER;
+/** initializes default mechanism once */
+static pthread_once_t _once = PTHREAD_ONCE_INIT;
+#define _LOCK()         pthread_mutex_lock(&_mutex)
+#define _UNLOCK()       pthread_mutex_unlock(&_mutex)
+#define _ONCE(f)        pthread_once(&_once, f)
+#define _YIELD()        sched_yield()
+#else
+static bool _once;
+#define _LOCK()
+#define _UNLOCK()
+#define _ONCE(f)        do { if(!_once) { _once = true; f(); } } while(0)
+#define _YIELD()
+#endif
+
+
+/** one active logging mechanism */
+struct Sink
+{
+        /** the mechanism */
+        NftLogMechanism *mechanism;
+        /** minimum level given in specification (L_INVALID if none) */
+        NftLoglevel level;
+};
+
+
+/** 
+ * set of active mechanisms. Never changed after it has been published, so 
+ * logging threads can use it without locking.
+ */
+struct Mechanisms
+{
+        /** the mechanisms */
+        struct Sink sinks[MAX_SINKS];
+        /** amount of used mechanisms */
+        int nsinks;
+        /** specification (as passed to nft_log_mechanism_set) */
+        char spec[MAX_SPEC];
+};
+
+
+/** flag: a mechanism handles unformatted messages */
+#define FLAG_RECORDS    (1 << 0)
+/** flag: a mechanism needs formatted messages */
+#define FLAG_TEXT       (1 << 1)
+
+
+/** amount of known mechanisms */
+#define MECHANISMS      (sizeof(nft_log_mechanisms) / sizeof(nft_log_mechanisms[0]))
+
+/** currently used logging mechanisms (NULL before first initialization) */
+static struct Mechanisms *_config;
+/** FLAG_* of current mechanisms */
+static unsigned int _flags;
+/** 
+ * global level last passed to _mechanism_level() (used by mechanisms 
+ * without own level) 
+ */
+static NftLoglevel _global = L_MAX;
+/** amount of published configurations using a mechanism */
+static unsigned int _users[MECHANISMS];
+/** 
+ * threads currently using a published _config (one counter per epoch 
+ * parity) 
+ */
+static unsigned int _readers[2];
+/** current epoch (new readers are counted in _readers[_epoch & 1]) */
+static unsigned int _epoch;
 
 
 
@@ -85,9 +176,10 @@ static NftLogMechanism *_current;
  * get logging mechanism descriptor by name
  *
  * @param[in] name printable name of mechanism
+ * @param[in] len length of name
  * @result NftLogMechanism or NULL
  */
-static NftLogMechanism *_get(const char *name)
+static NftLogMechanism *_get(const char *name, size_t len)
 {
         if(!name)
                 return NULL;
@@ -97,7 +189,7 @@ static NftLogMechanism *_get(const char *name)
             mlist++)
         {
                 NftLogMechanism *m = (*mlist->get) ();
-                if(strcmp(name, m->name) == 0)
+                if(strncmp(name, m->name, len) == 0 && m->name[len] == '\0')
                 {
                         return m;
                 }
@@ -108,20 +200,554 @@ static NftLogMechanism *_get(const char *name)
 
 
 /**
- * log message using current mechanism
+ * parse mechanism specification ("name[:level],name[:level],...")
+ *
+ * @param[in] spec specification
+ * @param[out] sinks parsed mechanisms
+ * @result amount of mechanisms or -1 upon error
+ */
+static int _parse(const char *spec, struct Sink *sinks)
+{
+        int n = 0;
+
+        for(const char *p = spec; *p;)
+        {
+                size_t len = strcspn(p, ",");
+                size_t name_len = strcspn(p, ":,");
+
+                if(n >= MAX_SINKS)
+                {
+                        fprintf(stderr, "Too many logging mechanisms: \"%s\"\n",
+                                spec);
+                        return -1;
+                }
+
+                if(!(sinks[n].mechanism = _get(p, name_len)))
+                {
+                        fprintf(stderr, "Unknown logging mechanism: \"%.*s\"\n",
+                                (int) name_len, p);
+                        return -1;
+                }
+
+                sinks[n].level = L_INVALID;
+                if(name_len < len &&
+                   (sinks[n].level = _log_level_parse(p + name_len + 1,
+                                                      len - name_len - 1)) ==
+                   L_INVALID)
+                {
+                        fprintf(stderr, "Invalid loglevel: \"%.*s\"\n",
+                                (int) (len - name_len - 1), p + name_len + 1);
+                        return -1;
+                }
+
+                /* every mechanism can only be used once */
+                for(int i = 0; i < n; i++)
+                {
+                        if(sinks[i].mechanism == sinks[n].mechanism)
+                        {
+                                fprintf(stderr,
+                                        "Logging mechanism used twice: \"%s\"\n",
+                                        sinks[n].mechanism->name);
+                                return -1;
+                        }
+                }
+
+                n++;
+
+                p += len;
+                if(*p == ',')
+                        p++;
+        }
+
+        if(n == 0)
+        {
+                fprintf(stderr, "No logging mechanism given\n");
+                return -1;
+        }
+
+        return n;
+}
+
+
+/**
+ * start using a published configuration
+ *
+ * @param[in] slot where configuration is published
+ * @param[out] parity epoch parity to pass to _reader_leave()
+ * @result current configuration (NULL if none)
+ */
+static struct Mechanisms *_reader_enter(struct Mechanisms **slot,
+                                        unsigned int *parity)
+{
+        *parity = __atomic_load_n(&_epoch, __ATOMIC_ACQUIRE) & 1;
+        __atomic_add_fetch(&_readers[*parity], 1, __ATOMIC_SEQ_CST);
+        return __atomic_load_n(slot, __ATOMIC_SEQ_CST);
+}
+
+
+/** finish using configuration returned by _reader_enter() */
+static void _reader_leave(unsigned int parity)
+{
+        __atomic_sub_fetch(&_readers[parity], 1, __ATOMIC_RELEASE);
+}
+
+
+/**
+ * wait until no thread uses a configuration that has been replaced before.
+ * The epoch is flipped twice, so readers that started while an earlier 
+ * grace period was running are waited for, too.
+ */
+static void _synchronize()
+{
+        for(int i = 0; i < 2; i++)
+        {
+                unsigned int old =
+                        __atomic_fetch_add(&_epoch, 1, __ATOMIC_SEQ_CST) & 1;
+
+                while(__atomic_load_n(&_readers[old], __ATOMIC_SEQ_CST))
+                        _YIELD();
+        }
+}
+
+
+/**
+ * get usage counter of a mechanism
+ */
+static unsigned int *_users_of(const NftLogMechanism * m)
+{
+        for(size_t i = 0; nft_log_mechanisms[i].get; i++)
+        {
+                if(nft_log_mechanisms[i].get() == m)
+                        return &_users[i];
+        }
+
+        return NULL;
+}
+
+
+/**
+ * start using a mechanism (initialize it if nobody used it before)
+ *
+ * @result NFT_SUCCESS or NFT_FAILURE
+ */
+static NftResult _acquire(NftLogMechanism * m)
+{
+        unsigned int *users = _users_of(m);
+        if(*users == 0 && m->init)
+        {
+                if(!m->init())
+                {
+                        fprintf(stderr,
+                                "Failed to initialize mechanism \"%s\"\n",
+                                m->name);
+                        return NFT_FAILURE;
+                }
+
+                m->initialized = true;
+        }
+
+        (*users)++;
+        return NFT_SUCCESS;
+}
+
+
+/**
+ * stop using a mechanism (deinitialize it if nobody uses it anymore)
+ */
+static void _release(NftLogMechanism * m)
+{
+        unsigned int *users = _users_of(m);
+        if(--(*users) > 0)
+                return;
+
+        if(m->deinit && m->initialized)
+                m->deinit();
+        m->initialized = false;
+}
+
+
+/**
+ * exchange a set of mechanisms. New mechanisms are initialized before 
+ * they are published, old ones are deinitialized once no thread is 
+ * logging through them anymore (unless another configuration still 
+ * uses them).
+ *
+ * @param[in] slot where configuration is published
+ * @param[in] spec mechanism specification or NULL to remove all mechanisms
+ * @result NFT_SUCCESS or NFT_FAILURE
+ */
+static NftResult _config_set(struct Mechanisms **slot, const char *spec)
+{
+        struct Mechanisms *c = NULL;
+        struct Sink sinks[MAX_SINKS];
+        int n = 0;
+        if(spec)
+        {
+                if(!(c = calloc(1, sizeof(*c))))
+                {
+                        perror("calloc");
+                        return NFT_FAILURE;
+                }
+
+                if(strlen(spec) >= sizeof(c->spec) ||
+                   (n = _parse(spec, sinks)) < 0)
+                {
+                        if(strlen(spec) >= sizeof(c->spec))
+                                fprintf(stderr,
+                                        "Mechanism specification too long\n");
+                        free(c);
+                        return NFT_FAILURE;
+                }
+        }
+
+        _LOCK();
+
+        struct Mechanisms *old = *slot;
+
+        /* write pending messages using current mechanisms */
+        if(old)
+                nft_log_async_flush();
+
+        /* initialize new mechanisms */
+        NftResult result = NFT_SUCCESS;
+        unsigned int flags = 0;
+        for(int i = 0; i < n; i++)
+        {
+                if(!_acquire(sinks[i].mechanism))
+                {
+                        result = NFT_FAILURE;
+                        continue;
+                }
+
+                c->sinks[c->nsinks++] = sinks[i];
+                flags |= (sinks[i].mechanism->record ?
+                          FLAG_RECORDS : FLAG_TEXT);
+        }
+
+        if(c && result)
+                strcpy(c->spec, spec);
+
+        /* publish new mechanisms */
+        __atomic_store_n(slot, c, __ATOMIC_SEQ_CST);
+        if(slot == &_config)
+                __atomic_store_n(&_flags, flags, __ATOMIC_RELEASE);
+
+        /* deinitialize old mechanisms once nobody uses them anymore */
+        if(old)
+        {
+                _synchronize();
+
+                for(int i = 0; i < old->nsinks; i++)
+                        _release(old->sinks[i].mechanism);
+
+                free(old);
+        }
+
+        _UNLOCK();
+
+        return result;
+}
+
+
+/**
+ * exchange current mechanisms
+ *
+ * @param[in] spec mechanism specification
+ * @result NFT_SUCCESS or NFT_FAILURE
+ */
+static NftResult _set(const char *spec)
+{
+        NftResult result = _config_set(&_config, spec);
+
+        /* mechanisms might want more verbose messages */
+        _log_level_update();
+
+        return result;
+}
+
+
+/**
+ * initialize default mechanisms (called once)
+ */
+static void _init()
+{
+        /* mechanisms have been set explicitly before */
+        if(__atomic_load_n(&_config, __ATOMIC_ACQUIRE))
+                return;
+
+        if(nft_log_mechanism_set(NULL))
+                return;
+
+        /* use default mechanism if the configured ones are unusable */
+        _LOCK();
+        bool none = (!_config || !_config->nsinks);
+        _UNLOCK();
+        if(none)
+                _set(NFT_LOG_DEFAULT_MECHANISM);
+}
+
+
+/**
+ * make sure mechanisms are initialized (they are initialized upon first 
+ * use if @ref nft_log_mechanism_set() hasn't been called before)
+ */
+void _mechanism_init()
+{
+#ifdef HAVE_PTHREAD_H
+        /* called again while initializing from the same thread (a mechanism
+           logged from init()) */
+        static __thread bool initializing;
+        if(initializing)
+                return;
+        initializing = true;
+#endif
+        _ONCE(_init);
+#ifdef HAVE_PTHREAD_H
+        initializing = false;
+#endif
+}
+
+
+/**
+ * start using a set of mechanisms (initialize current mechanisms first if 
+ * needed)
+ *
+ * @param[in] slot where configuration is published (NULL for current 
+ *            mechanisms)
+ * @param[out] parity epoch parity to pass to _reader_leave()
+ * @result configuration or NULL
+ */
+static struct Mechanisms *_use(struct Mechanisms **slot,
+                               unsigned int *parity)
+{
+        struct Mechanisms *c;
+        if((c = _reader_enter(slot ? slot : &_config, parity)) || slot)
+                return c;
+
+        _reader_leave(*parity);
+        _mechanism_init();
+        return _reader_enter(&_config, parity);
+}
+
+
+/**
+ * get minimum level of messages passed to a mechanism
+ *
+ * @param[in] base level used for mechanisms without own level 
+ *            (L_INVALID for the global level)
+ */
+static NftLoglevel _threshold(const struct Sink *s, NftLoglevel base)
+{
+        if(s->level != L_INVALID)
+                return s->level;
+
+        if(base != L_INVALID)
+                return base;
+
+        return __atomic_load_n(&_global, __ATOMIC_RELAXED);
+}
+
+
+/**
+ * pass message to all mechanisms of a configuration that want it
+ */
+static void _log(struct Mechanisms **slot, NftLoglevel base,
+                 NftLoglevel level, char *msg, size_t len)
+{
+        unsigned int parity;
+        struct Mechanisms *c = _use(slot, &parity);
+
+        for(int i = 0; c && i < c->nsinks; i++)
+        {
+                struct Sink *s = &c->sinks[i];
+                NftLogMechanism *m = s->mechanism;
+                if(level >= _threshold(s, base) && m->log)
+                        m->log(level, msg, len);
+        }
+
+        _reader_leave(parity);
+}
+
+
+/**
+ * calculate minimum loglevel of every mechanism
+ *
+ * @param[in] level global @ref NftLoglevel (used for mechanisms without 
+ *            own level)
+ * @result most verbose level any mechanism wants
+ */
+NftLoglevel _mechanism_level(NftLoglevel level)
+{
+        __atomic_store_n(&_global, level, __ATOMIC_RELAXED);
+
+        return _mechanism_sinks_level(NULL, L_INVALID);
+}
+
+
+/**
+ * calculate minimum loglevel of a set of mechanisms
+ *
+ * @param[in] slot set of mechanisms (NULL for current mechanisms)
+ * @param[in] base level used for mechanisms without own level 
+ *            (L_INVALID for the global level)
+ * @result most verbose level any mechanism wants
+ */
+NftLoglevel _mechanism_sinks_level(struct Mechanisms **slot,
+                                   NftLoglevel base)
+{
+        _LOCK();
+
+        struct Mechanisms *c = (slot ? *slot : _config);
+        NftLoglevel min = L_MIN;
+        for(int i = 0; c && i < c->nsinks; i++)
+        {
+                NftLoglevel t = _threshold(&c->sinks[i], base);
+                if(t < min)
+                        min = t;
+        }
+
+        /* no mechanisms: behave like one without own level */
+        if(!c || !c->nsinks)
+                min = (base != L_INVALID ? base :
+                       __atomic_load_n(&_global, __ATOMIC_RELAXED));
+
+        _UNLOCK();
+
+        return min;
+}
+
+
+/**
+ * exchange a set of mechanisms that isn't the current one (e.g. of a 
+ * @ref NftLogger)
+ *
+ * @param[in] slot where the set is published
+ * @param[in] spec mechanism specification or NULL to remove all mechanisms
+ * @result NFT_SUCCESS or NFT_FAILURE
+ */
+NftResult _mechanism_sinks_set(struct Mechanisms **slot, const char *spec)
+{
+        return _config_set(slot, spec);
+}
+
+
+/**
+ * log message using a set of mechanisms
+ *
+ * @param[in] slot set of mechanisms (NULL for current mechanisms)
+ * @param[in] base level used for mechanisms without own level 
+ *            (L_INVALID for the global level)
+ * @param[in] level the NftLoglevel of the message
+ * @param[in] msg the message to log
+ * @param[in] len length of message
+ */
+void _mechanism_sinks_log(struct Mechanisms **slot, NftLoglevel base,
+                          NftLoglevel level, char *msg, size_t len)
+{
+        /* pass to writer thread if asynchronous logging is active */
+        if(_async_push(slot, base, level, msg, len))
+                return;
+
+        _log(slot, base, level, msg, len);
+}
+
+
+/**
+ * log message using current mechanisms
  *
  * @param[in] msg the message to log
  * @param[in] level the NftLoglevel of the message
+ * @param[in] len length of message
+ */
+void _mechanism_log(NftLoglevel level, char *msg, size_t len)
+{
+        _mechanism_sinks_log(NULL, L_INVALID, level, msg, len);
+}
+
+
+/**
+ * log message using a set of mechanisms from the calling thread (used by 
+ * the asynchronous writer thread)
+ *
+ * @param[in] slot set of mechanisms (NULL for current mechanisms)
+ * @param[in] base level used for mechanisms without own level 
+ *            (L_INVALID for the global level)
+ * @param[in] level the NftLoglevel of the message
+ * @param[in] msg the message to log
+ * @param[in] len length of message
  */
-void _mechanism_log(NftLoglevel level, char *msg)
+void _mechanism_log_sync(struct Mechanisms **slot, NftLoglevel base,
+                         NftLoglevel level, char *msg, size_t len)
 {
-        /* set current mechanism (will exit immediately if not necessary */
-        if(!_current)
-                nft_log_mechanism_set(NFT_LOG_DEFAULT_MECHANISM);
+        _log(slot, base, level, msg, len);
+}
+
+
+/**
+ * get FLAG_* of current mechanisms
+ */
+static unsigned int _flags_get()
+{
+        if(!__atomic_load_n(&_config, __ATOMIC_ACQUIRE))
+                _mechanism_init();
+
+        return __atomic_load_n(&_flags, __ATOMIC_ACQUIRE);
+}
+
 
-        /* log */
-        if(_current->log)
-                _current->log(level, msg);
+/**
+ * check if any current mechanism handles unformatted messages
+ *
+ * @result true if @ref _mechanism_log_record() should be used
+ */
+bool _mechanism_records()
+{
+        return _flags_get() & FLAG_RECORDS;
+}
+
+
+/**
+ * check if any current mechanism needs formatted messages
+ *
+ * @result true if @ref _mechanism_log_record() needs the formatted message
+ */
+bool _mechanism_text()
+{
+        return _flags_get() & FLAG_TEXT;
+}
+
+
+/**
+ * log unformatted message using current mechanisms from the calling thread.
+ * Mechanisms that can't handle unformatted messages get the formatted one.
+ *
+ * @param[in] record the message to log
+ * @param[in] base level used for mechanisms without own level 
+ *            (L_INVALID for the global level)
+ * @param[in] msg formatted message (only needed if @ref _mechanism_text())
+ * @param[in] len length of formatted message
+ */
+void _mechanism_log_record(const NftLogRecord * record, NftLoglevel base,
+                           char *msg, size_t len)
+{
+        unsigned int parity;
+        struct Mechanisms *c = _use(NULL, &parity);
+
+        for(int i = 0; c && i < c->nsinks; i++)
+        {
+                struct Sink *s = &c->sinks[i];
+                NftLogMechanism *m = s->mechanism;
+                if(record->level < _threshold(s, base))
+                        continue;
+
+                /* msg might be missing if mechanisms changed meanwhile */
+                if(m->record)
+                        m->record(record);
+                else if(m->log && msg)
+                        m->log(record->level, msg, len);
+        }
+
+        _reader_leave(parity);
 }
 
 
@@ -143,17 +769,22 @@ void nft_log_mechanism_print_list()
 
 
 /**
- * set current logging mechanism
+ * set current logging mechanism(s)
+ *
+ * Several mechanisms can be used at once, each with its own minimum 
+ * loglevel, e.g. "syslog:error,file:debug,stderr". Mechanisms without 
+ * level use the level set by @ref nft_log_level_set(). 
+ *
+ * Mechanisms can be changed while other threads are logging. Mechanisms 
+ * that are used before and after the change stay initialized, others are 
+ * deinitialized as soon as no thread is logging through them anymore.
  *
  * @param[in] name The valid name of a mechanism (s. @ref nft_log_mechanisms)
+ *            or a comma separated list of "name[:level]"
  * @result NFT_SUCCESS or NFT_FAILURE
  */
 NftResult nft_log_mechanism_set(const char *name)
 {
-        /* same mechanism as before? */
-        if(_current && name && strcmp(name, _current->name) == 0)
-                return NFT_SUCCESS;
-
         /* logging mechanism name from environment always wins */
         char *mechanism_name;
         if((mechanism_name = getenv(NFT_LOG_ENV_MECHANISM)))
@@ -163,6 +794,13 @@ NftResult nft_log_mechanism_set(const char *name)
         if(!name)
                 name = NFT_LOG_DEFAULT_MECHANISM;
 
+        /* same mechanisms as before? */
+        _LOCK();
+        bool same = (_config && strcmp(name, _config->spec) == 0);
+        _UNLOCK();
+        if(same)
+                return NFT_SUCCESS;
+
         /* "list" mechanism to print a list of all mechanisms ? */
         if(strcmp(name, "list") == 0)
         {
@@ -178,35 +816,12 @@ NftResult nft_log_mechanism_set(const char *name)
                 name = NFT_LOG_DEFAULT_MECHANISM;
         }
 
-        /* deinitialize current mechanism */
-        if(_current && _current->deinit)
-        {
-                _current->deinit();
-                _current->initialized = false;
-        }
+        NftResult result = _set(name);
 
-        /* get new mechanism */
-        if(!(_current = _get(name)))
-        {
-                fprintf(stderr, "Unknown logging mechanism: \"%s\"\n", name);
-                return NFT_FAILURE;
-        }
+        /* asynchronous logging requested by environment? */
+        _async_env();
 
-        /* initialize mechanism */
-        if(_current->init)
-        {
-                if(!_current->init())
-                {
-                        fprintf(stderr,
-                                "Failed to initialize mechanism \"%s\"\n",
-                                name);
-                        return NFT_FAILURE;
-                }
-
-                _current->initialized = true;
-        }
-
-        return NFT_SUCCESS;
+        return result;
 }
 
 /**
@@ -0,0 +1,426 @@
+/*
+ * libniftylog - niftylight logging library
+ * Copyright (C) 2006-2014 Daniel Hiepler <daniel@niftylight.de>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+/**
+ * @file output.c
+ */
+
+/**
+ * @addtogroup logger
+ * @{
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "logger.h"
+#include "_output.h"
+#include "_json.h"
+#include "_timestamp.h"
+#include "_thread.h"
+
+
+
+/** names of output formats (must be synced with NftLogOutput) */
+static const char *_names[] = {
+        "text",
+        "json",
+};
+
+
+/** current output format */
+static NftLogOutput _mode;
+/** true as soon as the environment has been read */
+static bool _env_read;
+
+
+/** JSON object being written */
+struct Out
+{
+        /** destination */
+        char *buf;
+        /** space in buf that may be used (closing braces are reserved) */
+        size_t room;
+        /** bytes written */
+        size_t pos;
+        /** something didn't fit */
+        bool full;
+        /** no member written to current object, yet */
+        bool first;
+};
+
+
+
+
+/**
+ * parse name of output format
+ *
+ * @result NftLogOutput or -1 if name is invalid
+ */
+static int _parse(const char *name)
+{
+        for(int i = 0; i < NFT_LOG_OUTPUT_MAX; i++)
+        {
+                if(strcmp(name, _names[i]) == 0)
+                        return i;
+        }
+
+        fprintf(stderr, "Invalid output format: \"%s\"\n", name);
+        return -1;
+}
+
+
+/**
+ * get current output format (reads environment upon first call)
+ */
+static NftLogOutput _mode_get()
+{
+        if(!__atomic_load_n(&_env_read, __ATOMIC_ACQUIRE))
+        {
+                char *env;
+                int mode;
+                if((env = getenv(NFT_LOG_ENV_OUTPUT)) &&
+                   (mode = _parse(env)) >= 0)
+                        __atomic_store_n(&_mode, mode, __ATOMIC_RELAXED);
+
+                __atomic_store_n(&_env_read, true, __ATOMIC_RELEASE);
+        }
+
+        return __atomic_load_n(&_mode, __ATOMIC_RELAXED);
+}
+
+
+/**
+ * append bytes (nothing if they don't fit)
+ */
+static void _raw(struct Out *o, const char *s, size_t len)
+{
+        if(o->full || o->pos + len > o->room)
+        {
+                o->full = true;
+                return;
+        }
+
+        memcpy(o->buf + o->pos, s, len);
+        o->pos += len;
+}
+
+
+/**
+ * append string (truncated to fit, but always terminated)
+ */
+static void _string(struct Out *o, const char *s, size_t len)
+{
+        if(o->full || o->pos + 2 > o->room)
+        {
+                o->full = true;
+                return;
+        }
+
+        o->buf[o->pos++] = '"';
+        o->pos += _json_escape(o->buf + o->pos, o->room - o->pos - 1, s, len);
+        o->buf[o->pos++] = '"';
+}
+
+
+/**
+ * append name of member
+ */
+static void _key(struct Out *o, const char *key)
+{
+        if(!o->first)
+                _raw(o, ",", 1);
+        o->first = false;
+
+        _string(o, key, strlen(key));
+        _raw(o, ":", 1);
+}
+
+
+/**
+ * append member with string (or raw) value, left out completely if it 
+ * doesn't fit
+ */
+static void _member(struct Out *o, const char *key, const char *s, size_t len,
+                    bool raw)
+{
+        struct Out mark = *o;
+
+        _key(o, key);
+        if(raw)
+                _raw(o, s, len);
+        else
+                _string(o, s, len);
+
+        if(o->full)
+                *o = mark;
+}
+
+
+/**
+ * append value of field
+ */
+static void _value(struct Out *o, const NftLogKv * kv)
+{
+        char tmp[32];
+        int n;
+        switch (kv->type)
+        {
+                case NFT_KV_TYPE_INT:
+                {
+                        n = snprintf(tmp, sizeof(tmp), "%lld",
+                                     (long long) kv->value.i);
+                        break;
+                }
+
+                case NFT_KV_TYPE_UINT:
+                {
+                        n = snprintf(tmp, sizeof(tmp), "%llu",
+                                     (unsigned long long) kv->value.u);
+                        break;
+                }
+
+                case NFT_KV_TYPE_DBL:
+                {
+                        /* JSON has no NaN or infinity */
+                        if(!isfinite(kv->value.d))
+                        {
+                                n = snprintf(tmp, sizeof(tmp), "null");
+                                break;
+                        }
+
+                        /* shortest of the usual precisions that 
+                           round-trips */
+                        n = snprintf(tmp, sizeof(tmp), "%.15g", kv->value.d);
+                        if(strtod(tmp, NULL) != kv->value.d)
+                                n = snprintf(tmp, sizeof(tmp), "%.17g",
+                                             kv->value.d);
+                        break;
+                }
+
+                case NFT_KV_TYPE_BOOL:
+                {
+                        n = snprintf(tmp, sizeof(tmp), "%s",
+                                     kv->value.b ? "true" : "false");
+                        break;
+                }
+
+                case NFT_KV_TYPE_STR:
+                {
+                        if(kv->value.s)
+                        {
+                                _string(o, kv->value.s, strlen(kv->value.s));
+                                return;
+                        }
+                }
+                        /* fall through */
+
+                default:
+                {
+                        n = snprintf(tmp, sizeof(tmp), "null");
+                        break;
+                }
+        }
+
+        _raw(o, tmp, (size_t) n);
+}
+
+
+/**
+ * append fields of structured message as nested object (fields that don't
+ * fit are left out)
+ */
+static void _fields(struct Out *o, const NftLogKv * kv, size_t count)
+{
+        /* keep room for closing brace */
+        o->room--;
+
+        _key(o, "fields");
+        _raw(o, "{", 1);
+        o->first = true;
+
+        for(size_t i = 0; i < count && !o->full; i++)
+        {
+                struct Out mark = *o;
+
+                _key(o, kv[i].key ? kv[i].key : "(null)");
+                _value(o, &kv[i]);
+
+                if(o->full)
+                        *o = mark;
+        }
+
+        o->room++;
+        o->first = false;
+        _raw(o, "}", 1);
+}
+
+
+/**
+ * check if messages should be passed to mechanisms as JSON objects
+ */
+bool _output_json()
+{
+        return _mode_get() == NFT_LOG_OUTPUT_JSON;
+}
+
+
+/**
+ * encode message as one JSON object (without newline): level, timestamp & 
+ * thread (if enabled), call-site, fields of structured messages & message.
+ * The message is truncated to fit, the result is always valid JSON.
+ *
+ * @param[out] buf destination (\0 terminated)
+ * @param[in] size space in buf (at least 64 bytes)
+ * @param[in] file call-site (or NULL)
+ * @param[in] time time of message (nanoseconds since epoch) or 0 for now
+ * @param[in] thread thread info of logging thread or NULL for calling thread
+ * @param[in] weight sampling weight (only printed if > 1)
+ * @param[in] body message without prefix
+ * @param[in] kv fields of structured message (or NULL)
+ * @result length of object
+ */
+size_t _output_json_encode(char *buf, size_t size, NftLoglevel level,
+                           const char *file, const char *func, int line,
+                           uint64_t time, const char *thread,
+                           unsigned int weight, const char *body, size_t body_len,
+                           const NftLogKv * kv, size_t kv_count)
+{
+        /* keep room for "}\0" */
+        struct Out o = {.buf = buf,.room = size - 2,.first = true }, mark;
+        _raw(&o, "{", 1);
+
+        const char *name;
+        if(!(name = nft_log_level_to_string(level)))
+                name = "(null)";
+        _member(&o, "level", name, strlen(name), false);
+
+        /* same timestamp & thread info as text prefix, without spaces */
+        char ts[64];
+        size_t n;
+        if((n = _timestamp(ts, sizeof(ts), time)) > 1)
+                _member(&o, "timestamp", ts, n - 1, false);
+
+        if(!thread)
+                thread = _thread_prefix(&n);
+        else
+                n = strlen(thread);
+        if(n > 3 && thread[0] == '[')
+                _member(&o, "thread", thread + 1, n - 3, false);
+
+        if(file)
+        {
+                char num[16];
+                int l = snprintf(num, sizeof(num), "%d", line);
+
+                _member(&o, "file", file, strlen(file), false);
+                _member(&o, "line", num, (size_t) l, true);
+                _member(&o, "func", func, strlen(func), false);
+        }
+
+        if(weight > 1)
+        {
+                char num[16];
+                int l = snprintf(num, sizeof(num), "%u", weight);
+
+                _member(&o, "weight", num, (size_t) l, true);
+        }
+
+        /* fields that don't fit are left out */
+        if(kv && kv_count)
+        {
+                mark = o;
+                _fields(&o, kv, kv_count);
+                if(o.full)
+                        o = mark;
+        }
+
+        _member(&o, "message", body, body_len, false);
+
+        buf[o.pos++] = '}';
+        buf[o.pos] = '\0';
+
+        return o.pos;
+}
+
+
+/**
+ * set format of messages passed to mechanisms that print text. The 
+ * NFT_LOG_OUTPUT environment variable (holding the name of a format) always
+ * wins.
+ *
+ * @param[in] output @ref NftLogOutput
+ * @result NFT_SUCCESS or NFT_FAILURE
+ */
+NftResult nft_log_output_set(NftLogOutput output)
+{
+        if(output < NFT_LOG_OUTPUT_TEXT || output >= NFT_LOG_OUTPUT_MAX)
+                return NFT_FAILURE;
+
+        /* environment always wins (only if it's valid) */
+        char *env;
+        int m;
+        if((env = getenv(NFT_LOG_ENV_OUTPUT)) && (m = _parse(env)) >= 0)
+                output = m;
+
+        __atomic_store_n(&_mode, output, __ATOMIC_RELAXED);
+        __atomic_store_n(&_env_read, true, __ATOMIC_RELEASE);
+
+        return NFT_SUCCESS;
+}
+
+
+/**
+ * get current output format
+ *
+ * @result @ref NftLogOutput
+ */
+NftLogOutput nft_log_output_get()
+{
+        return _mode_get();
+}
+
+
+/**
+ * @}
+ */
@@ -0,0 +1,544 @@
+/*
+ * libniftylog - niftylight logging library
+ * Copyright (C) 2006-2014 Daniel Hiepler <daniel@niftylight.de>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+/**
+ * @file ratelimit.c
+ */
+
+/**
+ * @addtogroup logger
+ * @{
+ */
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
+#include <time.h>
+#include "config.h"
+#include "logger-mechanism.h"
+#include "logger-instance.h"
+#include "_logger.h"
+#include "_env.h"
+#include "_flusher.h"
+#include "_ratelimit.h"
+
+
+/* cheap clock for the buckets (a few ms resolution are plenty) */
+#ifdef CLOCK_MONOTONIC_COARSE
+#define CLOCK_BUCKET    CLOCK_MONOTONIC_COARSE
+#else
+#define CLOCK_BUCKET    CLOCK_MONOTONIC
+#endif
+
+/** 
+ * interval (ms) in which call-sites with dropped messages are checked for 
+ * refilled buckets 
+ */
+#define REPORT_INTERVAL 1000
+
+
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+/** serializes access to pending reports */
+static pthread_mutex_t _mutex = PTHREAD_MUTEX_INITIALIZER;
+/** serializes reporting (held while call-sites are reported) */
+static pthread_mutex_t _report_mutex = PTHREAD_MUTEX_INITIALIZER;
+#define _LOCK()         pthread_mutex_lock(&_mutex)
+#define _UNLOCK()       pthread_mutex_unlock(&_mutex)
+#define _REPORT_LOCK()  pthread_mutex_lock(&_report_mutex)
+#define _REPORT_UNLOCK() pthread_mutex_unlock(&_report_mutex)
+#else
+#define _LOCK()
+#define _UNLOCK()
+#define _REPORT_LOCK()
+#define _REPORT_UNLOCK()
+#endif
+
+
+/** call-site that dropped messages which haven't been reported yet */
+struct Pending
+{
+        /** the call-site */
+        NftLogSite *site;
+        /** level of the dropped messages */
+        NftLoglevel level;
+        /** logger of call-site (NULL for nft_log_site() call-sites) */
+        NftLogger *logger;
+};
+
+
+/** 
+ * rate limit per level (rate in the upper, burst in the lower 32 bits, 
+ * 0 if unlimited) 
+ */
+static uint64_t _limits[L_MIN];
+/** true as soon as the environment has been read */
+static bool _env_read;
+/** call-sites with unreported dropped messages */
+static struct Pending *_pending;
+/** amount of entries in _pending */
+static size_t _pending_count;
+/** size of _pending */
+static size_t _pending_size;
+/** thread that reports dropped messages once buckets are refilled */
+static struct Flusher *_reporter;
+/** true if atexit handler has been installed */
+static bool _atexit;
+
+
+
+
+/**
+ * store limit of one level (or all levels if level is L_INVALID)
+ */
+static void _store(NftLoglevel level, unsigned int rate, unsigned int burst)
+{
+        /* default burst: one second worth of messages */
+        if(!burst)
+                burst = rate;
+
+        uint64_t limit = rate ? ((uint64_t) rate << 32) | burst : 0;
+
+        if(level != L_INVALID)
+        {
+                __atomic_store_n(&_limits[level], limit, __ATOMIC_RELAXED);
+                return;
+        }
+
+        for(level = L_MAX + 1; level < L_MIN; level++)
+                __atomic_store_n(&_limits[level], limit, __ATOMIC_RELAXED);
+}
+
+
+/**
+ * check & apply "rate[:burst]" value of NFT_LOG_RATELIMIT
+ */
+static bool _value(NftLoglevel level, const char *value, bool apply)
+{
+        char *end;
+        unsigned long rate, burst = 0;
+        if(*value < '0' || *value > '9')
+                return false;
+        rate = strtoul(value, &end, 10);
+
+        if(*end == ':')
+        {
+                value = end + 1;
+                if(*value < '0' || *value > '9')
+                        return false;
+                burst = strtoul(value, &end, 10);
+        }
+
+        if(*end || rate > UINT_MAX || burst > UINT_MAX)
+                return false;
+
+        if(apply)
+                _store(level, rate, burst);
+
+        return true;
+}
+
+
+/**
+ * apply environment variable
+ */
+static void _env_apply()
+{
+        _env_levels(NFT_LOG_ENV_RATELIMIT, "rate limit", _value);
+}
+
+
+/**
+ * get limit of level (reads environment upon first call)
+ */
+static uint64_t _limit_get(NftLoglevel level)
+{
+        if(!__atomic_load_n(&_env_read, __ATOMIC_ACQUIRE))
+        {
+                _env_apply();
+                __atomic_store_n(&_env_read, true, __ATOMIC_RELEASE);
+        }
+
+        return __atomic_load_n(&_limits[level], __ATOMIC_RELAXED);
+}
+
+
+/**
+ * get bucket parameters of a call-site
+ *
+ * @param[out] interval ns between two messages
+ * @param[out] tolerance ns the bucket may be ahead of now
+ * @result false if call-site isn't limited
+ */
+static bool _bucket(NftLogSite * site, NftLoglevel level,
+                    uint64_t * interval, uint64_t * tolerance)
+{
+        /* explicit limit of call-site or limit of level */
+        uint64_t rate = site->rate, burst = site->burst;
+        if(!rate)
+        {
+                uint64_t limit;
+                if(level <= L_MAX || level >= L_MIN ||
+                   !(limit = _limit_get(level)))
+                        return false;
+
+                rate = limit >> 32;
+                burst = limit & UINT32_MAX;
+        }
+
+        if(!burst)
+                burst = rate;
+
+        *interval = 1000000000ULL / rate;
+        *tolerance = *interval * (burst - 1);
+        return true;
+}
+
+
+/**
+ * current time of buckets (ns)
+ */
+static uint64_t _now()
+{
+        struct timespec ts;
+        clock_gettime(CLOCK_BUCKET, &ts);
+        return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+
+/**
+ * log "suppressed N messages" for a call-site (if it still has dropped 
+ * messages that haven't been reported by the call-site itself)
+ */
+static void _report(const struct Pending *p)
+{
+        unsigned long suppressed;
+        if(!(suppressed = __atomic_exchange_n(&p->site->suppressed, 0,
+                                              __ATOMIC_RELAXED)))
+                return;
+
+        if(p->logger)
+                nft_logger_log(p->logger, p->level, p->site->file,
+                               p->site->func, p->site->line,
+                               "suppressed %lu messages", suppressed);
+        else
+                nft_log(p->level, p->site->file, p->site->func,
+                        p->site->line, "suppressed %lu messages",
+                        suppressed);
+}
+
+
+/**
+ * report call-sites that match a condition & remove them from the pending 
+ * list
+ *
+ * @param[in] match function that returns true if call-site should be 
+ *            reported
+ * @param[in] userdata passed to match
+ */
+static void _report_matching(bool (*match) (const struct Pending * p,
+                                            const void *userdata),
+                             const void *userdata)
+{
+        _REPORT_LOCK();
+
+        for(;;)
+        {
+                /* take one matching entry (messages are logged unlocked, a 
+                   call-site may drop messages meanwhile) */
+                struct Pending p = { 0 };
+                _LOCK();
+                for(size_t i = 0; i < _pending_count; i++)
+                {
+                        if(match(&_pending[i], userdata))
+                        {
+                                p = _pending[i];
+                                _pending[i] = _pending[--_pending_count];
+                                break;
+                        }
+                }
+                _UNLOCK();
+
+                if(!p.site)
+                        break;
+
+                _report(&p);
+        }
+
+        _REPORT_UNLOCK();
+}
+
+
+/**
+ * true if the bucket of a call-site allows a message again
+ */
+static bool _refilled(const struct Pending *p, const void *userdata)
+{
+        const uint64_t *now = userdata;
+        uint64_t interval, tolerance;
+        return !_bucket(p->site, p->level, &interval, &tolerance) ||
+                __atomic_load_n(&p->site->bucket, __ATOMIC_RELAXED) <=
+                *now + tolerance;
+}
+
+
+/**
+ * true for every call-site
+ */
+static bool _any(const struct Pending *p, const void *userdata)
+{
+        return true;
+}
+
+
+/**
+ * true if call-site is within a range of call-sites
+ */
+static bool _within(const struct Pending *p, const void *userdata)
+{
+        NftLogSite *const *range = userdata;
+        return p->site >= range[0] && p->site < range[1];
+}
+
+
+/**
+ * report call-sites whose buckets have been refilled (called periodically 
+ * by reporter thread)
+ */
+static void _report_refilled()
+{
+        uint64_t now = _now();
+        _report_matching(_refilled, &now);
+}
+
+
+/**
+ * report all pending call-sites upon exit
+ */
+static void _exit_report()
+{
+        _LOCK();
+        struct Flusher *reporter = _reporter;
+        _reporter = NULL;
+        _UNLOCK();
+
+        _flusher_stop(reporter);
+        _report_matching(_any, NULL);
+}
+
+
+/**
+ * remember call-site that started dropping messages, so they're reported 
+ * once its bucket is refilled even if it doesn't log anymore
+ */
+static void _pending_add(NftLogSite * site, NftLoglevel level,
+                         NftLogger * logger)
+{
+        _LOCK();
+
+        /* already pending? */
+        for(size_t i = 0; i < _pending_count; i++)
+        {
+                if(_pending[i].site == site)
+                {
+                        _UNLOCK();
+                        return;
+                }
+        }
+
+        if(_pending_count == _pending_size)
+        {
+                size_t size = _pending_size ? _pending_size * 2 : 16;
+                struct Pending *p;
+                if(!(p = realloc(_pending, size * sizeof(*p))))
+                {
+                        /* call-site will report when it logs again */
+                        _UNLOCK();
+                        perror("realloc");
+                        return;
+                }
+                _pending = p;
+                _pending_size = size;
+        }
+
+        _pending[_pending_count].site = site;
+        _pending[_pending_count].level = level;
+        _pending[_pending_count].logger = logger;
+        _pending_count++;
+
+        bool install = !_atexit;
+        _atexit = true;
+        if(!_reporter)
+                _reporter = _flusher_start(REPORT_INTERVAL,
+                                           _report_refilled);
+
+        _UNLOCK();
+
+        if(install)
+                atexit(_exit_report);
+}
+
+
+/**
+ * report dropped messages of a range of call-sites right away (before 
+ * they're unregistered)
+ *
+ * @param[in] start first @ref NftLogSite of range
+ * @param[in] stop end of range
+ */
+void _ratelimit_forget(NftLogSite * start, NftLogSite * stop)
+{
+        NftLogSite *range[2] = { start, stop };
+        _report_matching(_within, range);
+}
+
+
+/**
+ * take one token from the bucket of a call-site. The bucket is stored as 
+ * the time it will be full again: each message pushes it one interval 
+ * (1s / rate) into the future, a message finding it more than burst - 1 
+ * intervals ahead of now is dropped. This needs one compare & swap per 
+ * message and no timer to refill the bucket. Call-sites that drop 
+ * messages are reported by a thread once their bucket is refilled (or 
+ * upon exit) if they don't log again themselves.
+ *
+ * @param[in] site @ref NftLogSite
+ * @param[in] level @ref NftLoglevel of the message
+ * @param[in] logger @ref NftLogger dropped messages are reported to (NULL 
+ *            for call-sites of nft_log_site())
+ * @param[out] suppressed amount of messages dropped since the previous one
+ *             that passed (only set if message passes)
+ * @result true if message should be logged
+ */
+bool _ratelimit_wants(NftLogSite * site, NftLoglevel level,
+                      NftLogger * logger, unsigned long *suppressed)
+{
+        *suppressed = 0;
+
+        uint64_t interval, tolerance;
+        if(!_bucket(site, level, &interval, &tolerance))
+                return true;
+
+        uint64_t now = _now();
+        uint64_t full = __atomic_load_n(&site->bucket, __ATOMIC_RELAXED);
+        do
+        {
+                /* bucket empty? */
+                if(full > now + tolerance)
+                {
+                        if(__atomic_add_fetch(&site->suppressed, 1,
+                                              __ATOMIC_RELAXED) == 1)
+                                _pending_add(site, level, logger);
+                        return false;
+                }
+        }
+        while(!__atomic_compare_exchange_n(&site->bucket, &full,
+                                           (full > now ? full : now) +
+                                           interval, true, __ATOMIC_RELAXED,
+                                           __ATOMIC_RELAXED));
+
+        *suppressed = __atomic_exchange_n(&site->suppressed, 0,
+                                          __ATOMIC_RELAXED);
+        return true;
+}
+
+
+/**
+ * limit the rate of messages of a level per call-site. A call-site may 
+ * log burst messages at once, then rate messages per second. Dropped 
+ * messages aren't formatted at all, "suppressed N messages" is logged 
+ * before the next message that passes or, if the call-site doesn't log 
+ * anymore, about a second after its bucket has been refilled (or upon 
+ * exit). Call-sites of 
+ * @ref NFT_LOG_RATELIMITED() use their own limit. The 
+ * NFT_LOG_RATELIMIT environment variable (comma separated list of 
+ * "rate[:burst]" for all levels and "level=rate[:burst]", e.g. 
+ * "error=10:50,debug=100") always wins for the levels it mentions.
+ *
+ * @param[in] level @ref NftLoglevel or L_INVALID for all levels
+ * @param[in] rate messages per second or 0 to disable limit
+ * @param[in] burst messages logged at once or 0 for rate
+ * @result NFT_SUCCESS or NFT_FAILURE
+ */
+NftResult nft_log_ratelimit_set(NftLoglevel level, unsigned int rate,
+                                unsigned int burst)
+{
+        if(level != L_INVALID && (level <= L_MAX || level >= L_MIN))
+                return NFT_FAILURE;
+
+        _store(level, rate, burst);
+
+        /* environment always wins */
+        _env_apply();
+        __atomic_store_n(&_env_read, true, __ATOMIC_RELEASE);
+
+        return NFT_SUCCESS;
+}
+
+
+/**
+ * get rate limit of a level
+ *
+ * @param[in] level @ref NftLoglevel
+ * @param[out] rate messages per second (0 if unlimited)
+ * @param[out] burst messages logged at once
+ * @result NFT_SUCCESS or NFT_FAILURE
+ */
+NftResult nft_log_ratelimit_get(NftLoglevel level, unsigned int *rate,
+                                unsigned int *burst)
+{
+        if(level <= L_MAX || level >= L_MIN || !rate || !burst)
+                return NFT_FAILURE;
+
+        uint64_t limit = _limit_get(level);
+        *rate = limit >> 32;
+        *burst = limit & UINT32_MAX;
+
+        return NFT_SUCCESS;
+}
+
+
+/**
+ * @}
+ */
@@ -0,0 +1,251 @@
+/*
+ * libniftylog - niftylight logging library
+ * Copyright (C) 2006-2014 Daniel Hiepler <daniel@niftylight.de>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+/**
+ * @file sample.c
+ */
+
+/**
+ * @addtogroup logger
+ * @{
+ */
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
+#include <time.h>
+#include "config.h"
+#include "logger-mechanism.h"
+#include "_logger.h"
+#include "_env.h"
+#include "_sample.h"
+
+
+/** 1 in how many messages of a level are logged (0 = all) */
+static unsigned int _rates[L_MIN];
+/** true as soon as the environment has been read */
+static bool _env_read;
+/** state of PRNG of calling thread (0 until seeded) */
+static __thread uint64_t _state;
+
+
+
+
+/**
+ * store sampling rate of one level (or all levels if level is L_INVALID)
+ */
+static void _store(NftLoglevel level, unsigned int n)
+{
+        if(n == 1)
+                n = 0;
+
+        if(level != L_INVALID)
+        {
+                __atomic_store_n(&_rates[level], n, __ATOMIC_RELAXED);
+                return;
+        }
+
+        for(level = L_MAX + 1; level < L_MIN; level++)
+                __atomic_store_n(&_rates[level], n, __ATOMIC_RELAXED);
+}
+
+
+/**
+ * check & apply "[1/]N" value of NFT_LOG_SAMPLE
+ */
+static bool _value(NftLoglevel level, const char *value, bool apply)
+{
+        if(strncmp(value, "1/", 2) == 0)
+                value += 2;
+
+        char *end;
+        unsigned long n;
+        if(*value < '0' || *value > '9' ||
+           (n = strtoul(value, &end, 10)) > UINT_MAX || *end)
+                return false;
+
+        if(apply)
+                _store(level, n);
+
+        return true;
+}
+
+
+/**
+ * apply environment variable
+ */
+static void _env_apply()
+{
+        _env_levels(NFT_LOG_ENV_SAMPLE, "sampling rate", _value);
+}
+
+
+/**
+ * get sampling rate of level (reads environment upon first call)
+ */
+static unsigned int _rate_get(NftLoglevel level)
+{
+        if(!__atomic_load_n(&_env_read, __ATOMIC_ACQUIRE))
+        {
+                _env_apply();
+                __atomic_store_n(&_env_read, true, __ATOMIC_RELEASE);
+        }
+
+        return __atomic_load_n(&_rates[level], __ATOMIC_RELAXED);
+}
+
+
+/**
+ * next number of PRNG of calling thread (xorshift64*, seeded once per 
+ * thread)
+ */
+static uint64_t _random()
+{
+        uint64_t x = _state;
+        if(!x)
+        {
+                struct timespec t;
+                clock_gettime(CLOCK_MONOTONIC, &t);
+                x = ((uint64_t) t.tv_nsec << 32) ^ (uint64_t) t.tv_sec ^
+                        ((uint64_t) _log_tid() * 0x9e3779b97f4a7c15ULL) ^
+                        (uint64_t) (uintptr_t) &_state;
+                if(!x)
+                        x = 1;
+        }
+
+        x ^= x >> 12;
+        x ^= x << 25;
+        x ^= x >> 27;
+        _state = x;
+
+        return x * 0x2545f4914f6cdd1dULL;
+}
+
+
+/**
+ * get weight of messages of a call-site
+ *
+ * @param[in] site @ref NftLogSite
+ * @param[in] level @ref NftLoglevel of the message
+ * @result N if 1 in N messages is logged, 0 if all messages are logged
+ */
+unsigned int _sample_weight(const NftLogSite * site, NftLoglevel level)
+{
+        if(site->sample)
+                return site->sample > 1 ? site->sample : 0;
+
+        if(level <= L_MAX || level >= L_MIN)
+                return 0;
+
+        return _rate_get(level);
+}
+
+
+/**
+ * decide if message of a call-site is logged (randomly, so periodic 
+ * messages don't alias with the sampling rate)
+ *
+ * @param[in] site @ref NftLogSite
+ * @param[in] level @ref NftLoglevel of the message
+ * @result true if message should be logged
+ */
+bool _sample_wants(const NftLogSite * site, NftLoglevel level)
+{
+        unsigned int n;
+        if(!(n = _sample_weight(site, level)))
+                return true;
+
+        /* map upper 32 bits to [0, n) */
+        return ((_random() >> 32) * n) >> 32 == 0;
+}
+
+
+/**
+ * log only 1 in N messages of a level, chosen randomly per call-site. 
+ * Dropped messages aren't formatted, logged messages carry N as weight 
+ * (s. @ref NftLogMessage, @ref NftLogRecord & the JSON output) so counts
+ * can be scaled up again. Call-sites of @ref NFT_LOG_SAMPLED() use their
+ * own rate. The NFT_LOG_SAMPLE environment variable (comma separated list
+ * of "1/N" for all levels and "level=1/N", e.g. "noisy=1/1000") always 
+ * wins for the levels it mentions.
+ *
+ * @param[in] level @ref NftLoglevel or L_INVALID for all levels
+ * @param[in] n log 1 in n messages (0 or 1 to log all messages)
+ * @result NFT_SUCCESS or NFT_FAILURE
+ */
+NftResult nft_log_sample_set(NftLoglevel level, unsigned int n)
+{
+        if(level != L_INVALID && (level <= L_MAX || level >= L_MIN))
+                return NFT_FAILURE;
+
+        _store(level, n);
+
+        /* environment always wins */
+        _env_apply();
+        __atomic_store_n(&_env_read, true, __ATOMIC_RELEASE);
+
+        return NFT_SUCCESS;
+}
+
+
+/**
+ * get sampling rate of a level
+ *
+ * @param[in] level @ref NftLoglevel
+ * @result N if 1 in N messages is logged (1 if all messages are logged or 
+ *         level is invalid)
+ */
+unsigned int nft_log_sample_get(NftLoglevel level)
+{
+        if(level <= L_MAX || level >= L_MIN)
+                return 1;
+
+        unsigned int n = _rate_get(level);
+        return n ? n : 1;
+}
+
+
+/**
+ * @}
+ */
@@ -0,0 +1,708 @@
+/*
+ * libniftylog - niftylight logging library
+ * Copyright (C) 2006-2014 Daniel Hiepler <daniel@niftylight.de>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/**
+ * @file site.c
+ */
+
+/**
+ * @addtogroup logger
+ * @{
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "logger.h"
+#include "logger-mechanism.h"
+#include "_mechanism.h"
+#include "_site.h"
+#include "_ratelimit.h"
+
+
+
+/** one registered call-site section (one per binary/library) */
+struct SiteRange
+{
+        /** first call-site */
+        NftLogSite *start;
+        /** end of call-site section */
+        NftLogSite *stop;
+        /** next range */
+        struct SiteRange *next;
+};
+
+
+/** one "pattern=level" rule of NFT_LOG_LEVEL */
+struct Rule
+{
+        /** pattern matched against __FILE__ */
+        char *pattern;
+        /** level of call-sites matching pattern */
+        NftLoglevel level;
+        /** most verbose level logged by those call-sites */
+        NftLoglevel threshold;
+};
+
+
+/** list of registered call-site ranges */
+static struct SiteRange *_ranges;
+/** protects _ranges */
+static bool _lock;
+/** loglevel call-sites have been updated with */
+static NftLoglevel _level;
+/** true as soon as a valid loglevel is known */
+static bool _level_valid;
+/** rules of current level specification */
+static struct Rule *_rules;
+/** amount of rules */
+static int _nrules;
+/** 
+ * generation of level specification (changed whenever levels change, so 
+ * call-sites know their cached levels are stale) 
+ */
+static unsigned int _generation = 1;
+
+
+
+/** lock list of call-site ranges */
+static void _ranges_lock()
+{
+        while(__atomic_test_and_set(&_lock, __ATOMIC_ACQUIRE));
+}
+
+
+/** unlock list of call-site ranges */
+static void _ranges_unlock()
+{
+        __atomic_clear(&_lock, __ATOMIC_RELEASE);
+}
+
+
+/** 
+ * match glob pattern ('*' and '?') against string 
+ */
+static bool _glob(const char *pattern, const char *s)
+{
+        const char *star = NULL, *retry = NULL;
+
+        while(*s)
+        {
+                if(*pattern == '*')
+                {
+                        star = ++pattern;
+                        retry = s;
+                }
+                else if(*pattern == '?' || *pattern == *s)
+                {
+                        pattern++;
+                        s++;
+                }
+                else if(star)
+                {
+                        /* let last '*' match one more character */
+                        pattern = star;
+                        s = ++retry;
+                }
+                else
+                        return false;
+        }
+
+        while(*pattern == '*')
+                pattern++;
+
+        return *pattern == '\0';
+}
+
+
+/** 
+ * check if pattern matches file (complete path or any part following '/')
+ */
+static bool _pattern_matches(const char *pattern, const char *file)
+{
+        for(const char *p = file; p; p = strchr(p, '/'))
+        {
+                if(*p == '/')
+                        p++;
+
+                if(_glob(pattern, p))
+                        return true;
+        }
+
+        return false;
+}
+
+
+/** 
+ * find rule for file (called with lock held)
+ *
+ * @result last matching rule or NULL
+ */
+static struct Rule *_rule(const char *file)
+{
+        struct Rule *result = NULL;
+        for(int i = 0; i < _nrules; i++)
+        {
+                if(_pattern_matches(_rules[i].pattern, file))
+                        result = &_rules[i];
+        }
+
+        return result;
+}
+
+
+/** resolve cached levels of a call-site (called with lock held) */
+static void _site_resolve(NftLogSite * site)
+{
+        struct Rule *r = _rule(site->file);
+
+        __atomic_store_n(&site->threshold, r ? r->threshold : _level,
+                         __ATOMIC_RELAXED);
+        __atomic_store_n(&site->rule, r ? r->level : L_INVALID,
+                         __ATOMIC_RELAXED);
+        __atomic_store_n(&site->generation, _generation, __ATOMIC_RELEASE);
+}
+
+
+/** make sure cached levels of a call-site are up to date */
+static void _site_check(NftLogSite * site)
+{
+        if(__atomic_load_n(&site->generation, __ATOMIC_ACQUIRE) ==
+           __atomic_load_n(&_generation, __ATOMIC_ACQUIRE))
+                return;
+
+        _ranges_lock();
+        _site_resolve(site);
+        _ranges_unlock();
+}
+
+
+/** update enabled-state of one call-site (called with lock held) */
+static void _site_update(NftLogSite * site)
+{
+        if(site->generation != _generation)
+                _site_resolve(site);
+
+        int enabled;
+        switch (site->mode)
+        {
+                case NFT_LOG_SITE_ON:
+                {
+                        enabled = 1;
+                        break;
+                }
+
+                case NFT_LOG_SITE_OFF:
+                {
+                        enabled = 0;
+                        break;
+                }
+
+                default:
+                {
+                        /* loglevel unknown at compile time or loglevel unknown, 
+                           yet? Let NFT_LOG() check at runtime */
+                        if(site->level == L_INVALID || !_level_valid)
+                                enabled = 1;
+                        else
+                                enabled = (site->level >= site->threshold);
+                        break;
+                }
+        }
+
+        __atomic_store_n(&site->enabled, enabled, __ATOMIC_RELAXED);
+}
+
+
+/** update enabled-state of all call-sites in a range */
+static void _range_update(struct SiteRange *r)
+{
+        for(NftLogSite * s = r->start; s < r->stop; s++)
+                _site_update(s);
+}
+
+
+/** check if file of call-site matches file (full path or basename) */
+static bool _file_matches(const char *sitefile, const char *file)
+{
+        if(!file)
+                return true;
+
+        size_t slen = strlen(sitefile);
+        size_t flen = strlen(file);
+
+        if(flen > slen)
+                return false;
+
+        if(strcmp(sitefile + slen - flen, file) != 0)
+                return false;
+
+        return (flen == slen || sitefile[slen - flen - 1] == '/');
+}
+
+
+/**
+ * replace rules of level specification (called with level mutex held)
+ *
+ * @param[in] spec comma separated list of "pattern=level" rules and 
+ *            (optionally) one level name or NULL
+ * @result default level of specification or L_INVALID if none
+ */
+NftLoglevel _site_spec_set(const char *spec)
+{
+        NftLoglevel result = L_INVALID;
+        struct Rule *rules = NULL;
+        int n = 0;
+
+        for(const char *p = spec; p && *p;)
+        {
+                size_t len = strcspn(p, ",");
+                char entry[len + 1];
+                memcpy(entry, p, len);
+                entry[len] = '\0';
+
+                p += len;
+                if(*p == ',')
+                        p++;
+
+                char *level;
+                if(!(level = strrchr(entry, '=')))
+                {
+                        result = nft_log_level_from_string(entry);
+                        continue;
+                }
+                *level++ = '\0';
+
+                struct Rule r = {.level = nft_log_level_from_string(level) };
+                if(r.level == L_INVALID)
+                        continue;
+
+                struct Rule *tmp;
+                if(!(tmp = realloc(rules, (n + 1) * sizeof(struct Rule))))
+                {
+                        perror("realloc");
+                        break;
+                }
+                rules = tmp;
+
+                if(!(r.pattern = strdup(entry)))
+                {
+                        perror("strdup");
+                        break;
+                }
+                r.threshold = r.level;
+                rules[n++] = r;
+        }
+
+        _ranges_lock();
+
+        struct Rule *old = _rules;
+        int nold = _nrules;
+        _rules = rules;
+        _nrules = n;
+        __atomic_add_fetch(&_generation, 1, __ATOMIC_RELEASE);
+
+        _ranges_unlock();
+
+        for(int i = 0; i < nold; i++)
+                free(old[i].pattern);
+        free(old);
+
+        return result;
+}
+
+
+/**
+ * update all call-sites with new loglevel (called with level mutex held 
+ * when loglevel changes)
+ *
+ * @param[in] level currently effective loglevel
+ * @result most verbose level any call-site logs
+ */
+NftLoglevel _site_update_all(NftLoglevel level)
+{
+        /* mechanisms might want more verbose messages than rules */
+        NftLoglevel thresholds[_nrules > 0 ? _nrules : 1];
+        for(int i = 0; i < _nrules; i++)
+                thresholds[i] = _mechanism_sinks_level(NULL, _rules[i].level);
+
+        _ranges_lock();
+
+        _level = level;
+        _level_valid = true;
+
+        NftLoglevel min = level;
+        for(int i = 0; i < _nrules; i++)
+        {
+                _rules[i].threshold = thresholds[i];
+                if(thresholds[i] < min)
+                        min = thresholds[i];
+        }
+
+        /* cached levels of all call-sites are stale */
+        __atomic_add_fetch(&_generation, 1, __ATOMIC_RELEASE);
+
+        for(struct SiteRange * r = _ranges; r; r = r->next)
+                _range_update(r);
+
+        _ranges_unlock();
+
+        return min;
+}
+
+
+/**
+ * find out if a call-site should log a message (slow path of NFT_LOG())
+ *
+ * @param[in] site @ref NftLogSite
+ * @param[in] level @ref NftLoglevel of the message
+ * @result true if message should be logged
+ */
+bool _site_wants(NftLogSite * site, NftLoglevel level)
+{
+        switch (__atomic_load_n(&site->mode, __ATOMIC_RELAXED))
+        {
+                case NFT_LOG_SITE_ON:
+                        return true;
+
+                case NFT_LOG_SITE_OFF:
+                        return false;
+
+                default:
+                {
+                        /* reads environment upon first call */
+                        nft_log_level_get();
+
+                        _site_check(site);
+                        return level >= __atomic_load_n(&site->threshold,
+                                                        __ATOMIC_RELAXED);
+                }
+        }
+}
+
+
+/**
+ * get level of the NFT_LOG_LEVEL rule matching a call-site
+ *
+ * @param[in] site @ref NftLogSite or NULL
+ * @result level of rule or L_INVALID if no rule matches
+ */
+NftLoglevel _site_rule(const NftLogSite * site)
+{
+        if(!site)
+                return L_INVALID;
+
+        /* cached levels are maintained by library */
+        _site_check((NftLogSite *) site);
+        return __atomic_load_n(&site->rule, __ATOMIC_RELAXED);
+}
+
+
+/**
+ * get level messages of a call-site are checked against by subscribers and
+ * mechanisms without own level
+ *
+ * @param[in] site @ref NftLogSite or NULL
+ * @result L_MAX if call-site has been switched on, level of matching rule 
+ *         or L_INVALID (global level) otherwise
+ */
+NftLoglevel _site_base(const NftLogSite * site)
+{
+        if(site && __atomic_load_n(&site->mode, __ATOMIC_RELAXED) ==
+           NFT_LOG_SITE_ON)
+                return L_MAX;
+
+        return _site_rule(site);
+}
+
+
+/**
+ * find out if a message from a source file should be logged (used for 
+ * messages without call-site)
+ *
+ * @param[in] file __FILE__ of message
+ * @param[in] level @ref NftLoglevel of message
+ * @param[out] rule level of matching NFT_LOG_LEVEL rule or L_INVALID
+ * @result true if message should be logged
+ */
+bool _site_file_wants(const char *file, NftLoglevel level, NftLoglevel * rule)
+{
+        *rule = L_INVALID;
+
+        /* no rules, no need to lock */
+        if(!__atomic_load_n(&_nrules, __ATOMIC_RELAXED))
+                return level >= __atomic_load_n(&_level, __ATOMIC_RELAXED);
+
+        _ranges_lock();
+        struct Rule *r = _rule(file);
+        NftLoglevel threshold = r ? r->threshold : _level;
+        if(r)
+                *rule = r->level;
+        _ranges_unlock();
+
+        return level >= threshold;
+}
+
+
+/**
+ * register call-sites of a binary/library. This is called automatically 
+ * upon load for every binary/library that includes logger.h
+ *
+ * @param[in] start first @ref NftLogSite
+ * @param[in] stop end of call-site section
+ */
+void nft_log_sites_register(NftLogSite * start, NftLogSite * stop)
+{
+        if(!start || start >= stop)
+                return;
+
+        _ranges_lock();
+
+        /* already registered? */
+        for(struct SiteRange * r = _ranges; r; r = r->next)
+        {
+                if(r->start == start)
+                {
+                        _ranges_unlock();
+                        return;
+                }
+        }
+
+        struct SiteRange *r;
+        if(!(r = malloc(sizeof(struct SiteRange))))
+        {
+                _ranges_unlock();
+                perror("malloc");
+                return;
+        }
+
+        r->start = start;
+        r->stop = stop;
+        r->next = _ranges;
+        _ranges = r;
+
+        /* sites of this range can use cached state from now on */
+        _range_update(r);
+
+        _ranges_unlock();
+}
+
+
+/**
+ * unregister call-sites of a binary/library. This is called automatically 
+ * upon unload for every binary/library that includes logger.h
+ *
+ * @param[in] start first @ref NftLogSite as passed to nft_log_sites_register()
+ */
+void nft_log_sites_unregister(NftLogSite * start)
+{
+        if(!start)
+                return;
+
+        _ranges_lock();
+
+        NftLogSite *stop = NULL;
+        for(struct SiteRange ** r = &_ranges; *r; r = &(*r)->next)
+        {
+                if((*r)->start == start)
+                {
+                        struct SiteRange *tmp = *r;
+                        *r = tmp->next;
+                        stop = tmp->stop;
+                        free(tmp);
+                        break;
+                }
+        }
+
+        _ranges_unlock();
+
+        /* report dropped messages while call-sites are still mapped */
+        if(stop)
+                _ratelimit_forget(start, stop);
+}
+
+
+/**
+ * call a function for every registered call-site. func is called without
+ * holding the lock of the call-site list, so it may block or use other
+ * nft_log_site*() functions.
+ *
+ * @param[in] func @ref NftLogSiteFunc to call
+ * @param[in] userdata arbitrary pointer that will be passed to func
+ * @note binaries/libraries must not be unloaded while this is running
+ */
+void nft_log_sites_foreach(NftLogSiteFunc * func, void *userdata)
+{
+        if(!func)
+                return;
+
+        _ranges_lock();
+
+        /* copy ranges, so func can be called unlocked */
+        size_t count = 0;
+        for(struct SiteRange * r = _ranges; r; r = r->next)
+                count++;
+
+        struct SiteRange *ranges = NULL;
+        if(count && !(ranges = malloc(count * sizeof(struct SiteRange))))
+        {
+                _ranges_unlock();
+                perror("malloc");
+                return;
+        }
+
+        size_t n = 0;
+        for(struct SiteRange * r = _ranges; r; r = r->next)
+                ranges[n++] = *r;
+
+        _ranges_unlock();
+
+        for(size_t i = 0; i < count; i++)
+        {
+                for(NftLogSite * s = ranges[i].start; s < ranges[i].stop; s++)
+                        func(userdata, s);
+        }
+
+        free(ranges);
+}
+
+
+/** print one call-site */
+static void _site_print(void *userdata, NftLogSite * site)
+{
+        const char *mode;
+        switch (site->mode)
+        {
+                case NFT_LOG_SITE_ON:
+                {
+                        mode = "on";
+                        break;
+                }
+
+                case NFT_LOG_SITE_OFF:
+                {
+                        mode = "off";
+                        break;
+                }
+
+                default:
+                {
+                        mode = site->enabled ? "enabled" : "disabled";
+                        break;
+                }
+        }
+
+        printf("%s:%d %s() [%s] %s \"%s\"\n",
+               site->file, site->line, site->func,
+               site->level == L_INVALID ? "?" :
+               nft_log_level_to_string(site->level),
+               mode, site->format ? site->format : "?");
+}
+
+
+/**
+ * print list of all registered call-sites to stdout
+ */
+void nft_log_sites_print()
+{
+        nft_log_sites_foreach(_site_print, NULL);
+}
+
+
+/**
+ * set mode of all call-sites matching file & line
+ *
+ * @param[in] file full path or basename of source file or NULL for all files 
+ * @param[in] line line of call-site or 0 for all lines
+ * @param[in] mode new @ref NftLogSiteMode
+ * @result amount of call-sites changed
+ */
+int nft_log_sites_mode_set(const char *file, int line, NftLogSiteMode mode)
+{
+        int result = 0;
+
+        _ranges_lock();
+
+        for(struct SiteRange * r = _ranges; r; r = r->next)
+        {
+                for(NftLogSite * s = r->start; s < r->stop; s++)
+                {
+                        if(line && s->line != line)
+                                continue;
+
+                        if(!_file_matches(s->file, file))
+                                continue;
+
+                        __atomic_store_n(&s->mode, mode, __ATOMIC_RELAXED);
+                        _site_update(s);
+                        result++;
+                }
+        }
+
+        _ranges_unlock();
+
+        return result;
+}
+
+
+/**
+ * set mode of one call-site
+ *
+ * @param[in] site @ref NftLogSite (e.g. from nft_log_sites_foreach())
+ * @param[in] mode new @ref NftLogSiteMode
+ */
+void nft_log_site_mode_set(NftLogSite * site, NftLogSiteMode mode)
+{
+        if(!site)
+                return;
+
+        _ranges_lock();
+        __atomic_store_n(&site->mode, mode, __ATOMIC_RELAXED);
+        _site_update(site);
+        _ranges_unlock();
+}
+
+
+/**
+ * @}
+ */
@@ -0,0 +1,279 @@
+/*
+ * libniftylog - niftylight logging library
+ * Copyright (C) 2006-2014 Daniel Hiepler <daniel@niftylight.de>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+/**
+ * @file thread.c
+ */
+
+/**
+ * @addtogroup logger
+ * @{
+ */
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "config.h"
+#include "logger-mechanism.h"
+#include "_logger.h"
+#include "_thread.h"
+
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
+
+
+
+/** names of thread info modes (must be synced with NftLogThread) */
+static const char *_names[] = {
+        "off",
+        "id",
+        "name",
+        "all",
+};
+
+
+/** current thread info mode */
+static NftLogThread _mode;
+/** true as soon as the environment has been read */
+static bool _env_read;
+
+/** thread info of the calling thread */
+static __thread struct
+{
+        /** mode the text has been built for (OFF if nothing cached) */
+        NftLogThread mode;
+        /** true if name has been looked up or set */
+        bool named;
+        /** name of thread (empty if unknown) */
+        char name[THREAD_NAME_MAX];
+        /** "[tid name] " */
+        char text[THREAD_PREFIX_MAX];
+        /** length of text */
+        size_t len;
+} _self;
+
+
+
+
+/**
+ * parse name of thread info mode
+ *
+ * @result NftLogThread or -1 if name is invalid
+ */
+static int _parse(const char *name)
+{
+        for(int i = 0; i < NFT_LOG_THREAD_MAX; i++)
+        {
+                if(strcmp(name, _names[i]) == 0)
+                        return i;
+        }
+
+        fprintf(stderr, "Invalid thread info mode: \"%s\"\n", name);
+        return -1;
+}
+
+
+/**
+ * get current mode (reads environment upon first call)
+ */
+static NftLogThread _mode_get()
+{
+        if(!__atomic_load_n(&_env_read, __ATOMIC_ACQUIRE))
+        {
+                char *env;
+                int mode;
+                if((env = getenv(NFT_LOG_ENV_THREAD)) &&
+                   (mode = _parse(env)) >= 0)
+                        __atomic_store_n(&_mode, mode, __ATOMIC_RELAXED);
+
+                __atomic_store_n(&_env_read, true, __ATOMIC_RELEASE);
+        }
+
+        return __atomic_load_n(&_mode, __ATOMIC_RELAXED);
+}
+
+
+/**
+ * build text of calling thread (once per thread and mode)
+ */
+static void _build(NftLogThread mode)
+{
+        /* ask kernel once if no name has been set */
+        if(!_self.named && mode != NFT_LOG_THREAD_ID)
+        {
+#ifdef HAVE_PTHREAD_H
+                if(pthread_getname_np(pthread_self(), _self.name,
+                                      sizeof(_self.name)) != 0)
+#endif
+                        _self.name[0] = '\0';
+                _self.named = true;
+        }
+
+        /* threads without name are printed by id */
+        int n;
+        if(mode == NFT_LOG_THREAD_NAME && _self.name[0])
+                n = snprintf(_self.text, sizeof(_self.text), "[%s] ",
+                             _self.name);
+        else if(mode == NFT_LOG_THREAD_ID || !_self.name[0])
+                n = snprintf(_self.text, sizeof(_self.text), "[%lu] ",
+                             _log_tid());
+        else
+                n = snprintf(_self.text, sizeof(_self.text), "[%lu %s] ",
+                             _log_tid(), _self.name);
+
+        _self.len = (n < 0 ? 0 : (size_t) n < sizeof(_self.text) ?
+                     (size_t) n : sizeof(_self.text) - 1);
+        _self.mode = mode;
+}
+
+
+/**
+ * get thread info of calling thread (no syscall after the first message)
+ *
+ * @param[out] len length of text
+ * @result "[tid name] " (\0 terminated) or "" if thread info is disabled
+ */
+const char *_thread_prefix(size_t *len)
+{
+        NftLogThread mode = _mode_get();
+        if(mode == NFT_LOG_THREAD_OFF)
+        {
+                *len = 0;
+                return "";
+        }
+
+        if(_self.mode != mode)
+                _build(mode);
+
+        *len = _self.len;
+        return _self.text;
+}
+
+
+/**
+ * drop cached thread info of the calling thread (called in a forked 
+ * child, whose thread id differs from the parent's)
+ */
+void _thread_forked()
+{
+        _self.mode = NFT_LOG_THREAD_OFF;
+}
+
+
+/**
+ * set which thread info is printed in front of every message. The 
+ * NFT_LOG_THREAD environment variable (holding the name of a mode) always 
+ * wins.
+ *
+ * @param[in] mode @ref NftLogThread
+ * @result NFT_SUCCESS or NFT_FAILURE
+ */
+NftResult nft_log_thread_set(NftLogThread mode)
+{
+        if(mode < NFT_LOG_THREAD_OFF || mode >= NFT_LOG_THREAD_MAX)
+                return NFT_FAILURE;
+
+        /* environment always wins (only if it's valid) */
+        char *env;
+        int m;
+        if((env = getenv(NFT_LOG_ENV_THREAD)) && (m = _parse(env)) >= 0)
+                mode = m;
+
+        __atomic_store_n(&_mode, mode, __ATOMIC_RELAXED);
+        __atomic_store_n(&_env_read, true, __ATOMIC_RELEASE);
+
+        return NFT_SUCCESS;
+}
+
+
+/**
+ * get current thread info mode
+ *
+ * @result @ref NftLogThread
+ */
+NftLogThread nft_log_thread_get()
+{
+        return _mode_get();
+}
+
+
+/**
+ * set name of calling thread used in log messages. This doesn't rename the
+ * thread (the kernel isn't involved). Names are truncated to 
+ * THREAD_NAME_MAX - 1 characters.
+ *
+ * @param[in] name new name or NULL to use the name the kernel knows
+ */
+void nft_log_thread_name_set(const char *name)
+{
+        if(name)
+        {
+                strncpy(_self.name, name, sizeof(_self.name) - 1);
+                _self.name[sizeof(_self.name) - 1] = '\0';
+        }
+
+        _self.named = (name != NULL);
+
+        /* rebuild text on next message */
+        _self.mode = NFT_LOG_THREAD_OFF;
+}
+
+
+/**
+ * get name of calling thread used in log messages
+ *
+ * @result name (empty if unknown)
+ */
+const char *nft_log_thread_name_get()
+{
+        if(!_self.named)
+                _build(NFT_LOG_THREAD_ALL);
+
+        return _self.name;
+}
+
+
+/**
+ * @}
+ */
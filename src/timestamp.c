@@ -0,0 +1,318 @@
+/*
+ * libniftylog - niftylight logging library
+ * Copyright (C) 2006-2014 Daniel Hiepler <daniel@niftylight.de>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+/**
+ * @file timestamp.c
+ */
+
+/**
+ * @addtogroup logger
+ * @{
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "logger.h"
+#include "_timestamp.h"
+#include "_clock.h"
+
+
+
+/** clock used for coarse wall-clock timestamps */
+#ifdef CLOCK_REALTIME_COARSE
+#define CLOCK_COARSE    CLOCK_REALTIME_COARSE
+#else
+#define CLOCK_COARSE    CLOCK_REALTIME
+#endif
+
+
+/** names of timestamp modes (must be synced with NftLogTimestamp) */
+static const char *_names[] = {
+        "off",
+        "sec",
+        "msec",
+        "usec",
+        "monotonic",
+};
+
+
+/** current timestamp mode */
+static NftLogTimestamp _mode;
+/** true as soon as the environment has been read */
+static bool _env_read;
+
+/** date & time part of the last timestamp of the calling thread */
+static __thread struct
+{
+        /** mode the text has been built for (OFF if nothing cached) */
+        NftLogTimestamp mode;
+        /** second the text has been built for */
+        time_t sec;
+        /** "YYYY-mm-dd HH:MM:SS" or seconds since boot */
+        char text[32];
+        /** length of text */
+        size_t len;
+} _cache;
+
+
+
+
+/**
+ * parse name of timestamp mode
+ *
+ * @result NftLogTimestamp or -1 if name is invalid
+ */
+static int _parse(const char *name)
+{
+        for(int i = 0; i < NFT_LOG_TIMESTAMP_MAX; i++)
+        {
+                if(strcmp(name, _names[i]) == 0)
+                        return i;
+        }
+
+        fprintf(stderr, "Invalid timestamp mode: \"%s\"\n", name);
+        return -1;
+}
+
+
+/**
+ * get current mode (reads environment upon first call)
+ */
+static NftLogTimestamp _mode_get()
+{
+        if(!__atomic_load_n(&_env_read, __ATOMIC_ACQUIRE))
+        {
+                char *env;
+                int mode;
+                if((env = getenv(NFT_LOG_ENV_TIMESTAMP)) &&
+                   (mode = _parse(env)) >= 0)
+                        __atomic_store_n(&_mode, mode, __ATOMIC_RELAXED);
+
+                __atomic_store_n(&_env_read, true, __ATOMIC_RELEASE);
+        }
+
+        return __atomic_load_n(&_mode, __ATOMIC_RELAXED);
+}
+
+
+/**
+ * build date & time part of timestamp (once per second and thread)
+ */
+static void _cache_update(NftLogTimestamp mode, time_t sec)
+{
+        int n;
+        if(mode == NFT_LOG_TIMESTAMP_MONOTONIC)
+        {
+                n = snprintf(_cache.text, sizeof(_cache.text), "%lld",
+                             (long long) sec);
+        }
+        else
+        {
+                struct tm tm;
+#ifdef WIN32
+                localtime_s(&tm, &sec);
+#else
+                localtime_r(&sec, &tm);
+#endif
+                n = (int) strftime(_cache.text, sizeof(_cache.text),
+                                   "%Y-%m-%d %H:%M:%S", &tm);
+        }
+
+        _cache.len = (n > 0 ? (size_t) n : 0);
+        _cache.mode = mode;
+        _cache.sec = sec;
+}
+
+
+/**
+ * print fraction of second with a certain amount of digits
+ *
+ * @result amount of bytes written
+ */
+static size_t _fraction(char *buf, long nsec, int digits)
+{
+        for(int i = 9; i > digits; i--)
+                nsec /= 10;
+
+        buf[0] = '.';
+        for(int i = digits; i > 0; i--)
+        {
+                buf[i] = (char) ('0' + nsec % 10);
+                nsec /= 10;
+        }
+
+        return (size_t) digits + 1;
+}
+
+
+/**
+ * write timestamp (followed by a space) to buffer
+ *
+ * @param[out] buf destination
+ * @param[in] size space in buf
+ * @param[in] time time of message (nanoseconds since epoch) or 0 for now
+ * @result length of timestamp or 0 if timestamps are disabled
+ */
+size_t _timestamp(char *buf, size_t size, uint64_t time)
+{
+        NftLogTimestamp mode = _mode_get();
+        if(mode == NFT_LOG_TIMESTAMP_OFF)
+                return 0;
+
+        struct timespec t;
+        switch (mode)
+        {
+                case NFT_LOG_TIMESTAMP_MONOTONIC:
+                {
+                        clock_gettime(CLOCK_MONOTONIC, &t);
+
+                        /* message logged earlier (e.g. by another thread) */
+                        if(time)
+                        {
+                                struct timespec now;
+                                clock_gettime(CLOCK_REALTIME, &now);
+                                uint64_t rt = (uint64_t) now.tv_sec *
+                                        1000000000ULL +
+                                        (uint64_t) now.tv_nsec;
+                                uint64_t mono = (uint64_t) t.tv_sec *
+                                        1000000000ULL + (uint64_t) t.tv_nsec;
+                                if(rt > time && mono > rt - time)
+                                        mono -= rt - time;
+                                t.tv_sec = (time_t) (mono / 1000000000ULL);
+                                t.tv_nsec = (long) (mono % 1000000000ULL);
+                        }
+                        break;
+                }
+
+                default:
+                {
+                        /* precise timestamps come from the configured clock */
+                        if(!time && mode == NFT_LOG_TIMESTAMP_USEC)
+                                time = _clock_ns(_clock_now());
+
+                        if(time)
+                        {
+                                t.tv_sec = (time_t) (time / 1000000000ULL);
+                                t.tv_nsec = (long) (time % 1000000000ULL);
+                        }
+                        else
+                                clock_gettime(CLOCK_COARSE, &t);
+                        break;
+                }
+        }
+
+        if(_cache.mode != mode || _cache.sec != t.tv_sec)
+                _cache_update(mode, t.tv_sec);
+
+        /* "text.fraction " */
+        char tmp[48];
+        memcpy(tmp, _cache.text, _cache.len);
+        size_t len = _cache.len;
+        switch (mode)
+        {
+                case NFT_LOG_TIMESTAMP_MSEC:
+                {
+                        len += _fraction(&tmp[len], t.tv_nsec, 3);
+                        break;
+                }
+
+                case NFT_LOG_TIMESTAMP_USEC:
+                case NFT_LOG_TIMESTAMP_MONOTONIC:
+                {
+                        len += _fraction(&tmp[len], t.tv_nsec, 6);
+                        break;
+                }
+
+                default:
+                        break;
+        }
+        tmp[len++] = ' ';
+
+        if(len > size)
+                len = size;
+        memcpy(buf, tmp, len);
+
+        return len;
+}
+
+
+/**
+ * set timestamp mode. The NFT_LOG_TIMESTAMP environment variable (holding
+ * the name of a mode) always wins.
+ *
+ * @param[in] mode @ref NftLogTimestamp
+ * @result NFT_SUCCESS or NFT_FAILURE
+ */
+NftResult nft_log_timestamp_set(NftLogTimestamp mode)
+{
+        if(mode < NFT_LOG_TIMESTAMP_OFF || mode >= NFT_LOG_TIMESTAMP_MAX)
+                return NFT_FAILURE;
+
+        /* environment always wins (only if it's valid) */
+        char *env;
+        int m;
+        if((env = getenv(NFT_LOG_ENV_TIMESTAMP)) && (m = _parse(env)) >= 0)
+                mode = m;
+
+        __atomic_store_n(&_mode, mode, __ATOMIC_RELAXED);
+        __atomic_store_n(&_env_read, true, __ATOMIC_RELEASE);
+
+        return NFT_SUCCESS;
+}
+
+
+/**
+ * get current timestamp mode
+ *
+ * @result @ref NftLogTimestamp
+ */
+NftLogTimestamp nft_log_timestamp_get()
+{
+        return _mode_get();
+}
+
+
+/**
+ * @}
+ */
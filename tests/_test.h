@@ -0,0 +1,271 @@
+/*
+ * libniftylog - niftylight logging library
+ * Copyright (C) 2006-2014 Daniel Hiepler <daniel@niftylight.de>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/**
+ * @file _test.h
+ * helpers shared by tests that check what has been logged
+ */
+
+#ifndef _TEST_H
+#define _TEST_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+
+
+/** length of lines read by the helpers (longer lines are split) */
+#define TEST_LINE_MAX   1024
+
+
+/** how _test_find() compares a line with a string */
+typedef enum
+{
+        /** line equals string */
+        TEST_EQUALS,
+        /** line contains string */
+        TEST_CONTAINS,
+        /** line ends with string */
+        TEST_ENDS,
+} TestMatch;
+
+
+/** temporary file created by _test_file() */
+static char _test_path[64];
+
+
+
+
+/**
+ * create empty temporary file "/tmp/niftylog-<name>-XXXXXX" (its path is 
+ * stored in _test_path)
+ */
+static inline bool _test_file(const char *name)
+{
+        snprintf(_test_path, sizeof(_test_path), "/tmp/niftylog-%s-XXXXXX",
+                 name);
+
+        int fd;
+        if((fd = mkstemp(_test_path)) < 0)
+        {
+                perror("mkstemp");
+                return false;
+        }
+        close(fd);
+
+        return true;
+}
+
+
+/**
+ * redirect stderr to a new temporary file, so tests can check what has 
+ * been logged
+ */
+static inline bool _test_capture(const char *name)
+{
+        if(!_test_file(name))
+                return false;
+
+        if(!freopen(_test_path, "w", stderr))
+        {
+                perror("freopen");
+                return false;
+        }
+
+        return true;
+}
+
+
+/**
+ * open everything written to stderr so far for reading
+ */
+static inline FILE *_test_open()
+{
+        fflush(stderr);
+
+        FILE *f;
+        if(!(f = fopen(_test_path, "r")))
+                perror("fopen");
+
+        return f;
+}
+
+
+/**
+ * discard everything written to stderr so far
+ */
+static inline bool _test_truncate()
+{
+        fflush(stderr);
+
+        if(ftruncate(STDERR_FILENO, 0) != 0)
+        {
+                perror("ftruncate");
+                return false;
+        }
+        lseek(STDERR_FILENO, 0, SEEK_SET);
+
+        return true;
+}
+
+
+/**
+ * count lines written to stderr that start with prefix
+ *
+ * @result amount of lines or -1 upon error
+ */
+static inline int _test_count(const char *prefix)
+{
+        FILE *f;
+        if(!(f = _test_open()))
+                return -1;
+
+        char line[TEST_LINE_MAX];
+        int n = 0;
+        while(fgets(line, (int) sizeof(line), f))
+        {
+                if(strncmp(line, prefix, strlen(prefix)) == 0)
+                        n++;
+        }
+        fclose(f);
+
+        return n;
+}
+
+
+/**
+ * check amount of lines written to stderr that start with prefix
+ */
+static inline bool _test_expect(const char *prefix, int n)
+{
+        int c = _test_count(prefix);
+        if(c != n)
+                fprintf(stdout, "%d lines \"%s\" instead of %d\n", c, prefix,
+                        n);
+
+        return c == n;
+}
+
+
+/**
+ * find first line written to stderr that matches a string
+ *
+ * @param[in] match how line and string are compared
+ * @param[in] s the string
+ * @param[out] line buffer for the line without newline (or NULL)
+ * @param[in] size size of line buffer
+ * @result true if line has been found
+ */
+static inline bool _test_find(TestMatch match, const char *s, char *line,
+                              size_t size)
+{
+        char buf[TEST_LINE_MAX];
+        if(!line)
+        {
+                line = buf;
+                size = sizeof(buf);
+        }
+
+        FILE *f;
+        if(!(f = _test_open()))
+                return false;
+
+        bool found = false;
+        size_t slen = strlen(s);
+        while(!found && fgets(line, (int) size, f))
+        {
+                line[strcspn(line, "\n")] = '\0';
+                size_t len = strlen(line);
+
+                switch (match)
+                {
+                        case TEST_EQUALS:
+                                found = (strcmp(line, s) == 0);
+                                break;
+                        case TEST_CONTAINS:
+                                found = (strstr(line, s) != NULL);
+                                break;
+                        case TEST_ENDS:
+                                found = (len >= slen &&
+                                         strcmp(line + len - slen, s) == 0);
+                                break;
+                }
+        }
+        fclose(f);
+
+        return found;
+}
+
+
+/**
+ * check that a line equal to s has been written to stderr
+ */
+static inline bool _test_line(const char *s)
+{
+        if(_test_find(TEST_EQUALS, s, NULL, 0))
+                return true;
+
+        fprintf(stdout, "\"%s\" missing\n", s);
+        return false;
+}
+
+
+/**
+ * check that s has (or hasn't) been written to stderr
+ *
+ * @param[in] s the string
+ * @param[in] expected true if s must be found, false if it must be absent
+ */
+static inline bool _test_contains(const char *s, bool expected)
+{
+        if(_test_find(TEST_CONTAINS, s, NULL, 0) == expected)
+                return true;
+
+        fprintf(stdout, "\"%s\" %s\n", s, expected ? "missing" : "unexpected");
+        return false;
+}
+
+
+#endif /* _TEST_H */
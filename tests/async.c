@@ -0,0 +1,242 @@
+/*
+ * libniftylog - niftylight logging library
+ * Copyright (C) 2006-2014 Daniel Hiepler <daniel@niftylight.de>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "niftylog.h"
+#include "_test.h"
+
+
+/** amount of producer threads */
+#define THREADS         4
+/** messages per thread */
+#define MESSAGES        5000
+/** marker at beginning of each message */
+#define MARKER          "async-test"
+
+
+/** original stderr */
+static int _stderr;
+
+
+
+/** producer thread */
+static void *_producer(void *arg)
+{
+        for(int i = 0; i < MESSAGES; i++)
+                NFT_LOG(L_INFO, MARKER " %ld %d", (long) arg, i);
+
+        return NULL;
+}
+
+
+/** count messages written to redirected stderr and truncate file */
+static int _count()
+{
+        int result = _test_count(MARKER);
+        if(!_test_truncate())
+                return -1;
+
+        return result;
+}
+
+
+/** run producers with a policy and check results */
+static bool _run(NftLogAsyncPolicy policy, size_t slots)
+{
+        if(!nft_log_async_enable(policy, slots))
+                return false;
+
+        pthread_t t[THREADS];
+        for(long i = 0; i < THREADS; i++)
+                pthread_create(&t[i], NULL, _producer, (void *) i);
+        for(int i = 0; i < THREADS; i++)
+                pthread_join(t[i], NULL);
+
+        nft_log_async_flush();
+
+        int written = _count();
+        uint64_t dropped = nft_log_async_dropped();
+
+        nft_log_async_disable();
+
+        if(written + dropped != THREADS * MESSAGES ||
+           (policy == NFT_LOG_ASYNC_BLOCK && dropped) ||
+           nft_log_async_policy() != NFT_LOG_ASYNC_OFF)
+        {
+                dprintf(_stderr, "policy %d: %d written + %llu dropped != %d"
+                        "\n", policy, written, (unsigned long long) dropped,
+                        THREADS * MESSAGES);
+                return false;
+        }
+
+        dprintf(_stderr, "policy %d: %d written, %llu dropped\n", policy,
+                written, (unsigned long long) dropped);
+        return true;
+}
+
+
+/** slow subscriber counting messages */
+static void _slow(void *userdata, const NftLogMessage * m)
+{
+        usleep(1000);
+        __atomic_add_fetch((int *) userdata, 1, __ATOMIC_RELEASE);
+}
+
+
+/** check that flush returns only after messages have been written */
+static bool _flush()
+{
+        int delivered = 0;
+        if(!nft_log_subscribe(_slow, &delivered, NFT_LOG_LEVELS_ALL) ||
+           !nft_log_async_enable(NFT_LOG_ASYNC_BLOCK, 16))
+                return false;
+        nft_log_async_defer(true);
+
+        bool result = true;
+        for(int i = 0; i < 200 && result; i++)
+        {
+                NFT_LOG(L_INFO, MARKER " flush %d", i);
+                nft_log_async_flush();
+
+                int n = __atomic_load_n(&delivered, __ATOMIC_ACQUIRE);
+                if(n != i + 1)
+                {
+                        dprintf(_stderr, "flush returned after %d of %d "
+                                "messages\n", n, i + 1);
+                        result = false;
+                }
+        }
+
+        nft_log_async_defer(false);
+        nft_log_async_disable();
+        nft_log_unsubscribe(_slow, &delivered);
+        _count();
+
+        return result;
+}
+
+
+/** length of longest line written to redirected stderr (truncates file) */
+static size_t _longest()
+{
+        FILE *f;
+        if(!(f = _test_open()))
+                return 0;
+
+        size_t longest = 0, len = 0;
+        int c;
+        while((c = fgetc(f)) != EOF)
+        {
+                if(c != '\n')
+                        len++;
+                else
+                        len = 0;
+                if(len > longest)
+                        longest = len;
+        }
+        fclose(f);
+
+        _count();
+
+        return longest;
+}
+
+
+/** check that messages longer than a slot aren't truncated */
+static bool _long()
+{
+        char s[2000];
+        memset(s, 'x', sizeof(s) - 1);
+        s[sizeof(s) - 1] = '\0';
+
+        if(!nft_log_async_enable(NFT_LOG_ASYNC_BLOCK, 16))
+                return false;
+
+        bool result = true;
+        for(int defer = 0; defer <= 1; defer++)
+        {
+                nft_log_async_defer(defer);
+                NFT_LOG(L_INFO, "%s", s);
+                nft_log_async_flush();
+
+                size_t len = _longest();
+                if(len != sizeof(s) - 1)
+                {
+                        dprintf(_stderr, "long message (deferred: %d) has "
+                                "%zu instead of %zu bytes\n", defer, len,
+                                sizeof(s) - 1);
+                        result = false;
+                }
+        }
+
+        nft_log_async_defer(false);
+        nft_log_async_disable();
+
+        return result;
+}
+
+
+int main(int argc, char *argv[])
+{
+        NFT_LOG_CHECK_VERSION;
+
+        nft_log_level_set(L_INFO);
+        nft_log_mechanism_set("stderr");
+
+        /* redirect stderr to file */
+        _stderr = dup(STDERR_FILENO);
+        if(!_test_capture("async"))
+                return EXIT_FAILURE;
+
+        bool result = _run(NFT_LOG_ASYNC_BLOCK, 16) &&
+                _run(NFT_LOG_ASYNC_DROP, 16) &&
+                _run(NFT_LOG_ASYNC_OVERWRITE, 16) &&
+                _run(NFT_LOG_ASYNC_BLOCK, 0) && _flush() && _long();
+
+        unlink(_test_path);
+
+        return result ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,190 @@
+/*
+ * libniftylog - niftylight logging library
+ * Copyright (C) 2006-2014 Daniel Hiepler <daniel@niftylight.de>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * microbenchmark: built-in formatter vs. glibc vsnprintf()
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <time.h>
+#include "niftylog.h"
+#include "_format.h"
+#include "_json.h"
+
+
+/** amount of iterations per run */
+#define ITERATIONS      (1000*1000)
+
+
+/** formatting function to benchmark */
+typedef int (*Formatter) (char *buf, size_t size, const char *fmt,
+                          va_list args);
+
+
+/** make sure the compiler can't optimize our loops away */
+static volatile int _sink;
+
+
+/** current time in nanoseconds */
+static double _now()
+{
+        struct timespec t;
+        clock_gettime(CLOCK_MONOTONIC, &t);
+        return (double) t.tv_sec * 1e9 + (double) t.tv_nsec;
+}
+
+
+/** call formatter with variable arguments */
+static void _call(Formatter f, const char *fmt, ...)
+{
+        char buf[512];
+        va_list args;
+        va_start(args, fmt);
+        _sink += f(buf, sizeof(buf), fmt, args);
+        va_end(args);
+}
+
+
+/** integers only */
+static void _ints(Formatter f, int i)
+{
+        _call(f, "frame %d of %u, offset %ld, size %zu", i, 1000u,
+              (long) i * 4096, (size_t) i * 3);
+}
+
+
+/** strings & characters */
+static void _strings(Formatter f, int i)
+{
+        _call(f, "device \"%s\" (%c) on port %.*s: %-12s|", "ws2801",
+              'A' + i % 26, 4, "/dev/spidev0.0", "ok");
+}
+
+
+/** hex & pointers */
+static void _hex(Formatter f, int i)
+{
+        _call(f, "register 0x%08x = %#x at %p", i, i ^ 0xdead, (void *) &_sink);
+}
+
+
+/** floating point */
+static void _floats(Formatter f, int i)
+{
+        _call(f, "gamma %.2f, brightness %f, ratio %g", 2.2 + i * 1e-6,
+              (double) i / 7.0, 0.75);
+}
+
+
+/** mixed message as typically logged */
+static void _mixed(Formatter f, int i)
+{
+        _call(f, "%s:%d %s() %s: chain \"%s\" has %d LEDs (%.1f%%)",
+              "chain.c", 421, "led_chain_new", "debug", "chain0", i,
+              (double) i / 10.0);
+}
+
+
+/** run benchmark with both formatters and print result */
+static void _bench(const char *name, void (*work) (Formatter, int))
+{
+        double start = _now();
+        for(int i = 0; i < ITERATIONS; i++)
+                work(vsnprintf, i);
+        double libc = (_now() - start) / (double) ITERATIONS;
+
+        start = _now();
+        for(int i = 0; i < ITERATIONS; i++)
+                work(_format, i);
+        double own = (_now() - start) / (double) ITERATIONS;
+
+        printf("%-12s vsnprintf() %8.2f ns, _format() %8.2f ns (%.1fx)\n",
+               name, libc, own, libc / own);
+}
+
+
+/** escape typical message for JSON with one implementation */
+static void _bench_json(const char *name, JsonImpl impl)
+{
+        JsonEscape *f;
+        if(!(f = _json_escape_impl(impl)))
+        {
+                printf("%-12s not supported\n", name);
+                return;
+        }
+
+        static const char msg[] =
+                "chain \"chain0\" has 1024 LEDs, updating strip 3 of 8 with "
+                "gamma 2.20 at 59.8 fps (render took 1.42 ms)";
+        char buf[sizeof(msg) * 6];
+
+        double start = _now();
+        for(int i = 0; i < ITERATIONS; i++)
+                _sink += (int) f(buf, sizeof(buf), msg, sizeof(msg) - 1);
+        double t = (_now() - start) / (double) ITERATIONS;
+
+        printf("%-12s %8.2f ns (%.2f ns/byte)\n", name, t,
+               t / (double) (sizeof(msg) - 1));
+}
+
+
+int main(int argc, char *argv[])
+{
+        NFT_LOG_CHECK_VERSION;
+
+        printf("formatting one message:\n");
+        _bench("integers", _ints);
+        _bench("strings", _strings);
+        _bench("hex", _hex);
+        _bench("floats", _floats);
+        _bench("mixed", _mixed);
+
+        printf("\nescaping one message for JSON:\n");
+        _bench_json("scalar", JSON_SCALAR);
+        _bench_json("sse2", JSON_SSE2);
+        _bench_json("avx2", JSON_AVX2);
+
+        return EXIT_SUCCESS;
+}
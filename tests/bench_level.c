@@ -0,0 +1,139 @@
+/*
+ * libniftylog - niftylight logging library
+ * Copyright (C) 2006-2014 Daniel Hiepler <daniel@niftylight.de>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * microbenchmark: cost of a log-call that's filtered by the current loglevel
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "niftylog.h"
+
+
+/** amount of iterations per run */
+#define ITERATIONS      (10*1000*1000)
+
+
+/** make sure the compiler can't optimize our loops away */
+static volatile int _sink;
+
+
+/** current time in nanoseconds */
+static double _now()
+{
+        struct timespec t;
+        clock_gettime(CLOCK_MONOTONIC, &t);
+        return (double) t.tv_sec * 1e9 + (double) t.tv_nsec;
+}
+
+
+/** what nft_log() used to do for every call before the loglevel was cached */
+static void _uncached()
+{
+        for(int i = 0; i < ITERATIONS; i++)
+        {
+                NftLoglevel l =
+                        nft_log_level_from_string(getenv(NFT_LOG_ENV_LEVEL));
+                if(l > L_NOISY)
+                        continue;
+                _sink++;
+        }
+}
+
+
+/** filtered nft_log() call */
+static void _nft_log()
+{
+        for(int i = 0; i < ITERATIONS; i++)
+                nft_log(L_NOISY, __FILE__, __func__, __LINE__,
+                        "filtered %d", i);
+}
+
+
+/** disabled NFT_LOG() call-site */
+static void _nft_log_site()
+{
+        for(int i = 0; i < ITERATIONS; i++)
+                NFT_LOG(L_NOISY, "filtered %d", i);
+}
+
+
+/** inline check as used by applications */
+static void _inline()
+{
+        for(int i = 0; i < ITERATIONS; i++)
+        {
+                if(!nft_log_level_is_enabled(L_NOISY))
+                        continue;
+                _sink++;
+        }
+}
+
+
+/** run benchmark and print result */
+static void _bench(const char *name, void (*f) (void))
+{
+        double start = _now();
+        f();
+        printf("%-40s %8.2f ns/call\n", name,
+               (_now() - start) / (double) ITERATIONS);
+}
+
+
+int main(int argc, char *argv[])
+{
+        NFT_LOG_CHECK_VERSION;
+
+        /* filter everything below "error" */
+        setenv(NFT_LOG_ENV_LEVEL, "error", 1);
+        nft_log_level_reload();
+
+        printf("filtered L_NOISY message at loglevel \"error\":\n");
+        _bench("getenv() + parse per call (before)", _uncached);
+        _bench("nft_log() with cached loglevel", _nft_log);
+        _bench("NFT_LOG() with disabled call-site", _nft_log_site);
+        _bench("nft_log_level_is_enabled()", _inline);
+
+        return EXIT_SUCCESS;
+}
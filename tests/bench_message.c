@@ -0,0 +1,186 @@
+/*
+ * libniftylog - niftylight logging library
+ * Copyright (C) 2006-2014 Daniel Hiepler <daniel@niftylight.de>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * microbenchmark: cost of assembling a log-message (prefix + body)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <alloca.h>
+#include <time.h>
+#include "niftylog.h"
+
+
+/** amount of iterations per run */
+#define ITERATIONS      (2*1000*1000)
+/** size of message buffers */
+#define MAX_MSG_SIZE    4096
+
+
+/** make sure the compiler can't optimize our loops away */
+static volatile size_t _sink;
+
+
+/** current time in nanoseconds */
+static double _now()
+{
+        struct timespec t;
+        clock_gettime(CLOCK_MONOTONIC, &t);
+        return (double) t.tv_sec * 1e9 + (double) t.tv_nsec;
+}
+
+
+/** 
+ * what nft_log() used to do in debug mode: format body, format prefix + 
+ * body into second buffer, mechanism needs strlen()
+ */
+static void _two_pass_va(NftLoglevel level, const char *file,
+                         const char *func, int line, const char *msg, ...)
+{
+        va_list args;
+        va_start(args, msg);
+
+        char *tmp = alloca(MAX_MSG_SIZE);
+        vsnprintf(tmp, MAX_MSG_SIZE - 1, msg, args);
+
+        char *message = alloca(MAX_MSG_SIZE);
+        snprintf(message, MAX_MSG_SIZE - 1, "%s:%d %s() %s: %s", file, line,
+                 func, nft_log_level_to_string(level), tmp);
+
+        _sink += strlen(message);
+
+        va_end(args);
+}
+
+
+/** old message assembly */
+static void _two_pass()
+{
+        for(int i = 0; i < ITERATIONS; i++)
+                _two_pass_va(L_DEBUG, __FILE__, __func__, __LINE__,
+                             "message %d from %s", i, "bench");
+}
+
+
+/** nft_log() in debug mode using "null" mechanism */
+static void _nft_log()
+{
+        for(int i = 0; i < ITERATIONS; i++)
+                nft_log(L_DEBUG, __FILE__, __func__, __LINE__,
+                        "message %d from %s", i, "bench");
+}
+
+
+/** nft_log() in debug mode with timestamps */
+static void _nft_log_timestamp()
+{
+        for(int i = 0; i < ITERATIONS; i++)
+                nft_log(L_DEBUG, __FILE__, __func__, __LINE__,
+                        "message %d from %s", i, "bench");
+}
+
+
+/** strftime() per message (what timestamps would cost without cache) */
+static void _strftime()
+{
+        for(int i = 0; i < ITERATIONS; i++)
+        {
+                char buf[64];
+                struct timespec t;
+                struct tm tm;
+                clock_gettime(CLOCK_REALTIME, &t);
+                localtime_r(&t.tv_sec, &tm);
+                _sink += strftime(buf, sizeof(buf), "%Y-%m-%d %H:%M:%S", &tm);
+        }
+}
+
+
+/** run benchmark and print result */
+static void _bench(const char *name, void (*f) (void))
+{
+        double start = _now();
+        f();
+        printf("%-40s %8.2f ns/message\n", name,
+               (_now() - start) / (double) ITERATIONS);
+}
+
+
+int main(int argc, char *argv[])
+{
+        NFT_LOG_CHECK_VERSION;
+
+        /* measure assembly only */
+        unsetenv(NFT_LOG_ENV_MECHANISM);
+        unsetenv(NFT_LOG_ENV_LEVEL);
+        nft_log_level_set(L_DEBUG);
+        nft_log_mechanism_set("null");
+
+        printf("L_DEBUG message in debug mode:\n");
+        _bench("two buffers, two passes (before)", _two_pass);
+        _bench("nft_log() single pass", _nft_log);
+
+        printf("\ntimestamps:\n");
+        unsetenv(NFT_LOG_ENV_TIMESTAMP);
+        _bench("localtime_r() + strftime() per message", _strftime);
+        nft_log_timestamp_set(NFT_LOG_TIMESTAMP_MSEC);
+        _bench("nft_log() with \"msec\" timestamp", _nft_log_timestamp);
+        nft_log_timestamp_set(NFT_LOG_TIMESTAMP_USEC);
+        _bench("nft_log() with \"usec\" timestamp", _nft_log_timestamp);
+        nft_log_clock_set(NFT_LOG_CLOCK_TSC);
+        _bench("nft_log() with \"usec\" timestamp, tsc", _nft_log_timestamp);
+        nft_log_clock_set(NFT_LOG_CLOCK_REALTIME);
+        nft_log_timestamp_set(NFT_LOG_TIMESTAMP_MONOTONIC);
+        _bench("nft_log() with \"monotonic\" timestamp", _nft_log_timestamp);
+        nft_log_timestamp_set(NFT_LOG_TIMESTAMP_OFF);
+
+        printf("\nthread info:\n");
+        unsetenv(NFT_LOG_ENV_THREAD);
+        nft_log_thread_set(NFT_LOG_THREAD_ALL);
+        _bench("nft_log() with \"all\" thread info", _nft_log);
+        nft_log_thread_set(NFT_LOG_THREAD_OFF);
+
+        return EXIT_SUCCESS;
+}
@@ -0,0 +1,137 @@
+/*
+ * libniftylog - niftylight logging library
+ * Copyright (C) 2006-2014 Daniel Hiepler <daniel@niftylight.de>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+/*
+ * microbenchmark: throughput of mechanisms writing to a file
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <time.h>
+#include "niftylog.h"
+#include "_test.h"
+
+
+/** messages per run */
+#define MESSAGES        (500*1000)
+/** threads for multi-threaded runs */
+#define THREADS         4
+
+
+/** messages per thread in current run */
+static int _per_thread;
+
+
+/** current time in nanoseconds */
+static double _now()
+{
+        struct timespec t;
+        clock_gettime(CLOCK_MONOTONIC, &t);
+        return (double) t.tv_sec * 1e9 + (double) t.tv_nsec;
+}
+
+
+/** log messages */
+static void *_thread(void *arg)
+{
+        for(int i = 0; i < _per_thread; i++)
+                NFT_LOG(L_INFO, "message %d from %s", i, "bench");
+
+        return NULL;
+}
+
+
+/** log MESSAGES with mechanism and print result (including final flush) */
+static void _bench(const char *mechanism, int threads)
+{
+        unlink(_test_path);
+        if(!nft_log_mechanism_set(mechanism))
+                exit(EXIT_FAILURE);
+
+        _per_thread = MESSAGES / threads;
+
+        double start = _now();
+
+        pthread_t t[THREADS];
+        for(int i = 0; i < threads; i++)
+                pthread_create(&t[i], NULL, _thread, NULL);
+        for(int i = 0; i < threads; i++)
+                pthread_join(t[i], NULL);
+
+        nft_log_mechanism_set("null");
+        fflush(stderr);
+
+        printf("%-10s %d thread(s) %28.2f ns/message\n", mechanism,
+               threads, (_now() - start) / (double) MESSAGES);
+}
+
+
+int main(int argc, char *argv[])
+{
+        NFT_LOG_CHECK_VERSION;
+
+        /* stderr redirected to a file */
+        if(!_test_capture("bench"))
+                return EXIT_FAILURE;
+        setvbuf(stderr, NULL, _IONBF, 0);
+
+        unsetenv(NFT_LOG_ENV_MECHANISM);
+        unsetenv(NFT_LOG_ENV_LEVEL);
+        setenv("NFT_LOG_FILE", _test_path, 1);
+        setenv("NFT_LOG_MMAP_FILE", _test_path, 1);
+        nft_log_level_set(L_INFO);
+
+        printf("L_INFO message written to a file:\n");
+        for(int threads = 1; threads <= THREADS; threads *= THREADS)
+        {
+                _bench("stderr", threads);
+                _bench("file", threads);
+                _bench("mmap", threads);
+        }
+
+        unlink(_test_path);
+
+        return EXIT_SUCCESS;
+}
@@ -0,0 +1,195 @@
+/*
+ * libniftylog - niftylight logging library
+ * Copyright (C) 2006-2014 Daniel Hiepler <daniel@niftylight.de>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "niftylog.h"
+#include "_test.h"
+
+
+/** maximum amount of expected lines */
+#define MAX_LINES       128
+/** repetitions of one message to check size of log */
+#define REPEAT          100
+
+
+/** expected output of decoder */
+static char _expected[MAX_LINES][512];
+/** loglevel of expected lines */
+static NftLoglevel _levels[MAX_LINES];
+/** amount of expected lines */
+static int _count;
+
+
+/** log message and remember expected decoder output */
+#define LOG(level, fmt, ...) \
+        do { \
+                char _m[256]; \
+                snprintf(_m, sizeof(_m), fmt, ##__VA_ARGS__); \
+                snprintf(_expected[_count], sizeof(_expected[0]), \
+                         "%s:%d %s() %s: %s", __FILE__, __LINE__, __func__, \
+                         nft_log_level_to_string(level), _m); \
+                _levels[_count++] = level; \
+                NFT_LOG(level, fmt, ##__VA_ARGS__); \
+        } while(0)
+
+
+/** run decoder and compare output with all expected lines >= level */
+static bool _check(const char *args, NftLoglevel level, bool none)
+{
+        char cmd[1024];
+        snprintf(cmd, sizeof(cmd), "%s %s %s", DECODER, args, _test_path);
+
+        FILE *f;
+        if(!(f = popen(cmd, "r")))
+        {
+                perror("popen");
+                return false;
+        }
+
+        bool result = true;
+        char line[1024];
+        for(int i = 0; i < _count; i++)
+        {
+                if(_levels[i] < level || none)
+                        continue;
+
+                if(!fgets(line, sizeof(line), f))
+                {
+                        fprintf(stderr, "%s: missing line \"%s\"\n", cmd,
+                                _expected[i]);
+                        result = false;
+                        break;
+                }
+
+                line[strcspn(line, "\n")] = '\0';
+                if(strcmp(line, _expected[i]) != 0)
+                {
+                        fprintf(stderr, "%s: \"%s\" != \"%s\"\n", cmd, line,
+                                _expected[i]);
+                        result = false;
+                }
+        }
+
+        if(result && fgets(line, sizeof(line), f))
+        {
+                fprintf(stderr, "%s: unexpected line \"%s\"\n", cmd, line);
+                result = false;
+        }
+
+        if(pclose(f) != 0)
+                result = false;
+
+        return result;
+}
+
+
+int main(int argc, char *argv[])
+{
+        NFT_LOG_CHECK_VERSION;
+
+        if(!_test_file("binary"))
+                return EXIT_FAILURE;
+
+        setenv("NFT_LOG_BINARY_FILE", _test_path, 1);
+        nft_log_level_set(L_INFO);
+        if(!nft_log_mechanism_set("binary"))
+                return EXIT_FAILURE;
+
+        char buf[32];
+        snprintf(buf, sizeof(buf), "copied");
+
+        LOG(L_INFO, "no arguments");
+        LOG(L_INFO, "%d %u %ld %lld %zu", -1, 2u, -3L, -4LL, (size_t) 5);
+        LOG(L_NOTICE, "%s %.3s %10s|%-6s|", "string", "truncated", buf, "x");
+        LOG(L_WARNING, "%f %.2e %g %c %x %#o", 3.5, 1234.5, 0.25, 'c', 255,
+            8);
+        LOG(L_ERROR, "%*d|%-*.*f|%%", 5, 42, 8, 2, 2.345);
+
+        /* call-site is only stored once */
+        struct stat st;
+        fflush(NULL);
+        stat(_test_path, &st);
+        off_t before = st.st_size;
+        for(int i = 0; i < REPEAT; i++)
+                LOG(L_INFO, "repeated message from a call-site %d", i);
+
+        /* preformatted text (not from an NFT_LOG() call-site) */
+        nft_log(L_INFO, __FILE__, __func__, __LINE__, "text %d", 1);
+        snprintf(_expected[_count], sizeof(_expected[0]), "text 1");
+        _levels[_count++] = L_INFO;
+
+        /* structured message (stored as text) */
+        NFT_LOG_KV(L_INFO, "frame", NFT_KV_INT("strip", 3),
+                   NFT_KV_STR("mode", "a b"));
+        snprintf(_expected[_count], sizeof(_expected[0]),
+                 "frame strip=3 mode=\"a b\"");
+        _levels[_count++] = L_INFO;
+
+        /* close file */
+        nft_log_mechanism_set("null");
+
+        stat(_test_path, &st);
+        off_t per_message = (st.st_size - before) / REPEAT;
+
+        bool result = true;
+        if(per_message > 48)
+        {
+                fprintf(stderr, "%ld bytes per message\n",
+                        (long) per_message);
+                result = false;
+        }
+
+        result = _check("", L_MAX, false) &&
+                _check("-l warning", L_WARNING, false) &&
+                _check("-a 1", L_MAX, false) &&
+                _check("-a 4000000000", L_MAX, true) &&
+                _check("-b 1", L_MAX, true) && result;
+
+        unlink(_test_path);
+
+        return result ? EXIT_SUCCESS : EXIT_FAILURE;
+}
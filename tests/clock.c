@@ -0,0 +1,165 @@
+/*
+ * libniftylog - niftylight logging library
+ * Copyright (C) 2006-2014 Daniel Hiepler <daniel@niftylight.de>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/**
+ * @file clock.c
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "niftylog.h"
+
+
+/** messages per mode (spread over more than one calibration period) */
+#define MESSAGES        30
+/** pause between messages (ns) */
+#define PAUSE           50000000L
+/** allowed difference between converted time & CLOCK_REALTIME (ns) */
+#define BOUND           1000000LL
+
+
+/** time of last message received */
+static uint64_t _time;
+/** messages received */
+static int _count;
+
+
+/** subscriber that remembers the time of the message */
+static void _subscriber(void *userdata, const NftLogMessage * m)
+{
+        _time = m->time;
+        _count++;
+}
+
+
+/** current time in nanoseconds since epoch */
+static uint64_t _now()
+{
+        struct timespec t;
+        clock_gettime(CLOCK_REALTIME, &t);
+        return (uint64_t) t.tv_sec * 1000000000ULL + (uint64_t) t.tv_nsec;
+}
+
+
+/** log messages & compare their time to CLOCK_REALTIME */
+static bool _check(const char *name, bool async)
+{
+        int64_t worst = 0;
+        for(int i = 0; i < MESSAGES; i++)
+        {
+                int count = _count;
+                uint64_t before = _now();
+                NFT_LOG(L_INFO, "%s %d", name, i);
+                uint64_t after = _now();
+                if(async)
+                        nft_log_async_flush();
+
+                if(_count != count + 1)
+                {
+                        printf("%s: message %d not received\n", name, i);
+                        return false;
+                }
+
+                int64_t d = 0;
+                if(_time < before)
+                        d = (int64_t) (before - _time);
+                else if(_time > after)
+                        d = (int64_t) (_time - after);
+                if(d > worst)
+                        worst = d;
+
+                struct timespec t = {.tv_nsec = PAUSE };
+                nanosleep(&t, NULL);
+        }
+
+        printf("%s: worst difference %lld ns\n", name, (long long) worst);
+        return worst <= BOUND;
+}
+
+
+int main(int argc, char *argv[])
+{
+        unsetenv(NFT_LOG_ENV_MECHANISM);
+        unsetenv(NFT_LOG_ENV_LEVEL);
+        unsetenv(NFT_LOG_ENV_CLOCK);
+        nft_log_level_set(L_INFO);
+        nft_log_mechanism_set("null");
+
+        if(!nft_log_subscribe(_subscriber, NULL, NFT_LOG_LEVELS_ALL))
+                return EXIT_FAILURE;
+
+        bool result = true;
+
+        if(nft_log_clock_get() != NFT_LOG_CLOCK_REALTIME)
+        {
+                printf("realtime clock isn't the default\n");
+                result = false;
+        }
+        result &= _check("realtime", false);
+
+        /* falls back to realtime clock without invariant TSC */
+        if(!nft_log_clock_set(NFT_LOG_CLOCK_TSC))
+        {
+                printf("no invariant TSC, checking fallback\n");
+                if(nft_log_clock_get() != NFT_LOG_CLOCK_REALTIME)
+                        result = false;
+        }
+        else if(nft_log_clock_get() != NFT_LOG_CLOCK_TSC)
+                result = false;
+
+        result &= _check("tsc", false);
+
+        /* raw ticks converted by writer thread */
+        if(!nft_log_async_enable(NFT_LOG_ASYNC_BLOCK, 0))
+                return EXIT_FAILURE;
+        result &= _check("tsc-async", true);
+        nft_log_async_disable();
+
+        nft_log_clock_set(NFT_LOG_CLOCK_REALTIME);
+        if(nft_log_clock_get() != NFT_LOG_CLOCK_REALTIME)
+                result = false;
+
+        return result ? EXIT_SUCCESS : EXIT_FAILURE;
+}
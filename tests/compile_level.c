@@ -0,0 +1,158 @@
+/*
+ * libniftylog - niftylight logging library
+ * Copyright (C) 2006-2014 Daniel Hiepler <daniel@niftylight.de>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * built with -DNFT_LOG_COMPILE_LEVEL=L_INFO. Checks that statements below
+ * that loglevel are removed from the binary.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "niftylog.h"
+
+
+/** amount of messages received by _log_func() */
+static int _received;
+
+
+
+/** NftLogFunc that counts received messages */
+static void _log_func(void *userdata, NftLoglevel level, const char *file,
+                      const char *func, int line, const char *msg)
+{
+        _received++;
+}
+
+
+/** log at all loglevels (markers must end with "-compiled-out"/"-compiled-in") */
+static void _log()
+{
+        NFT_LOG(L_VERY_NOISY, "verynoisy-compiled-out");
+        NFT_LOG(L_NOISY, "noisy-compiled-out");
+        NFT_LOG(L_DEBUG, "debug-compiled-out");
+        NFT_LOG(L_INFO, "info-compiled-in");
+        NFT_LOG(L_ERROR, "error-compiled-in");
+
+        /* loglevels unknown at compile time are filtered at runtime */
+        volatile NftLoglevel l = L_DEBUG;
+        NFT_LOG(l, "runtime debug");
+}
+
+
+/** 
+ * decode string stored with every character shifted by one (so the string 
+ * we search for doesn't end up in the binary itself) 
+ */
+static char *_decode(char *s)
+{
+        for(char *c = s; *c; c++)
+                (*c)--;
+        return s;
+}
+
+
+/** count occurrences of string in file */
+static int _count(const char *path, const char *needle)
+{
+        FILE *f;
+        if(!(f = fopen(path, "rb")))
+                return -1;
+
+        int result = 0;
+        size_t len = strlen(needle), matched = 0;
+        int c;
+        while((c = fgetc(f)) != EOF)
+        {
+                if(c == needle[matched])
+                {
+                        if(++matched == len)
+                        {
+                                result++;
+                                matched = 0;
+                        }
+                }
+                else
+                        matched = (c == needle[0]) ? 1 : 0;
+        }
+
+        fclose(f);
+        return result;
+}
+
+
+int main(int argc, char *argv[])
+{
+        NFT_LOG_CHECK_VERSION;
+
+        nft_log_func_register(_log_func, NULL);
+        nft_log_level_set(L_VERY_NOISY);
+        _log();
+
+        if(_received != 2)
+        {
+                fprintf(stderr, "received %d messages (expected 2)\n",
+                        _received);
+                return EXIT_FAILURE;
+        }
+
+        /* "-compiled-out" & "-compiled-in" */
+        char out[] = ".dpnqjmfe.pvu";
+        char in[] = ".dpnqjmfe.jo";
+        int nout, nin;
+        if((nin = _count("/proc/self/exe", _decode(in))) < 0)
+        {
+                fprintf(stderr, "can't read /proc/self/exe, skipping\n");
+                return 77;
+        }
+        nout = _count("/proc/self/exe", _decode(out));
+
+        if(nin != 2 || nout != 0)
+        {
+                fprintf(stderr, "found %d compiled-in (expected 2) and %d "
+                        "compiled-out (expected 0) format strings in binary\n",
+                        nin, nout);
+                return EXIT_FAILURE;
+        }
+
+        return EXIT_SUCCESS;
+}
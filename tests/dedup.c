@@ -0,0 +1,154 @@
+/*
+ * libniftylog - niftylight logging library
+ * Copyright (C) 2006-2014 Daniel Hiepler <daniel@niftylight.de>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/**
+ * @file dedup.c
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "niftylog.h"
+#include "_test.h"
+
+
+int main(int argc, char *argv[])
+{
+        if(!_test_capture("dedup"))
+                return EXIT_FAILURE;
+
+        unsetenv(NFT_LOG_ENV_MECHANISM);
+        unsetenv(NFT_LOG_ENV_LEVEL);
+        unsetenv(NFT_LOG_ENV_THREAD);
+        unsetenv(NFT_LOG_ENV_TIMESTAMP);
+        unsetenv(NFT_LOG_ENV_OUTPUT);
+        unsetenv(NFT_LOG_ENV_DEDUP);
+        nft_log_level_set(L_INFO);
+
+        bool result = true;
+
+        /* off by default */
+        for(int i = 0; i < 3; i++)
+                NFT_LOG(L_INFO, "plain");
+        result &= _test_expect("plain", 3);
+
+        if(nft_log_dedup_get() != 0)
+        {
+                fprintf(stdout, "deduplication on by default\n");
+                result = false;
+        }
+
+        nft_log_dedup_set(200);
+        if(nft_log_dedup_get() != 200)
+        {
+                fprintf(stdout, "timeout not set\n");
+                result = false;
+        }
+
+        /* repeats of recent messages are dropped (even interleaved, from 
+           different call-sites & only if the level matches) */
+        for(int i = 0; i < 10; i++)
+        {
+                NFT_LOG(L_INFO, "storm %d", 1);
+                NFT_LOG(L_INFO, "other");
+                nft_log(L_INFO, __FILE__, __func__, __LINE__, "storm 1");
+        }
+        NFT_LOG(L_ERROR, "storm 1");
+        result &= _test_expect("storm 1", 1);
+        result &= _test_expect("other", 1);
+        result &= _test_expect("error: storm 1", 1);
+        result &= _test_expect("last message", 0);
+
+        nft_log_dedup_flush();
+        result &= _test_expect("last message repeated 19 times: storm 1", 1);
+        result &= _test_expect("last message repeated 9 times: other", 1);
+
+        /* summary after timeout (the repeat that triggers it is counted in
+           the next summary) */
+        for(int i = 0; i < 5; i++)
+                NFT_LOG(L_INFO, "tick");
+        usleep(250000);
+        NFT_LOG(L_INFO, "tick");
+        result &= _test_expect("tick", 1);
+        result &= _test_expect("last message repeated 4 times: tick", 1);
+
+        /* summary when pushed out by other messages */
+        NFT_LOG(L_INFO, "evict");
+        NFT_LOG(L_INFO, "evict");
+        for(int i = 0; i < 8; i++)
+                NFT_LOG(L_INFO, "fill %d", i);
+        result &= _test_expect("last message repeated 1 times: evict", 1);
+
+        /* long messages are quoted partially */
+        char s[256];
+        memset(s, 'x', sizeof(s) - 1);
+        s[sizeof(s) - 1] = '\0';
+        NFT_LOG(L_INFO, "%s", s);
+        NFT_LOG(L_INFO, "%s", s);
+        result &= _test_expect("xxxxxxxx", 1);
+
+        /* turning off writes pending summaries */
+        nft_log_dedup_set(0);
+        result &= _test_expect("last message repeated 1 times: tick", 1);
+        char expect[128];
+        snprintf(expect, sizeof(expect),
+                 "last message repeated 1 times: %.64s...\n", s);
+        result &= _test_expect(expect, 1);
+
+        NFT_LOG(L_INFO, "plain");
+        result &= _test_expect("plain", 4);
+
+        /* summary after timeout even if nothing else is logged */
+        nft_log_dedup_set(100);
+        for(int i = 0; i < 3; i++)
+                NFT_LOG(L_INFO, "lull");
+        usleep(400000);
+        result &= _test_expect("last message repeated 2 times: lull", 1);
+        nft_log_dedup_set(0);
+
+        unlink(_test_path);
+
+        return result ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,162 @@
+/*
+ * libniftylog - niftylight logging library
+ * Copyright (C) 2006-2014 Daniel Hiepler <daniel@niftylight.de>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "niftylog.h"
+
+
+/** last message received by _func() */
+static char _msg[1024];
+/** thread that called _func() */
+static pthread_t _thread;
+/** amount of failed checks */
+static int _failed;
+
+
+/** log function that records the last message */
+static void _func(void *userdata, NftLoglevel level, const char *file,
+                  const char *func, int line, const char *msg)
+{
+        snprintf(_msg, sizeof(_msg), "%s", msg);
+        _thread = pthread_self();
+}
+
+
+/** log a message deferred and compare it with snprintf() */
+#define CHECK(fmt, ...) \
+        do { \
+                char _expected[1024]; \
+                snprintf(_expected, sizeof(_expected), fmt, ##__VA_ARGS__); \
+                _msg[0] = '\0'; \
+                NFT_LOG(L_INFO, fmt, ##__VA_ARGS__); \
+                nft_log_async_flush(); \
+                if(strcmp(_msg, _expected) != 0 || \
+                   pthread_equal(_thread, pthread_self())) \
+                { \
+                        fprintf(stderr, "%s:%d: \"%s\" != \"%s\"\n", \
+                                __FILE__, __LINE__, _msg, _expected); \
+                        _failed++; \
+                } \
+        } while(0)
+
+
+int main(int argc, char *argv[])
+{
+        NFT_LOG_CHECK_VERSION;
+
+        nft_log_level_set(L_INFO);
+        nft_log_mechanism_set("null");
+        nft_log_func_register(_func, NULL);
+
+        if(!nft_log_async_enable(NFT_LOG_ASYNC_BLOCK, 0))
+        {
+                /* no thread support */
+                return 77;
+        }
+        nft_log_async_defer(true);
+
+        int i = -42;
+        unsigned int u = 42;
+        long l = -1234567890L;
+        long long ll = -1234567890123LL;
+        unsigned long long ull = 18446744073709551615ULL;
+        size_t z = 4096;
+        double d = 3.14159265358979;
+        void *p = &i;
+        char c = 'x';
+        short h = -7;
+        signed char hh = -8;
+        const char *volatile none = NULL;
+
+        CHECK("no arguments");
+        CHECK("%d %i %u", i, i, u);
+        CHECK("%ld %lld %llu", l, ll, ull);
+        CHECK("%zu %zd", z, (ssize_t) z);
+        CHECK("%x %X %#x %o %08x", u, u, u, u, u);
+        CHECK("%hd %hhd", h, hh);
+        CHECK("%p", p);
+        CHECK("%c%c", c, 'y');
+        CHECK("%f %.2f %e %g %10.3f %-10.1f|", d, d, d, d, d, d);
+        CHECK("%*d|%-*d|%.*f", 6, i, 6, i, 3, d);
+        CHECK("%s %.3s %10s %-10s|", "string", "truncated", "right",
+              "left");
+        CHECK("%.*s", 4, "precision");
+        CHECK("%s", none);
+        CHECK("100%% %d%%", 100);
+        CHECK("%s %d %s %f %c", "mixed", 1, "types", d, c);
+
+        /* strings must be copied when the message is logged */
+        char buf[32];
+        snprintf(buf, sizeof(buf), "original");
+        _msg[0] = '\0';
+        NFT_LOG(L_INFO, "copy %s", buf);
+        snprintf(buf, sizeof(buf), "modified");
+        nft_log_async_flush();
+        if(strcmp(_msg, "copy original") != 0)
+        {
+                fprintf(stderr, "string not copied: \"%s\"\n", _msg);
+                _failed++;
+        }
+
+        /* arguments exceeding the slot are formatted by the logging thread 
+           (and truncated like every asynchronous message) */
+        char big[2048];
+        memset(big, 'a', sizeof(big) - 1);
+        big[sizeof(big) - 1] = '\0';
+        _msg[0] = '\0';
+        NFT_LOG(L_INFO, "%s", big);
+        nft_log_async_flush();
+        if(strlen(_msg) < 512 || strncmp(_msg, big, strlen(_msg)) != 0)
+        {
+                fprintf(stderr, "long message not logged: \"%.20s...\"\n",
+                        _msg);
+                _failed++;
+        }
+
+        nft_log_async_disable();
+
+        return _failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
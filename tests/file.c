@@ -0,0 +1,232 @@
+/*
+ * libniftylog - niftylight logging library
+ * Copyright (C) 2006-2014 Daniel Hiepler <daniel@niftylight.de>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+/**
+ * @file file.c
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include "niftylog.h"
+
+
+/** amount of logging threads */
+#define THREADS         4
+/** messages per thread */
+#define MESSAGES        500
+
+
+/** temporary directory */
+static char _dir[] = "/tmp/niftylog-file-XXXXXX";
+/** logfile */
+static char _path[sizeof(_dir) + 16];
+/** last message number seen from each thread */
+static int _last[THREADS];
+
+
+/** log messages from one thread */
+static void *_thread(void *arg)
+{
+        int t = (int) (intptr_t) arg;
+
+        for(int i = 0; i < MESSAGES; i++)
+                NFT_LOG(L_INFO, "thread %d message %d", t, i);
+
+        return NULL;
+}
+
+
+/** size of file or -1 */
+static long _size(const char *path)
+{
+        struct stat st;
+        if(stat(path, &st) != 0)
+                return -1;
+
+        return (long) st.st_size;
+}
+
+
+/** check that every line of file is intact and in order per thread */
+static bool _check(const char *path)
+{
+        FILE *f;
+        if(!(f = fopen(path, "r")))
+        {
+                fprintf(stderr, "%s: missing\n", path);
+                return false;
+        }
+
+        bool result = true;
+        char line[256];
+        while(fgets(line, sizeof(line), f))
+        {
+                int t, i, n = 0;
+                if(strncmp(line, "warning: ", 9) == 0)
+                        continue;
+
+                if(sscanf(line, "thread %d message %d\n%n", &t, &i, &n) != 2 ||
+                   line[n] != '\0' || t < 0 || t >= THREADS || i <= _last[t])
+                {
+                        fprintf(stderr, "%s: unexpected line \"%s\"\n", path,
+                                line);
+                        result = false;
+                        continue;
+                }
+
+                _last[t] = i;
+        }
+
+        fclose(f);
+        return result;
+}
+
+
+int main(int argc, char *argv[])
+{
+        NFT_LOG_CHECK_VERSION;
+
+        if(!mkdtemp(_dir))
+        {
+                perror("mkdtemp");
+                return EXIT_FAILURE;
+        }
+        snprintf(_path, sizeof(_path), "%s/log", _dir);
+
+        setenv("NFT_LOG_FILE", _path, 1);
+        setenv("NFT_LOG_FILE_BUFFER", "1k", 1);
+        setenv("NFT_LOG_FILE_FLUSH", "60000", 1);
+        setenv("NFT_LOG_FILE_ROTATE_SIZE", "4k", 1);
+        setenv("NFT_LOG_FILE_KEEP", "2", 1);
+        nft_log_level_set(L_INFO);
+        if(!nft_log_mechanism_set("file"))
+                return EXIT_FAILURE;
+
+        bool result = true;
+
+        /* messages below warning are buffered... */
+        NFT_LOG(L_INFO, "thread 0 message -1");
+        if(_size(_path) != 0)
+        {
+                fprintf(stderr, "info message not buffered\n");
+                result = false;
+        }
+
+        /* ...warnings are written immediately */
+        NFT_LOG(L_WARNING, "flushed");
+        if(_size(_path) != (long) (sizeof("thread 0 message -1\n") +
+                                   sizeof("warning: flushed\n") - 2))
+        {
+                fprintf(stderr, "warning not flushed (%ld bytes)\n",
+                        _size(_path));
+                result = false;
+        }
+
+        pthread_t threads[THREADS];
+        for(int t = 0; t < THREADS; t++)
+                pthread_create(&threads[t], NULL, _thread,
+                               (void *) (intptr_t) t);
+        for(int t = 0; t < THREADS; t++)
+                pthread_join(threads[t], NULL);
+
+        /* final marker per thread (older messages may be rotated away) */
+        for(int t = 0; t < THREADS; t++)
+                NFT_LOG(L_INFO, "thread %d message %d", t, MESSAGES);
+
+        /* flush & close file */
+        nft_log_mechanism_set("null");
+
+        char rotated[3][sizeof(_path) + 4];
+        for(int i = 0; i < 3; i++)
+                snprintf(rotated[i], sizeof(rotated[i]), "%s.%d", _path,
+                         i + 1);
+
+        if(_size(rotated[2]) >= 0)
+        {
+                fprintf(stderr, "%s should have been removed\n", rotated[2]);
+                result = false;
+        }
+
+        /* oldest first, so message numbers must increase */
+        for(int t = 0; t < THREADS; t++)
+                _last[t] = -2;
+        result = _check(rotated[1]) && result;
+        result = _check(rotated[0]) && result;
+        result = _check(_path) && result;
+
+        /* the newest messages must not be lost */
+        for(int t = 0; t < THREADS; t++)
+        {
+                if(_last[t] != MESSAGES)
+                {
+                        fprintf(stderr, "thread %d: last message %d\n", t,
+                                _last[t]);
+                        result = false;
+                }
+        }
+
+        /* buffered messages are written after the flush interval even if no
+           further message is logged */
+        unlink(_path);
+        setenv("NFT_LOG_FILE_FLUSH", "50", 1);
+        if(!nft_log_mechanism_set("file"))
+                return EXIT_FAILURE;
+        NFT_LOG(L_INFO, "lone message");
+        usleep(300000);
+        if(_size(_path) <= 0)
+        {
+                fprintf(stderr, "message not written after flush interval\n");
+                result = false;
+        }
+        nft_log_mechanism_set("null");
+
+        unlink(_path);
+        for(int i = 0; i < 3; i++)
+                unlink(rotated[i]);
+        rmdir(_dir);
+
+        return result ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,389 @@
+/*
+ * libniftylog - niftylight logging library
+ * Copyright (C) 2006-2014 Daniel Hiepler <daniel@niftylight.de>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * differential test: built-in formatter vs. glibc vsnprintf()
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <string.h>
+#include <limits.h>
+#include <float.h>
+#include <math.h>
+#include "niftylog.h"
+#include "_format.h"
+
+
+/** amount of random cases per conversion type */
+#define ITERATIONS      100000
+/** maximum amount of mismatches to print */
+#define MAX_REPORTS     20
+
+
+/** amount of checked cases */
+static unsigned long _cases;
+/** amount of mismatches */
+static unsigned long _failed;
+/** state of random number generator */
+static uint64_t _state = 0x9E3779B97F4A7C15ULL;
+
+
+
+/** xorshift random number generator (reproducible) */
+static uint64_t _rand()
+{
+        _state ^= _state << 13;
+        _state ^= _state >> 7;
+        _state ^= _state << 17;
+        return _state;
+}
+
+
+/** random number 0..n-1 */
+static int _rand_n(int n)
+{
+        return (int) (_rand() % (uint64_t) n);
+}
+
+
+/** compare _format() with vsnprintf() */
+static void _check(const char *fmt, ...)
+{
+        char expected[512], actual[512];
+
+        /* also check truncation into small buffers */
+        size_t size = sizeof(expected);
+        if(_rand_n(4) == 0)
+                size = (size_t) _rand_n(16);
+
+        va_list a, b;
+        va_start(a, fmt);
+        va_copy(b, a);
+        memset(expected, 'E', sizeof(expected));
+        memset(actual, 'E', sizeof(actual));
+        int n_expected = vsnprintf(expected, size, fmt, a);
+        int n_actual = _format(actual, size, fmt, b);
+        va_end(b);
+        va_end(a);
+
+        _cases++;
+
+        if(n_expected == n_actual &&
+           memcmp(expected, actual, size ? size : 1) == 0)
+                return;
+
+        if(_failed++ < MAX_REPORTS)
+        {
+                fprintf(stderr, "\"%s\" (size %zu): \"%.*s\" (%d) != "
+                        "\"%.*s\" (%d)\n", fmt, size,
+                        (int) (size ? strnlen(actual, size) : 0), actual,
+                        n_actual,
+                        (int) (size ? strnlen(expected, size) : 0),
+                        expected, n_expected);
+        }
+}
+
+
+/** random flags, width & precision */
+static size_t _spec(char *fmt, const char *flags, bool *sw, bool *sp)
+{
+        size_t l = 0;
+        fmt[l++] = '%';
+
+        for(const char *f = flags; *f; f++)
+        {
+                if(_rand_n(4) == 0)
+                        fmt[l++] = *f;
+        }
+
+        *sw = false;
+        switch (_rand_n(4))
+        {
+                case 0:
+                        l += (size_t) sprintf(fmt + l, "%d", _rand_n(25));
+                        break;
+                case 1:
+                        fmt[l++] = '*';
+                        *sw = true;
+                        break;
+        }
+
+        *sp = false;
+        switch (_rand_n(4))
+        {
+                case 0:
+                        l += (size_t) sprintf(fmt + l, ".%d", _rand_n(20));
+                        break;
+                case 1:
+                        l += (size_t) sprintf(fmt + l, ".*");
+                        *sp = true;
+                        break;
+        }
+
+        return l;
+}
+
+
+/** call _check() with optional width & precision arguments */
+#define CHECK(fmt, sw, w, sp, p, v) \
+        do { \
+                if(sw && sp) \
+                        _check(fmt, w, p, v); \
+                else if(sw) \
+                        _check(fmt, w, v); \
+                else if(sp) \
+                        _check(fmt, p, v); \
+                else \
+                        _check(fmt, v); \
+        } while(0)
+
+
+/** random integer with random amount of bits */
+static uint64_t _rand_int()
+{
+        static const uint64_t special[] = {
+                0, 1, 9, 10, 99, 100, 0x7f, 0x80, 0xff, 0x7fff, 0x8000,
+                0xffff, INT_MAX, (uint64_t) INT_MIN, UINT_MAX, LLONG_MAX,
+                (uint64_t) LLONG_MIN, ULLONG_MAX, 1000000000000000000ULL,
+        };
+
+        if(_rand_n(4) == 0)
+                return special[_rand_n(sizeof(special) / sizeof(special[0]))];
+
+        int bits = 1 + _rand_n(64);
+        return bits == 64 ? _rand() : _rand() & ((1ULL << bits) - 1);
+}
+
+
+/** integer conversions */
+static void _integers()
+{
+        static const char *lengths[] = { "hh", "h", "", "l", "ll", "z", "j",
+                "t"
+        };
+        static const char conversions[] = "diuxXo";
+
+        for(int i = 0; i < ITERATIONS; i++)
+        {
+                char fmt[64];
+                bool sw, sp;
+                size_t l = _spec(fmt, "-+ #0", &sw, &sp);
+                int len = _rand_n(8);
+                l += (size_t) sprintf(fmt + l, "%s%c", lengths[len],
+                                      conversions[_rand_n(6)]);
+                fmt[l] = '\0';
+
+                int w = _rand_n(40) - 10, p = _rand_n(30) - 5;
+                uint64_t v = _rand_int();
+                if(_rand_n(2))
+                        v = -v;
+
+                switch (len)
+                {
+                        case 0:
+                        case 1:
+                        case 2:
+                                CHECK(fmt, sw, w, sp, p, (int) v);
+                                break;
+                        case 3:
+                                CHECK(fmt, sw, w, sp, p, (long) v);
+                                break;
+                        case 4:
+                                CHECK(fmt, sw, w, sp, p, (long long) v);
+                                break;
+                        case 5:
+                                CHECK(fmt, sw, w, sp, p, (size_t) v);
+                                break;
+                        case 6:
+                                CHECK(fmt, sw, w, sp, p, (intmax_t) v);
+                                break;
+                        case 7:
+                                CHECK(fmt, sw, w, sp, p, (ptrdiff_t) v);
+                                break;
+                }
+        }
+}
+
+
+/** random double of random magnitude */
+static double _rand_double()
+{
+        static const double special[] = {
+                0.0, -0.0, 0.5, 1.5, 2.5, 0.125, 0.1, 0.2, 0.3, 1.0, 10.0,
+                9.9999995, 99999.95, 999999.5, 0.00001, 0.0001, 0.00009999995,
+                1e15, 1e16, 1e17, 1e22, 1e23, 1e300, DBL_MAX, DBL_MIN,
+                DBL_TRUE_MIN, 123456789.125, 0.05, 0.005, 0.0005,
+        };
+
+        switch (_rand_n(8))
+        {
+                case 0:
+                        return special[_rand_n(sizeof(special) /
+                                               sizeof(special[0]))];
+                case 1:
+                        return INFINITY;
+                case 2:
+                        return NAN;
+                case 3:
+                {
+                        /* short decimal fractions (likely ties) */
+                        return (double) _rand_n(100000) /
+                                pow(10, _rand_n(6));
+                }
+                default:
+                {
+                        double m = (double) (_rand() >> 11) /
+                                9007199254740992.0;
+                        return m * pow(10, _rand_n(40) - 15);
+                }
+        }
+}
+
+
+/** floating point conversions */
+static void _floats()
+{
+        static const char conversions[] = "fFgGe";
+
+        for(int i = 0; i < ITERATIONS; i++)
+        {
+                char fmt[64];
+                bool sw, sp;
+                size_t l = _spec(fmt, "-+ #0", &sw, &sp);
+                l += (size_t) sprintf(fmt + l, "%c", conversions[_rand_n(5)]);
+                fmt[l] = '\0';
+
+                int w = _rand_n(40) - 10, p = _rand_n(25) - 3;
+                double v = _rand_double();
+                if(_rand_n(2))
+                        v = -v;
+
+                CHECK(fmt, sw, w, sp, p, v);
+        }
+}
+
+
+/** strings, characters & pointers */
+static void _strings()
+{
+        static const char *strings[] = {
+                "", "a", "string", "longer string with spaces", NULL,
+                "\xe4\xf6\xfc", "%d",
+        };
+
+        for(int i = 0; i < ITERATIONS; i++)
+        {
+                char fmt[64];
+                bool sw, sp;
+                size_t l = _spec(fmt, "-", &sw, &sp);
+                int w = _rand_n(40) - 10, p = _rand_n(30) - 5;
+
+                switch (_rand_n(3))
+                {
+                        case 0:
+                        {
+                                strcpy(fmt + l, "s");
+                                const char *s = strings[_rand_n(7)];
+                                CHECK(fmt, sw, w, sp, p, s);
+                                break;
+                        }
+
+                        case 1:
+                        {
+                                strcpy(fmt + l, "c");
+                                CHECK(fmt, sw, w, sp, p, _rand_n(256));
+                                break;
+                        }
+
+                        case 2:
+                        {
+                                strcpy(fmt + l, "p");
+                                void *ptr = _rand_n(4) ? (void *) (uintptr_t)
+                                        _rand_int() : NULL;
+                                CHECK(fmt, sw, w, sp, p, ptr);
+                                break;
+                        }
+                }
+        }
+}
+
+
+/** complete messages as used by applications */
+static void _messages()
+{
+        const char *s = "text";
+        int i = 42;
+        double d = 3.14159;
+
+        _check("");
+        _check("no conversions");
+        _check("100%%");
+        _check("%d items in %s (%.2f%%)", i, s, d);
+        _check("%s:%d %s() %s: %s", "file.c", 123, "func", "info", s);
+        _check("0x%08x|%-10s|%+5d|%lu|%zu", 0xbeef, s, i, 99UL,
+               (size_t) 4096);
+        _check("[%*s] [%-*s] [%.*s]", 8, s, 8, s, 2, s);
+        _check("%g %g %g %g", 0.0001, 123456.0, 1234567.0, 1e-5);
+        _check("pos %2$s %1$d", i, s);
+        _check("%ls", L"wide");
+        _check("%Lf", 1.5L);
+        _check("%a", d);
+}
+
+
+int main(int argc, char *argv[])
+{
+        NFT_LOG_CHECK_VERSION;
+
+        _integers();
+        _floats();
+        _strings();
+        _messages();
+
+        printf("%lu cases, %lu mismatches\n", _cases, _failed);
+
+        return _failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,299 @@
+/*
+ * libniftylog - niftylight logging library
+ * Copyright (C) 2006-2014 Daniel Hiepler <daniel@niftylight.de>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+/**
+ * @file journald.c
+ */
+
+/* F_GET_SEALS */
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "niftylog.h"
+
+
+/** size of entries the server receives */
+#define ENTRY_SIZE      (64*1024)
+
+
+/** temporary directory */
+static char _dir[] = "/tmp/niftylog-journal-XXXXXX";
+/** socket of our "journald" */
+static struct sockaddr_un _addr;
+/** server socket */
+static int _fd = -1;
+/** last received entry */
+static char _entry[ENTRY_SIZE];
+static size_t _entry_len;
+/** last entry was passed as memfd */
+static bool _memfd;
+
+
+/** receive one entry (datagram or memfd) */
+static bool _receive()
+{
+        union
+        {
+                struct cmsghdr header;
+                char buf[CMSG_SPACE(sizeof(int))];
+        } control;
+
+        struct iovec iov = {.iov_base = _entry,.iov_len = sizeof(_entry) };
+        struct msghdr m = {
+                .msg_iov = &iov,
+                .msg_iovlen = 1,
+                .msg_control = control.buf,
+                .msg_controllen = sizeof(control.buf),
+        };
+
+        ssize_t n;
+        if((n = recvmsg(_fd, &m, MSG_DONTWAIT)) < 0)
+        {
+                fprintf(stderr, "no entry received\n");
+                return false;
+        }
+        _entry_len = (size_t) n;
+        _memfd = false;
+
+        struct cmsghdr *c;
+        if((c = CMSG_FIRSTHDR(&m)) && c->cmsg_type == SCM_RIGHTS)
+        {
+                int fd;
+                memcpy(&fd, CMSG_DATA(c), sizeof(int));
+                _memfd = true;
+
+                int seals = fcntl(fd, F_GET_SEALS);
+                if(seals < 0 || !(seals & F_SEAL_WRITE))
+                {
+                        fprintf(stderr, "memfd not sealed\n");
+                        close(fd);
+                        return false;
+                }
+
+                n = pread(fd, _entry, sizeof(_entry), 0);
+                close(fd);
+                if(n < 0)
+                        return false;
+                _entry_len = (size_t) n;
+        }
+
+        return true;
+}
+
+
+/** get value of field from last entry (native protocol) */
+static bool _field(const char *name, char *value, size_t size)
+{
+        const char *p = _entry, *end = _entry + _entry_len;
+
+        while(p < end)
+        {
+                const char *field = p, *v;
+                const char *nl = memchr(p, '\n', (size_t) (end - p));
+                const char *eq = memchr(p, '=', (size_t) (end - p));
+                size_t len, name_len;
+
+                if(!nl)
+                        return false;
+
+                if(eq && eq < nl)
+                {
+                        /* NAME=value\n */
+                        name_len = (size_t) (eq - p);
+                        v = eq + 1;
+                        len = (size_t) (nl - v);
+                        p = nl + 1;
+                }
+                else
+                {
+                        /* NAME\n<le64 length>value\n */
+                        uint64_t l = 0;
+                        for(int i = 0; i < 8; i++)
+                                l |= (uint64_t) (unsigned char) nl[1 + i] <<
+                                        (8 * i);
+
+                        name_len = (size_t) (nl - p);
+                        v = nl + 9;
+                        len = (size_t) l;
+                        if(v + len >= end || v[len] != '\n')
+                                return false;
+                        p = v + len + 1;
+                }
+
+                if(name_len == strlen(name) &&
+                   strncmp(field, name, name_len) == 0)
+                {
+                        if(len >= size)
+                                len = size - 1;
+                        memcpy(value, v, len);
+                        value[len] = '\0';
+                        return true;
+                }
+        }
+
+        return false;
+}
+
+
+/** check field of last entry */
+static bool _expect(const char *name, const char *expected)
+{
+        static char value[ENTRY_SIZE];
+        if(!_field(name, value, sizeof(value)))
+        {
+                fprintf(stderr, "field %s missing\n", name);
+                return false;
+        }
+
+        if(strcmp(value, expected) != 0)
+        {
+                fprintf(stderr, "%s=\"%.64s\" (expected \"%.64s\")\n", name,
+                        value, expected);
+                return false;
+        }
+
+        return true;
+}
+
+
+int main(int argc, char *argv[])
+{
+        NFT_LOG_CHECK_VERSION;
+
+        if(!mkdtemp(_dir))
+        {
+                perror("mkdtemp");
+                return EXIT_FAILURE;
+        }
+
+        /* local journald */
+        _addr.sun_family = AF_UNIX;
+        snprintf(_addr.sun_path, sizeof(_addr.sun_path), "%s/socket", _dir);
+        if((_fd = socket(AF_UNIX, SOCK_DGRAM, 0)) < 0 ||
+           bind(_fd, (struct sockaddr *) &_addr, sizeof(_addr)) != 0)
+        {
+                perror("socket");
+                return EXIT_FAILURE;
+        }
+
+        setenv("NFT_LOG_JOURNAL_SOCKET", _addr.sun_path, 1);
+        setenv("NFT_LOG_IDENT", "test-ident", 1);
+        /* small send buffer, so big entries need a memfd */
+        setenv("NFT_LOG_JOURNAL_SNDBUF", "4k", 1);
+        nft_log_level_set(L_INFO);
+        if(!nft_log_mechanism_set("journald"))
+                return EXIT_FAILURE;
+
+        bool result = true;
+        char line[16];
+
+        /* call-site fields */
+        NFT_LOG(L_NOTICE, "hello %d %s", 42, "journal");
+        snprintf(line, sizeof(line), "%d", __LINE__ - 1);
+        result = _receive() && !_memfd &&
+                _expect("PRIORITY", "5") &&
+                _expect("SYSLOG_IDENTIFIER", "test-ident") &&
+                _expect("MESSAGE", "hello 42 journal") &&
+                _expect("CODE_FILE", __FILE__) &&
+                _expect("CODE_LINE", line) &&
+                _expect("CODE_FUNC", __func__) && result;
+
+        /* multi-line message uses binary-safe encoding */
+        NFT_LOG(L_ERROR, "first\nsecond");
+        result = _receive() && _expect("PRIORITY", "3") &&
+                _expect("MESSAGE", "first\nsecond") && result;
+
+        /* format string that's not constant */
+        const char *volatile format = "dynamic %s";
+        NFT_LOG(L_INFO, format, "format");
+        result = _receive() && _expect("MESSAGE", "dynamic format") &&
+                _expect("CODE_FUNC", __func__) && result;
+
+        /* structured fields */
+        NFT_LOG_KV(L_INFO, "frame", NFT_KV_INT("strip", 3),
+                   NFT_KV_DBL("fps", 59.5), NFT_KV_STR("mode", "a b"),
+                   NFT_KV_BOOL("2nd-pass", true));
+        result = _receive() &&
+                _expect("MESSAGE", "frame strip=3 fps=59.5 mode=\"a b\" "
+                        "2nd-pass=true") &&
+                _expect("STRIP", "3") && _expect("FPS", "59.5") &&
+                _expect("MODE", "a b") && _expect("F_2ND_PASS", "true") &&
+                result;
+
+        /* message without call-site */
+        nft_log(L_WARNING, __FILE__, __func__, __LINE__, "plain %d", 1);
+        result = _receive() && _expect("PRIORITY", "4") &&
+                _expect("MESSAGE", "warning: plain 1") && result;
+
+        /* entry too large for one datagram */
+        static char big[16384];
+        snprintf(big, sizeof(big), "%12000d", 7);
+        NFT_LOG(L_INFO, "%12000d", 7);
+        if(!_receive() || !_memfd || !_expect("MESSAGE", big))
+        {
+                fprintf(stderr, "big entry not passed as memfd\n");
+                result = false;
+        }
+
+        nft_log_mechanism_set("null");
+
+        /* missing journald */
+        setenv("NFT_LOG_JOURNAL_SOCKET", "/nonexistent/socket", 1);
+        if(nft_log_mechanism_set("journald"))
+        {
+                fprintf(stderr, "initialized without journal socket\n");
+                result = false;
+        }
+
+        close(_fd);
+        unlink(_addr.sun_path);
+        rmdir(_dir);
+
+        return result ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,541 @@
+/*
+ * libniftylog - niftylight logging library
+ * Copyright (C) 2006-2014 Daniel Hiepler <daniel@niftylight.de>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * round-trip fuzz test: JSON encoder (all string escaping implementations
+ * the CPU supports) vs. a strict reference parser
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include "niftylog.h"
+#include "_test.h"
+#include "_json.h"
+
+
+/** amount of random strings per implementation */
+#define ITERATIONS      20000
+/** maximum length of random strings */
+#define MAX_LEN         300
+/** maximum amount of mismatches to print */
+#define MAX_REPORTS     10
+
+
+/** state of random number generator */
+static uint64_t _state = 0x9E3779B97F4A7C15ULL;
+/** amount of mismatches */
+static unsigned long _failed;
+
+
+
+/** xorshift random number generator (reproducible) */
+static uint64_t _rand()
+{
+        _state ^= _state << 13;
+        _state ^= _state >> 7;
+        _state ^= _state << 17;
+        return _state;
+}
+
+
+/** encode codepoint as UTF-8 */
+static size_t _put_utf8(unsigned char *d, uint32_t c)
+{
+        if(c < 0x80)
+        {
+                d[0] = (unsigned char) c;
+                return 1;
+        }
+        if(c < 0x800)
+        {
+                d[0] = (unsigned char) (0xc0 | (c >> 6));
+                d[1] = (unsigned char) (0x80 | (c & 0x3f));
+                return 2;
+        }
+        if(c < 0x10000)
+        {
+                d[0] = (unsigned char) (0xe0 | (c >> 12));
+                d[1] = (unsigned char) (0x80 | ((c >> 6) & 0x3f));
+                d[2] = (unsigned char) (0x80 | (c & 0x3f));
+                return 3;
+        }
+        d[0] = (unsigned char) (0xf0 | (c >> 18));
+        d[1] = (unsigned char) (0x80 | ((c >> 12) & 0x3f));
+        d[2] = (unsigned char) (0x80 | ((c >> 6) & 0x3f));
+        d[3] = (unsigned char) (0x80 | (c & 0x3f));
+        return 4;
+}
+
+
+/** decode one UTF-8 sequence (RFC 3629), 0 if invalid */
+static size_t _get_utf8(const unsigned char *s, size_t len, uint32_t *c)
+{
+        size_t n;
+        uint32_t min;
+        if(s[0] < 0x80)
+        {
+                *c = s[0];
+                return 1;
+        }
+        else if((s[0] & 0xe0) == 0xc0)
+        {
+                n = 2;
+                min = 0x80;
+                *c = s[0] & 0x1f;
+        }
+        else if((s[0] & 0xf0) == 0xe0)
+        {
+                n = 3;
+                min = 0x800;
+                *c = s[0] & 0x0f;
+        }
+        else if((s[0] & 0xf8) == 0xf0)
+        {
+                n = 4;
+                min = 0x10000;
+                *c = s[0] & 0x07;
+        }
+        else
+                return 0;
+
+        if(len < n)
+                return 0;
+
+        for(size_t i = 1; i < n; i++)
+        {
+                if((s[i] & 0xc0) != 0x80)
+                        return 0;
+                *c = (*c << 6) | (s[i] & 0x3f);
+        }
+
+        if(*c < min || *c > 0x10ffff || (*c >= 0xd800 && *c <= 0xdfff))
+                return 0;
+
+        return n;
+}
+
+
+/** what a correct encoder must preserve: invalid UTF-8 bytes become U+FFFD */
+static size_t _expected(unsigned char *d, const unsigned char *s, size_t len)
+{
+        size_t o = 0;
+        for(size_t i = 0; i < len;)
+        {
+                uint32_t c;
+                size_t n;
+                if(!(n = _get_utf8(s + i, len - i, &c)))
+                {
+                        c = 0xfffd;
+                        n = 1;
+                }
+                o += _put_utf8(d + o, c);
+                i += n;
+        }
+        return o;
+}
+
+
+/** parse 4 hex digits */
+static bool _hex4(const char *s, uint32_t *v)
+{
+        *v = 0;
+        for(int i = 0; i < 4; i++)
+        {
+                char c = s[i];
+                *v <<= 4;
+                if(c >= '0' && c <= '9')
+                        *v |= (uint32_t) (c - '0');
+                else if(c >= 'a' && c <= 'f')
+                        *v |= (uint32_t) (c - 'a' + 10);
+                else if(c >= 'A' && c <= 'F')
+                        *v |= (uint32_t) (c - 'A' + 10);
+                else
+                        return false;
+        }
+        return true;
+}
+
+
+/**
+ * reference parser for the contents of a JSON string (RFC 8259): decodes
+ * escapes, rejects raw control characters, lone quotes/backslashes and 
+ * invalid UTF-8
+ *
+ * @result length of decoded string or -1 if invalid
+ */
+static long _parse_string(unsigned char *d, const char *s, size_t len)
+{
+        size_t o = 0;
+        for(size_t i = 0; i < len;)
+        {
+                unsigned char c = (unsigned char) s[i];
+                if(c < 0x20 || c == '"')
+                        return -1;
+
+                if(c != '\\')
+                {
+                        uint32_t cp;
+                        size_t n;
+                        if(!(n = _get_utf8((const unsigned char *) s + i,
+                                           len - i, &cp)))
+                                return -1;
+                        memcpy(d + o, s + i, n);
+                        o += n;
+                        i += n;
+                        continue;
+                }
+
+                if(i + 1 >= len)
+                        return -1;
+
+                uint32_t cp;
+                switch (s[i + 1])
+                {
+                        case '"':
+                        case '\\':
+                        case '/':
+                                d[o++] = (unsigned char) s[i + 1];
+                                i += 2;
+                                continue;
+                        case 'b':
+                                d[o++] = '\b';
+                                i += 2;
+                                continue;
+                        case 'f':
+                                d[o++] = '\f';
+                                i += 2;
+                                continue;
+                        case 'n':
+                                d[o++] = '\n';
+                                i += 2;
+                                continue;
+                        case 'r':
+                                d[o++] = '\r';
+                                i += 2;
+                                continue;
+                        case 't':
+                                d[o++] = '\t';
+                                i += 2;
+                                continue;
+                        case 'u':
+                        {
+                                if(i + 6 > len || !_hex4(s + i + 2, &cp))
+                                        return -1;
+                                i += 6;
+
+                                /* surrogate pair */
+                                if(cp >= 0xd800 && cp <= 0xdbff)
+                                {
+                                        uint32_t lo;
+                                        if(i + 6 > len || s[i] != '\\' ||
+                                           s[i + 1] != 'u' ||
+                                           !_hex4(s + i + 2, &lo) ||
+                                           lo < 0xdc00 || lo > 0xdfff)
+                                                return -1;
+                                        cp = 0x10000 + ((cp - 0xd800) << 10) +
+                                                (lo - 0xdc00);
+                                        i += 6;
+                                }
+                                else if(cp >= 0xdc00 && cp <= 0xdfff)
+                                        return -1;
+
+                                o += _put_utf8(d + o, cp);
+                                continue;
+                        }
+                        default:
+                                return -1;
+                }
+        }
+
+        return (long) o;
+}
+
+
+/** random string with all kinds of bytes that need attention */
+static size_t _random(unsigned char *s)
+{
+        size_t len = (size_t) (_rand() % MAX_LEN);
+        size_t i = 0;
+        while(i < len)
+        {
+                uint64_t r = _rand();
+                switch (r % 8)
+                {
+                        /* runs of plain ASCII (for the SIMD paths) */
+                        case 0:
+                        case 1:
+                        case 2:
+                        {
+                                size_t n = (size_t) ((r >> 8) % 40);
+                                for(size_t j = 0; j < n && i < len; j++)
+                                        s[i++] = (unsigned char) (0x20 +
+                                                                  (_rand() %
+                                                                   0x5f));
+                                break;
+                        }
+                        case 3:
+                                s[i++] = "\"\\/"[(r >> 8) % 3];
+                                break;
+                        case 4:
+                                s[i++] = (unsigned char) ((r >> 8) % 0x20);
+                                break;
+                        /* valid UTF-8 (all lengths) */
+                        case 5:
+                        {
+                                uint32_t c = (uint32_t) ((r >> 8) % 0x110000);
+                                if(c >= 0xd800 && c <= 0xdfff)
+                                        c = 0xe9;
+                                if(i + 4 <= len)
+                                        i += _put_utf8(s + i, c);
+                                else
+                                        s[i++] = 'x';
+                                break;
+                        }
+                        /* random byte (possibly invalid UTF-8) */
+                        default:
+                                s[i++] = (unsigned char) (r >> 8);
+                                break;
+                }
+        }
+
+        return i;
+}
+
+
+/** report mismatch */
+static void _report(const char *impl, const char *what,
+                    const unsigned char *s, size_t len)
+{
+        if(++_failed > MAX_REPORTS)
+                return;
+
+        printf("%s: %s for input (%zu bytes):", impl, what, len);
+        for(size_t i = 0; i < len; i++)
+                printf(" %02x", s[i]);
+        printf("\n");
+}
+
+
+/** fuzz one implementation */
+static void _fuzz(const char *name, JsonEscape * f, JsonEscape * reference)
+{
+        static unsigned char s[MAX_LEN + 4], expected[MAX_LEN * 4],
+                decoded[MAX_LEN * 6];
+        static char out[MAX_LEN * 6], ref[MAX_LEN * 6];
+
+        for(int it = 0; it < ITERATIONS; it++)
+        {
+                size_t len = _random(s);
+                size_t elen = _expected(expected, s, len);
+
+                /* round trip with enough room */
+                size_t n = f(out, sizeof(out), (const char *) s, len);
+                long d = _parse_string(decoded, out, n);
+                if(d < 0)
+                {
+                        _report(name, "invalid JSON", s, len);
+                        continue;
+                }
+                if((size_t) d != elen || memcmp(decoded, expected, elen) != 0)
+                {
+                        _report(name, "round trip mismatch", s, len);
+                        continue;
+                }
+
+                /* same output as scalar implementation */
+                size_t rn = reference(ref, sizeof(ref), (const char *) s, len);
+                if(rn != n || memcmp(ref, out, n) != 0)
+                {
+                        _report(name, "differs from scalar", s, len);
+                        continue;
+                }
+
+                /* truncated output is valid JSON and a prefix */
+                size_t room = (size_t) (_rand() % (n + 1));
+                n = f(out, room, (const char *) s, len);
+                d = _parse_string(decoded, out, n);
+                if(n > room || d < 0 || (size_t) d > elen ||
+                   memcmp(decoded, expected, (size_t) d) != 0)
+                        _report(name, "bad truncation", s, len);
+        }
+}
+
+
+/** find value of top-level string member in JSON object (simple objects
+    as written by the library: no nested strings before the member) */
+static bool _member(const char *line, const char *key, char *value,
+                    size_t size)
+{
+        char pattern[64];
+        snprintf(pattern, sizeof(pattern), "\"%s\":", key);
+
+        const char *p;
+        if(!(p = strstr(line, pattern)))
+                return false;
+        p += strlen(pattern);
+
+        /* string or other value */
+        size_t len;
+        if(*p == '"')
+        {
+                const char *e = ++p;
+                while(*e && *e != '"')
+                        e += (*e == '\\') ? 2 : 1;
+                len = (size_t) (e - p);
+                static unsigned char tmp[4096];
+                long d = _parse_string(tmp, p, len);
+                if(d < 0 || (size_t) d >= size)
+                        return false;
+                memcpy(value, tmp, (size_t) d);
+                value[d] = '\0';
+                return true;
+        }
+
+        len = strcspn(p, ",}");
+        if(len >= size)
+                return false;
+        memcpy(value, p, len);
+        value[len] = '\0';
+        return true;
+}
+
+
+/** check member of last line written to stderr */
+static bool _expect(const char *key, const char *expected)
+{
+        static char line[8192], last[8192];
+        FILE *f;
+        if(!(f = _test_open()))
+                return false;
+        last[0] = '\0';
+        while(fgets(line, sizeof(line), f))
+                strcpy(last, line);
+        fclose(f);
+
+        char value[4096];
+        if(last[0] != '{' || !strstr(last, "}\n") ||
+           !_member(last, key, value, sizeof(value)))
+        {
+                printf("member \"%s\" missing: %s", key, last);
+                return false;
+        }
+
+        if(strcmp(value, expected) != 0)
+        {
+                printf("%s=\"%s\" (expected \"%s\")\n", key, value, expected);
+                return false;
+        }
+
+        return true;
+}
+
+
+int main(int argc, char *argv[])
+{
+        JsonEscape *scalar = _json_escape_impl(JSON_SCALAR);
+        static const char *names[] = { "scalar", "sse2", "avx2" };
+        for(int i = JSON_SCALAR; i <= JSON_AVX2; i++)
+        {
+                JsonEscape *f;
+                if(!(f = _json_escape_impl((JsonImpl) i)))
+                {
+                        printf("%s not supported\n", names[i]);
+                        continue;
+                }
+                _fuzz(names[i], f, scalar);
+        }
+
+        /* messages as JSON lines */
+        if(!_test_capture("json"))
+                return EXIT_FAILURE;
+
+        unsetenv(NFT_LOG_ENV_MECHANISM);
+        unsetenv(NFT_LOG_ENV_LEVEL);
+        unsetenv(NFT_LOG_ENV_OUTPUT);
+        unsetenv(NFT_LOG_ENV_TIMESTAMP);
+        unsetenv(NFT_LOG_ENV_THREAD);
+        nft_log_level_set(L_INFO);
+        nft_log_output_set(NFT_LOG_OUTPUT_JSON);
+
+        bool result = true;
+        char line[16];
+
+        NFT_LOG(L_WARNING, "quote \" tab \t %s", "end\n");
+        snprintf(line, sizeof(line), "%d", __LINE__ - 1);
+        result &= _expect("level", "warning") &&
+                _expect("message", "quote \" tab \t end\n") &&
+                _expect("file", __FILE__) && _expect("line", line) &&
+                _expect("func", __func__);
+
+        nft_log_thread_name_set("json");
+        nft_log_thread_set(NFT_LOG_THREAD_NAME);
+        nft_log_timestamp_set(NFT_LOG_TIMESTAMP_SEC);
+        NFT_LOG_KV(L_INFO, "frame", NFT_KV_INT("strip", -3),
+                   NFT_KV_STR("mode", "a\"b"), NFT_KV_BOOL("ok", true));
+        result &= _expect("thread", "json") &&
+                _expect("strip", "-3") && _expect("mode", "a\"b") &&
+                _expect("ok", "true") && _expect("message", "frame");
+
+        /* invalid UTF-8 */
+        NFT_LOG(L_INFO, "bad \xff byte");
+        result &= _expect("message", "bad \xef\xbf\xbd byte");
+
+        /* huge message is truncated but stays valid */
+        static char big[8192];
+        memset(big, '"', sizeof(big) - 1);
+        NFT_LOG(L_INFO, "%s", big);
+        result &= _expect("level", "info");
+
+        unlink(_test_path);
+
+        if(_failed)
+        {
+                printf("%lu mismatches\n", _failed);
+                result = false;
+        }
+
+        return result ? EXIT_SUCCESS : EXIT_FAILURE;
+}
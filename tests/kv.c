@@ -0,0 +1,151 @@
+/*
+ * libniftylog - niftylight logging library
+ * Copyright (C) 2006-2014 Daniel Hiepler <daniel@niftylight.de>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/**
+ * @file kv.c
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "niftylog.h"
+#include "_test.h"
+
+
+/** what the subscriber received */
+static struct
+{
+        int count;
+        char body[256];
+        size_t kv_count;
+        NftLogKv kv[8];
+} _received;
+
+/** times a field value has been evaluated */
+static int _evaluated;
+
+
+
+
+/** subscriber that records what it got */
+static void _subscriber(void *userdata, const NftLogMessage * m)
+{
+        _received.count++;
+        snprintf(_received.body, sizeof(_received.body), "%.*s",
+                 (int) m->body_len, m->body);
+        _received.kv_count = m->kv_count;
+        for(size_t i = 0; i < m->kv_count && i < 8; i++)
+                _received.kv[i] = m->kv[i];
+}
+
+
+/** field value with side effect */
+static int _value(int v)
+{
+        _evaluated++;
+        return v;
+}
+
+
+int main(int argc, char *argv[])
+{
+        if(!_test_capture("kv"))
+                return EXIT_FAILURE;
+
+        unsetenv(NFT_LOG_ENV_MECHANISM);
+        unsetenv(NFT_LOG_ENV_LEVEL);
+        nft_log_level_set(L_INFO);
+
+        if(!nft_log_subscribe(_subscriber, NULL, NFT_LOG_LEVELS_ALL))
+                return EXIT_FAILURE;
+
+        bool result = true;
+
+        /* typed fields reach subscribers & text mechanisms */
+        NFT_LOG_KV(L_INFO, "frame", NFT_KV_INT("strip", _value(3)),
+                   NFT_KV_DBL("fps", 59.8), NFT_KV_UINT("bytes", 4096u),
+                   NFT_KV_STR("name", "left \"panel\""),
+                   NFT_KV_BOOL("dirty", false));
+        if(_received.count != 1 || _received.kv_count != 5 ||
+           _received.kv[0].type != NFT_KV_TYPE_INT ||
+           _received.kv[0].value.i != 3 ||
+           strcmp(_received.kv[1].key, "fps") != 0 ||
+           _received.kv[1].value.d != 59.8 ||
+           _received.kv[2].value.u != 4096 ||
+           _received.kv[4].value.b != false ||
+           strcmp(_received.body, "frame strip=3 fps=59.8 bytes=4096 "
+                  "name=\"left \\\"panel\\\"\" dirty=false") != 0)
+        {
+                printf("wrong message: %d \"%s\" (%zu fields)\n",
+                       _received.count, _received.body, _received.kv_count);
+                result = false;
+        }
+        result &= _test_line("frame strip=3 fps=59.8 bytes=4096 "
+                        "name=\"left \\\"panel\\\"\" dirty=false");
+
+        /* filtered messages don't even evaluate their fields */
+        NFT_LOG_KV(L_DEBUG, "filtered", NFT_KV_INT("strip", _value(4)));
+        if(_received.count != 1 || _evaluated != 1)
+        {
+                printf("filtered message evaluated/received\n");
+                result = false;
+        }
+
+        /* ordinary messages have no fields */
+        NFT_LOG(L_ERROR, "plain %d", 1);
+        if(_received.count != 2 || _received.kv_count != 0)
+        {
+                printf("plain message has fields\n");
+                result = false;
+        }
+        result &= _test_line("error: plain 1");
+
+        /* message is no format string */
+        NFT_LOG_KV(L_WARNING, "100%", NFT_KV_STR("empty", ""));
+        result &= _test_line("warning: 100% empty=\"\"");
+
+        unlink(_test_path);
+
+        return result ? EXIT_SUCCESS : EXIT_FAILURE;
+}
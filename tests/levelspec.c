@@ -0,0 +1,127 @@
+/*
+ * libniftylog - niftylight logging library
+ * Copyright (C) 2006-2014 Daniel Hiepler <daniel@niftylight.de>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/**
+ * @file levelspec.c
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "niftylog.h"
+#include "_test.h"
+
+
+/** log debug message from the same call-site every time */
+static void _debug(const char *tag)
+{
+        NFT_LOG(L_DEBUG, "%s", tag);
+}
+
+
+int main(int argc, char *argv[])
+{
+        if(!_test_capture("levelspec"))
+                return EXIT_FAILURE;
+
+        unsetenv(NFT_LOG_ENV_MECHANISM);
+        setenv(NFT_LOG_ENV_LEVEL,
+               "warning,src/hw/*=verbose,nomatch.c=noisy,levelspec.c=debug",
+               1);
+
+        bool result = true;
+
+        /* call-sites of this file */
+        _debug("site-debug");
+        NFT_LOG(L_NOISY, "site-noisy");
+        NftLoglevel l = (argc > 100 ? L_INFO : L_DEBUG);
+        NFT_LOG(l, "variable-debug");
+
+        /* messages without call-site */
+        nft_log(L_VERBOSE, "../src/hw/spi.c", __func__, __LINE__,
+                "hw-verbose");
+        nft_log(L_DEBUG, "../src/hw/spi.c", __func__, __LINE__, "hw-debug");
+        nft_log(L_INFO, "src/render.c", __func__, __LINE__, "render-info");
+        nft_log(L_ERROR, "src/render.c", __func__, __LINE__, "render-error");
+
+        /* getter returns the default level, the early-out uses the most 
+           verbose level of all rules (even if no call-site matches) */
+        if(nft_log_level_get() != L_WARNING ||
+           !nft_log_level_is_enabled(L_NOISY))
+        {
+                fprintf(stdout, "level: %s\n",
+                        nft_log_level_to_string(nft_log_level_get()));
+                result = false;
+        }
+
+        /* changed specification invalidates cached levels */
+        setenv(NFT_LOG_ENV_LEVEL, "warning,spi.c=debug", 1);
+        nft_log_level_reload();
+        _debug("reload-debug");
+        nft_log(L_DEBUG, "../src/hw/spi.c", __func__, __LINE__,
+                "reload-hw-debug");
+
+        /* plain level name still works */
+        setenv(NFT_LOG_ENV_LEVEL, "debug", 1);
+        nft_log_level_reload();
+        _debug("plain-debug");
+
+        result &= _test_contains("site-debug", true);
+        result &= _test_contains("site-noisy", false);
+        result &= _test_contains("variable-debug", true);
+        result &= _test_contains("hw-verbose", true);
+        result &= _test_contains(": hw-debug", false);
+        result &= _test_contains("render-info", false);
+        result &= _test_contains("render-error", true);
+        /* long prefix only for call-sites with a debug rule */
+        result &= _test_contains("levelspec.c:", true);
+        result &= _test_contains("render.c:", false);
+        result &= _test_contains("reload-debug", false);
+        result &= _test_contains("reload-hw-debug", true);
+        result &= _test_contains("plain-debug", true);
+
+        unlink(_test_path);
+
+        return result ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,200 @@
+/*
+ * libniftylog - niftylight logging library
+ * Copyright (C) 2006-2014 Daniel Hiepler <daniel@niftylight.de>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/**
+ * @file loggers.c
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "niftylog.h"
+
+
+/** temporary directory */
+static char _dir[] = "/tmp/niftylog-loggers-XXXXXX";
+/** output of mechanisms */
+static char _file[64], _stderr[64];
+
+
+/** check if file contains (or doesn't contain) string */
+static bool _contains(const char *path, const char *s, bool expected)
+{
+        FILE *f;
+        if(!(f = fopen(path, "r")))
+        {
+                perror("fopen");
+                return false;
+        }
+
+        bool found = false;
+        char line[1024];
+        while(!found && fgets(line, sizeof(line), f))
+                found = (strstr(line, s) != NULL);
+        fclose(f);
+
+        if(found != expected)
+        {
+                fprintf(stdout, "%s: \"%s\" %s\n", path, s,
+                        expected ? "missing" : "unexpected");
+                return false;
+        }
+
+        return true;
+}
+
+
+/** check result of a test */
+static bool _check(bool ok, const char *what)
+{
+        if(!ok)
+                fprintf(stdout, "failed: %s\n", what);
+        return ok;
+}
+
+
+int main(int argc, char *argv[])
+{
+        NFT_LOG_CHECK_VERSION;
+
+        if(!mkdtemp(_dir))
+        {
+                perror("mkdtemp");
+                return EXIT_FAILURE;
+        }
+        snprintf(_file, sizeof(_file), "%s/file", _dir);
+        snprintf(_stderr, sizeof(_stderr), "%s/stderr", _dir);
+
+        unsetenv(NFT_LOG_ENV_MECHANISM);
+        unsetenv(NFT_LOG_ENV_LEVEL);
+        setenv("NFT_LOG_FILE", _file, 1);
+        if(!freopen(_stderr, "w", stderr))
+        {
+                perror("freopen");
+                return EXIT_FAILURE;
+        }
+
+        bool result = true;
+
+        nft_log_level_set(L_WARNING);
+        if(!nft_log_mechanism_set("stderr"))
+                return EXIT_FAILURE;
+
+        /* hierarchy */
+        NftLogger *root = nft_logger_get(NULL);
+        NftLogger *abc = nft_logger_get("a.b.c");
+        NftLogger *ab = nft_logger_get("a.b");
+        NftLogger *a = nft_logger_get("a");
+        NftLogger *x = nft_logger_get("x");
+        result &= _check(root && abc && ab && a && x, "get");
+        if(!result)
+                return EXIT_FAILURE;
+
+        result &= _check(nft_logger_get("") == root, "root");
+        result &= _check(nft_logger_get("a.b.c") == abc, "same logger");
+        result &= _check(nft_logger_parent(abc) == ab &&
+                         nft_logger_parent(ab) == a &&
+                         nft_logger_parent(a) == root &&
+                         !nft_logger_parent(root), "parents");
+        result &= _check(strcmp(nft_logger_name(abc), "a.b.c") == 0 &&
+                         strcmp(nft_logger_name(root), "") == 0, "names");
+        result &= _check(!nft_logger_get("a..b") && !nft_logger_get(".a") &&
+                         !nft_logger_get("a."), "invalid names");
+
+        /* inherited levels */
+        result &= _check(nft_logger_level_get(abc) == L_WARNING, "inherit");
+        nft_logger_level_set(a, L_DEBUG);
+        result &= _check(nft_logger_is_enabled(abc, L_DEBUG) &&
+                         !nft_logger_is_enabled(abc, L_NOISY) &&
+                         !nft_logger_is_enabled(root, L_DEBUG) &&
+                         !nft_logger_is_enabled(x, L_DEBUG),
+                         "level of parent");
+        nft_logger_level_set(ab, L_ERROR);
+        result &= _check(!nft_logger_is_enabled(abc, L_WARNING) &&
+                         nft_logger_is_enabled(a, L_DEBUG), "own level");
+        nft_logger_level_set(ab, L_INVALID);
+        result &= _check(nft_logger_is_enabled(abc, L_DEBUG), "reset level");
+        result &= _check(!nft_logger_level_set(ab, L_MIN), "invalid level");
+
+        /* loggers without own level follow global level */
+        nft_log_level_set(L_INFO);
+        result &= _check(nft_logger_is_enabled(x, L_INFO) &&
+                         nft_logger_level_get(x) == L_INFO, "global level");
+        nft_log_level_set(L_WARNING);
+
+        /* inherited mechanisms */
+        nft_logger_mechanism_set(a, "file");
+        NFT_LOGGER_LOG(abc, L_DEBUG, "abc-debug");
+        NFT_LOGGER_LOG(abc, L_NOISY, "abc-noisy");
+        NFT_LOG(L_DEBUG, "root-debug");
+        NFT_LOG(L_ERROR, "root-error");
+
+        /* mechanisms of root logger get messages of own level */
+        nft_logger_level_set(x, L_VERBOSE);
+        NFT_LOGGER_LOG(x, L_VERBOSE, "x-verbose");
+        NFT_LOGGER_LOG(x, L_DEBUG, "x-debug");
+
+        /* back to mechanisms of root logger */
+        nft_logger_mechanism_set(a, NULL);
+        NFT_LOGGER_LOG(ab, L_INFO, "ab-info");
+
+        fflush(stderr);
+
+        result &= _contains(_file, "abc-debug", true);
+        result &= _contains(_file, "abc-noisy", false);
+        result &= _contains(_file, "root-error", false);
+        result &= _contains(_file, "ab-info", false);
+        result &= _contains(_stderr, "abc-debug", false);
+        result &= _contains(_stderr, "root-debug", false);
+        result &= _contains(_stderr, "root-error", true);
+        result &= _contains(_stderr, "x-verbose", true);
+        result &= _contains(_stderr, "x-debug", false);
+        result &= _contains(_stderr, "ab-info", true);
+
+        unlink(_file);
+        unlink(_stderr);
+        rmdir(_dir);
+
+        return result ? EXIT_SUCCESS : EXIT_FAILURE;
+}
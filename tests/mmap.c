@@ -0,0 +1,172 @@
+/*
+ * libniftylog - niftylight logging library
+ * Copyright (C) 2006-2014 Daniel Hiepler <daniel@niftylight.de>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+/**
+ * @file mmap.c
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include "niftylog.h"
+#include "_test.h"
+
+
+/** amount of logging threads */
+#define THREADS         4
+/** messages per thread (fills a couple of segments) */
+#define MESSAGES        5000
+/** content of logfile before the test */
+#define EXISTING        "existing content\n"
+
+
+/** last message number seen from each thread */
+static int _last[THREADS];
+
+
+/** log messages from one thread */
+static void *_thread(void *arg)
+{
+        int t = (int) (intptr_t) arg;
+
+        for(int i = 0; i < MESSAGES; i++)
+                NFT_LOG(L_INFO, "thread %d message %d", t, i);
+
+        return NULL;
+}
+
+
+/** check that every line is intact and no message is missing */
+static bool _check()
+{
+        FILE *f;
+        if(!(f = fopen(_test_path, "r")))
+        {
+                perror("fopen");
+                return false;
+        }
+
+        bool result = true;
+        char *line = NULL;
+        size_t size = 0;
+        ssize_t len;
+
+        if((len = getline(&line, &size, f)) < 0 || strcmp(line, EXISTING) != 0)
+        {
+                fprintf(stderr, "existing content lost\n");
+                result = false;
+        }
+
+        while((len = getline(&line, &size, f)) >= 0)
+        {
+                int t, i, n = 0;
+                if((size_t) len != strlen(line) ||
+                   sscanf(line, "thread %d message %d\n%n", &t, &i, &n) != 2 ||
+                   line[n] != '\0' || t < 0 || t >= THREADS ||
+                   i != _last[t] + 1)
+                {
+                        fprintf(stderr, "unexpected line \"%s\"\n", line);
+                        result = false;
+                        break;
+                }
+
+                _last[t] = i;
+        }
+
+        free(line);
+        fclose(f);
+
+        for(int t = 0; t < THREADS; t++)
+        {
+                if(_last[t] != MESSAGES - 1)
+                {
+                        fprintf(stderr, "thread %d: last message %d\n", t,
+                                _last[t]);
+                        result = false;
+                }
+        }
+
+        return result;
+}
+
+
+int main(int argc, char *argv[])
+{
+        NFT_LOG_CHECK_VERSION;
+
+        FILE *f;
+        if(!_test_file("mmap") || !(f = fopen(_test_path, "w")))
+                return EXIT_FAILURE;
+        if(fputs(EXISTING, f) == EOF)
+        {
+                perror("fputs");
+                return EXIT_FAILURE;
+        }
+        fclose(f);
+
+        setenv("NFT_LOG_MMAP_FILE", _test_path, 1);
+        setenv("NFT_LOG_MMAP_SEGMENT", "64k", 1);
+        nft_log_level_set(L_INFO);
+        if(!nft_log_mechanism_set("mmap"))
+                return EXIT_FAILURE;
+
+        pthread_t threads[THREADS];
+        for(int t = 0; t < THREADS; t++)
+                pthread_create(&threads[t], NULL, _thread,
+                               (void *) (intptr_t) t);
+        for(int t = 0; t < THREADS; t++)
+                pthread_join(threads[t], NULL);
+
+        /* truncate & close file */
+        nft_log_mechanism_set("null");
+
+        for(int t = 0; t < THREADS; t++)
+                _last[t] = -1;
+        bool result = _check();
+
+        unlink(_test_path);
+
+        return result ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,195 @@
+/*
+ * libniftylog - niftylight logging library
+ * Copyright (C) 2006-2014 Daniel Hiepler <daniel@niftylight.de>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/**
+ * @file ratelimit.c
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "niftylog.h"
+#include "_test.h"
+
+
+/** one call-site with explicit limit */
+static void _burst(int i)
+{
+        NFT_LOG_RATELIMITED(L_INFO, 10, 3, "burst %d", i);
+}
+
+
+/** call-site that doesn't log again after dropping messages */
+static void _quiet(int i)
+{
+        NFT_LOG_RATELIMITED(L_INFO, 10, 1, "quiet %d", i);
+}
+
+
+/** call-site of a process that exits right after dropping messages */
+static void _exiting(int i)
+{
+        NFT_LOG_RATELIMITED(L_INFO, 10, 1, "exiting %d", i);
+}
+
+
+/** check limit of level */
+static bool _limit(NftLoglevel level, unsigned int rate, unsigned int burst)
+{
+        unsigned int r, b;
+        if(!nft_log_ratelimit_get(level, &r, &b))
+        {
+                fprintf(stdout, "failed to get limit of \"%s\"\n",
+                        nft_log_level_to_string(level));
+                return false;
+        }
+
+        if(r != rate || b != burst)
+        {
+                fprintf(stdout, "limit of \"%s\" is %u:%u instead of %u:%u\n",
+                        nft_log_level_to_string(level), r, b, rate, burst);
+                return false;
+        }
+
+        return true;
+}
+
+
+int main(int argc, char *argv[])
+{
+        if(!_test_capture("ratelimit"))
+                return EXIT_FAILURE;
+
+        unsetenv(NFT_LOG_ENV_MECHANISM);
+        unsetenv(NFT_LOG_ENV_LEVEL);
+        unsetenv(NFT_LOG_ENV_THREAD);
+        unsetenv(NFT_LOG_ENV_TIMESTAMP);
+        unsetenv(NFT_LOG_ENV_OUTPUT);
+        setenv(NFT_LOG_ENV_RATELIMIT, "notice=2:1", 1);
+        nft_log_level_set(L_INFO);
+
+        bool result = true;
+
+        /* unlimited by default */
+        for(int i = 0; i < 10; i++)
+                NFT_LOG(L_INFO, "free %d", i);
+        result &= _test_expect("free ", 10);
+
+        /* explicit limit of call-site: burst, then rate */
+        for(int i = 0; i < 100; i++)
+                _burst(i);
+        result &= _test_expect("burst ", 3);
+        result &= _test_expect("suppressed", 0);
+
+        /* bucket refilled */
+        usleep(250000);
+        _burst(100);
+        result &= _test_expect("suppressed 97 messages", 1);
+        result &= _test_expect("burst 100", 1);
+
+        /* limit of level */
+        result &= _limit(L_INFO, 0, 0);
+        if(!nft_log_ratelimit_set(L_INFO, 5, 2))
+                return EXIT_FAILURE;
+        result &= _limit(L_INFO, 5, 2);
+
+        for(int i = 0; i < 10; i++)
+                NFT_LOG(L_INFO, "level %d", i);
+        result &= _test_expect("level ", 2);
+
+        for(int i = 0; i < 10; i++)
+                NFT_LOGGER_LOG(NULL, L_INFO, "logger %d", i);
+        result &= _test_expect("logger ", 2);
+
+        for(int i = 0; i < 10; i++)
+                NFT_LOG(L_ERROR, "other level %d", i);
+        result &= _test_expect("error: other level ", 10);
+
+        /* environment wins */
+        result &= _limit(L_NOTICE, 2, 1);
+        nft_log_ratelimit_set(L_NOTICE, 100, 0);
+        result &= _limit(L_NOTICE, 2, 1);
+
+        /* all levels, default burst */
+        nft_log_ratelimit_set(L_INVALID, 50, 0);
+        result &= _limit(L_ERROR, 50, 50);
+        result &= _limit(L_INFO, 50, 50);
+        nft_log_ratelimit_set(L_INVALID, 0, 0);
+        result &= _limit(L_INFO, 0, 0);
+
+        if(nft_log_ratelimit_set(L_MIN, 1, 1))
+        {
+                fprintf(stdout, "invalid level accepted\n");
+                result = false;
+        }
+
+        /* dropped messages are reported once the bucket is refilled, even 
+           if the call-site doesn't log again (level limits are off by now, 
+           so the call-sites of both level limit checks report as well) */
+        for(int i = 0; i < 10; i++)
+                _quiet(i);
+        result &= _test_expect("quiet ", 1);
+        usleep(1500000);
+        result &= _test_expect("suppressed 9 messages", 1);
+        result &= _test_expect("suppressed 8 messages", 2);
+
+        /* ...and upon exit */
+        fflush(stderr);
+        pid_t pid;
+        if((pid = fork()) == 0)
+        {
+                for(int i = 0; i < 20; i++)
+                        _exiting(i);
+                exit(EXIT_SUCCESS);
+        }
+        waitpid(pid, NULL, 0);
+        result &= _test_expect("exiting ", 1);
+        result &= _test_expect("suppressed 19 messages", 1);
+
+        unlink(_test_path);
+
+        return result ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,212 @@
+/*
+ * libniftylog - niftylight logging library
+ * Copyright (C) 2006-2014 Daniel Hiepler <daniel@niftylight.de>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/**
+ * @file sample.c
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "niftylog.h"
+#include "_test.h"
+
+
+/** messages received by subscriber */
+struct Received
+{
+        /** amount of messages */
+        int count;
+        /** sum of weights */
+        long weights;
+        /** true if any message had another weight */
+        bool mismatch;
+        /** expected weight */
+        unsigned int weight;
+};
+
+
+
+/** count messages & weights */
+static void _subscriber(void *userdata, const NftLogMessage * m)
+{
+        struct Received *r = userdata;
+
+        r->count++;
+        r->weights += m->weight ? m->weight : 1;
+        if(m->weight != r->weight)
+                r->mismatch = true;
+}
+
+
+/** check amount of messages & weights (random, so allow 25%) */
+static bool _expect(struct Received *r, const char *what, int total)
+{
+        int n = r->weight ? r->weight : 1;
+        int expected = total / n;
+        int tolerance = expected / 4 + 1;
+        bool ok = true;
+
+        if(abs(r->count - expected) > tolerance)
+        {
+                fprintf(stdout, "%s: %d messages instead of ~%d\n", what,
+                        r->count, expected);
+                ok = false;
+        }
+
+        if(labs(r->weights - total) > (long) tolerance * n)
+        {
+                fprintf(stdout, "%s: weights sum up to %ld instead of ~%d\n",
+                        what, r->weights, total);
+                ok = false;
+        }
+
+        if(r->mismatch)
+        {
+                fprintf(stdout, "%s: wrong weight\n", what);
+                ok = false;
+        }
+
+        *r = (struct Received) {.weight = r->weight };
+        return ok;
+}
+
+
+/** one call-site with explicit rate */
+static void _sampled(int i)
+{
+        NFT_LOG_SAMPLED(L_INFO, 4, "sampled %d", i);
+}
+
+
+int main(int argc, char *argv[])
+{
+        if(!_test_capture("sample"))
+                return EXIT_FAILURE;
+
+        unsetenv(NFT_LOG_ENV_MECHANISM);
+        unsetenv(NFT_LOG_ENV_LEVEL);
+        unsetenv(NFT_LOG_ENV_OUTPUT);
+        setenv(NFT_LOG_ENV_SAMPLE, "verynoisy=1/10", 1);
+        nft_log_level_set(L_VERY_NOISY);
+
+        struct Received r = { 0 };
+        if(!nft_log_subscribe(_subscriber, &r, NFT_LOG_LEVELS_ALL))
+                return EXIT_FAILURE;
+
+        bool result = true;
+
+        /* all messages by default */
+        if(nft_log_sample_get(L_NOISY) != 1)
+        {
+                fprintf(stdout, "noisy messages sampled by default\n");
+                result = false;
+        }
+
+        for(int i = 0; i < 100; i++)
+                NFT_LOG(L_NOISY, "all %d", i);
+        result &= _expect(&r, "unsampled", 100);
+
+        /* rate of level */
+        r.weight = 100;
+        nft_log_sample_set(L_NOISY, 100);
+        for(int i = 0; i < 100000; i++)
+                NFT_LOG(L_NOISY, "noisy %d", i);
+        result &= _expect(&r, "noisy", 100000);
+
+        /* from environment */
+        r.weight = 10;
+        for(int i = 0; i < 10000; i++)
+                NFT_LOG(L_VERY_NOISY, "very noisy %d", i);
+        result &= _expect(&r, "very noisy", 10000);
+
+        /* environment wins */
+        nft_log_sample_set(L_VERY_NOISY, 2);
+        if(nft_log_sample_get(L_VERY_NOISY) != 10)
+        {
+                fprintf(stdout, "environment didn't win\n");
+                result = false;
+        }
+
+        /* explicit rate of call-site */
+        r.weight = 4;
+        for(int i = 0; i < 10000; i++)
+                _sampled(i);
+        result &= _expect(&r, "call-site", 10000);
+
+        /* structured messages */
+        r.weight = 100;
+        for(int i = 0; i < 10000; i++)
+                NFT_LOG_KV(L_NOISY, "kv", NFT_KV_INT("i", i));
+        result &= _expect(&r, "structured", 10000);
+
+        /* weight is part of JSON object */
+        nft_log_output_set(NFT_LOG_OUTPUT_JSON);
+        r.weight = 4;
+        for(int i = 0; i < 100 && !r.count; i++)
+                _sampled(i);
+        result &= _test_contains("\"weight\":4,", true);
+        nft_log_output_set(NFT_LOG_OUTPUT_TEXT);
+
+        /* all levels */
+        nft_log_sample_set(L_INVALID, 0);
+        if(nft_log_sample_get(L_NOISY) != 1 ||
+           nft_log_sample_get(L_ERROR) != 1)
+        {
+                fprintf(stdout, "sampling not turned off\n");
+                result = false;
+        }
+
+        if(nft_log_sample_set(L_MIN, 2))
+        {
+                fprintf(stdout, "invalid level accepted\n");
+                result = false;
+        }
+
+        nft_log_unsubscribe(_subscriber, &r);
+        unlink(_test_path);
+
+        return result ? EXIT_SUCCESS : EXIT_FAILURE;
+}
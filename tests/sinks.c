@@ -0,0 +1,183 @@
+/*
+ * libniftylog - niftylight logging library
+ * Copyright (C) 2006-2014 Daniel Hiepler <daniel@niftylight.de>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+/**
+ * @file sinks.c
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "niftylog.h"
+
+
+/** temporary directory */
+static char _dir[] = "/tmp/niftylog-sinks-XXXXXX";
+/** output of mechanisms */
+static char _file[64], _mmap[64], _stderr[64], _binary[64];
+
+
+/** check if file contains (or doesn't contain) string */
+static bool _contains(const char *path, const char *s, bool expected)
+{
+        FILE *f;
+        if(!(f = fopen(path, "r")))
+        {
+                perror("fopen");
+                return false;
+        }
+
+        /* files might contain binary data */
+        static char buf[64 * 1024];
+        size_t n = fread(buf, 1, sizeof(buf), f), len = strlen(s);
+        fclose(f);
+
+        bool found = false;
+        for(size_t i = 0; !found && i + len <= n; i++)
+                found = memcmp(buf + i, s, len) == 0;
+
+        if(found != expected)
+        {
+                fprintf(stdout, "%s: \"%s\" %s\n", path, s,
+                        expected ? "missing" : "unexpected");
+                return false;
+        }
+
+        return true;
+}
+
+
+int main(int argc, char *argv[])
+{
+        NFT_LOG_CHECK_VERSION;
+
+        if(!mkdtemp(_dir))
+        {
+                perror("mkdtemp");
+                return EXIT_FAILURE;
+        }
+        snprintf(_file, sizeof(_file), "%s/file", _dir);
+        snprintf(_mmap, sizeof(_mmap), "%s/mmap", _dir);
+        snprintf(_stderr, sizeof(_stderr), "%s/stderr", _dir);
+        snprintf(_binary, sizeof(_binary), "%s/binary", _dir);
+
+        unsetenv(NFT_LOG_ENV_MECHANISM);
+        unsetenv(NFT_LOG_ENV_LEVEL);
+        setenv("NFT_LOG_FILE", _file, 1);
+        setenv("NFT_LOG_MMAP_FILE", _mmap, 1);
+        setenv("NFT_LOG_BINARY_FILE", _binary, 1);
+        if(!freopen(_stderr, "w", stderr))
+        {
+                perror("freopen");
+                return EXIT_FAILURE;
+        }
+
+        bool result = true;
+
+        /* stderr uses global level */
+        nft_log_level_set(L_WARNING);
+        if(!nft_log_mechanism_set("file:debug,mmap:error,stderr"))
+                return EXIT_FAILURE;
+
+        /* early-out uses most verbose mechanism, getter returns global 
+           level */
+        if(nft_log_level_get() != L_WARNING ||
+           !nft_log_level_is_enabled(L_DEBUG) ||
+           nft_log_level_is_enabled(L_NOISY))
+        {
+                printf("effective level is %d\n", nft_log_level_get());
+                result = false;
+        }
+
+        NFT_LOG(L_NOISY, "noisy message");
+        NFT_LOG(L_DEBUG, "debug message");
+        NFT_LOG(L_INFO, "info message");
+        NFT_LOG(L_WARNING, "warning message");
+        NFT_LOG(L_ERROR, "error message");
+
+        /* invalid specifications keep current mechanisms */
+        if(nft_log_mechanism_set("stderr:bogus") ||
+           nft_log_mechanism_set("stderr,foo") ||
+           nft_log_mechanism_set("stderr,stderr"))
+        {
+                printf("invalid specification accepted\n");
+                result = false;
+        }
+        NFT_LOG(L_ERROR, "still logging");
+
+        /* mechanisms with and without support for unformatted messages */
+        if(!nft_log_mechanism_set("binary:info,file:info"))
+                return EXIT_FAILURE;
+        NFT_LOG(L_INFO, "shared %d", 42);
+        NFT_LOG(L_DEBUG, "filtered %d", 43);
+        nft_log_mechanism_set("null");
+        fflush(stderr);
+
+        result = _contains(_file, "noisy message", false) &&
+                _contains(_file, "debug message", true) &&
+                _contains(_file, "info message", true) &&
+                _contains(_file, "error message", true) &&
+                _contains(_file, "still logging", true) &&
+                _contains(_file, "shared 42", true) &&
+                _contains(_file, "filtered 43", false) &&
+                _contains(_mmap, "info message", false) &&
+                _contains(_mmap, "warning message", false) &&
+                _contains(_mmap, "error message", true) &&
+                _contains(_stderr, "info message", false) &&
+                _contains(_stderr, "warning message", true) &&
+                _contains(_stderr, "error message", true) &&
+                _contains(_stderr, "sinks.c:", false) && result;
+
+        /* binary mechanism got the unformatted message */
+        if(access(_binary, F_OK) != 0 ||
+           !_contains(_binary, "shared %d", true))
+                result = false;
+
+        unlink(_file);
+        unlink(_mmap);
+        unlink(_stderr);
+        unlink(_binary);
+        rmdir(_dir);
+
+        return result ? EXIT_SUCCESS : EXIT_FAILURE;
+}
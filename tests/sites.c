@@ -0,0 +1,185 @@
+/*
+ * libniftylog - niftylight logging library
+ * Copyright (C) 2006-2014 Daniel Hiepler <daniel@niftylight.de>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "niftylog.h"
+
+
+/** amount of messages received by _log_func() */
+static int _received;
+/** amount of evaluated arguments */
+static int _evaluated;
+/** call-site found by _find_site() */
+static NftLogSite *_found;
+
+
+
+/** NftLogFunc that counts received messages */
+static void _log_func(void *userdata, NftLoglevel level, const char *file,
+                      const char *func, int line, const char *msg)
+{
+        _received++;
+}
+
+
+/** argument with side-effect */
+static int _arg()
+{
+        return ++_evaluated;
+}
+
+
+/** NftLogSiteFunc to find call-site by format string */
+static void _find_site(void *userdata, NftLogSite * site)
+{
+        if(site->format && strcmp(site->format, (const char *) userdata) == 0)
+                _found = site;
+}
+
+
+/** NftLogSiteFunc that switches off the call-site of _noisy() */
+static void _switch_off(void *userdata, NftLogSite * site)
+{
+        if(site->format && strcmp(site->format, "noisy %d") == 0)
+                nft_log_site_mode_set(site, NFT_LOG_SITE_OFF);
+}
+
+
+/** find call-site by format string */
+static NftLogSite *_site(const char *format)
+{
+        _found = NULL;
+        nft_log_sites_foreach(_find_site, (void *) format);
+        return _found;
+}
+
+
+/** noisy call-site */
+static void _noisy()
+{
+        NFT_LOG(L_NOISY, "noisy %d", _arg());
+}
+
+
+/** check amount of received messages and evaluated arguments */
+static bool _check(const char *what, int received, int evaluated)
+{
+        if(_received == received && _evaluated == evaluated)
+                return true;
+
+        fprintf(stderr, "%s: received %d (expected %d), evaluated %d "
+                "(expected %d)\n", what, _received, received, _evaluated,
+                evaluated);
+        return false;
+}
+
+
+int main(int argc, char *argv[])
+{
+        NFT_LOG_CHECK_VERSION;
+
+        nft_log_func_register(_log_func, NULL);
+        if(!nft_log_level_set(L_INFO))
+                return EXIT_FAILURE;
+
+        /* disabled statement must not evaluate its arguments */
+        NFT_LOG(L_DEBUG, "debug %d", _arg());
+        if(!_check("disabled", 0, 0))
+                return EXIT_FAILURE;
+
+        /* enabled statement */
+        NFT_LOG(L_INFO, "info %d", _arg());
+        if(!_check("enabled", 1, 1))
+                return EXIT_FAILURE;
+
+        /* loglevel that's not known at compile time */
+        volatile NftLoglevel l = L_DEBUG;
+        NFT_LOG(l, "runtime %d", _arg());
+        l = L_ERROR;
+        NFT_LOG(l, "runtime %d", _arg());
+        if(!_check("runtime loglevel", 2, 2))
+                return EXIT_FAILURE;
+
+        /* call-sites must be listed */
+        NftLogSite *s;
+        if(!(s = _site("noisy %d")) || s->level != L_NOISY || s->enabled)
+        {
+                fprintf(stderr, "call-site \"noisy %%d\" not found\n");
+                return EXIT_FAILURE;
+        }
+
+        /* switch on call-site */
+        nft_log_site_mode_set(s, NFT_LOG_SITE_ON);
+        _noisy();
+        if(!_check("forced on", 3, 3))
+                return EXIT_FAILURE;
+
+        /* switch off all call-sites of this file */
+        if(nft_log_sites_mode_set("sites.c", 0, NFT_LOG_SITE_OFF) < 5)
+        {
+                fprintf(stderr, "Failed to switch off call-sites\n");
+                return EXIT_FAILURE;
+        }
+        NFT_LOG(L_ERROR, "error %d", _arg());
+        _noisy();
+        if(!_check("forced off", 3, 3))
+                return EXIT_FAILURE;
+
+        /* back to default */
+        nft_log_sites_mode_set("sites.c", 0, NFT_LOG_SITE_DEFAULT);
+        nft_log_level_set(L_VERY_NOISY);
+        _noisy();
+        if(!_check("default", 4, 4))
+                return EXIT_FAILURE;
+
+        /* callback may change call-sites */
+        nft_log_sites_foreach(_switch_off, NULL);
+        _noisy();
+        if(!_check("switched off by callback", 4, 4))
+                return EXIT_FAILURE;
+
+        nft_log_sites_print();
+
+        return EXIT_SUCCESS;
+}
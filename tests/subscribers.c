@@ -0,0 +1,266 @@
+/*
+ * libniftylog - niftylight logging library
+ * Copyright (C) 2006-2014 Daniel Hiepler <daniel@niftylight.de>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+/**
+ * @file subscribers.c
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include "niftylog.h"
+
+
+/** what one subscriber received */
+struct Received
+{
+        /** amount of messages */
+        int count;
+        /** copy of last message */
+        NftLogMessage last;
+        char body[256];
+        char prefix[64];
+        /** body was \0 terminated & followed the prefix */
+        bool zero_copy;
+};
+
+
+/** marks userdata of subscribers that are still registered */
+#define MAGIC           0x5ab5c1beu
+
+
+/** messages received by legacy NftLogFunc */
+static int _legacy;
+/** true while _churn_logger() should log */
+static bool _churn_running;
+/** calls of _churn_subscriber() with freed userdata */
+static int _churn_errors;
+
+
+/** subscriber that records what it got */
+static void _subscriber(void *userdata, const NftLogMessage * m)
+{
+        struct Received *r = userdata;
+
+        r->count++;
+        r->last = *m;
+        snprintf(r->body, sizeof(r->body), "%.*s", (int) m->body_len,
+                 m->body);
+        snprintf(r->prefix, sizeof(r->prefix), "%.*s", (int) m->prefix_len,
+                 m->prefix);
+        r->zero_copy = m->body[m->body_len] == '\0' &&
+                m->prefix + m->prefix_len == m->body;
+}
+
+
+/** subscriber that checks its userdata is still valid */
+static void _churn_subscriber(void *userdata, const NftLogMessage * m)
+{
+        /* still valid a little later (gives unsubscribe a chance to 
+           return too early) */
+        volatile const unsigned int *magic = userdata;
+        for(int i = 0; i < 2 && *magic == MAGIC; i++)
+                sched_yield();
+        if(*magic != MAGIC)
+                __atomic_add_fetch(&_churn_errors, 1, __ATOMIC_RELAXED);
+}
+
+
+/** log until stopped */
+static void *_churn_logger(void *arg)
+{
+        while(__atomic_load_n(&_churn_running, __ATOMIC_ACQUIRE))
+                NFT_LOG(L_INFO, "churn");
+
+        return NULL;
+}
+
+
+/** legacy logging function */
+static void _func(void *userdata, NftLoglevel level, const char *file,
+                  const char *func, int line, const char *msg)
+{
+        _legacy++;
+}
+
+
+/** current time in nanoseconds since epoch */
+static uint64_t _now()
+{
+        struct timespec t;
+        clock_gettime(CLOCK_REALTIME, &t);
+        return (uint64_t) t.tv_sec * 1000000000ULL + (uint64_t) t.tv_nsec;
+}
+
+
+int main(int argc, char *argv[])
+{
+        NFT_LOG_CHECK_VERSION;
+
+        unsetenv(NFT_LOG_ENV_MECHANISM);
+        unsetenv(NFT_LOG_ENV_LEVEL);
+        nft_log_level_set(L_INFO);
+        nft_log_mechanism_set("null");
+
+        bool result = true;
+        struct Received all = { 0 }, errors = { 0 };
+
+        if(!nft_log_subscribe(_subscriber, &all, NFT_LOG_LEVELS_ALL) ||
+           !nft_log_subscribe(_subscriber, &errors,
+                              NFT_LOG_LEVELS_FROM(L_ERROR)))
+                return EXIT_FAILURE;
+        nft_log_func_register(_func, NULL);
+
+        /* message for the first subscriber only */
+        uint64_t before = _now();
+        NFT_LOG(L_INFO, "info %d", 1);
+        uint64_t after = _now();
+
+        if(all.count != 1 || errors.count != 0 || _legacy != 1 ||
+           strcmp(all.body, "info 1") != 0 || all.last.body_len != 6 ||
+           all.last.prefix_len != 0 || !all.zero_copy ||
+           all.last.level != L_INFO || strcmp(all.last.file, __FILE__) != 0 ||
+           strcmp(all.last.func, __func__) != 0 ||
+           all.last.time < before || all.last.time > after ||
+           all.last.tid != (unsigned long) syscall(SYS_gettid))
+        {
+                printf("info: count %d/%d/%d body \"%s\"\n", all.count,
+                       errors.count, _legacy, all.body);
+                result = false;
+        }
+
+        /* message for both (prefix split from body) */
+        uint64_t sequence = all.last.sequence;
+        nft_log(L_ERROR, __FILE__, __func__, __LINE__, "error %s", "two");
+
+        if(all.count != 2 || errors.count != 1 || _legacy != 2 ||
+           strcmp(errors.body, "error two") != 0 ||
+           strcmp(errors.prefix, "error: ") != 0 || !errors.zero_copy ||
+           all.last.sequence != sequence + 1 ||
+           errors.last.sequence != all.last.sequence)
+        {
+                printf("error: count %d/%d/%d body \"%s\" prefix \"%s\"\n",
+                       all.count, errors.count, _legacy, errors.body,
+                       errors.prefix);
+                result = false;
+        }
+
+        /* messages below current loglevel never reach subscribers */
+        NFT_LOG(L_DEBUG, "debug");
+        if(all.count != 2)
+        {
+                printf("filtered message passed to subscriber\n");
+                result = false;
+        }
+
+        /* ...even if a mechanism wants more verbose messages */
+        if(!nft_log_mechanism_set("null:debug"))
+                return EXIT_FAILURE;
+        NFT_LOG(L_DEBUG, "debug for mechanism");
+        nft_log(L_DEBUG, __FILE__, __func__, __LINE__, "debug for %s",
+                "mechanism");
+        if(all.count != 2 || _legacy != 2 || nft_log_level_get() != L_INFO)
+        {
+                printf("message for verbose mechanism passed to subscriber "
+                       "(count %d/%d)\n", all.count, _legacy);
+                result = false;
+        }
+        nft_log_mechanism_set("null");
+
+        /* unsubscribe */
+        if(!nft_log_unsubscribe(_subscriber, &all) ||
+           nft_log_unsubscribe(_subscriber, &all))
+                result = false;
+        nft_log_func_register(NULL, NULL);
+        NFT_LOG(L_ERROR, "after unsubscribe");
+        if(all.count != 2 || errors.count != 2 || _legacy != 2)
+        {
+                printf("unsubscribed function called\n");
+                result = false;
+        }
+
+        /* userdata may be freed as soon as unsubscribe returns */
+        pthread_t t;
+        __atomic_store_n(&_churn_running, true, __ATOMIC_RELEASE);
+        pthread_create(&t, NULL, _churn_logger, NULL);
+        for(int i = 0; i < 2000; i++)
+        {
+                unsigned int *magic;
+                if(!(magic = malloc(sizeof(*magic))))
+                        return EXIT_FAILURE;
+                *magic = MAGIC;
+                nft_log_subscribe(_churn_subscriber, magic,
+                                  NFT_LOG_LEVELS_ALL);
+                /* give the logging thread a chance to call us */
+                sched_yield();
+                nft_log_unsubscribe(_churn_subscriber, magic);
+                *magic = 0;
+                free(magic);
+        }
+        __atomic_store_n(&_churn_running, false, __ATOMIC_RELEASE);
+        pthread_join(t, NULL);
+        if(_churn_errors)
+        {
+                printf("%d calls after unsubscribe\n", _churn_errors);
+                result = false;
+        }
+
+        /* limited amount of subscribers */
+        int n;
+        for(n = 0; n < 100; n++)
+        {
+                if(!nft_log_subscribe(_subscriber, &all, 0))
+                        break;
+        }
+        if(n == 100)
+        {
+                printf("unlimited subscribers\n");
+                result = false;
+        }
+
+        return result ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,161 @@
+/*
+ * libniftylog - niftylight logging library
+ * Copyright (C) 2006-2014 Daniel Hiepler <daniel@niftylight.de>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/**
+ * @file switch.c
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "niftylog.h"
+
+
+/** amount of logging threads */
+#define THREADS         4
+/** messages per thread */
+#define MESSAGES        20000
+/** marker at beginning of each message */
+#define MARKER          "switch-test"
+
+
+/** temporary directory */
+static char _dir[] = "/tmp/niftylog-switch-XXXXXX";
+/** output of mechanisms */
+static char _file[64], _mmap[64];
+/** threads that are still logging */
+static int _running = THREADS;
+
+
+/** logging thread */
+static void *_thread(void *arg)
+{
+        for(int i = 0; i < MESSAGES; i++)
+                NFT_LOG(L_INFO, MARKER " %ld %d", (long) arg, i);
+
+        __atomic_sub_fetch(&_running, 1, __ATOMIC_RELEASE);
+        return NULL;
+}
+
+
+/** count messages in file */
+static int _count(const char *path)
+{
+        FILE *f;
+        if(!(f = fopen(path, "r")))
+        {
+                perror("fopen");
+                return -1;
+        }
+
+        int result = 0;
+        char line[256];
+        while(fgets(line, sizeof(line), f))
+        {
+                if(strstr(line, MARKER))
+                        result++;
+        }
+        fclose(f);
+
+        return result;
+}
+
+
+int main(int argc, char *argv[])
+{
+        NFT_LOG_CHECK_VERSION;
+
+        if(!mkdtemp(_dir))
+        {
+                perror("mkdtemp");
+                return EXIT_FAILURE;
+        }
+        snprintf(_file, sizeof(_file), "%s/file", _dir);
+        snprintf(_mmap, sizeof(_mmap), "%s/mmap", _dir);
+
+        unsetenv(NFT_LOG_ENV_MECHANISM);
+        unsetenv(NFT_LOG_ENV_LEVEL);
+        setenv("NFT_LOG_FILE", _file, 1);
+        setenv("NFT_LOG_MMAP_FILE", _mmap, 1);
+
+        if(!nft_log_mechanism_set("file:info"))
+                return EXIT_FAILURE;
+
+        pthread_t t[THREADS];
+        for(long i = 0; i < THREADS; i++)
+                pthread_create(&t[i], NULL, _thread, (void *) i);
+
+        /* exchange mechanisms and level while threads are logging. "file" 
+           stays active all the time, so it must get every message. */
+        const char *specs[] = { "file:info,null", "file:info,mmap:error",
+                "null,file:info", "file:info"
+        };
+        int switches = 0;
+        while(__atomic_load_n(&_running, __ATOMIC_ACQUIRE))
+        {
+                if(!nft_log_mechanism_set(specs[switches % 4]) ||
+                   !nft_log_level_set(switches % 2 ? L_ERROR : L_DEBUG))
+                        return EXIT_FAILURE;
+
+                switches++;
+        }
+
+        for(int i = 0; i < THREADS; i++)
+                pthread_join(t[i], NULL);
+
+        /* flush and close file */
+        nft_log_mechanism_set("null");
+
+        int count = _count(_file);
+        bool result = (count == THREADS * MESSAGES);
+        printf("%d switches, %d of %d messages\n", switches, count,
+               THREADS * MESSAGES);
+
+        unlink(_file);
+        unlink(_mmap);
+        rmdir(_dir);
+
+        return result ? EXIT_SUCCESS : EXIT_FAILURE;
+}
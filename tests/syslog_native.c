@@ -0,0 +1,254 @@
+/*
+ * libniftylog - niftylight logging library
+ * Copyright (C) 2006-2014 Daniel Hiepler <daniel@niftylight.de>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+/**
+ * @file syslog_native.c
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "niftylog.h"
+
+
+/** size of datagrams the server receives */
+#define DATAGRAM_SIZE   8192
+
+
+/** temporary directory */
+static char _dir[] = "/tmp/niftylog-syslog-XXXXXX";
+/** socket of our "syslog daemon" */
+static struct sockaddr_un _addr;
+/** server socket */
+static int _fd = -1;
+
+
+/** receive all pending datagrams, return amount */
+static int _receive(char datagrams[][DATAGRAM_SIZE], int max)
+{
+        int count = 0;
+        ssize_t n;
+        char buf[DATAGRAM_SIZE];
+
+        while((n = recv(_fd, buf, sizeof(buf) - 1, MSG_DONTWAIT)) >= 0)
+        {
+                buf[n] = '\0';
+                if(count < max)
+                        strcpy(datagrams[count], buf);
+                count++;
+        }
+
+        return count;
+}
+
+
+/** check RFC 5424 framing */
+static bool _check_5424(const char *d, int pri, const char *msg)
+{
+        int p, version, pid, n = 0;
+        char stamp[64], host[256], app[64];
+        char hostname[256] = "";
+        gethostname(hostname, sizeof(hostname));
+
+        if(sscanf(d, "<%d>%d %63s %255s %63s %d - - %n", &p, &version,
+                  stamp, host, app, &pid, &n) != 6 || n == 0 ||
+           p != pri || version != 1 || strlen(stamp) != 27 ||
+           stamp[10] != 'T' || stamp[19] != '.' || stamp[26] != 'Z' ||
+           strcmp(host, hostname) != 0 || strcmp(app, "test-ident") != 0 ||
+           pid != (int) getpid() || strcmp(d + n, msg) != 0)
+        {
+                fprintf(stderr, "unexpected datagram \"%s\"\n", d);
+                return false;
+        }
+
+        return true;
+}
+
+
+/** check RFC 3164 framing */
+static bool _check_3164(const char *d, int pri, const char *msg)
+{
+        int p, day, h, m, s, pid, n = 0;
+        char month[4];
+
+        if(sscanf(d, "<%d>%3s %d %d:%d:%d test-ident[%d]: %n", &p, month,
+                  &day, &h, &m, &s, &pid, &n) != 7 || n == 0 || p != pri ||
+           pid != (int) getpid() || strcmp(d + n, msg) != 0 ||
+           d[strcspn(d, ">") + 4] != ' ')
+        {
+                fprintf(stderr, "unexpected datagram \"%s\"\n", d);
+                return false;
+        }
+
+        return true;
+}
+
+
+int main(int argc, char *argv[])
+{
+        NFT_LOG_CHECK_VERSION;
+
+        if(!mkdtemp(_dir))
+        {
+                perror("mkdtemp");
+                return EXIT_FAILURE;
+        }
+
+        /* local syslog daemon */
+        _addr.sun_family = AF_UNIX;
+        snprintf(_addr.sun_path, sizeof(_addr.sun_path), "%s/log", _dir);
+        if((_fd = socket(AF_UNIX, SOCK_DGRAM, 0)) < 0 ||
+           bind(_fd, (struct sockaddr *) &_addr, sizeof(_addr)) != 0)
+        {
+                perror("socket");
+                return EXIT_FAILURE;
+        }
+
+        setenv("NFT_LOG_SYSLOG_SOCKET", _addr.sun_path, 1);
+        setenv("NFT_LOG_IDENT", "test-ident", 1);
+        setenv("NFT_LOG_SYSLOG_BATCH", "8", 1);
+        setenv("NFT_LOG_SYSLOG_FLUSH", "60000", 1);
+        nft_log_level_set(L_INFO);
+
+        bool result = true;
+        static char d[64][DATAGRAM_SIZE];
+        char msg[64];
+        int n;
+
+        /* RFC 5424 */
+        setenv("NFT_LOG_SYSLOG_FORMAT", "5424", 1);
+        if(!nft_log_mechanism_set("syslog-native"))
+                return EXIT_FAILURE;
+
+        /* messages are queued until the batch is full */
+        for(int i = 0; i < 7; i++)
+                NFT_LOG(L_INFO, "message %d", i);
+        if((n = _receive(d, 64)) != 0)
+        {
+                fprintf(stderr, "%d datagrams sent before batch was full\n",
+                        n);
+                result = false;
+        }
+
+        NFT_LOG(L_INFO, "message %d", 7);
+        if((n = _receive(d, 64)) != 8)
+        {
+                fprintf(stderr, "received %d datagrams instead of 8\n", n);
+                result = false;
+        }
+        for(int i = 0; i < n && i < 8; i++)
+        {
+                snprintf(msg, sizeof(msg), "message %d", i);
+                result = _check_5424(d[i], 8 + 6, msg) && result;
+        }
+
+        /* warnings are sent immediately (together with queued messages) */
+        NFT_LOG(L_NOTICE, "notice");
+        NFT_LOG(L_ERROR, "error");
+        if((n = _receive(d, 64)) != 2)
+        {
+                fprintf(stderr, "received %d datagrams instead of 2\n", n);
+                result = false;
+        }
+        else
+        {
+                result = _check_5424(d[0], 8 + 5, "notice") &&
+                        _check_5424(d[1], 8 + 3, "error: error") && result;
+        }
+
+        /* RFC 3164 (queue is sent when mechanism is deinitialized) */
+        nft_log_mechanism_set("null");
+        setenv("NFT_LOG_SYSLOG_FORMAT", "3164", 1);
+        if(!nft_log_mechanism_set("syslog-native"))
+                return EXIT_FAILURE;
+
+        /* receive in between, sender blocks when more than 
+           net.unix.max_dgram_qlen (default: 10) datagrams are pending */
+        for(int i = 0; i < 10; i++)
+                NFT_LOG(L_INFO, "message %d", i);
+        n = _receive(d, 64);
+        nft_log_mechanism_set("null");
+        n += _receive(d + n, 64 - n);
+
+        if(n != 10)
+        {
+                fprintf(stderr, "received %d datagrams instead of 10\n", n);
+                result = false;
+        }
+        for(int i = 0; i < n && i < 10; i++)
+        {
+                snprintf(msg, sizeof(msg), "message %d", i);
+                result = _check_3164(d[i], 8 + 6, msg) && result;
+        }
+
+        /* queued messages are sent after the flush interval even if no
+           further message is logged */
+        setenv("NFT_LOG_SYSLOG_FLUSH", "50", 1);
+        if(!nft_log_mechanism_set("syslog-native"))
+                return EXIT_FAILURE;
+        NFT_LOG(L_INFO, "lone message");
+        usleep(300000);
+        if((n = _receive(d, 64)) != 1)
+        {
+                fprintf(stderr, "received %d datagrams instead of 1 after "
+                        "flush interval\n", n);
+                result = false;
+        }
+        nft_log_mechanism_set("null");
+
+        /* connecting to missing daemon fails */
+        setenv("NFT_LOG_SYSLOG_SOCKET", "/nonexistent/log", 1);
+        if(nft_log_mechanism_set("syslog-native"))
+        {
+                fprintf(stderr, "connected to nonexistent socket\n");
+                result = false;
+        }
+
+        close(_fd);
+        unlink(_addr.sun_path);
+        rmdir(_dir);
+
+        return result ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,152 @@
+/*
+ * libniftylog - niftylight logging library
+ * Copyright (C) 2006-2014 Daniel Hiepler <daniel@niftylight.de>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/**
+ * @file thread.c
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include "niftylog.h"
+#include "_test.h"
+
+
+/** thread named by the kernel */
+static void *_worker(void *arg)
+{
+        bool *result = arg;
+        char s[64];
+
+        pthread_setname_np(pthread_self(), "worker7");
+
+        nft_log_thread_set(NFT_LOG_THREAD_NAME);
+        NFT_LOG(L_INFO, "from worker");
+        nft_log_async_flush();
+        *result &= _test_line("[worker7] from worker");
+
+        /* name for logging only */
+        nft_log_thread_name_set("renamed");
+        NFT_LOG(L_INFO, "renamed worker");
+        nft_log_async_flush();
+        *result &= _test_line("[renamed] renamed worker");
+
+        /* formatted by writer thread */
+        nft_log_thread_set(NFT_LOG_THREAD_ALL);
+        nft_log_async_defer(true);
+        NFT_LOG(L_INFO, "deferred %d", 1);
+        nft_log_async_flush();
+        snprintf(s, sizeof(s), "[%ld renamed] deferred 1",
+                 (long) syscall(SYS_gettid));
+        *result &= _test_line(s);
+        nft_log_async_defer(false);
+
+        return NULL;
+}
+
+
+int main(int argc, char *argv[])
+{
+        if(!_test_capture("thread"))
+                return EXIT_FAILURE;
+
+        unsetenv(NFT_LOG_ENV_MECHANISM);
+        unsetenv(NFT_LOG_ENV_LEVEL);
+        unsetenv(NFT_LOG_ENV_THREAD);
+        unsetenv(NFT_LOG_ENV_TIMESTAMP);
+        nft_log_level_set(L_INFO);
+
+        bool result = true;
+        char s[64];
+
+        /* disabled by default */
+        NFT_LOG(L_INFO, "no thread info");
+        result &= _test_line("no thread info");
+
+        nft_log_thread_set(NFT_LOG_THREAD_ID);
+        NFT_LOG(L_INFO, "by id");
+        snprintf(s, sizeof(s), "[%ld] by id", (long) syscall(SYS_gettid));
+        result &= _test_line(s);
+
+        /* forked child logs with its own id */
+        pid_t pid;
+        if((pid = fork()) == 0)
+        {
+                NFT_LOG(L_INFO, "forked");
+                exit(EXIT_SUCCESS);
+        }
+        waitpid(pid, NULL, 0);
+        snprintf(s, sizeof(s), "[%ld] forked", (long) pid);
+        result &= _test_line(s);
+
+        nft_log_thread_name_set("main-log");
+        nft_log_thread_set(NFT_LOG_THREAD_ALL);
+        NFT_LOG(L_ERROR, "by id & name");
+        snprintf(s, sizeof(s), "[%ld main-log] error: by id & name",
+                 (long) syscall(SYS_gettid));
+        result &= _test_line(s);
+
+        if(strcmp(nft_log_thread_name_get(), "main-log") != 0)
+        {
+                fprintf(stdout, "wrong name \"%s\"\n",
+                        nft_log_thread_name_get());
+                result = false;
+        }
+
+        if(!nft_log_async_enable(NFT_LOG_ASYNC_BLOCK, 0))
+                return EXIT_FAILURE;
+
+        pthread_t t;
+        pthread_create(&t, NULL, _worker, &result);
+        pthread_join(t, NULL);
+
+        nft_log_async_disable();
+        unlink(_test_path);
+
+        return result ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,170 @@
+/*
+ * libniftylog - niftylight logging library
+ * Copyright (C) 2006-2014 Daniel Hiepler <daniel@niftylight.de>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/**
+ * @file timestamp.c
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include "niftylog.h"
+#include "_test.h"
+
+
+/** find line ending with string */
+static bool _line(const char *s, char *line, size_t size)
+{
+        if(_test_find(TEST_ENDS, s, line, size))
+                return true;
+
+        fprintf(stdout, "\"%s\" missing\n", s);
+        return false;
+}
+
+
+/** check wall-clock timestamp with a certain amount of fraction digits */
+static bool _check_wall(const char *s, int digits)
+{
+        char line[256];
+        if(!_line(s, line, sizeof(line)))
+                return false;
+
+        struct tm tm = {.tm_isdst = -1 };
+        int n = 0;
+        if(sscanf(line, "%4d-%2d-%2d %2d:%2d:%2d%n", &tm.tm_year, &tm.tm_mon,
+                  &tm.tm_mday, &tm.tm_hour, &tm.tm_min, &tm.tm_sec, &n) != 6)
+        {
+                fprintf(stdout, "no timestamp: \"%s\"\n", line);
+                return false;
+        }
+        tm.tm_year -= 1900;
+        tm.tm_mon -= 1;
+
+        /* fraction */
+        int f = 0;
+        if(digits)
+        {
+                if(line[n] != '.')
+                {
+                        fprintf(stdout, "no fraction: \"%s\"\n", line);
+                        return false;
+                }
+                while(line[n + 1 + f] >= '0' && line[n + 1 + f] <= '9')
+                        f++;
+                n += f + 1;
+        }
+
+        double dif = difftime(time(NULL), mktime(&tm));
+        if(f != digits || line[n] != ' ' || dif < -2 || dif > 5)
+        {
+                fprintf(stdout, "wrong timestamp: \"%s\"\n", line);
+                return false;
+        }
+
+        return true;
+}
+
+
+int main(int argc, char *argv[])
+{
+        if(!_test_capture("timestamp"))
+                return EXIT_FAILURE;
+
+        unsetenv(NFT_LOG_ENV_MECHANISM);
+        unsetenv(NFT_LOG_ENV_LEVEL);
+        unsetenv(NFT_LOG_ENV_TIMESTAMP);
+        nft_log_level_set(L_INFO);
+
+        bool result = true;
+        char line[256];
+
+        /* disabled by default */
+        NFT_LOG(L_INFO, "ts-off");
+        result &= _line("ts-off", line, sizeof(line)) &&
+                strcmp(line, "ts-off") == 0;
+
+        nft_log_timestamp_set(NFT_LOG_TIMESTAMP_SEC);
+        NFT_LOG(L_INFO, "ts-sec");
+        result &= _check_wall("ts-sec", 0);
+
+        nft_log_timestamp_set(NFT_LOG_TIMESTAMP_MSEC);
+        NFT_LOG(L_INFO, "ts-msec");
+        NFT_LOG(L_ERROR, "ts-error");
+        result &= _check_wall("ts-msec", 3);
+        result &= _check_wall("error: ts-error", 3);
+
+        nft_log_timestamp_set(NFT_LOG_TIMESTAMP_USEC);
+        NFT_LOG(L_INFO, "ts-usec");
+        result &= _check_wall("ts-usec", 6);
+
+        /* seconds since boot */
+        nft_log_timestamp_set(NFT_LOG_TIMESTAMP_MONOTONIC);
+        NFT_LOG(L_INFO, "ts-monotonic");
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        long long sec;
+        int usec;
+        if(!_line("ts-monotonic", line, sizeof(line)) ||
+           sscanf(line, "%lld.%6d ", &sec, &usec) != 2 ||
+           sec > now.tv_sec || sec < now.tv_sec - 2)
+        {
+                fprintf(stdout, "wrong monotonic timestamp: \"%s\"\n", line);
+                result = false;
+        }
+
+        /* environment wins */
+        setenv(NFT_LOG_ENV_TIMESTAMP, "sec", 1);
+        nft_log_timestamp_set(NFT_LOG_TIMESTAMP_OFF);
+        if(nft_log_timestamp_get() != NFT_LOG_TIMESTAMP_SEC)
+        {
+                fprintf(stdout, "environment ignored\n");
+                result = false;
+        }
+
+        unlink(_test_path);
+
+        return result ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,444 @@
+/*
+ * libniftylog - niftylight logging library
+ * Copyright (C) 2006-2014 Daniel Hiepler <daniel@niftylight.de>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+/**
+ * @file nftlog-decode.c
+ * @brief convert files written by the "binary" logging mechanism to text
+ */
+
+#define _XOPEN_SOURCE 700
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include "niftylog.h"
+#include "_capture.h"
+#include "_logger.h"
+#include "_binary.h"
+
+
+/** maximum length of strings in dictionary entries */
+#define MAX_STRING_SIZE         65536
+
+
+/** call-site read from dictionary */
+struct Site
+{
+        char *file;
+        char *func;
+        char *format;
+        int line;
+};
+
+
+/** options */
+static struct
+{
+        /** minimum loglevel */
+        NftLoglevel level;
+        /** only messages logged at or after this time (ns) */
+        uint64_t after;
+        /** only messages logged before this time (ns) */
+        uint64_t before;
+        /** print timestamp & thread-id */
+        bool timestamps;
+} _opts = {
+        .level = L_MAX,
+        .after = 0,
+        .before = UINT64_MAX,
+        .timestamps = false,
+};
+
+
+/** call-site dictionary (indexed by id) */
+static struct Site *_sites;
+/** amount of entries in _sites */
+static size_t _sites_size;
+
+
+
+
+/** print help text */
+static void _usage(const char *name)
+{
+        printf("Usage: %s [options] [file...]\n\n"
+               "Convert log written by the \"binary\" logging mechanism "
+               "to text.\nReads stdin if no file is given.\n\n"
+               "  -l <level>    only print messages with this loglevel or "
+               "higher\n"
+               "  -a <time>     only print messages logged at or after "
+               "<time>\n"
+               "  -b <time>     only print messages logged before <time>\n"
+               "  -t            print timestamp and thread-id\n"
+               "  -h            this help\n\n"
+               "<time> is either seconds since epoch or "
+               "\"YYYY-MM-DD HH:MM:SS\" (local time)\n"
+               "valid loglevels: ", name);
+        nft_log_print_loglevels();
+        printf("\n");
+}
+
+
+/** parse time argument */
+static bool _parse_time(const char *s, uint64_t * ns)
+{
+        /* seconds since epoch? */
+        char *end;
+        double seconds = strtod(s, &end);
+        if(end != s && *end == '\0' && seconds >= 0)
+        {
+                *ns = (uint64_t) (seconds * 1e9);
+                return true;
+        }
+
+        /* date & time */
+        struct tm tm;
+        memset(&tm, 0, sizeof(tm));
+        if(!(end = strptime(s, "%Y-%m-%d %H:%M:%S", &tm)) || *end != '\0')
+        {
+                fprintf(stderr, "Invalid time: \"%s\"\n", s);
+                return false;
+        }
+        tm.tm_isdst = -1;
+
+        time_t t;
+        if((t = mktime(&tm)) < 0)
+        {
+                fprintf(stderr, "Invalid time: \"%s\"\n", s);
+                return false;
+        }
+
+        *ns = (uint64_t) t * 1000000000ULL;
+        return true;
+}
+
+
+/** forget all call-sites */
+static void _sites_clear()
+{
+        for(size_t i = 0; i < _sites_size; i++)
+        {
+                free(_sites[i].file);
+                free(_sites[i].func);
+                free(_sites[i].format);
+        }
+        free(_sites);
+        _sites = NULL;
+        _sites_size = 0;
+}
+
+
+/** read \0 terminated string of given length */
+static char *_read_string(FILE * f, uint32_t len)
+{
+        if(len == 0 || len > MAX_STRING_SIZE)
+                return NULL;
+
+        char *s;
+        if(!(s = malloc(len)))
+        {
+                perror("malloc");
+                return NULL;
+        }
+
+        if(fread(s, len, 1, f) != 1 || s[len - 1] != '\0')
+        {
+                free(s);
+                return NULL;
+        }
+
+        return s;
+}
+
+
+/** read & check header (type byte already consumed) */
+static bool _read_header(FILE * f, uint8_t first)
+{
+        BinaryHeader h;
+        ((uint8_t *) & h)[0] = first;
+        if(fread((uint8_t *) & h + 1, sizeof(h) - 1, 1, f) != 1 ||
+           memcmp(h.magic, BINARY_MAGIC, sizeof(h.magic)) != 0)
+        {
+                fprintf(stderr, "Invalid header\n");
+                return false;
+        }
+
+        if(h.version != BINARY_VERSION)
+        {
+                fprintf(stderr, "Unsupported version: %u\n",
+                        (unsigned int) h.version);
+                return false;
+        }
+
+        uint8_t sizes[] = BINARY_SIZES;
+        if(h.byteorder != BINARY_BYTEORDER ||
+           memcmp(h.sizes, sizes, sizeof(sizes)) != 0)
+        {
+                fprintf(stderr,
+                        "Log was written on a host with different ABI\n");
+                return false;
+        }
+
+        /* new dictionary starts */
+        _sites_clear();
+
+        return true;
+}
+
+
+/** read dictionary entry (type byte already consumed) */
+static bool _read_site(FILE * f)
+{
+        BinarySite s;
+        if(fread((uint8_t *) & s + 1, sizeof(s) - 1, 1, f) != 1 || s.id == 0)
+                return false;
+
+        if(s.id >= _sites_size)
+        {
+                size_t size = (size_t) s.id * 2;
+                struct Site *sites;
+                if(!(sites = realloc(_sites, size * sizeof(struct Site))))
+                {
+                        perror("realloc");
+                        return false;
+                }
+                memset(&sites[_sites_size], 0,
+                       (size - _sites_size) * sizeof(struct Site));
+                _sites = sites;
+                _sites_size = size;
+        }
+
+        struct Site *site = &_sites[s.id];
+        free(site->file);
+        free(site->func);
+        free(site->format);
+        site->line = s.line;
+        site->file = _read_string(f, s.file_len);
+        site->func = _read_string(f, s.func_len);
+        site->format = _read_string(f, s.format_len);
+
+        return site->file && site->func && site->format;
+}
+
+
+/** read & print message (type byte already consumed) */
+static bool _read_message(FILE * f)
+{
+        BinaryMessage m;
+        if(fread((uint8_t *) & m + 1, sizeof(m) - 1, 1, f) != 1 ||
+           m.len >= MAX_MSG_SIZE)
+                return false;
+
+        char data[MAX_MSG_SIZE];
+        if(m.len && fread(data, m.len, 1, f) != 1)
+                return false;
+
+        /* filter */
+        if((NftLoglevel) m.level < _opts.level ||
+           m.time < _opts.after || m.time >= _opts.before)
+                return true;
+
+        if(_opts.timestamps)
+        {
+                time_t t = (time_t) (m.time / 1000000000ULL);
+                struct tm tm;
+                char date[32];
+                strftime(date, sizeof(date), "%Y-%m-%d %H:%M:%S",
+                         localtime_r(&t, &tm));
+                printf("%s.%06lu [%lu] ", date,
+                       (unsigned long) (m.time % 1000000000ULL / 1000),
+                       (unsigned long) m.tid);
+        }
+
+        /* preformatted text */
+        if(m.site == 0)
+        {
+                printf("%.*s\n", (int) m.len, data);
+                return true;
+        }
+
+        if(m.site >= _sites_size || !_sites[m.site].format)
+        {
+                fprintf(stderr, "Unknown call-site: %u\n",
+                        (unsigned int) m.site);
+                return false;
+        }
+
+        struct Site *s = &_sites[m.site];
+        char msg[MAX_MSG_SIZE];
+        if(_capture_render(msg, sizeof(msg), s->format, data, m.len) < 0)
+        {
+                fprintf(stderr, "Invalid arguments for \"%s\"\n", s->format);
+                return false;
+        }
+
+        const char *level = nft_log_level_to_string((NftLoglevel) m.level);
+        printf("%s:%d %s() %s: %s\n", s->file, s->line, s->func,
+               level ? level : "invalid", msg);
+
+        return true;
+}
+
+
+/** decode one file */
+static bool _decode(FILE * f, const char *name)
+{
+        bool header = false;
+        int c;
+        while((c = fgetc(f)) != EOF)
+        {
+                bool ok;
+                switch (c)
+                {
+                        case BINARY_SITE:
+                        {
+                                ok = header && _read_site(f);
+                                break;
+                        }
+
+                        case BINARY_MESSAGE:
+                        {
+                                ok = header && _read_message(f);
+                                break;
+                        }
+
+                        default:
+                        {
+                                ok = header = _read_header(f, (uint8_t) c);
+                                break;
+                        }
+                }
+
+                if(!ok)
+                {
+                        fprintf(stderr, "%s: corrupt record at offset %ld\n",
+                                name, ftell(f));
+                        return false;
+                }
+        }
+
+        return true;
+}
+
+
+int main(int argc, char *argv[])
+{
+        int opt;
+        while((opt = getopt(argc, argv, "l:a:b:th")) != -1)
+        {
+                switch (opt)
+                {
+                        case 'l':
+                        {
+                                if((_opts.level =
+                                    nft_log_level_from_string(optarg)) ==
+                                   L_INVALID)
+                                        return EXIT_FAILURE;
+                                break;
+                        }
+
+                        case 'a':
+                        {
+                                if(!_parse_time(optarg, &_opts.after))
+                                        return EXIT_FAILURE;
+                                break;
+                        }
+
+                        case 'b':
+                        {
+                                if(!_parse_time(optarg, &_opts.before))
+                                        return EXIT_FAILURE;
+                                break;
+                        }
+
+                        case 't':
+                        {
+                                _opts.timestamps = true;
+                                break;
+                        }
+
+                        case 'h':
+                        {
+                                _usage(argv[0]);
+                                return EXIT_SUCCESS;
+                        }
+
+                        default:
+                        {
+                                _usage(argv[0]);
+                                return EXIT_FAILURE;
+                        }
+                }
+        }
+
+        bool result = true;
+
+        /* read stdin */
+        if(optind >= argc)
+        {
+                result = _decode(stdin, "stdin");
+        }
+        /* read files */
+        else
+        {
+                for(int i = optind; i < argc; i++)
+                {
+                        FILE *f;
+                        if(!(f = fopen(argv[i], "rb")))
+                        {
+                                fprintf(stderr, "%s: ", argv[i]);
+                                perror("fopen");
+                                result = false;
+                                continue;
+                        }
+
+                        result = _decode(f, argv[i]) && result;
+                        fclose(f);
+                }
+        }
+
+        _sites_clear();
+
+        return result ? EXIT_SUCCESS : EXIT_FAILURE;
+}